@@ -0,0 +1,98 @@
+#include "../include/BerTlv.h"
+
+namespace {
+    const size_t MAX_TAG_BYTES = 3;
+    const size_t MAX_LENGTH_BYTES = 4;
+}
+
+TlvReader::TlvReader(std::string_view data) : data(data), position(0), failed(false) {}
+
+bool TlvReader::next(TlvElement& element) {
+    if (failed || atEnd()) {
+        return false;
+    }
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t size = data.size();
+    size_t at = position;
+
+    // Tag: low five bits all set means more bytes follow, each with the
+    // top bit set but the last
+    uint32_t tag = bytes[at++];
+    const bool constructed = (tag & 0x20) != 0;
+    if ((tag & 0x1F) == 0x1F) {
+        size_t tagBytes = 1;
+        do {
+            if (at == size || ++tagBytes > MAX_TAG_BYTES) {
+                failed = true;
+                return false;
+            }
+            tag = (tag << 8) | bytes[at];
+        } while (bytes[at++] & 0x80);
+    }
+
+    if (at == size) {
+        failed = true;
+        return false;
+    }
+    size_t length = bytes[at++];
+    if (length & 0x80) {
+        const size_t lengthBytes = length & 0x7F;
+        if (lengthBytes == 0 || lengthBytes > MAX_LENGTH_BYTES || size - at < lengthBytes) {
+            failed = true;
+            return false;
+        }
+        length = 0;
+        for (size_t i = 0; i < lengthBytes; ++i) {
+            length = (length << 8) | bytes[at++];
+        }
+    }
+    if (size - at < length) {
+        failed = true;
+        return false;
+    }
+
+    element.tag = tag;
+    element.constructed = constructed;
+    element.value = data.substr(at, length);
+    element.encoded = data.substr(position, at + length - position);
+    position = at + length;
+    return true;
+}
+
+bool TlvReader::find(uint32_t tag, TlvElement& element) {
+    while (next(element)) {
+        if (element.tag == tag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TlvReader::parse(std::string_view data, TlvElement& element) {
+    TlvReader reader(data);
+    return reader.next(element);
+}
+
+void TlvReader::append(std::string& out, uint32_t tag, std::string_view value) {
+    for (int shift = 16; shift > 0; shift -= 8) {
+        if (tag >> shift) {
+            out.push_back(static_cast<char>(tag >> shift));
+        }
+    }
+    out.push_back(static_cast<char>(tag));
+
+    const size_t length = value.size();
+    if (length < 0x80) {
+        out.push_back(static_cast<char>(length));
+    } else {
+        size_t lengthBytes = 1;
+        while (lengthBytes < MAX_LENGTH_BYTES && (length >> (lengthBytes * 8))) {
+            ++lengthBytes;
+        }
+        out.push_back(static_cast<char>(0x80 | lengthBytes));
+        for (size_t i = lengthBytes; i > 0; --i) {
+            out.push_back(static_cast<char>(length >> ((i - 1) * 8)));
+        }
+    }
+    out.append(value);
+}
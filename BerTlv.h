@@ -0,0 +1,42 @@
+#ifndef BER_TLV_H
+#define BER_TLV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct TlvElement {
+    uint32_t tag;                // tag bytes as read, e.g. 0x5F1F
+    bool constructed;            // value holds further elements
+    std::string_view value;
+    std::string_view encoded;    // tag, length and value
+};
+
+// BER-TLV as used by the ICAO LDS files on the passport chip. Tags take
+// one to three bytes, lengths the short form or 0x81-0x84; indefinite
+// lengths are not used by the LDS and are rejected. Elements are views
+// into the reader's buffer, nothing is copied.
+class TlvReader {
+private:
+    std::string_view data;
+    size_t position;
+    bool failed;
+
+public:
+    explicit TlvReader(std::string_view data);
+
+    // The next element at this level; false at the end or on malformed
+    // input (hasError() tells which)
+    bool next(TlvElement& element);
+    // Skips to the next element with the tag
+    bool find(uint32_t tag, TlvElement& element);
+    bool atEnd() const { return position == data.size(); }
+    bool hasError() const { return failed; }
+
+    // The element at the start of data
+    static bool parse(std::string_view data, TlvElement& element);
+    static void append(std::string& out, uint32_t tag, std::string_view value);
+};
+
+#endif // BER_TLV_H
@@ -0,0 +1,119 @@
+#include "../include/BinaryLogReader.h"
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+BinaryLogReader::BinaryLogReader(std::istream& in) :
+    in(in), haveSession(false), steadyBase(0), wallBase(0), offset(0) {}
+
+BinaryLogReader::Status BinaryLogReader::next(BinaryLogRecord& record) {
+    const size_t headerSize = offsetof(BinaryLogRecord, args);
+    in.read(reinterpret_cast<char*>(&record), headerSize);
+    if (in.gcount() == 0) {
+        return END;
+    }
+    if (static_cast<size_t>(in.gcount()) < headerSize) {
+        return TRUNCATED;
+    }
+    if (record.argCount > BINARY_LOG_MAX_ARGS) {
+        return CORRUPT;
+    }
+    const size_t argumentSize = record.argCount * sizeof(BinaryLogRecord::Argument);
+    if (!in.read(reinterpret_cast<char*>(record.args), argumentSize)) {
+        return TRUNCATED;
+    }
+
+    if (record.messageId == MSG_SESSION_START) {
+        if (record.argCount < 3 || record.args[0].intValue != BINARY_LOG_MAGIC) {
+            return NOT_A_LOG;
+        }
+        if (record.args[1].intValue != BINARY_LOG_VERSION) {
+            return UNSUPPORTED_VERSION;
+        }
+        haveSession = true;
+        steadyBase = record.timestamp;
+        wallBase = record.args[2].intValue;
+    } else if (!haveSession) {
+        return NO_SESSION;
+    }
+    offset += headerSize + argumentSize;
+    return RECORD;
+}
+
+int64_t BinaryLogReader::wallClock(const BinaryLogRecord& record) const {
+    return wallBase + (record.timestamp - steadyBase);
+}
+
+const char* BinaryLogReader::levelName(uint8_t level) {
+    switch (level) {
+        case 0:  return "DEBUG";
+        case 1:  return "INFO";
+        case 2:  return "WARNING";
+        case 3:  return "ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+std::string BinaryLogReader::formatArgument(const BinaryLogRecord& record, int index) {
+    const auto& arg = record.args[index];
+    switch (record.argTypes[index]) {
+        case ARG_INT:
+            return std::to_string(arg.intValue);
+        case ARG_DOUBLE: {
+            std::ostringstream ss;
+            ss << std::fixed << std::setprecision(2) << arg.doubleValue;
+            return ss.str();
+        }
+        case ARG_TEXT: {
+            size_t length = 0;
+            while (length < BINARY_LOG_TEXT_SIZE && arg.text[length] != '\0') {
+                ++length;
+            }
+            return std::string(arg.text, length);
+        }
+        default:
+            return "?";
+    }
+}
+
+std::string BinaryLogReader::renderMessage(const BinaryLogRecord& record) {
+    const char* format = logMessageFormat(record.messageId);
+    std::string out;
+    int next = 0;
+
+    if (!format) {
+        // Unknown id (newer catalog): print the raw arguments
+        out = "message " + std::to_string(record.messageId);
+        for (int i = 0; i < record.argCount; ++i) {
+            out += " " + formatArgument(record, i);
+        }
+        return out;
+    }
+
+    for (const char* p = format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            out += next < record.argCount ? formatArgument(record, next) : "{}";
+            ++next;
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+    return out;
+}
+
+std::string BinaryLogReader::formatWallClock(int64_t wallNs) {
+    std::time_t seconds = static_cast<std::time_t>(wallNs / 1000000000);
+    int millis = static_cast<int>((wallNs / 1000000) % 1000);
+
+    std::tm localTime;
+#ifdef _WIN32
+    localtime_s(&localTime, &seconds);
+#else
+    localtime_r(&seconds, &localTime);
+#endif
+    std::ostringstream ss;
+    ss << std::put_time(&localTime, "%Y-%m-%d %H:%M:%S") << '.'
+       << std::setw(3) << std::setfill('0') << millis;
+    return ss.str();
+}
@@ -0,0 +1,47 @@
+#ifndef BINARY_LOG_READER_H
+#define BINARY_LOG_READER_H
+
+#include "LogRecord.h"
+#include <cstdint>
+#include <istream>
+#include <string>
+
+// Reads back the structured binary log written by Logger::logBinary()
+// (format in LogRecord.h), record by record; logdecoder renders what it
+// returns as text.
+class BinaryLogReader {
+public:
+    enum Status {
+        RECORD,                // record filled in
+        END,                   // clean end of the log
+        TRUNCATED,             // the last record is cut short; nothing follows
+        CORRUPT,               // argument count out of range
+        NOT_A_LOG,             // session record with the wrong magic
+        UNSUPPORTED_VERSION,
+        NO_SESSION             // a record before any session record
+    };
+
+private:
+    std::istream& in;
+    bool haveSession;
+    int64_t steadyBase;   // steady clock of the current session record
+    int64_t wallBase;     // wall clock at that steady time
+    uint64_t offset;      // of the next record
+
+public:
+    explicit BinaryLogReader(std::istream& in);
+
+    Status next(BinaryLogRecord& record);
+    // Byte offset of the record next() returns next
+    uint64_t getOffset() const { return offset; }
+    // Wall clock of a record, ns since the epoch, through the session record
+    int64_t wallClock(const BinaryLogRecord& record) const;
+
+    static const char* levelName(uint8_t level);
+    static std::string formatArgument(const BinaryLogRecord& record, int index);
+    // The catalog format with "{}" replaced by the arguments
+    static std::string renderMessage(const BinaryLogRecord& record);
+    static std::string formatWallClock(int64_t wallNs);
+};
+
+#endif // BINARY_LOG_READER_H
@@ -0,0 +1,58 @@
+#ifndef COUNTRY_CODE_H
+#define COUNTRY_CODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Three-letter ICAO country codes packed into 16 bits. Letters are A-Z and
+// the filler '<' (e.g. "D<<" for Germany), so each position has 27 values.
+// 0 is reserved for "no / invalid code", valid codes are 1..COUNTRY_CODE_SLOTS-1.
+const uint16_t INVALID_COUNTRY_CODE = 0;
+const size_t COUNTRY_CODE_SLOTS = 27 * 27 * 27 + 1;
+
+inline int countryCodeDigit(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c == '<' || c == ' ') {
+        return 26;
+    }
+    return -1;
+}
+
+// Shorter codes are treated as filler padded ("D" == "D<<")
+inline uint16_t packCountryCode(std::string_view code) {
+    if (code.empty() || code.size() > 3) {
+        return INVALID_COUNTRY_CODE;
+    }
+
+    int packed = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        int digit = countryCodeDigit(i < code.size() ? code[i] : '<');
+        if (digit < 0) {
+            return INVALID_COUNTRY_CODE;
+        }
+        packed = packed * 27 + digit;
+    }
+    return static_cast<uint16_t>(packed + 1);
+}
+
+// MRZ form, fillers kept (e.g. "D<<")
+inline std::string unpackCountryCode(uint16_t packed) {
+    if (packed == INVALID_COUNTRY_CODE || packed >= COUNTRY_CODE_SLOTS) {
+        return std::string();
+    }
+
+    int value = packed - 1;
+    std::string code(3, '<');
+    for (int i = 2; i >= 0; --i) {
+        int digit = value % 27;
+        code[i] = digit == 26 ? '<' : static_cast<char>('A' + digit);
+        value /= 27;
+    }
+    return code;
+}
+
+#endif // COUNTRY_CODE_H
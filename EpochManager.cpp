@@ -0,0 +1,138 @@
+#include "../include/EpochManager.h"
+
+// Gives each thread its own reader slot and hands it back at thread exit
+struct EpochThreadSlot {
+    EpochManager* manager;
+    int slot;
+
+    EpochThreadSlot() : manager(nullptr), slot(-1) {}
+    ~EpochThreadSlot() {
+        if (manager && slot >= 0) {
+            manager->releaseSlot(slot);
+        }
+    }
+};
+
+namespace {
+    thread_local EpochThreadSlot threadSlot;
+}
+
+EpochManager::EpochManager() : globalEpoch(1), overflowReaders(0) {
+    for (auto& slot : slots) {
+        slot.epoch.store(0, std::memory_order_relaxed);
+        slot.owned.store(false, std::memory_order_relaxed);
+        slot.depth = 0;
+    }
+}
+
+EpochManager::~EpochManager() {
+    std::lock_guard<std::mutex> lock(retireMutex);
+    for (auto& entry : retired) {
+        entry.second();
+    }
+    retired.clear();
+}
+
+EpochManager& EpochManager::instance() {
+    // Never destroyed: thread-exit hooks may still release slots late
+    static EpochManager* manager = new EpochManager();
+    return *manager;
+}
+
+int EpochManager::acquireSlot() {
+    for (size_t i = 0; i < MAX_READER_SLOTS; ++i) {
+        bool expected = false;
+        if (!slots[i].owned.load(std::memory_order_relaxed) &&
+            slots[i].owned.compare_exchange_strong(expected, true)) {
+            slots[i].depth = 0;
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void EpochManager::releaseSlot(int slot) {
+    slots[slot].epoch.store(0);
+    slots[slot].owned.store(false);
+}
+
+EpochManager::Guard EpochManager::pin() {
+    if (threadSlot.manager != this) {
+        if (threadSlot.manager && threadSlot.slot >= 0) {
+            threadSlot.manager->releaseSlot(threadSlot.slot);
+        }
+        threadSlot.manager = this;
+        threadSlot.slot = acquireSlot();
+    }
+
+    int slot = threadSlot.slot;
+    if (slot < 0) {
+        overflowReaders.fetch_add(1);
+        return Guard(this, -1);
+    }
+
+    ReaderSlot& reader = slots[slot];
+    if (reader.depth++ == 0) {
+        // seq_cst store: the announcement must be visible before the
+        // snapshot pointer is read
+        reader.epoch.store(globalEpoch.load());
+    }
+    return Guard(this, slot);
+}
+
+void EpochManager::unpin(int slot) {
+    if (slot < 0) {
+        overflowReaders.fetch_sub(1);
+        return;
+    }
+
+    ReaderSlot& reader = slots[slot];
+    if (--reader.depth == 0) {
+        reader.epoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochManager::retire(std::function<void()> deleter) {
+    // Readers that pinned at or before this epoch may still see the
+    // retired snapshot; later readers see the new pointer
+    uint64_t epoch = globalEpoch.fetch_add(1);
+    std::lock_guard<std::mutex> lock(retireMutex);
+    retired.emplace_back(epoch, std::move(deleter));
+}
+
+void EpochManager::collect() {
+    if (overflowReaders.load() > 0) {
+        return;
+    }
+
+    uint64_t oldestActive = UINT64_MAX;
+    for (const auto& slot : slots) {
+        uint64_t epoch = slot.epoch.load();
+        if (epoch != 0 && epoch < oldestActive) {
+            oldestActive = epoch;
+        }
+    }
+
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(retireMutex);
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); ++i) {
+            if (retired[i].first < oldestActive) {
+                ready.push_back(std::move(retired[i].second));
+            } else {
+                retired[kept++] = std::move(retired[i]);
+            }
+        }
+        retired.resize(kept);
+    }
+
+    for (auto& deleter : ready) {
+        deleter();
+    }
+}
+
+size_t EpochManager::getRetiredCount() {
+    std::lock_guard<std::mutex> lock(retireMutex);
+    return retired.size();
+}
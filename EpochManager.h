@@ -0,0 +1,110 @@
+#ifndef EPOCH_MANAGER_H
+#define EPOCH_MANAGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation for read-mostly snapshots (RCU style).
+//
+// Readers pin the current epoch for the duration of a lookup; pinning is
+// two atomic stores to a per-thread slot, no lock. Writers publish a new
+// snapshot with an atomic pointer swap and retire the old one, which is
+// deleted once no reader pinned before the swap is still active.
+class EpochManager {
+public:
+    static const size_t MAX_READER_SLOTS = 256;
+
+    class Guard {
+    private:
+        EpochManager* manager;
+        int slot;
+
+    public:
+        Guard(EpochManager* manager, int slot) : manager(manager), slot(slot) {}
+        Guard(Guard&& other) : manager(other.manager), slot(other.slot) { other.manager = nullptr; }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() {
+            if (manager) {
+                manager->unpin(slot);
+            }
+        }
+    };
+
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch;   // 0 = not reading
+        std::atomic<bool> owned;
+        uint32_t depth;                // nesting, only touched by the owner
+    };
+
+    std::atomic<uint64_t> globalEpoch;
+    ReaderSlot slots[MAX_READER_SLOTS];
+    // Readers that found no free slot; while any is active nothing is freed
+    std::atomic<uint32_t> overflowReaders;
+
+    std::mutex retireMutex;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired;
+
+public:
+    EpochManager();
+    ~EpochManager();
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // Shared by all snapshot holders in the process
+    static EpochManager& instance();
+
+    // Enter a read-side critical section; may be nested
+    Guard pin();
+
+    // Call after the old snapshot has been unlinked
+    void retire(std::function<void()> deleter);
+
+    // Frees retired snapshots no reader can still see
+    void collect();
+
+    size_t getRetiredCount();
+
+private:
+    void unpin(int slot);
+    int acquireSlot();
+    void releaseSlot(int slot);
+
+    friend struct EpochThreadSlot;
+};
+
+// Atomically published, epoch-reclaimed pointer to an immutable snapshot
+template <typename T>
+class EpochPointer {
+private:
+    std::atomic<const T*> current;
+
+public:
+    explicit EpochPointer(const T* initial = nullptr) : current(initial) {}
+    ~EpochPointer() { delete current.load(); }
+
+    EpochPointer(const EpochPointer&) = delete;
+    EpochPointer& operator=(const EpochPointer&) = delete;
+
+    // Only valid while a Guard from EpochManager::instance().pin() is held
+    const T* load() const { return current.load(std::memory_order_seq_cst); }
+
+    // Writers must be serialized by the caller
+    void publish(const T* next) {
+        const T* previous = current.exchange(next, std::memory_order_seq_cst);
+        if (previous) {
+            EpochManager& manager = EpochManager::instance();
+            manager.retire([previous] { delete previous; });
+            manager.collect();
+        }
+    }
+};
+
+#endif // EPOCH_MANAGER_H
@@ -0,0 +1,455 @@
+#include "../include/FaceMatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FACE_MATCHER_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FACE_MATCHER_SSE2 1
+#endif
+
+namespace {
+    const int FACE_WIDTH = FaceMatcher::FACE_WIDTH;
+    const int FACE_HEIGHT = FaceMatcher::FACE_HEIGHT;
+    // Room for the last 16-pixel chunk of a row to read past its end
+    const int FACE_STRIDE = FACE_WIDTH + 32;
+    const int LBP_MARGIN = FaceMatcher::LBP_MARGIN;
+
+    // The region is sampled once at WORK_SCALE times the face resolution,
+    // grown by MARGIN_X/MARGIN_Y face pixels per side for the alignment
+    // search; face windows are cut from it
+    const int WORK_SCALE = 2;
+    const int MARGIN_X = FACE_WIDTH / 8;
+    const int MARGIN_Y = FACE_HEIGHT / 8;
+    const int WORK_WIDTH = (FACE_WIDTH + 2 * MARGIN_X) * WORK_SCALE;
+    const int WORK_HEIGHT = (FACE_HEIGHT + 2 * MARGIN_Y) * WORK_SCALE;
+
+    // Alignment search: a coarse grid of shifts, then single-pixel shifts
+    // and scales around the best one
+    const int COARSE_SHIFT = 4;
+    const int COARSE_STEP = 2;
+    const int SCALE_PERCENTS[3] = {94, 100, 106};
+
+    // Uniform LBP: patterns with at most two 0/1 transitions around the
+    // circle get a bin each, all others share the last one
+    struct UniformTable {
+        uint8_t bin[256];
+
+        UniformTable() {
+            int next = 0;
+            for (int code = 0; code < 256; ++code) {
+                int transitions = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    transitions += ((code >> bit) & 1) != ((code >> ((bit + 1) % 8)) & 1);
+                }
+                bin[code] = static_cast<uint8_t>(transitions <= 2 ? next++ : FaceMatcher::PATTERN_COUNT - 1);
+            }
+        }
+    };
+
+    // Square root of the count, a full cell of one pattern at 255
+    struct RootTable {
+        uint8_t value[FaceMatcher::CELL_SIZE * FaceMatcher::CELL_SIZE + 1];
+
+        RootTable() {
+            for (size_t count = 0; count < sizeof(value); ++count) {
+                double root = 255.0 * std::sqrt(static_cast<double>(count) / (sizeof(value) - 1));
+                value[count] = static_cast<uint8_t>(root + 0.5);
+            }
+        }
+    };
+
+    bool validInput(const unsigned char* pixels, int width, int height, int channels,
+                    const FaceMatcher::Region& face) {
+        return pixels && channels >= 1 && channels <= 4 && face.left >= 0 && face.top >= 0 &&
+               face.width >= FACE_WIDTH * 2 && face.height >= FACE_HEIGHT * 2 &&
+               face.left + face.width <= width && face.top + face.height <= height;
+    }
+
+    // Box average of the source area under each work pixel, the region
+    // grown by the search margin; outside the image the edge repeats.
+    // Large regions are read every other row and column.
+    void sampleWork(const unsigned char* pixels, int width, int height, int channels, size_t stride,
+                    const FaceMatcher::Region& region, unsigned char* work) {
+        const int left = region.left - region.width * MARGIN_X / FACE_WIDTH;
+        const int top = region.top - region.height * MARGIN_Y / FACE_HEIGHT;
+        const int spanX = region.width * WORK_WIDTH / (FACE_WIDTH * WORK_SCALE);
+        const int step = region.width >= 3 * FACE_WIDTH * WORK_SCALE &&
+                         region.height >= 3 * FACE_HEIGHT * WORK_SCALE ? 2 : 1;
+
+        int columnStart[WORK_WIDTH + 1];
+        for (int x = 0; x <= WORK_WIDTH; ++x) {
+            columnStart[x] = x * spanX / WORK_WIDTH;
+        }
+        std::vector<size_t> columnOffset(static_cast<size_t>(spanX));
+        for (int sx = 0; sx < spanX; ++sx) {
+            columnOffset[sx] = static_cast<size_t>(std::min(std::max(left + sx, 0), width - 1)) * channels;
+        }
+
+        std::vector<uint32_t> columnSums(static_cast<size_t>(spanX));
+        for (int y = 0; y < WORK_HEIGHT; ++y) {
+            const int rowStart = top + y * region.height / (FACE_HEIGHT * WORK_SCALE);
+            const int rowEnd = top + (y + 1) * region.height / (FACE_HEIGHT * WORK_SCALE);
+            std::fill(columnSums.begin(), columnSums.end(), 0);
+            uint32_t rows = 0;
+            for (int sy = rowStart; sy < rowEnd; sy += step, ++rows) {
+                const unsigned char* row = pixels + static_cast<size_t>(std::min(std::max(sy, 0), height - 1)) * stride;
+                if (channels == 1) {
+                    for (int sx = 0; sx < spanX; sx += step) {
+                        columnSums[sx] += row[columnOffset[sx]];
+                    }
+                } else {
+                    for (int sx = 0; sx < spanX; sx += step) {
+                        const unsigned char* pixel = row + columnOffset[sx];
+                        columnSums[sx] += (pixel[0] * 77u + pixel[1] * 150u + pixel[2] * 29u) >> 8;
+                    }
+                }
+            }
+            for (int x = 0; x < WORK_WIDTH; ++x) {
+                uint32_t sum = 0;
+                uint32_t columns = 0;
+                for (int sx = columnStart[x] + (step - columnStart[x] % step) % step; sx < columnStart[x + 1];
+                     sx += step) {
+                    sum += columnSums[sx];
+                    ++columns;
+                }
+                work[y * WORK_WIDTH + x] = static_cast<unsigned char>(sum / (rows * columns));
+            }
+        }
+    }
+
+    // The face window at the given scale and shift (face pixels) out of
+    // the work image; bilinear, so scale 1 and no shift is a 2x2 average
+    void cutWindow(const unsigned char* work, int scalePercent, int shiftX, int shiftY, unsigned char* crop) {
+        // Work coordinates in 1/256 pixel
+        const int stepSize = WORK_SCALE * 256 * scalePercent / 100;
+        const int originX = (WORK_WIDTH / 2 + shiftX * WORK_SCALE) * 256 - FACE_WIDTH / 2 * stepSize + stepSize / 2 - 128;
+        const int originY = (WORK_HEIGHT / 2 + shiftY * WORK_SCALE) * 256 - FACE_HEIGHT / 2 * stepSize + stepSize / 2 - 128;
+        for (int y = 0; y < FACE_HEIGHT; ++y) {
+            const int wy = std::min(std::max(originY + y * stepSize, 0), (WORK_HEIGHT - 1) * 256 - 1);
+            const unsigned char* upper = work + (wy >> 8) * WORK_WIDTH;
+            const unsigned char* lower = upper + WORK_WIDTH;
+            const int fy = wy & 255;
+            for (int x = 0; x < FACE_WIDTH; ++x) {
+                const int wx = std::min(std::max(originX + x * stepSize, 0), (WORK_WIDTH - 1) * 256 - 1);
+                const int ix = wx >> 8;
+                const int fx = wx & 255;
+                const int top = upper[ix] * (256 - fx) + upper[ix + 1] * fx;
+                const int bottom = lower[ix] * (256 - fx) + lower[ix + 1] * fx;
+                crop[y * FACE_STRIDE + x] = static_cast<unsigned char>((top * (256 - fy) + bottom * fy + 32768) >> 16);
+            }
+        }
+    }
+
+    // LBP codes of one row; codes at x = 0 and x >= FACE_WIDTH - 1 are
+    // not used. Neighbours clockwise from the top left set bits 0-7 when
+    // at least LBP_MARGIN brighter than the centre.
+    void lbpRow(const unsigned char* face, int y, unsigned char* codes) {
+        const unsigned char* above = face + (y - 1) * FACE_STRIDE;
+        const unsigned char* row = face + y * FACE_STRIDE;
+        const unsigned char* below = face + (y + 1) * FACE_STRIDE;
+#ifdef FACE_MATCHER_SSE2
+        for (int x = 1; x < FACE_WIDTH - 1; x += 16) {
+            const __m128i centre = _mm_adds_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)),
+                                                 _mm_set1_epi8(static_cast<char>(LBP_MARGIN)));
+            const __m128i neighbours[8] = {
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x - 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x + 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x + 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x - 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1))
+            };
+            __m128i code = _mm_setzero_si128();
+            for (int bit = 0; bit < 8; ++bit) {
+                // neighbour >= centre + margin  <=>  max(neighbour, that) == neighbour
+                const __m128i set = _mm_cmpeq_epi8(_mm_max_epu8(neighbours[bit], centre), neighbours[bit]);
+                code = _mm_or_si128(code, _mm_and_si128(set, _mm_set1_epi8(static_cast<char>(1 << bit))));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + x), code);
+        }
+#else
+        for (int x = 1; x < FACE_WIDTH - 1; ++x) {
+            const int centre = std::min(row[x] + LBP_MARGIN, 255);
+            const unsigned char neighbours[8] = {above[x - 1], above[x], above[x + 1], row[x + 1],
+                                                 below[x + 1], below[x], below[x - 1], row[x - 1]};
+            unsigned char code = 0;
+            for (int bit = 0; bit < 8; ++bit) {
+                code |= static_cast<unsigned char>((neighbours[bit] >= centre) << bit);
+            }
+            codes[x] = code;
+        }
+#endif
+    }
+
+    // Cell pattern histograms of a face window
+    void describe(const unsigned char* crop, FaceMatcher::Descriptor& descriptor) {
+        static const UniformTable uniform;
+        static const RootTable roots;
+
+        uint16_t counts[FaceMatcher::CELL_ROWS * FaceMatcher::CELL_COLUMNS][FaceMatcher::PATTERN_COUNT];
+        std::memset(counts, 0, sizeof(counts));
+        alignas(16) unsigned char codes[FACE_STRIDE];
+        for (int y = 1; y < FACE_HEIGHT - 1; ++y) {
+            lbpRow(crop, y, codes);
+            uint16_t (*cellRow)[FaceMatcher::PATTERN_COUNT] = counts + (y / FaceMatcher::CELL_SIZE) * FaceMatcher::CELL_COLUMNS;
+            for (int x = 1; x < FACE_WIDTH - 1; ++x) {
+                ++cellRow[x / FaceMatcher::CELL_SIZE][uniform.bin[codes[x]]];
+            }
+        }
+
+        std::memset(descriptor.values, 0, sizeof(descriptor.values));
+        uint32_t mass = 0;
+        for (int cell = 0; cell < FaceMatcher::CELL_ROWS * FaceMatcher::CELL_COLUMNS; ++cell) {
+            uint8_t* values = descriptor.values + cell * FaceMatcher::CELL_BYTES;
+            for (int bin = 0; bin < FaceMatcher::PATTERN_COUNT; ++bin) {
+                values[bin] = roots.value[counts[cell][bin]];
+                mass += values[bin];
+            }
+        }
+        descriptor.mass = mass;
+    }
+
+    // splitmix64; the synthetic face is a pure function of the identity
+    struct FaceRandom {
+        uint64_t state;
+
+        explicit FaceRandom(uint64_t seed) : state(seed) {}
+
+        double next(double low, double high) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            return low + (high - low) * static_cast<double>(z >> 11) / static_cast<double>(1ULL << 53);
+        }
+    };
+
+    struct SyntheticFace {
+        static const int BLOB_COUNT = 16;
+
+        double width, height, centreY;
+        double skin, shading, hairline, hair;
+        double eyeX, eyeY, eyeWidth, eyeHeight, browGap, browHeight;
+        double noseWidth, noseEnd, mouthY, mouthWidth, mouthHeight;
+        double textureAmplitude, textureU, textureV, texturePhase;
+        double blobU[BLOB_COUNT], blobV[BLOB_COUNT], blobRadius[BLOB_COUNT], blobAmplitude[BLOB_COUNT];
+
+        explicit SyntheticFace(uint64_t identity) {
+            FaceRandom random(identity);
+            width = random.next(0.36, 0.42);
+            height = random.next(0.44, 0.48);
+            centreY = random.next(0.50, 0.54);
+            skin = random.next(140, 190);
+            shading = random.next(-30, 30);
+            hairline = random.next(0.16, 0.30);
+            hair = random.next(30, 90);
+            eyeX = random.next(0.13, 0.19);
+            eyeY = random.next(0.40, 0.46);
+            eyeWidth = random.next(0.055, 0.08);
+            eyeHeight = random.next(0.022, 0.035);
+            browGap = random.next(0.06, 0.09);
+            browHeight = random.next(0.015, 0.035);
+            noseWidth = random.next(0.02, 0.04);
+            noseEnd = random.next(0.58, 0.66);
+            mouthY = random.next(0.71, 0.78);
+            mouthWidth = random.next(0.09, 0.16);
+            mouthHeight = random.next(0.018, 0.035);
+            textureAmplitude = random.next(6, 18);
+            textureU = random.next(2, 6);
+            textureV = random.next(2, 6);
+            texturePhase = random.next(0, 6.283);
+            for (int i = 0; i < BLOB_COUNT; ++i) {
+                blobU[i] = random.next(0.2, 0.8);
+                blobV[i] = random.next(0.15, 0.9);
+                blobRadius[i] = random.next(0.03, 0.09);
+                blobAmplitude[i] = random.next(-45, 45);
+            }
+        }
+
+        double inEllipse(double u, double v, double cu, double cv, double ru, double rv) const {
+            const double du = (u - cu) / ru;
+            const double dv = (v - cv) / rv;
+            return du * du + dv * dv;
+        }
+
+        // Brightness at (u, v) of the unit face box
+        double shade(double u, double v) const {
+            if (inEllipse(u, v, 0.5, centreY, width, height) > 1.0) {
+                return 215.0;
+            }
+            if (v < hairline) {
+                return hair + 10.0 * std::sin(40.0 * u);
+            }
+            for (int side = -1; side <= 1; side += 2) {
+                const double cu = 0.5 + side * eyeX;
+                if (inEllipse(u, v, cu, eyeY, eyeWidth, eyeHeight) <= 1.0) {
+                    return inEllipse(u, v, cu, eyeY, eyeHeight, eyeHeight) <= 1.0 ? 25.0 : 235.0;
+                }
+                if (std::fabs(u - cu) < eyeWidth * 1.2 && v > eyeY - browGap - browHeight && v < eyeY - browGap) {
+                    return hair + 20.0;
+                }
+            }
+            if (inEllipse(u, v, 0.5, mouthY, mouthWidth, mouthHeight) <= 1.0) {
+                return 95.0;
+            }
+
+            double value = skin + shading * (u - 0.5) +
+                           textureAmplitude * std::sin(6.283 * (textureU * u + textureV * v) + texturePhase);
+            if (std::fabs(u - 0.5) < noseWidth && v > eyeY + 0.04 && v < noseEnd) {
+                value -= 35.0;
+            }
+            for (int i = 0; i < BLOB_COUNT; ++i) {
+                const double d = inEllipse(u, v, blobU[i], blobV[i], blobRadius[i], blobRadius[i]);
+                if (d < 1.0) {
+                    value += blobAmplitude[i] * (1.0 - d) * (1.0 - d);
+                }
+            }
+            return value;
+        }
+    };
+}
+
+bool FaceMatcher::extract(const unsigned char* pixels, int width, int height, int channels, const Region& face,
+                          Descriptor& descriptor, size_t stride) {
+    if (!validInput(pixels, width, height, channels, face)) {
+        return false;
+    }
+    if (stride == 0) {
+        stride = static_cast<size_t>(width) * static_cast<size_t>(channels);
+    }
+
+    std::vector<unsigned char> work(WORK_WIDTH * WORK_HEIGHT);
+    sampleWork(pixels, width, height, channels, stride, face, work.data());
+    alignas(16) unsigned char crop[FACE_HEIGHT * FACE_STRIDE] = {};
+    cutWindow(work.data(), 100, 0, 0, crop);
+    describe(crop, descriptor);
+    return true;
+}
+
+double FaceMatcher::match(const Descriptor& reference, const unsigned char* pixels, int width, int height,
+                          int channels, const Region& face, Descriptor* best, size_t stride) {
+    if (!validInput(pixels, width, height, channels, face)) {
+        return 0.0;
+    }
+    if (stride == 0) {
+        stride = static_cast<size_t>(width) * static_cast<size_t>(channels);
+    }
+
+    std::vector<unsigned char> work(WORK_WIDTH * WORK_HEIGHT);
+    sampleWork(pixels, width, height, channels, stride, face, work.data());
+    alignas(16) unsigned char crop[FACE_HEIGHT * FACE_STRIDE] = {};
+    Descriptor candidate;
+    double bestScore = -1.0;
+    int bestX = 0, bestY = 0;
+    auto tryWindow = [&](int scalePercent, int shiftX, int shiftY) {
+        cutWindow(work.data(), scalePercent, shiftX, shiftY, crop);
+        describe(crop, candidate);
+        double score = similarity(reference, candidate);
+        if (score > bestScore) {
+            bestScore = score;
+            bestX = shiftX;
+            bestY = shiftY;
+            if (best) {
+                *best = candidate;
+            }
+        }
+    };
+
+    // The guide only places the face roughly: coarse shifts first, then
+    // the neighbourhood of the best one at each scale
+    for (int y = -COARSE_SHIFT; y <= COARSE_SHIFT; y += COARSE_STEP) {
+        for (int x = -COARSE_SHIFT; x <= COARSE_SHIFT; x += COARSE_STEP) {
+            tryWindow(100, x, y);
+        }
+    }
+    const int centreX = bestX, centreY = bestY;
+    for (int scalePercent : SCALE_PERCENTS) {
+        for (int y = centreY - 1; y <= centreY + 1; ++y) {
+            for (int x = centreX - 1; x <= centreX + 1; ++x) {
+                if (scalePercent != 100 || x != centreX || y != centreY) {
+                    tryWindow(scalePercent, x, y);
+                }
+            }
+        }
+    }
+    return bestScore;
+}
+
+uint32_t FaceMatcher::distance(const Descriptor& a, const Descriptor& b) {
+    return distance(a.values, b.values, DESCRIPTOR_BYTES);
+}
+
+uint32_t FaceMatcher::distance(const uint8_t* a, const uint8_t* b, size_t bytes) {
+#if defined(FACE_MATCHER_AVX2)
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t i = 0; i < bytes; i += 32) {
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+#elif defined(FACE_MATCHER_SSE2)
+    __m128i sum = _mm_setzero_si128();
+    for (size_t i = 0; i < bytes; i += 16) {
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+    }
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#else
+    uint32_t sum = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        sum += static_cast<uint32_t>(std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+    }
+    return sum;
+#endif
+}
+
+double FaceMatcher::similarity(const Descriptor& a, const Descriptor& b) {
+    const uint32_t total = a.mass + b.mass;
+    return total == 0 ? 0.0 : 1.0 - static_cast<double>(distance(a, b)) / total;
+}
+
+FaceMatcher::Region FaceMatcher::portraitRegion(int width, int height) {
+    // Head width about 60% of the image, face box in the face grid's
+    // 4:5 aspect, a little above the centre
+    Region region;
+    region.width = width * 3 / 5;
+    region.height = region.width * FACE_HEIGHT / FACE_WIDTH;
+    if (region.height > height) {
+        region.height = height;
+        region.width = height * FACE_WIDTH / FACE_HEIGHT;
+    }
+    region.left = (width - region.width) / 2;
+    region.top = (height - region.height) * 2 / 5;
+    return region;
+}
+
+void FaceMatcher::renderFace(uint64_t identity, unsigned char* pixels, int width, int height, int channels,
+                             const Region& region, int lighting) {
+    const SyntheticFace face(identity);
+    for (int y = 0; y < region.height; ++y) {
+        const int py = region.top + y;
+        if (py < 0 || py >= height) {
+            continue;
+        }
+        const double v = (y + 0.5) / region.height;
+        for (int x = 0; x < region.width; ++x) {
+            const int px = region.left + x;
+            if (px < 0 || px >= width) {
+                continue;
+            }
+            double value = face.shade((x + 0.5) / region.width, v) + lighting;
+            const unsigned char level = static_cast<unsigned char>(value < 0 ? 0 : value > 255 ? 255 : value);
+            std::memset(pixels + (static_cast<size_t>(py) * width + px) * channels, level, channels);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef FACE_MATCHER_H
+#define FACE_MATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 1:1 face comparison between the live camera frame and the chip
+// portrait, without a model runtime.
+//
+//   1. The face region is cropped and area-sampled to FACE_WIDTH x
+//      FACE_HEIGHT gray. Alignment comes from the framing: ICAO portraits
+//      place the face at fixed proportions (portraitRegion), the booth
+//      camera has a face guide, and match() searches small shifts and
+//      scales around it
+//   2. Uniform LBP(8,1) codes, 16 pixels at a time with SSE2; a neighbour
+//      sets its bit only when LBP_MARGIN brighter, which keeps noise on
+//      flat skin from flipping codes
+//   3. A 59-bin pattern histogram per 8x8 cell, square-rooted so a few
+//      dominant patterns do not swamp the rest, one 64-byte row per cell
+//   4. Descriptors are compared by sum of absolute differences
+//      (_mm256_sad_epu8 / _mm_sad_epu8), normalized to a 0..1 similarity
+//
+// LBP codes only compare neighbouring pixels, so the descriptor does not
+// change with exposure or contrast between the two captures.
+class FaceMatcher {
+public:
+    static const int FACE_WIDTH = 64;
+    static const int FACE_HEIGHT = 80;
+    static const int CELL_SIZE = 8;
+    static const int CELL_COLUMNS = FACE_WIDTH / CELL_SIZE;
+    static const int CELL_ROWS = FACE_HEIGHT / CELL_SIZE;
+    static const int PATTERN_COUNT = 59;   // 58 uniform patterns and the rest
+    static const size_t CELL_BYTES = 64;
+    static const size_t DESCRIPTOR_BYTES = CELL_COLUMNS * CELL_ROWS * CELL_BYTES;
+    static const int LBP_MARGIN = 3;   // gray levels a neighbour must exceed the centre by
+    // Same face at or above, calibrated on simulated captures
+    static constexpr double MATCH_THRESHOLD = 0.65;
+    // Similarity reported when either side had no usable face
+    static constexpr double NOT_COMPARED = -1.0;
+
+    struct Region {
+        int left;
+        int top;
+        int width;
+        int height;
+    };
+
+    struct Descriptor {
+        alignas(64) uint8_t values[DESCRIPTOR_BYTES];
+        uint32_t mass;   // sum of values
+    };
+
+    // pixels: 1 (gray), 3 (RGB) or 4 (RGBA) bytes per pixel; stride 0
+    // means tightly packed rows. False if the region is not inside the
+    // image or smaller than twice FACE_WIDTH x FACE_HEIGHT.
+    static bool extract(const unsigned char* pixels, int width, int height, int channels, const Region& face,
+                        Descriptor& descriptor, size_t stride = 0);
+
+    // Highest similarity to the reference over small shifts and scales
+    // of the region, for a face only roughly placed (the booth camera's
+    // guide); best receives the descriptor of the winning window. 0 if
+    // the region is not usable.
+    static double match(const Descriptor& reference, const unsigned char* pixels, int width, int height,
+                        int channels, const Region& face, Descriptor* best = nullptr, size_t stride = 0);
+
+    static uint32_t distance(const Descriptor& a, const Descriptor& b);
+    // Same kernel over any byte rows; bytes must be a multiple of 32
+    static uint32_t distance(const uint8_t* a, const uint8_t* b, size_t bytes);
+    // 1 for identical descriptors, 0 for nothing in common
+    static double similarity(const Descriptor& a, const Descriptor& b);
+
+    // Face box of a passport portrait (ISO/IEC 19794-5 token framing)
+    static Region portraitRegion(int width, int height);
+
+    // Draws the synthetic face of an identity into the region; lighting
+    // shifts the brightness. For the simulated camera and chip, and tests.
+    static void renderFace(uint64_t identity, unsigned char* pixels, int width, int height, int channels,
+                           const Region& region, int lighting = 0);
+};
+
+#endif // FACE_MATCHER_H
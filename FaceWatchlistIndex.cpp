@@ -0,0 +1,394 @@
+#include "../include/FaceWatchlistIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+    const char MAGIC[8] = {'F', 'A', 'C', 'E', 'I', 'D', 'X', '\0'};
+    const size_t TRAINING_PER_LIST = 64;   // k-means sample per centroid
+    const int KMEANS_ROUNDS = 8;
+    const uint64_t TRAINING_SEED = 20240917;
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint32_t codeDistance(const uint8_t* a, const uint8_t* b) {
+        return FaceMatcher::distance(a, b, FaceWatchlistIndex::CODE_BYTES);
+    }
+
+    double score(uint32_t distance, uint32_t massA, uint32_t massB) {
+        const uint32_t total = massA + massB;
+        return total == 0 ? 0.0 : 1.0 - static_cast<double>(distance) / total;
+    }
+
+    // Nearest centroid by SAD
+    uint32_t nearest(const uint8_t* code, const std::vector<uint8_t>& centroids, uint32_t count) {
+        uint32_t best = 0;
+        uint32_t bestDistance = UINT32_MAX;
+        for (uint32_t c = 0; c < count; ++c) {
+            uint32_t distance = codeDistance(code, centroids.data() + c * FaceWatchlistIndex::CODE_BYTES);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    // k-means over a sample of the codes; a centroid left without
+    // members keeps its previous position
+    std::vector<uint8_t> trainCentroids(const std::vector<uint8_t>& codes, size_t entryCount, uint32_t listCount) {
+        const size_t codeBytes = FaceWatchlistIndex::CODE_BYTES;
+        std::vector<size_t> sample(entryCount);
+        for (size_t i = 0; i < entryCount; ++i) {
+            sample[i] = i;
+        }
+        std::mt19937_64 rng(TRAINING_SEED);
+        std::shuffle(sample.begin(), sample.end(), rng);
+        sample.resize(std::min(entryCount, listCount * TRAINING_PER_LIST));
+
+        std::vector<uint8_t> centroids(listCount * codeBytes);
+        for (uint32_t c = 0; c < listCount; ++c) {
+            std::memcpy(&centroids[c * codeBytes], &codes[sample[c] * codeBytes], codeBytes);
+        }
+        std::vector<uint32_t> sums(listCount * codeBytes);
+        std::vector<uint32_t> members(listCount);
+        for (int round = 0; round < KMEANS_ROUNDS; ++round) {
+            std::fill(sums.begin(), sums.end(), 0);
+            std::fill(members.begin(), members.end(), 0);
+            for (size_t s : sample) {
+                const uint8_t* code = &codes[s * codeBytes];
+                uint32_t c = nearest(code, centroids, listCount);
+                ++members[c];
+                for (size_t i = 0; i < codeBytes; ++i) {
+                    sums[c * codeBytes + i] += code[i];
+                }
+            }
+            for (uint32_t c = 0; c < listCount; ++c) {
+                if (members[c] == 0) {
+                    continue;
+                }
+                for (size_t i = 0; i < codeBytes; ++i) {
+                    centroids[c * codeBytes + i] =
+                        static_cast<uint8_t>((sums[c * codeBytes + i] + members[c] / 2) / members[c]);
+                }
+            }
+        }
+        return centroids;
+    }
+}
+
+FaceWatchlistIndex::FaceWatchlistIndex()
+    : header(nullptr), centroids(nullptr), listOffsets(nullptr), codes(nullptr), descriptors(nullptr),
+      masses(nullptr), ids(nullptr), searches(0), scanned(0) {
+    for (auto& count : latencies) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void FaceWatchlistIndex::encode(const FaceMatcher::Descriptor& descriptor, Code& code) {
+    // Each code cell is the rounded mean of a 2x2 block of cells
+    const size_t cellBytes = FaceMatcher::CELL_BYTES;
+    const size_t rowBytes = FaceMatcher::CELL_COLUMNS * cellBytes;
+    uint8_t* out = code.values;
+    code.mass = 0;
+    for (int row = 0; row < FaceMatcher::CELL_ROWS; row += POOL) {
+        for (int column = 0; column < FaceMatcher::CELL_COLUMNS; column += POOL) {
+            const uint8_t* top = descriptor.values + row * rowBytes + column * cellBytes;
+            const uint8_t* bottom = top + rowBytes;
+            for (size_t i = 0; i < cellBytes; ++i) {
+                const unsigned sum = top[i] + top[cellBytes + i] + bottom[i] + bottom[cellBytes + i];
+                *out = static_cast<uint8_t>((sum + 2) / 4);
+                code.mass += *out++;
+            }
+        }
+    }
+}
+
+bool FaceWatchlistIndex::build(const std::vector<Entry>& entries, const std::string& path, std::string& error,
+                               uint32_t listCount) {
+    const size_t entryCount = entries.size();
+    if (listCount == AUTO_LISTS) {
+        listCount = entryCount <= FLAT_LIMIT ? FLAT :
+            static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(entryCount))));
+    }
+    if (listCount > entryCount) {
+        listCount = static_cast<uint32_t>(entryCount);
+    }
+    if (listCount == 1) {
+        listCount = FLAT;
+    }
+
+    std::vector<uint8_t> allCodes(entryCount * CODE_BYTES);
+    std::vector<uint32_t> codeMasses(entryCount);
+    Code code;
+    for (size_t i = 0; i < entryCount; ++i) {
+        encode(entries[i].descriptor, code);
+        std::memcpy(&allCodes[i * CODE_BYTES], code.values, CODE_BYTES);
+        codeMasses[i] = code.mass;
+    }
+
+    // Entries grouped by nearest centroid, in input order within a list
+    std::vector<uint8_t> centroidCodes;
+    std::vector<uint64_t> offsets(2, 0);
+    std::vector<size_t> order(entryCount);
+    if (listCount == FLAT) {
+        offsets[1] = entryCount;
+        for (size_t i = 0; i < entryCount; ++i) {
+            order[i] = i;
+        }
+    } else {
+        centroidCodes = trainCentroids(allCodes, entryCount, listCount);
+        std::vector<uint32_t> lists(entryCount);
+        offsets.assign(listCount + 1, 0);
+        for (size_t i = 0; i < entryCount; ++i) {
+            lists[i] = nearest(&allCodes[i * CODE_BYTES], centroidCodes, listCount);
+            ++offsets[lists[i] + 1];
+        }
+        for (uint32_t c = 0; c < listCount; ++c) {
+            offsets[c + 1] += offsets[c];
+        }
+        std::vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < entryCount; ++i) {
+            order[next[lists[i]]++] = i;
+        }
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.listCount = listCount;
+    header.entryCount = entryCount;
+    header.centroidsOffset = alignUp(sizeof(Header), BLOCK_BYTES);
+    header.listOffsetsOffset = alignUp(header.centroidsOffset + centroidCodes.size(), BLOCK_BYTES);
+    header.codesOffset = alignUp(header.listOffsetsOffset + offsets.size() * sizeof(uint64_t), BLOCK_BYTES);
+    header.descriptorsOffset = header.codesOffset + entryCount * CODE_BYTES;
+    header.massesOffset = header.descriptorsOffset + entryCount * FaceMatcher::DESCRIPTOR_BYTES;
+    header.idsOffset = alignUp(header.massesOffset + entryCount * 2 * sizeof(uint32_t), BLOCK_BYTES);
+    header.buildTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    // Write to a temporary name and rename, so booths never map a half-written index
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            error = "cannot create " + temporary;
+            return false;
+        }
+        const char padding[BLOCK_BYTES] = {0};
+        auto pad = [&](uint64_t offset) {
+            out.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(out.tellp())));
+        };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pad(header.centroidsOffset);
+        out.write(reinterpret_cast<const char*>(centroidCodes.data()), static_cast<std::streamsize>(centroidCodes.size()));
+        pad(header.listOffsetsOffset);
+        out.write(reinterpret_cast<const char*>(offsets.data()),
+                  static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+        pad(header.codesOffset);
+        for (size_t i : order) {
+            out.write(reinterpret_cast<const char*>(&allCodes[i * CODE_BYTES]), CODE_BYTES);
+        }
+        for (size_t i : order) {
+            out.write(reinterpret_cast<const char*>(entries[i].descriptor.values), FaceMatcher::DESCRIPTOR_BYTES);
+        }
+        for (size_t i : order) {
+            const uint32_t pair[2] = {codeMasses[i], entries[i].descriptor.mass};
+            out.write(reinterpret_cast<const char*>(pair), sizeof(pair));
+        }
+        pad(header.idsOffset);
+        for (size_t i : order) {
+            char id[ID_BYTES] = {0};
+            std::memcpy(id, entries[i].id.data(), std::min(entries[i].id.size(), ID_BYTES));
+            out.write(id, ID_BYTES);
+        }
+        if (!out.flush()) {
+            error = "cannot write " + temporary;
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "cannot rename " + temporary + " to " + path;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FaceWatchlistIndex::open(const std::string& path, std::string& error) {
+    header = nullptr;
+    if (!file.open(path, error)) {
+        return false;
+    }
+
+    const Header* candidate = reinterpret_cast<const Header*>(file.data());
+    if (file.size() < sizeof(Header) || std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a face watchlist index";
+        return false;
+    }
+    if (candidate->version != FORMAT_VERSION) {
+        error = path + ": unsupported index version " + std::to_string(candidate->version);
+        return false;
+    }
+    const uint64_t entryCount = candidate->entryCount;
+    const uint64_t listSlots = candidate->listCount == FLAT ? 2 : uint64_t(candidate->listCount) + 1;
+    if (entryCount > file.size() / (CODE_BYTES + FaceMatcher::DESCRIPTOR_BYTES) ||
+        candidate->listCount > entryCount || candidate->centroidsOffset % BLOCK_BYTES != 0 ||
+        candidate->listOffsetsOffset % BLOCK_BYTES != 0 || candidate->codesOffset % BLOCK_BYTES != 0 ||
+        candidate->idsOffset % BLOCK_BYTES != 0 ||
+        candidate->centroidsOffset + uint64_t(candidate->listCount) * CODE_BYTES > candidate->listOffsetsOffset ||
+        candidate->listOffsetsOffset + listSlots * sizeof(uint64_t) > candidate->codesOffset ||
+        candidate->codesOffset + entryCount * CODE_BYTES != candidate->descriptorsOffset ||
+        candidate->descriptorsOffset + entryCount * FaceMatcher::DESCRIPTOR_BYTES != candidate->massesOffset ||
+        candidate->massesOffset + entryCount * 2 * sizeof(uint32_t) > candidate->idsOffset ||
+        candidate->idsOffset > file.size() || (file.size() - candidate->idsOffset) / ID_BYTES < entryCount) {
+        error = path + ": corrupt index header";
+        return false;
+    }
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(file.data() + candidate->listOffsetsOffset);
+    if (offsets[0] != 0 || offsets[listSlots - 1] != entryCount ||
+        !std::is_sorted(offsets, offsets + listSlots)) {
+        error = path + ": corrupt list offsets";
+        return false;
+    }
+
+    header = candidate;
+    centroids = reinterpret_cast<const uint8_t*>(file.data() + header->centroidsOffset);
+    listOffsets = offsets;
+    codes = reinterpret_cast<const uint8_t*>(file.data() + header->codesOffset);
+    descriptors = reinterpret_cast<const uint8_t*>(file.data() + header->descriptorsOffset);
+    masses = reinterpret_cast<const uint32_t*>(file.data() + header->massesOffset);
+    ids = file.data() + header->idsOffset;
+
+    // Centroids and masses are read by every search, codes list by list,
+    // descriptors only for the shortlist
+    file.advise(header->centroidsOffset, header->codesOffset - header->centroidsOffset, MappedFile::WILL_NEED);
+    file.advise(header->massesOffset, entryCount * 2 * sizeof(uint32_t), MappedFile::WILL_NEED);
+    file.advise(header->descriptorsOffset, entryCount * FaceMatcher::DESCRIPTOR_BYTES, MappedFile::RANDOM);
+    return true;
+}
+
+size_t FaceWatchlistIndex::search(const FaceMatcher::Descriptor& face, size_t k,
+                                  std::vector<FaceWatchlistMatch>& matches, uint32_t probes) const {
+    if (!header || k == 0 || header->entryCount == 0) {
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    Code query;
+    encode(face, query);
+
+    // Lists to scan: all of a flat index, else the nearest centroids'
+    std::vector<uint32_t> lists;
+    if (header->listCount == FLAT) {
+        lists.push_back(0);
+    } else {
+        std::vector<std::pair<uint32_t, uint32_t>> nearby(header->listCount);
+        for (uint32_t c = 0; c < header->listCount; ++c) {
+            nearby[c] = {codeDistance(query.values, centroids + c * CODE_BYTES), c};
+        }
+        const size_t probed = std::min<size_t>(std::max(probes, 1u), nearby.size());
+        std::partial_sort(nearby.begin(), nearby.begin() + probed, nearby.end());
+        for (size_t i = 0; i < probed; ++i) {
+            lists.push_back(nearby[i].second);
+        }
+    }
+
+    // Best codes, worst of them on top of the heap
+    const size_t shortlistSize = std::max(SHORTLIST, k);
+    std::vector<FaceWatchlistMatch> shortlist;
+    shortlist.reserve(shortlistSize + 1);
+    auto worseFirst = [](const FaceWatchlistMatch& a, const FaceWatchlistMatch& b) { return a.score > b.score; };
+    uint64_t compared = 0;
+    for (uint32_t list : lists) {
+        for (uint64_t entry = listOffsets[list]; entry < listOffsets[list + 1]; ++entry) {
+            const double codeScore = score(codeDistance(query.values, codes + entry * CODE_BYTES), query.mass,
+                                           masses[entry * 2]);
+            if (shortlist.size() == shortlistSize && codeScore <= shortlist.front().score) {
+                continue;
+            }
+            shortlist.push_back({static_cast<uint32_t>(entry), codeScore});
+            std::push_heap(shortlist.begin(), shortlist.end(), worseFirst);
+            if (shortlist.size() > shortlistSize) {
+                std::pop_heap(shortlist.begin(), shortlist.end(), worseFirst);
+                shortlist.pop_back();
+            }
+        }
+        compared += listOffsets[list + 1] - listOffsets[list];
+    }
+
+    // Re-rank by the full descriptors
+    for (FaceWatchlistMatch& candidate : shortlist) {
+        const uint8_t* enrolled = descriptors + static_cast<size_t>(candidate.entry) * FaceMatcher::DESCRIPTOR_BYTES;
+        candidate.score = score(FaceMatcher::distance(face.values, enrolled, FaceMatcher::DESCRIPTOR_BYTES),
+                                face.mass, masses[candidate.entry * 2 + 1]);
+    }
+    const size_t found = std::min(k, shortlist.size());
+    std::partial_sort(shortlist.begin(), shortlist.begin() + found, shortlist.end(),
+                      [](const FaceWatchlistMatch& a, const FaceWatchlistMatch& b) { return a.score > b.score; });
+    matches.insert(matches.end(), shortlist.begin(), shortlist.begin() + found);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    searches.fetch_add(1, std::memory_order_relaxed);
+    scanned.fetch_add(compared, std::memory_order_relaxed);
+    latencies[latencyBucket(static_cast<uint64_t>(elapsed.count()))].fetch_add(1, std::memory_order_relaxed);
+    return found;
+}
+
+std::string_view FaceWatchlistIndex::getId(uint32_t entry) const {
+    if (!header || entry >= header->entryCount) {
+        return std::string_view();
+    }
+    const char* id = ids + static_cast<size_t>(entry) * ID_BYTES;
+    return std::string_view(id, std::find(id, id + ID_BYTES, '\0') - id);
+}
+
+size_t FaceWatchlistIndex::latencyBucket(uint64_t microseconds) {
+    // Exact below 8, then 8 buckets per power of two
+    if (microseconds < 8) {
+        return static_cast<size_t>(microseconds);
+    }
+    int exponent = 63;
+    while ((microseconds >> exponent) == 0) {
+        --exponent;
+    }
+    const size_t bucket = 8 * static_cast<size_t>(exponent - 2) + ((microseconds >> (exponent - 3)) & 7);
+    return std::min(bucket, LATENCY_BUCKETS - 1);
+}
+
+double FaceWatchlistIndex::bucketLimit(size_t bucket) {
+    if (bucket < 8) {
+        return static_cast<double>(bucket + 1);
+    }
+    const int exponent = static_cast<int>(bucket / 8) + 2;
+    return static_cast<double>((9 + bucket % 8) << (exponent - 3));
+}
+
+FaceWatchlistIndex::Statistics FaceWatchlistIndex::getStatistics() const {
+    Statistics stats = {searches.load(std::memory_order_relaxed), scanned.load(std::memory_order_relaxed), 0, 0};
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        counts[i] = latencies[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    auto percentile = [&](uint64_t permille) {
+        const uint64_t rank = (total * permille + 999) / 1000;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank && seen > 0) {
+                return bucketLimit(i);
+            }
+        }
+        return 0.0;
+    };
+    stats.p50Microseconds = percentile(500);
+    stats.p99Microseconds = percentile(990);
+    return stats;
+}
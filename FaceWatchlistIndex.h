@@ -0,0 +1,134 @@
+#ifndef FACE_WATCHLIST_INDEX_H
+#define FACE_WATCHLIST_INDEX_H
+
+#include "FaceMatcher.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct FaceWatchlistMatch {
+    uint32_t entry;   // index into the watchlist
+    double score;     // FaceMatcher similarity to the enrolled face
+};
+
+// 1:N face search against a watchlist, built offline and opened read-only.
+//
+//   1. Every enrolled descriptor is also kept as a compact code: 2x2
+//      FaceMatcher cells averaged into one, CODE_BYTES instead of
+//      DESCRIPTOR_BYTES. Codes are what a search scans
+//   2. Small lists are scanned whole. Larger ones are split into inverted
+//      lists around k-means centroids of the codes (IVF); a search scans
+//      only the lists of the nearest few centroids
+//   3. The best SHORTLIST codes are re-ranked by the full descriptors,
+//      which sit in their own section and are paged in only for those
+//
+// File layout (little-endian, sections 64-byte aligned):
+//   Header | centroids (listCount x CODE_BYTES) | list offsets
+//   (listCount + 1 x uint64) | codes | descriptors | masses (code and
+//   descriptor, 2 x uint32 per entry) | ids (ID_BYTES per entry)
+// Entries are stored grouped by list.
+//
+// Immutable once opened; search() is safe from any thread.
+class FaceWatchlistIndex {
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+    static const size_t BLOCK_BYTES = 64;
+    static const int POOL = 2;   // cells per code cell, each way
+    static const size_t CODE_BYTES = (FaceMatcher::CELL_COLUMNS / POOL) * (FaceMatcher::CELL_ROWS / POOL) *
+                                     FaceMatcher::CELL_BYTES;
+    static constexpr size_t ID_BYTES = 32;
+    static const uint32_t FLAT = 0;              // list count of an index scanned whole
+    static const uint32_t AUTO_LISTS = 0xFFFFFFFF;
+    static const size_t FLAT_LIMIT = 8192;       // AUTO_LISTS builds a flat index up to this size
+    static const uint32_t DEFAULT_PROBES = 8;
+    static constexpr size_t SHORTLIST = 32;
+    // A watchlist hit at or above; stricter than the 1:1 threshold, as
+    // every search is compared against the whole list
+    static constexpr double HIT_THRESHOLD = 0.70;
+
+    struct Header {
+        char magic[8];          // "FACEIDX\0"
+        uint32_t version;
+        uint32_t listCount;     // FLAT for a single list
+        uint64_t entryCount;
+        uint64_t centroidsOffset;
+        uint64_t listOffsetsOffset;
+        uint64_t codesOffset;
+        uint64_t descriptorsOffset;
+        uint64_t massesOffset;
+        uint64_t idsOffset;
+        uint64_t buildTime;     // seconds since the Unix epoch
+    };
+
+    struct Entry {
+        std::string id;
+        FaceMatcher::Descriptor descriptor;
+    };
+
+    struct Code {
+        alignas(64) uint8_t values[CODE_BYTES];
+        uint32_t mass;
+    };
+
+    struct Statistics {
+        uint64_t searches;
+        uint64_t scanned;            // codes compared, all searches
+        double p50Microseconds;      // bucket upper bounds, within 1/8
+        double p99Microseconds;
+    };
+
+private:
+    // Search latency histogram: 8 buckets per power of two of microseconds
+    static const size_t LATENCY_BUCKETS = 8 * 24;
+
+    MappedFile file;
+    const Header* header;
+    const uint8_t* centroids;
+    const uint64_t* listOffsets;
+    const uint8_t* codes;
+    const uint8_t* descriptors;
+    const uint32_t* masses;
+    const char* ids;
+
+    mutable std::atomic<uint64_t> searches;
+    mutable std::atomic<uint64_t> scanned;
+    mutable std::atomic<uint64_t> latencies[LATENCY_BUCKETS];
+
+    static size_t latencyBucket(uint64_t microseconds);
+    static double bucketLimit(size_t bucket);
+
+public:
+    FaceWatchlistIndex();
+
+    FaceWatchlistIndex(const FaceWatchlistIndex&) = delete;
+    FaceWatchlistIndex& operator=(const FaceWatchlistIndex&) = delete;
+
+    static void encode(const FaceMatcher::Descriptor& descriptor, Code& code);
+
+    // Offline build; ids longer than ID_BYTES are cut. listCount is the
+    // number of inverted lists, FLAT or AUTO_LISTS (about the square root
+    // of the entry count above FLAT_LIMIT).
+    static bool build(const std::vector<Entry>& entries, const std::string& path, std::string& error,
+                      uint32_t listCount = AUTO_LISTS);
+
+    bool open(const std::string& path, std::string& error);
+    bool isOpen() const { return header != nullptr; }
+
+    // Appends the k best enrolled faces, best first, whatever their
+    // score; probes is the number of lists scanned in an IVF index
+    size_t search(const FaceMatcher::Descriptor& face, size_t k, std::vector<FaceWatchlistMatch>& matches,
+                  uint32_t probes = DEFAULT_PROBES) const;
+
+    uint64_t size() const { return header ? header->entryCount : 0; }
+    uint32_t getListCount() const { return header ? header->listCount : 0; }
+    uint64_t getBuildTime() const { return header ? header->buildTime : 0; }
+    std::string_view getId(uint32_t entry) const;
+    bool isMapped() const { return file.isMapped(); }
+    Statistics getStatistics() const;
+};
+
+#endif // FACE_WATCHLIST_INDEX_H
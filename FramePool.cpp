@@ -0,0 +1,99 @@
+#include "../include/FramePool.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace {
+    unsigned char* allocateAligned(size_t size) {
+        return static_cast<unsigned char*>(::operator new(size, std::align_val_t(FramePool::ALIGNMENT)));
+    }
+
+    void freeAligned(unsigned char* block) {
+        ::operator delete(block, std::align_val_t(FramePool::ALIGNMENT));
+    }
+}
+
+void FramePool::Handle::reset() {
+    if (frame && frame->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        frame->pool->release(frame);
+    }
+    frame = nullptr;
+}
+
+FramePool::FramePool(int width, int height, int channels, size_t capacity)
+    : width(width), height(height), channels(channels),
+      frameBytes(static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(channels)),
+      stride((frameBytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT),
+      frameCount(capacity), storage(nullptr), frames(new Frame[capacity]), inUse(0), peakInUse(0),
+      acquisitions(0), exhausted(0) {
+    if (capacity > 0 && stride > 0) {
+        storage = allocateAligned(stride * capacity);
+        // Touch every page now rather than on the first captures
+        std::memset(storage, 0, stride * capacity);
+    }
+
+    freeFrames.reserve(capacity);
+    for (size_t i = capacity; i-- > 0;) {
+        Frame& frame = frames[i];
+        frame.data = storage ? storage + i * stride : nullptr;
+        frame.references.store(0);
+        frame.pool = this;
+        frame.overflow = false;
+        freeFrames.push_back(&frame);
+    }
+}
+
+FramePool::~FramePool() {
+    if (storage) {
+        freeAligned(storage);
+    }
+}
+
+FramePool::Handle FramePool::acquire() {
+    acquisitions.fetch_add(1, std::memory_order_relaxed);
+    size_t used = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t peak = peakInUse.load(std::memory_order_relaxed);
+    while (used > peak && !peakInUse.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+    }
+
+    Frame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(freeMutex);
+        if (!freeFrames.empty()) {
+            frame = freeFrames.back();
+            freeFrames.pop_back();
+        }
+    }
+
+    if (!frame) {
+        exhausted.fetch_add(1, std::memory_order_relaxed);
+        frame = new Frame;
+        frame->data = allocateAligned(std::max(stride, ALIGNMENT));
+        frame->pool = this;
+        frame->overflow = true;
+    }
+    frame->references.store(1, std::memory_order_relaxed);
+    return Handle(frame);
+}
+
+void FramePool::release(Frame* frame) {
+    inUse.fetch_sub(1, std::memory_order_relaxed);
+    if (frame->overflow) {
+        freeAligned(frame->data);
+        delete frame;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(freeMutex);
+    freeFrames.push_back(frame);
+}
+
+FramePool::Statistics FramePool::getStatistics() const {
+    Statistics statistics;
+    statistics.frameBytes = frameBytes;
+    statistics.capacity = getCapacity();
+    statistics.inUse = inUse.load();
+    statistics.peakInUse = peakInUse.load();
+    statistics.acquisitions = acquisitions.load();
+    statistics.exhausted = exhausted.load();
+    return statistics;
+}
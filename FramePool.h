@@ -0,0 +1,114 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Preallocated, recycled camera frame buffers.
+//
+// All frames are carved out of one block allocated and touched up front,
+// each width x height x channels bytes rounded up to ALIGNMENT, so a
+// capture neither allocates nor page-faults. A frame travels from capture
+// to saving and analysis as a Handle: copies share the buffer through an
+// intrusive reference count and the last one returns it to the pool.
+//
+// When every frame is in use, acquire() falls back to a heap-allocated
+// frame that is freed instead of recycled; such captures are counted as
+// exhaustions so the pool can be sized from the statistics.
+//
+// The pool must outlive every handle it gave out.
+class FramePool {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    struct Statistics {
+        size_t frameBytes;
+        size_t capacity;
+        size_t inUse;
+        size_t peakInUse;
+        uint64_t acquisitions;
+        uint64_t exhausted;   // served by an overflow frame
+    };
+
+private:
+    struct Frame {
+        unsigned char* data;
+        std::atomic<uint32_t> references;
+        FramePool* pool;
+        bool overflow;   // heap allocated because the pool was empty
+    };
+
+public:
+    class Handle {
+    private:
+        Frame* frame;
+
+    public:
+        Handle() : frame(nullptr) {}
+        explicit Handle(Frame* frame) : frame(frame) {}
+        Handle(const Handle& other) : frame(other.frame) {
+            if (frame) {
+                frame->references.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        Handle(Handle&& other) noexcept : frame(other.frame) { other.frame = nullptr; }
+        Handle& operator=(Handle other) noexcept {
+            std::swap(frame, other.frame);
+            return *this;
+        }
+        ~Handle() { reset(); }
+
+        // Drops this reference; the buffer goes back to the pool with the last one
+        void reset();
+
+        explicit operator bool() const { return frame != nullptr; }
+        unsigned char* data() const { return frame ? frame->data : nullptr; }
+        size_t size() const { return frame ? frame->pool->frameBytes : 0; }
+        uint32_t useCount() const { return frame ? frame->references.load() : 0; }
+        bool isPooled() const { return frame && !frame->overflow; }
+    };
+
+private:
+    const int width;
+    const int height;
+    const int channels;
+    const size_t frameBytes;
+    const size_t stride;   // frameBytes rounded up to ALIGNMENT
+    const size_t frameCount;
+
+    unsigned char* storage;
+    std::unique_ptr<Frame[]> frames;
+    std::mutex freeMutex;
+    std::vector<Frame*> freeFrames;   // most recently released last
+
+    std::atomic<size_t> inUse;
+    std::atomic<size_t> peakInUse;
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> exhausted;
+
+    void release(Frame* frame);
+
+public:
+    FramePool(int width, int height, int channels, size_t capacity);
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // A frame with a reference count of one; never empty
+    Handle acquire();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+    size_t getFrameBytes() const { return frameBytes; }
+    size_t getCapacity() const { return frameCount; }
+
+    Statistics getStatistics() const;
+};
+
+#endif // FRAME_POOL_H
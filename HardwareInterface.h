@@ -1,21 +1,49 @@
 #ifndef HARDWARE_INTERFACE_H
 #define HARDWARE_INTERFACE_H
 
+#include "FaceMatcher.h"
+#include "FramePool.h"
+#include "ImageStore.h"
+#include "LdsDocument.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <future>
+#include <mutex>
 
 // Forward declarations
 class Passport;
 
+// One instance can serve several booths at once (runLaneSimulation shares
+// it between lanes): bring-up is once per device, the frame pool and the
+// image store lock internally, and the simulation's random state and MRZ
+// reader scratch buffers are per thread. Beyond FRAME_POOL_SIZE frames in
+// flight, captures fall back to heap frames.
 class HardwareInterface {
 public:
-    // Camera simulation
+    // Camera frame geometry; the frame pool is sized from it
+    static const int CAMERA_WIDTH = 1920;
+    static const int CAMERA_HEIGHT = 1080;
+    static const int CAMERA_CHANNELS = 3;
+    static const size_t FRAME_POOL_SIZE = 4;
+    // Where the booth's on-screen guide puts the passenger's face
+    static constexpr FaceMatcher::Region FACE_GUIDE = {720, 180, 480, 600};
+    
+    // Camera simulation; the pixels stay in a pooled frame and copies of
+    // the image share it, so capture, saving and analysis see one buffer
     struct CameraImage {
-        std::vector<unsigned char> imageData;
+        FramePool::Handle frame;
         int width;
         int height;
+        int channels;
         std::string format; // "JPEG", "PNG", etc.
+        
+        CameraImage() : width(0), height(0), channels(0) {}
+        // False when the capture failed
+        explicit operator bool() const { return static_cast<bool>(frame); }
+        const unsigned char* data() const { return frame.data(); }
+        size_t size() const { return frame.size(); }
     };
     
     // Scanner simulation
@@ -24,43 +52,117 @@ public:
         std::string format; // "MRZ", "PDF417", etc.
     };
     
-    // RFID/NFC reader simulation
+    // RFID/NFC reader simulation: the LDS files as read from the chip
+    // and the document parsed over them in place
     struct RFIDData {
-        std::string chipData;
-        std::string securityKeys;
+        std::string com;                                         // EF.COM
+        std::string securityObject;                              // EF.SOD
+        std::string dataGroups[LdsDocument::MAX_DATA_GROUP + 1]; // [n] is DGn, empty if not read
+        LdsDocument document;
+        
+        RFIDData() = default;
+        // The document points into the files
+        RFIDData(const RFIDData&) = delete;
+        RFIDData& operator=(const RFIDData&) = delete;
+    };
+
+    // EAGER starts bringing devices up in the background on construction,
+    // DEFERRED waits until the first call that needs a device
+    enum InitializationMode {
+        EAGER,
+        DEFERRED
     };
 
 private:
-    bool cameraAvailable;
-    bool scannerAvailable;
-    bool rfidReaderAvailable;
+    // Each device is brought up exactly once; ready resolves to the result
+    struct DeviceState {
+        std::once_flag initOnce;
+        std::promise<bool> readyPromise;
+        std::shared_future<bool> ready;
+        std::atomic<bool> available;
+        
+        DeviceState() : ready(readyPromise.get_future().share()), available(false) {}
+    };
+    
+    DeviceState camera;
+    FramePool framePool;
+    ImageStore imageStore; // Declared after the pool: drained before it goes away
+    DeviceState scanner;
+    DeviceState rfidReader;
+    
+    std::once_flag initializationStarted;
+    std::mutex initMutex;
+    std::vector<std::future<void>> pendingInitializations;
     
 public:
-    HardwareInterface();
+    explicit HardwareInterface(InitializationMode mode = EAGER);
+    virtual ~HardwareInterface();
+    
+    // The device I/O (scan, capture, save, chip read) is virtual so tests
+    // can put stub devices behind PassportControlSystem
     
     // Camera functions
     bool initializeCamera();
-    std::shared_ptr<CameraImage> captureImage();
-    bool saveImage(const CameraImage& image, const std::string& filename);
+    virtual CameraImage captureImage();
+    // Queues the image for the background writer and returns at once;
+    // the future (and callback) report when it is on disk
+    virtual std::future<bool> saveImage(const CameraImage& image, const std::string& label,
+                                        ImageStore::Callback onStored = nullptr);
     
     // Scanner functions
     bool initializeScanner();
-    std::shared_ptr<ScanData> scanDocument();
+    virtual std::shared_ptr<ScanData> scanDocument();
     std::shared_ptr<Passport> parseScannedData(const ScanData& data);
     
+    // E-gate path without a document scanner: the camera photographs the
+    // data page and the MRZ is read from the frame (MrzReader)
+    CameraImage captureDocumentImage();
+    std::shared_ptr<ScanData> readMrzFromImage(const CameraImage& image);
+    
     // RFID functions
     bool initializeRFIDReader();
-    std::shared_ptr<RFIDData> readRFIDChip();
+    virtual std::shared_ptr<RFIDData> readRFIDChip();
+    // Similarity of the face at FACE_GUIDE to the chip portrait
+    // (FaceMatcher), NOT_COMPARED if either is missing; liveFace receives
+    // the descriptor of the face as aligned to the portrait
+    double matchFace(const CameraImage& image, const RFIDData& chip, FaceMatcher::Descriptor* liveFace = nullptr);
+    // The face at FACE_GUIDE as captured, for screening without a portrait
+    bool describeFace(const CameraImage& image, FaceMatcher::Descriptor& face);
     
     // Hardware status
-    bool isCameraAvailable() const { return cameraAvailable; }
-    bool isScannerAvailable() const { return scannerAvailable; }
-    bool isRFIDReaderAvailable() const { return rfidReaderAvailable; }
+    bool isCameraAvailable() const { return camera.available.load(); }
+    bool isScannerAvailable() const { return scanner.available.load(); }
+    bool isRFIDReaderAvailable() const { return rfidReader.available.load(); }
+    FramePool::Statistics getFramePoolStatistics() const { return framePool.getStatistics(); }
+    ImageStore::Statistics getImageStoreStatistics() const { return imageStore.getStatistics(); }
+    
+    // Per-device readiness; resolve once the device's initialization finishes
+    std::shared_future<bool> cameraReady() const { return camera.ready; }
+    std::shared_future<bool> scannerReady() const { return scanner.ready; }
+    std::shared_future<bool> rfidReaderReady() const { return rfidReader.ready; }
+    
+    // Start initializing all devices in parallel without waiting
+    void startHardwareInitialization();
     
     // Simulation functions
     void simulateHardwareConnection();
     std::shared_ptr<ScanData> simulateMRZScan();
-    std::shared_ptr<CameraImage> simulatePhotoCapture();
+    CameraImage simulatePhotoCapture();
+    
+protected:
+    // Actual device bring-up, run once per device. A subclass that
+    // overrides these constructs the base DEFERRED (EAGER would start them
+    // before the subclass exists), calls startHardwareInitialization()
+    // itself if wanted, and calls finishInitialization() in its destructor.
+    virtual bool connectCamera();
+    virtual bool connectScanner();
+    virtual bool connectRFIDReader();
+    // Waits for the background bring-ups started so far
+    void finishInitialization();
+    
+private:
+    bool ensureInitialized(DeviceState& device, bool (HardwareInterface::*connect)());
+    void launchInitialization(DeviceState& device, bool (HardwareInterface::*connect)());
 };
 
 #endif // HARDWARE_INTERFACE_H
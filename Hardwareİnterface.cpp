@@ -1,79 +1,186 @@
 #include "../include/HardwareInterface.h"
+#include "../include/LdsDocument.h"
 #include "../include/Passport.h"
+#include "../include/FaceMatcher.h"
+#include "../include/MrzCorrector.h"
+#include "../include/MrzReader.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <random>
 #include <chrono>
 #include <thread>
+#include <cstring>
+#include <string_view>
 
-HardwareInterface::HardwareInterface() : 
-    cameraAvailable(false), 
-    scannerAvailable(false), 
-    rfidReaderAvailable(false) {
-    // Initialize hardware simulation
-    simulateHardwareConnection();
+namespace {
+    // The simulated passenger; the camera and the chip show the same face
+    const uint64_t SIMULATED_PASSENGER = 0x5A17C0DE;
+    const int PORTRAIT_WIDTH = 240;
+    const int PORTRAIT_HEIGHT = 320;
+    const unsigned char PORTRAIT_BACKGROUND = 215;
+    
+    // One generator per capturing thread
+    std::mt19937_64& simulationGenerator() {
+        thread_local std::mt19937_64 generator(std::random_device{}());
+        return generator;
+    }
+    
+    // Noise for the simulated sensor
+    void fillSimulatedFrame(unsigned char* data, size_t size) {
+        uint64_t state = simulationGenerator()() | 1;
+        size_t i = 0;
+        for (; i + sizeof(state) <= size; i += sizeof(state)) {
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            std::memcpy(data + i, &state, sizeof(state));
+        }
+        for (; i < size; ++i) {
+            data[i] = static_cast<unsigned char>(state >> ((i % sizeof(state)) * 8));
+        }
+    }
+    
+    // The passenger standing roughly at the face guide: off by a few
+    // pixels and percent, under different light, with sensor noise
+    void renderSimulatedPassenger(unsigned char* data, int width, int height, int channels) {
+        std::mt19937_64& generator = simulationGenerator();
+        std::uniform_int_distribution<int> offset(-12, 12);
+        std::uniform_int_distribution<int> lighting(-30, 30);
+        std::uniform_int_distribution<int> noise(-8, 8);
+        std::uniform_real_distribution<double> scale(0.97, 1.03);
+        const FaceMatcher::Region& guide = HardwareInterface::FACE_GUIDE;
+        const double factor = scale(generator);
+        FaceMatcher::Region face = {guide.left + offset(generator), guide.top + offset(generator),
+                                    static_cast<int>(guide.width * factor), static_cast<int>(guide.height * factor)};
+        FaceMatcher::renderFace(SIMULATED_PASSENGER, data, width, height, channels, face, lighting(generator));
+        for (int y = std::max(face.top, 0); y < std::min(face.top + face.height, height); ++y) {
+            unsigned char* row = data + static_cast<size_t>(y) * width * channels;
+            for (int x = std::max(face.left, 0) * channels; x < std::min(face.left + face.width, width) * channels; ++x) {
+                row[x] = static_cast<unsigned char>(std::clamp(row[x] + noise(generator), 0, 255));
+            }
+        }
+    }
+}
+
+HardwareInterface::HardwareInterface(InitializationMode mode)
+    : framePool(CAMERA_WIDTH, CAMERA_HEIGHT, CAMERA_CHANNELS, FRAME_POOL_SIZE), imageStore("photos") {
+    // Bring devices up in the background; callers wait on the readiness
+    // futures or on the first use of each device
+    if (mode == EAGER) {
+        startHardwareInitialization();
+    }
+}
+
+HardwareInterface::~HardwareInterface() {
+    finishInitialization();
+}
+
+void HardwareInterface::finishInitialization() {
+    std::lock_guard<std::mutex> lock(initMutex);
+    for (auto& pending : pendingInitializations) {
+        pending.wait();
+    }
+}
+
+bool HardwareInterface::ensureInitialized(DeviceState& device, bool (HardwareInterface::*connect)()) {
+    std::call_once(device.initOnce, [this, &device, connect] {
+        bool ok = false;
+        try {
+            ok = (this->*connect)();
+        } catch (...) {
+            ok = false;
+        }
+        device.available = ok;
+        device.readyPromise.set_value(ok);
+    });
+    return device.ready.get();
+}
+
+void HardwareInterface::launchInitialization(DeviceState& device, bool (HardwareInterface::*connect)()) {
+    std::lock_guard<std::mutex> lock(initMutex);
+    pendingInitializations.push_back(std::async(std::launch::async, [this, &device, connect] {
+        ensureInitialized(device, connect);
+    }));
+}
+
+void HardwareInterface::startHardwareInitialization() {
+    std::call_once(initializationStarted, [this] {
+        launchInitialization(camera, &HardwareInterface::connectCamera);
+        launchInitialization(scanner, &HardwareInterface::connectScanner);
+        launchInitialization(rfidReader, &HardwareInterface::connectRFIDReader);
+    });
 }
 
 bool HardwareInterface::initializeCamera() {
+    return ensureInitialized(camera, &HardwareInterface::connectCamera);
+}
+
+bool HardwareInterface::connectCamera() {
     std::cout << "Initializing camera...\n";
     // Simulate camera initialization delay
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     
-    cameraAvailable = true;
     std::cout << "Camera initialized successfully.\n";
     return true;
 }
 
-std::shared_ptr<HardwareInterface::CameraImage> HardwareInterface::captureImage() {
-    if (!cameraAvailable) {
+HardwareInterface::CameraImage HardwareInterface::captureImage() {
+    // Brings the camera up on first use if it was deferred
+    if (!initializeCamera()) {
         std::cerr << "Camera not available.\n";
-        return nullptr;
+        return CameraImage();
     }
     
     std::cout << "Capturing image...\n";
     // Simulate capture delay
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     
-    auto image = std::make_shared<CameraImage>();
-    image->width = 1920;
-    image->height = 1080;
-    image->format = "JPEG";
+    CameraImage image;
+    image.frame = framePool.acquire();
+    image.width = framePool.getWidth();
+    image.height = framePool.getHeight();
+    image.channels = framePool.getChannels();
+    image.format = "JPEG";
     
-    // Simulate image data
-    image->imageData.resize(1024); // Simulated image data
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-    
-    for (size_t i = 0; i < image->imageData.size(); ++i) {
-        image->imageData[i] = static_cast<unsigned char>(dis(gen));
-    }
+    // Simulated sensor readout, a word at a time, with the passenger in
+    // front of it
+    fillSimulatedFrame(image.frame.data(), image.frame.size());
+    renderSimulatedPassenger(image.frame.data(), image.width, image.height, image.channels);
     
     std::cout << "Image captured successfully.\n";
     return image;
 }
 
-bool HardwareInterface::saveImage(const CameraImage& image, const std::string& filename) {
-    std::cout << "Saving image to " << filename << "\n";
-    // In a real implementation, this would save the image data to a file
-    // For simulation, we'll just pretend it's saved
-    std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    std::cout << "Image saved successfully.\n";
-    return true;
+std::future<bool> HardwareInterface::saveImage(const CameraImage& image, const std::string& label,
+                                               ImageStore::Callback onStored) {
+    std::cout << "Queueing image for " << label << "\n";
+    // The frame handle is queued, not the pixels
+    ImageStore::Image stored;
+    stored.pixels = image.frame;
+    stored.width = image.width;
+    stored.height = image.height;
+    stored.channels = image.channels;
+    stored.format = image.format;
+    return imageStore.save(stored, label, std::move(onStored));
 }
 
 bool HardwareInterface::initializeScanner() {
+    return ensureInitialized(scanner, &HardwareInterface::connectScanner);
+}
+
+bool HardwareInterface::connectScanner() {
     std::cout << "Initializing document scanner...\n";
     // Simulate scanner initialization delay
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     
-    scannerAvailable = true;
     std::cout << "Document scanner initialized successfully.\n";
     return true;
 }
 
 std::shared_ptr<HardwareInterface::ScanData> HardwareInterface::scanDocument() {
-    if (!scannerAvailable) {
+    if (!initializeScanner()) {
         std::cerr << "Document scanner not available.\n";
         return nullptr;
     }
@@ -91,39 +198,139 @@ std::shared_ptr<Passport> HardwareInterface::parseScannedData(const ScanData& da
         return nullptr;
     }
     
-    // Parse MRZ data
-    // In a real implementation, we would parse the actual MRZ lines
-    // For simulation, we'll create a sample passport
-    
+    // Parse MRZ data: the scanner delivers the MRZ lines separated by newlines
     std::cout << "Parsing MRZ data...\n";
-    auto passport = std::make_shared<Passport>();
+    std::string_view raw(data.rawData);
+    size_t lineBreak = raw.find('\n');
+    if (lineBreak == std::string_view::npos) {
+        std::cerr << "Incomplete MRZ data\n";
+        return nullptr;
+    }
+    
+    std::string line1(raw.substr(0, lineBreak));
+    std::string line2(raw.substr(lineBreak + 1));
+    
+    // OCR look-alikes (0/O, 1/I, 5/S, 8/B...) are repaired against the
+    // check digits here instead of scanning the page again
+    auto start = std::chrono::steady_clock::now();
+    MrzCorrector::Result corrected = MrzCorrector::correct(raw);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    if (corrected.valid && corrected.corrections > 0 && corrected.lineCount == 2) {
+        std::cout << "MRZ corrected: " << corrected.corrections << " characters in " << elapsed.count()
+                  << " us (confidence " << corrected.confidence << ").\n";
+        line1 = corrected.lines[0];
+        line2 = corrected.lines[1];
+    }
     
-    // Set sample data
-    passport->setPassportNumber("P12345678");
-    passport->setFirstName("JOHN");
-    passport->setLastName("SMITH");
-    passport->setNationality("USA");
-    passport->setDateOfBirth("800101");
-    passport->setGender("M");
-    passport->setExpirationDate("251231");
-    passport->setIssuingCountry("USA");
+    auto passport = std::make_shared<Passport>();
+    if (!passport->parseMRZ(line1, line2)) {
+        std::cerr << "Malformed MRZ data\n";
+        return nullptr;
+    }
     
     std::cout << "MRZ data parsed successfully.\n";
     return passport;
 }
 
+HardwareInterface::CameraImage HardwareInterface::captureDocumentImage() {
+    if (!initializeCamera()) {
+        std::cerr << "Camera not available.\n";
+        return CameraImage();
+    }
+    
+    CameraImage image;
+    image.frame = framePool.acquire();
+    image.width = framePool.getWidth();
+    image.height = framePool.getHeight();
+    image.channels = framePool.getChannels();
+    image.format = "RAW";
+    
+    // Simulated data page: light paper with the sample MRZ printed near
+    // the bottom edge
+    std::memset(image.frame.data(), 0xE8, image.frame.size());
+    auto scan = simulateMRZScan();
+    std::string_view raw(scan->rawData);
+    size_t lineBreak = raw.find('\n');
+    std::vector<std::string> lines = {std::string(raw.substr(0, lineBreak)), std::string(raw.substr(lineBreak + 1))};
+    const int scale = 4;
+    const int textWidth = static_cast<int>(lines[0].size()) * MrzReader::GLYPH_PITCH * scale;
+    const int textHeight = (MrzReader::LINE_PITCH + MrzReader::GLYPH_ROWS) * scale;
+    MrzReader::render(lines, image.frame.data(), image.width, image.height, image.channels, scale,
+                      (image.width - textWidth) / 2, image.height - textHeight - 60);
+    return image;
+}
+
+std::shared_ptr<HardwareInterface::ScanData> HardwareInterface::readMrzFromImage(const CameraImage& image) {
+    if (!image) {
+        return nullptr;
+    }
+    
+    // Readers keep scratch buffers; one per capturing thread
+    thread_local MrzReader reader;
+    auto start = std::chrono::steady_clock::now();
+    MrzReader::Result result = reader.read(image.data(), image.width, image.height, image.channels);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    if (!result.found) {
+        std::cerr << "No MRZ found in camera frame.\n";
+        return nullptr;
+    }
+    
+    std::cout << "MRZ read from camera frame in " << elapsed.count() << " us (confidence "
+              << result.confidence << ", " << result.uncertainCharacters << " uncertain characters).\n";
+    auto scanData = std::make_shared<ScanData>();
+    scanData->format = "MRZ";
+    for (size_t i = 0; i < result.lineCount; ++i) {
+        scanData->rawData += (i > 0 ? "\n" : "") + result.lines[i];
+    }
+    return scanData;
+}
+
+double HardwareInterface::matchFace(const CameraImage& image, const RFIDData& chip, FaceMatcher::Descriptor* liveFace) {
+    // Only simulated chips carry a portrait the matcher can read; JPEG
+    // and JPEG 2000 would need decoding first
+    const LdsDocument::Portrait& portrait = chip.document.getPortrait();
+    if (!image || portrait.image.empty() || portrait.imageType != LdsDocument::IMAGE_RAW_GRAY) {
+        return FaceMatcher::NOT_COMPARED;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    FaceMatcher::Descriptor reference;
+    if (!FaceMatcher::extract(reinterpret_cast<const unsigned char*>(portrait.image.data()), portrait.width,
+                              portrait.height, 1, FaceMatcher::portraitRegion(portrait.width, portrait.height),
+                              reference)) {
+        std::cerr << "Chip portrait has no usable face.\n";
+        return FaceMatcher::NOT_COMPARED;
+    }
+    const double similarity = FaceMatcher::match(reference, image.data(), image.width, image.height, image.channels,
+                                                 FACE_GUIDE, liveFace);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Face compared with chip portrait in " << elapsed.count() << " us (similarity "
+              << similarity << ").\n";
+    return similarity;
+}
+
+bool HardwareInterface::describeFace(const CameraImage& image, FaceMatcher::Descriptor& face) {
+    return image && FaceMatcher::extract(image.data(), image.width, image.height, image.channels, FACE_GUIDE, face);
+}
+
 bool HardwareInterface::initializeRFIDReader() {
+    return ensureInitialized(rfidReader, &HardwareInterface::connectRFIDReader);
+}
+
+bool HardwareInterface::connectRFIDReader() {
     std::cout << "Initializing RFID reader...\n";
     // Simulate RFID reader initialization delay
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     
-    rfidReaderAvailable = true;
     std::cout << "RFID reader initialized successfully.\n";
     return true;
 }
 
 std::shared_ptr<HardwareInterface::RFIDData> HardwareInterface::readRFIDChip() {
-    if (!rfidReaderAvailable) {
+    if (!initializeRFIDReader()) {
         std::cerr << "RFID reader not available.\n";
         return nullptr;
     }
@@ -132,16 +339,49 @@ std::shared_ptr<HardwareInterface::RFIDData> HardwareInterface::readRFIDChip() {
     // Simulate RFID read delay
     std::this_thread::sleep_for(std::chrono::milliseconds(2000));
     
+    // The simulated chip: DG1 from the data page MRZ, DG2 the portrait,
+    // and the SOD over both
     auto rfidData = std::make_shared<RFIDData>();
-    rfidData->chipData = "RFID_CHIP_DATA_SAMPLE";
-    rfidData->securityKeys = "SECURITY_KEYS_SAMPLE";
+    std::string mrz = simulateMRZScan()->rawData;
+    mrz.erase(std::remove(mrz.begin(), mrz.end(), '\n'), mrz.end());
+    std::vector<unsigned char> portrait(static_cast<size_t>(PORTRAIT_WIDTH) * PORTRAIT_HEIGHT, PORTRAIT_BACKGROUND);
+    FaceMatcher::renderFace(SIMULATED_PASSENGER, portrait.data(), PORTRAIT_WIDTH, PORTRAIT_HEIGHT, 1,
+                            FaceMatcher::portraitRegion(PORTRAIT_WIDTH, PORTRAIT_HEIGHT));
+    rfidData->dataGroups[1] = LdsDocument::encodeDataGroup1(mrz);
+    rfidData->dataGroups[2] = LdsDocument::encodeDataGroup2(portrait.data(), PORTRAIT_WIDTH, PORTRAIT_HEIGHT);
+    rfidData->com = LdsDocument::encodeCom((1u << 1) | (1u << 2));
+    rfidData->securityObject = LdsDocument::encodeSecurityObject(rfidData->dataGroups);
+    
+    // A file that does not parse is left out; verification then fails on
+    // the missing part rather than the read
+    auto start = std::chrono::steady_clock::now();
+    LdsDocument& document = rfidData->document;
+    std::string error;
+    if (!document.parseCom(rfidData->com, error)) {
+        std::cerr << "Chip file unreadable: " << error << "\n";
+    }
+    if (!document.parseSecurityObject(rfidData->securityObject, error)) {
+        std::cerr << "Chip file unreadable: " << error << "\n";
+    }
+    for (int number = 1; number <= LdsDocument::MAX_DATA_GROUP; ++number) {
+        if (!rfidData->dataGroups[number].empty() &&
+            !document.parseDataGroup(number, rfidData->dataGroups[number], error)) {
+            std::cerr << "Chip file unreadable: " << error << "\n";
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
     
+    std::cout << "RFID chip parsed in " << elapsed.count() << " us (LDS "
+              << std::string(document.getLdsVersion()) << ").\n";
     std::cout << "RFID chip read successfully.\n";
     return rfidData;
 }
 
 void HardwareInterface::simulateHardwareConnection() {
     std::cout << "Simulating hardware connection...\n";
+    // Devices come up in parallel; already initialized ones are not redone
+    startHardwareInitialization();
     initializeCamera();
     initializeScanner();
     initializeRFIDReader();
@@ -151,11 +391,11 @@ void HardwareInterface::simulateHardwareConnection() {
 std::shared_ptr<HardwareInterface::ScanData> HardwareInterface::simulateMRZScan() {
     auto scanData = std::make_shared<ScanData>();
     scanData->format = "MRZ";
-    scanData->rawData = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<\n"
-                        "P12345678<8USA800101<M251231<<<<<<<<<<";
+    scanData->rawData = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<\n"
+                        "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6";
     return scanData;
 }
 
-std::shared_ptr<HardwareInterface::CameraImage> HardwareInterface::simulatePhotoCapture() {
+HardwareInterface::CameraImage HardwareInterface::simulatePhotoCapture() {
     return captureImage();
 }
@@ -0,0 +1,348 @@
+#include "../include/ImageStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char OBJECT_MAGIC[8] = {'P', 'C', 'I', 'M', 'G', '1', '\0', '\0'};
+
+    // Fixed object header, followed by the pixels
+    struct ObjectHeader {
+        char magic[8];
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        uint32_t reserved;
+        char format[8];
+    };
+
+    ObjectHeader makeHeader(const ImageStore::Image& image) {
+        ObjectHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, OBJECT_MAGIC, sizeof(header.magic));
+        header.width = static_cast<uint32_t>(image.width);
+        header.height = static_cast<uint32_t>(image.height);
+        header.channels = static_cast<uint32_t>(image.channels);
+        std::memcpy(header.format, image.format.data(), std::min(image.format.size(), sizeof(header.format)));
+        return header;
+    }
+
+    uint64_t rotateLeft(uint64_t value, unsigned bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t finalize(uint64_t value) {
+        value = (value ^ (value >> 33)) * 0xff51afd7ed558ccdULL;
+        value = (value ^ (value >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+        return value ^ (value >> 33);
+    }
+
+#ifndef _WIN32
+    bool syncDirectory(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+#endif
+}
+
+ImageStore::ImageStore(const std::string& directory)
+    : directory(directory), objectDirectory(directory + "/objects"), stopping(false), completedCount(0),
+      directoryReady(false), queued(0), written(0), duplicates(0), failed(0), batches(0), bytesWritten(0) {
+    writerThread = std::thread(&ImageStore::writerLoop, this);
+}
+
+ImageStore::~ImageStore() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    writerWake.notify_all();
+    writerThread.join();
+}
+
+std::string ImageStore::contentId(const Image& image) {
+    // Two 64-bit lanes over the pixels, 16 bytes per step, seeded with
+    // the geometry so equal bytes in another shape get another id
+    const unsigned char* data = image.pixels.data();
+    const size_t size = image.pixels.size();
+    uint64_t h1 = 0x9e3779b97f4a7c15ULL ^ (static_cast<uint64_t>(image.width) << 32 | static_cast<uint32_t>(image.height));
+    uint64_t h2 = 0xc2b2ae3d27d4eb4fULL ^ (static_cast<uint64_t>(image.channels) << 32 | size);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint64_t a, b;
+        std::memcpy(&a, data + i, sizeof(a));
+        std::memcpy(&b, data + i + 8, sizeof(b));
+        h1 = rotateLeft(h1 ^ (a * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+        h2 = rotateLeft(h2 ^ (b * 0x4cf5ad432745937fULL), 33) * 0x87c37b91114253d5ULL;
+    }
+    uint64_t tail[2] = {0, 0};
+    std::memcpy(tail, data + i, size - i);
+    h1 = rotateLeft(h1 ^ (tail[0] * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+    h2 = rotateLeft(h2 ^ (tail[1] * 0x4cf5ad432745937fULL), 33) * 0x87c37b91114253d5ULL;
+
+    h1 += h2;
+    h2 += h1;
+    h1 = finalize(h1);
+    h2 = finalize(h2);
+    h1 += h2;
+    h2 += h1;
+
+    char id[33];
+    std::snprintf(id, sizeof(id), "%016llx%016llx", static_cast<unsigned long long>(h1),
+                  static_cast<unsigned long long>(h2));
+    return std::string(id, 32);
+}
+
+std::string ImageStore::objectPath(const std::string& contentId) const {
+    return objectDirectory + "/" + contentId + ".img";
+}
+
+std::future<bool> ImageStore::save(const Image& image, const std::string& label, Callback callback) {
+    Job job;
+    job.image = image;
+    job.label = label;
+    job.callback = std::move(callback);
+    job.stored = false;
+    std::future<bool> durable = job.durable.get_future();
+
+    if (!image.pixels) {
+        job.durable.set_value(false);
+        failed.fetch_add(1, std::memory_order_relaxed);
+        return durable;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueProgress.wait(lock, [this] { return jobs.size() < MAX_PENDING; });
+        jobs.push_back(std::move(job));
+        queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    writerWake.notify_one();
+    return durable;
+}
+
+void ImageStore::flush() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    const uint64_t target = queued.load();
+    queueProgress.wait(lock, [this, target] { return completedCount >= target; });
+}
+
+void ImageStore::writerLoop() {
+    std::vector<Job> batch;
+    batch.reserve(MAX_BATCH);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            writerWake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            while (!jobs.empty() && batch.size() < MAX_BATCH) {
+                batch.push_back(std::move(jobs.front()));
+                jobs.pop_front();
+            }
+        }
+        queueProgress.notify_all();
+
+        writeBatch(batch);
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            completedCount += batch.size();
+        }
+        queueProgress.notify_all();
+        batch.clear();
+    }
+}
+
+bool ImageStore::prepareDirectories() {
+    if (!directoryReady) {
+        std::error_code error;
+        std::filesystem::create_directories(objectDirectory, error);
+        directoryReady = !error;
+        if (error) {
+            std::cerr << "Cannot create image directory " << objectDirectory << ": " << error.message() << "\n";
+        }
+    }
+    return directoryReady;
+}
+
+bool ImageStore::writeObject(const Image& image, const std::string& path) {
+    const std::string temporary = path + ".tmp";
+    ObjectHeader header = makeHeader(image);
+
+#ifndef _WIN32
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Cannot create " << temporary << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // Header and pixels in one gather write; loop on short writes
+    struct iovec parts[2];
+    parts[0].iov_base = &header;
+    parts[0].iov_len = sizeof(header);
+    parts[1].iov_base = image.pixels.data();
+    parts[1].iov_len = image.pixels.size();
+    struct iovec* part = parts;
+    int partCount = 2;
+    off_t offset = 0;
+    bool ok = true;
+    while (partCount > 0) {
+        ssize_t count = pwritev(fd, part, partCount, offset);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        offset += count;
+        size_t remaining = static_cast<size_t>(count);
+        while (partCount > 0 && remaining >= part->iov_len) {
+            remaining -= part->iov_len;
+            ++part;
+            --partCount;
+        }
+        if (partCount > 0) {
+            part->iov_base = static_cast<char*>(part->iov_base) + remaining;
+            part->iov_len -= remaining;
+        }
+    }
+    ok = ok && fdatasync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+#else
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(image.pixels.data()), static_cast<std::streamsize>(image.pixels.size()));
+    file.close();
+    bool ok = static_cast<bool>(file);
+#endif
+
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot write image " << path << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    bytesWritten.fetch_add(sizeof(header) + image.pixels.size(), std::memory_order_relaxed);
+    return true;
+}
+
+bool ImageStore::appendLog(const std::string& records) {
+    const std::string path = directory + "/photos.log";
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const char* data = records.data();
+    size_t remaining = records.size();
+    bool ok = true;
+    while (remaining > 0) {
+        ssize_t count = ::write(fd, data, remaining);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        data += count;
+        remaining -= static_cast<size_t>(count);
+    }
+    ok = ok && fdatasync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#else
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << records;
+    file.close();
+    return static_cast<bool>(file);
+#endif
+}
+
+void ImageStore::writeBatch(std::vector<Job>& batch) {
+    const bool ready = prepareDirectories();
+    const long long now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::string records;
+    bool wroteObjects = false;
+    for (Job& job : batch) {
+        if (!ready) {
+            break;
+        }
+        job.contentId = contentId(job.image);
+        const std::string path = objectPath(job.contentId);
+        std::error_code error;
+        if (knownObjects.count(job.contentId) != 0 || std::filesystem::exists(path, error)) {
+            duplicates.fetch_add(1, std::memory_order_relaxed);
+            job.stored = true;
+        } else if (writeObject(job.image, path)) {
+            written.fetch_add(1, std::memory_order_relaxed);
+            wroteObjects = true;
+            job.stored = true;
+        }
+        if (job.stored) {
+            knownObjects.insert(job.contentId);
+            records += std::to_string(now) + " " + job.contentId + " " + job.label + "\n";
+        }
+    }
+
+    // One directory sync makes every rename in the batch durable, one
+    // log append records every visit
+    bool durable = ready;
+#ifndef _WIN32
+    if (wroteObjects) {
+        durable = syncDirectory(objectDirectory) && durable;
+    }
+#endif
+    if (!records.empty()) {
+        durable = appendLog(records) && durable;
+    }
+
+    for (Job& job : batch) {
+        const bool stored = job.stored && durable;
+        if (!stored) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        // The frame goes back to the pool before anyone is told
+        job.image.pixels.reset();
+        job.durable.set_value(stored);
+        if (job.callback) {
+            job.callback(stored, job.contentId);
+        }
+    }
+    batches.fetch_add(1, std::memory_order_relaxed);
+}
+
+ImageStore::Statistics ImageStore::getStatistics() const {
+    Statistics statistics;
+    statistics.written = written.load();
+    statistics.duplicates = duplicates.load();
+    statistics.failed = failed.load();
+    statistics.batches = batches.load();
+    statistics.bytesWritten = bytesWritten.load();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        statistics.queued = queued.load();
+        statistics.pending = static_cast<size_t>(statistics.queued - completedCount);
+    }
+    return statistics;
+}
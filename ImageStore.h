@@ -0,0 +1,122 @@
+#ifndef IMAGE_STORE_H
+#define IMAGE_STORE_H
+
+#include "FramePool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Content-addressed image store with a background writer.
+//
+// save() queues the frame handle (no pixel copy) and returns at once; the
+// writer thread takes up to MAX_BATCH queued images at a time. Each image
+// is stored as objects/<content id>.img, the id being a 128-bit hash of
+// the pixels and geometry, so a frame seen before is not written again.
+// Every save, duplicate or not, appends "<unix time> <id> <label>" to
+// photos.log; earlier visits are never overwritten.
+//
+// Objects are written with one pwritev() (header and pixels) to a
+// temporary name, synced and renamed. Per batch the directory and the log
+// are synced once, then the futures and callbacks report durability.
+// Without POSIX I/O the writer falls back to ofstream and rename.
+//
+// The queue holds at most MAX_PENDING images; save() waits for room
+// beyond that, which bounds the memory a stalled disk can pin. Queued
+// images keep their frames: the camera's pool has only
+// HardwareInterface::FRAME_POOL_SIZE, so the rest are heap frames, and at
+// 1920x1080x3 the bound is about 400 MB of pixels, not pool use.
+class ImageStore {
+public:
+    static const size_t MAX_BATCH = 16;
+    static const size_t MAX_PENDING = 64;
+
+    // Called on the writer thread once the image is durable (or failed)
+    using Callback = std::function<void(bool stored, const std::string& contentId)>;
+
+    struct Image {
+        FramePool::Handle pixels;
+        int width;
+        int height;
+        int channels;
+        std::string format;
+    };
+
+    struct Statistics {
+        uint64_t queued;
+        uint64_t written;      // new objects
+        uint64_t duplicates;   // already stored, only logged
+        uint64_t failed;
+        uint64_t batches;
+        uint64_t bytesWritten;
+        size_t pending;
+    };
+
+private:
+    struct Job {
+        Image image;
+        std::string label;
+        Callback callback;
+        std::promise<bool> durable;
+        std::string contentId;
+        bool stored;
+    };
+
+    const std::string directory;
+    const std::string objectDirectory;
+
+    mutable std::mutex queueMutex;
+    std::condition_variable writerWake;
+    std::condition_variable queueProgress;
+    std::deque<Job> jobs;
+    bool stopping;
+    uint64_t completedCount;   // guarded by queueMutex
+
+    std::unordered_set<std::string> knownObjects;   // writer thread only
+    bool directoryReady;                             // writer thread only
+
+    std::atomic<uint64_t> queued;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> duplicates;
+    std::atomic<uint64_t> failed;
+    std::atomic<uint64_t> batches;
+    std::atomic<uint64_t> bytesWritten;
+
+    std::thread writerThread;
+
+    void writerLoop();
+    void writeBatch(std::vector<Job>& batch);
+    bool prepareDirectories();
+    bool writeObject(const Image& image, const std::string& path);
+    bool appendLog(const std::string& records);
+
+public:
+    explicit ImageStore(const std::string& directory);
+    // Stores everything still queued before returning
+    ~ImageStore();
+
+    ImageStore(const ImageStore&) = delete;
+    ImageStore& operator=(const ImageStore&) = delete;
+
+    // Queues the image; the future turns true once it is on disk
+    std::future<bool> save(const Image& image, const std::string& label, Callback callback = nullptr);
+
+    // Waits until everything queued so far has been stored
+    void flush();
+
+    static std::string contentId(const Image& image);
+    std::string objectPath(const std::string& contentId) const;
+    const std::string& getDirectory() const { return directory; }
+
+    Statistics getStatistics() const;
+};
+
+#endif // IMAGE_STORE_H
@@ -0,0 +1,237 @@
+#include "../include/LaneScheduler.h"
+#include <iostream>
+
+LaneScheduler::LaneScheduler(size_t laneCount, size_t workerCount) :
+    workerCount(workerCount == 0 ? laneCount : workerCount),
+    pending(0),
+    stopped(false),
+    running(false),
+    submitGeneration(0),
+    submitted(0),
+    processed(0),
+    succeeded(0),
+    stolen(0) {
+    if (laneCount == 0) {
+        laneCount = 1;
+        if (this->workerCount == 0) {
+            this->workerCount = 1;
+        }
+    }
+
+    for (size_t i = 0; i < laneCount; ++i) {
+        lanes.push_back(std::make_unique<Lane>());
+    }
+    for (auto& counter : processedPerClass) {
+        counter = 0;
+    }
+}
+
+LaneScheduler::~LaneScheduler() {
+    stop();
+}
+
+void LaneScheduler::start() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (running) {
+        return;
+    }
+
+    running = true;
+    stopped = false;
+    startTime = std::chrono::steady_clock::now();
+    lastCompletion = startTime;
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&LaneScheduler::workerLoop, this, i);
+    }
+}
+
+void LaneScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopped = true;
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    workAvailable.notify_all();
+
+    // Workers drain whatever is still queued before exiting
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+void LaneScheduler::waitIdle() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allIdle.wait(lock, [this] { return pending == 0; });
+}
+
+bool LaneScheduler::submit(size_t lane, PriorityClass priority, Task task) {
+    if (!task || priority < 0 || priority >= PRIORITY_CLASS_COUNT) {
+        return false;
+    }
+
+    Lane& target = *lanes[lane % lanes.size()];
+    {
+        // Under the state lock, so a task is either refused or seen by the
+        // workers stop() waits for
+        std::lock_guard<std::mutex> state(stateMutex);
+        if (stopped) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(target.queueMutex);
+            target.queues[priority].push_back(std::move(task));
+        }
+        ++pending;
+        ++submitGeneration;
+    }
+    submitted++;
+    workAvailable.notify_one();
+    return true;
+}
+
+bool LaneScheduler::popFromLane(size_t lane, Task& task, PriorityClass& priority) {
+    Lane& source = *lanes[lane];
+    std::lock_guard<std::mutex> lock(source.queueMutex);
+
+    for (int p = 0; p < PRIORITY_CLASS_COUNT; ++p) {
+        auto& queue = source.queues[p];
+        if (!queue.empty()) {
+            task = std::move(queue.front());
+            queue.pop_front();
+            priority = static_cast<PriorityClass>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LaneScheduler::stealFromLane(size_t lane, Task& task, PriorityClass& priority) {
+    Lane& victim = *lanes[lane];
+    // Don't wait on a busy booth, just try the next one
+    std::unique_lock<std::mutex> lock(victim.queueMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+
+    for (int p = 0; p < PRIORITY_CLASS_COUNT; ++p) {
+        auto& queue = victim.queues[p];
+        if (!queue.empty()) {
+            // Take from the tail so the owning booth keeps its arrival order
+            task = std::move(queue.back());
+            queue.pop_back();
+            priority = static_cast<PriorityClass>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LaneScheduler::takeTask(size_t homeLane, Task& task, PriorityClass& priority, size_t& servedLane) {
+    if (popFromLane(homeLane, task, priority)) {
+        servedLane = homeLane;
+        return true;
+    }
+
+    // Home lane is empty: look for work at the other booths
+    for (size_t offset = 1; offset < lanes.size(); ++offset) {
+        size_t victim = (homeLane + offset) % lanes.size();
+        if (stealFromLane(victim, task, priority)) {
+            servedLane = victim;
+            stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LaneScheduler::workerLoop(size_t workerIndex) {
+    const size_t homeLane = workerIndex % lanes.size();
+
+    while (true) {
+        Task task;
+        PriorityClass priority = STANDARD;
+        size_t servedLane = homeLane;
+        const uint64_t seenGeneration = submitGeneration.load();
+
+        if (takeTask(homeLane, task, priority, servedLane)) {
+            bool ok = false;
+            try {
+                ok = task();
+            } catch (const std::exception& e) {
+                std::cerr << "Lane " << servedLane << " task failed: " << e.what() << "\n";
+            } catch (...) {
+                std::cerr << "Lane " << servedLane << " task failed with unknown error\n";
+            }
+
+            processed++;
+            if (ok) {
+                succeeded++;
+            }
+            processedPerClass[priority]++;
+            lanes[servedLane]->processed++;
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            lastCompletion = std::chrono::steady_clock::now();
+            if (--pending == 0) {
+                allIdle.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing found anywhere; sleep until something new is submitted.
+        // Comparing generations catches submits that raced with the scan.
+        std::unique_lock<std::mutex> lock(stateMutex);
+        if (!running) {
+            // Exit only if nothing was submitted since the scan
+            if (submitGeneration.load() == seenGeneration) {
+                return;
+            }
+            continue;
+        }
+        workAvailable.wait(lock, [this, seenGeneration] {
+            return !running || submitGeneration.load() != seenGeneration;
+        });
+    }
+}
+
+LaneScheduler::Statistics LaneScheduler::getStatistics() const {
+    Statistics stats;
+    stats.laneCount = lanes.size();
+    stats.workerCount = workerCount;
+    stats.submitted = submitted.load();
+    stats.processed = processed.load();
+    stats.succeeded = succeeded.load();
+    stats.stolen = stolen.load();
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        auto end = running ? std::chrono::steady_clock::now() : lastCompletion;
+        stats.elapsedSeconds = std::chrono::duration<double>(end - startTime).count();
+    }
+    stats.passengersPerSecond = stats.elapsedSeconds > 0.0 ?
+        static_cast<double>(stats.processed) / stats.elapsedSeconds : 0.0;
+
+    for (const auto& lane : lanes) {
+        stats.processedPerLane.push_back(lane->processed.load());
+    }
+    for (const auto& counter : processedPerClass) {
+        stats.processedPerClass.push_back(counter.load());
+    }
+    return stats;
+}
+
+const char* LaneScheduler::priorityToString(PriorityClass priority) {
+    switch (priority) {
+        case CREW:       return "CREW";
+        case DIPLOMATIC: return "DIPLOMATIC";
+        case EGATE:      return "EGATE";
+        case STANDARD:   return "STANDARD";
+        default:         return "UNKNOWN";
+    }
+}
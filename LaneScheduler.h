@@ -0,0 +1,103 @@
+#ifndef LANE_SCHEDULER_H
+#define LANE_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs passenger transactions for a row of booths (lanes) on a pool of
+// worker threads. Each lane has its own queue per priority class; a worker
+// serves its home lane first and steals from other lanes when it runs dry.
+class LaneScheduler {
+public:
+    // Lower value = served first
+    enum PriorityClass {
+        CREW,
+        DIPLOMATIC,
+        EGATE,
+        STANDARD,
+        PRIORITY_CLASS_COUNT
+    };
+
+    // A passenger transaction; returns true if it completed successfully
+    using Task = std::function<bool()>;
+
+    struct Statistics {
+        size_t laneCount;
+        size_t workerCount;
+        uint64_t submitted;
+        uint64_t processed;
+        uint64_t succeeded;
+        uint64_t stolen;
+        double elapsedSeconds;
+        double passengersPerSecond;
+        std::vector<uint64_t> processedPerLane;
+        std::vector<uint64_t> processedPerClass;
+    };
+
+private:
+    struct Lane {
+        std::mutex queueMutex;
+        std::deque<Task> queues[PRIORITY_CLASS_COUNT];
+        std::atomic<uint64_t> processed{0};
+    };
+
+    std::vector<std::unique_ptr<Lane>> lanes;
+    std::vector<std::thread> workers;
+    size_t workerCount;
+
+    mutable std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allIdle;
+    size_t pending;   // queued or running tasks
+    bool stopped;     // from stop() to the next start(); submits are refused
+    std::atomic<bool> running;
+    std::atomic<uint64_t> submitGeneration;
+
+    std::atomic<uint64_t> submitted;
+    std::atomic<uint64_t> processed;
+    std::atomic<uint64_t> succeeded;
+    std::atomic<uint64_t> stolen;
+    std::atomic<uint64_t> processedPerClass[PRIORITY_CLASS_COUNT];
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastCompletion;
+
+public:
+    // workerCount == 0 means one worker per lane
+    explicit LaneScheduler(size_t laneCount, size_t workerCount = 0);
+    ~LaneScheduler();
+
+    LaneScheduler(const LaneScheduler&) = delete;
+    LaneScheduler& operator=(const LaneScheduler&) = delete;
+
+    // Scheduler control
+    void start();
+    void stop();
+    void waitIdle();
+    bool isRunning() const { return running.load(); }
+
+    // Queue a passenger at a booth; false after stop(). Tasks submitted
+    // before start() wait for the workers.
+    bool submit(size_t lane, PriorityClass priority, Task task);
+
+    size_t getLaneCount() const { return lanes.size(); }
+    size_t getWorkerCount() const { return workerCount; }
+    Statistics getStatistics() const;
+
+    static const char* priorityToString(PriorityClass priority);
+
+private:
+    void workerLoop(size_t workerIndex);
+    bool popFromLane(size_t lane, Task& task, PriorityClass& priority);
+    bool stealFromLane(size_t lane, Task& task, PriorityClass& priority);
+    bool takeTask(size_t homeLane, Task& task, PriorityClass& priority, size_t& servedLane);
+};
+
+#endif // LANE_SCHEDULER_H
@@ -0,0 +1,412 @@
+#include "../include/LdsDocument.h"
+#include "../include/Sha256.h"
+#include <cstring>
+
+namespace {
+    const uint32_t COM_TAG = 0x60;
+    const uint32_t SOD_TAG = 0x77;
+    const uint8_t DATA_GROUP_TAGS[LdsDocument::MAX_DATA_GROUP + 1] = {
+        0, 0x61, 0x75, 0x63, 0x76, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70
+    };
+
+    // EF.COM
+    const uint32_t LDS_VERSION_TAG = 0x5F01;
+    const uint32_t UNICODE_VERSION_TAG = 0x5F36;
+    const uint32_t TAG_LIST_TAG = 0x5C;
+
+    // DG1 and DG2
+    const uint32_t MRZ_TAG = 0x5F1F;
+    const uint32_t BIOMETRIC_GROUP_TAG = 0x7F61;
+    const uint32_t BIOMETRIC_TEMPLATE_TAG = 0x7F60;
+    const uint32_t BIOMETRIC_HEADER_TAG = 0xA1;
+    const uint32_t BIOMETRIC_DATA_TAG = 0x5F2E;
+    const uint32_t BIOMETRIC_DATA_ENCIPHERED_TAG = 0x7F2E;
+
+    // ISO 19794-5 facial record
+    const size_t RECORD_HEADER_BYTES = 14;
+    const size_t FACIAL_INFO_BYTES = 20;
+    const size_t FEATURE_POINT_BYTES = 8;
+    const size_t IMAGE_INFO_BYTES = 12;
+    const uint8_t FULL_FRONTAL = 1;
+
+    // ASN.1 in EF.SOD
+    const uint32_t SEQUENCE = 0x30;
+    const uint32_t SET = 0x31;
+    const uint32_t INTEGER = 0x02;
+    const uint32_t OCTET_STRING = 0x04;
+    const uint32_t NULL_VALUE = 0x05;
+    const uint32_t OBJECT_IDENTIFIER = 0x06;
+    const uint32_t EXPLICIT_0 = 0xA0;
+    const std::string_view OID_SIGNED_DATA("\x2A\x86\x48\x86\xF7\x0D\x01\x07\x02", 9);
+    const std::string_view OID_LDS_SECURITY_OBJECT("\x67\x81\x08\x01\x01\x01", 6);
+    const std::string_view OID_SHA256("\x60\x86\x48\x01\x65\x03\x04\x02\x01", 9);
+
+    bool expect(TlvReader& reader, uint32_t tag, TlvElement& element) {
+        return reader.next(element) && element.tag == tag;
+    }
+
+    // Small non-negative INTEGER, -1 if it is not one
+    int smallInteger(std::string_view value) {
+        if (value.empty() || value.size() > 2 || (value[0] & 0x80)) {
+            return -1;
+        }
+        int result = 0;
+        for (char byte : value) {
+            result = (result << 8) | static_cast<unsigned char>(byte);
+        }
+        return result;
+    }
+
+    uint32_t readBigEndian(const unsigned char* bytes, int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    void appendBigEndian(std::string& out, uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; --i) {
+            out.push_back(static_cast<char>(value >> (i * 8)));
+        }
+    }
+
+    std::string wrap(uint32_t tag, std::string_view value) {
+        std::string out;
+        TlvReader::append(out, tag, value);
+        return out;
+    }
+}
+
+LdsDocument::LdsDocument() : listedGroups(0), securityObject(false), portrait{0, 0, 0, std::string_view()} {}
+
+uint8_t LdsDocument::dataGroupTag(int number) {
+    return number >= 1 && number <= MAX_DATA_GROUP ? DATA_GROUP_TAGS[number] : 0;
+}
+
+std::string_view LdsDocument::getDataGroup(int number) const {
+    return number >= 1 && number <= MAX_DATA_GROUP ? dataGroups[number] : std::string_view();
+}
+
+bool LdsDocument::parseCom(std::string_view file, std::string& error) {
+    TlvElement com, element;
+    if (!TlvReader::parse(file, com) || com.tag != COM_TAG) {
+        error = "EF.COM: not a COM file";
+        return false;
+    }
+    TlvReader reader(com.value);
+    uint32_t groups = 0;
+    while (reader.next(element)) {
+        if (element.tag == LDS_VERSION_TAG) {
+            ldsVersion = element.value;
+        } else if (element.tag == TAG_LIST_TAG) {
+            for (char tag : element.value) {
+                for (int number = 1; number <= MAX_DATA_GROUP; ++number) {
+                    if (DATA_GROUP_TAGS[number] == static_cast<uint8_t>(tag)) {
+                        groups |= 1u << number;
+                    }
+                }
+            }
+        }
+    }
+    if (reader.hasError()) {
+        error = "EF.COM: malformed";
+        return false;
+    }
+    listedGroups = groups;
+    return true;
+}
+
+bool LdsDocument::parseSecurityObject(std::string_view file, std::string& error) {
+    // ContentInfo > SignedData > encapContentInfo > LDSSecurityObject
+    TlvElement sod, element;
+    if (!TlvReader::parse(file, sod) || sod.tag != SOD_TAG || !TlvReader::parse(sod.value, element) ||
+        element.tag != SEQUENCE) {
+        error = "EF.SOD: not a security object";
+        return false;
+    }
+    TlvReader contentInfo(element.value);
+    if (!expect(contentInfo, OBJECT_IDENTIFIER, element) || element.value != OID_SIGNED_DATA ||
+        !expect(contentInfo, EXPLICIT_0, element) || !TlvReader::parse(element.value, element) ||
+        element.tag != SEQUENCE) {
+        error = "EF.SOD: no SignedData";
+        return false;
+    }
+    TlvReader signedData(element.value);
+    if (!expect(signedData, INTEGER, element) || !expect(signedData, SET, element) ||
+        !expect(signedData, SEQUENCE, element)) {
+        error = "EF.SOD: malformed SignedData";
+        return false;
+    }
+    TlvReader content(element.value);
+    if (!expect(content, OBJECT_IDENTIFIER, element) || element.value != OID_LDS_SECURITY_OBJECT ||
+        !expect(content, EXPLICIT_0, element) || !TlvReader::parse(element.value, element) ||
+        element.tag != OCTET_STRING || !TlvReader::parse(element.value, element) || element.tag != SEQUENCE) {
+        error = "EF.SOD: no LDS security object";
+        return false;
+    }
+    TlvReader securityObjectReader(element.value);
+    TlvElement algorithm;
+    if (!expect(securityObjectReader, INTEGER, element) || !expect(securityObjectReader, SEQUENCE, element) ||
+        !TlvReader::parse(element.value, algorithm) || algorithm.tag != OBJECT_IDENTIFIER) {
+        error = "EF.SOD: malformed LDS security object";
+        return false;
+    }
+    if (algorithm.value != OID_SHA256) {
+        error = "EF.SOD: unsupported digest algorithm";
+        return false;
+    }
+    if (!expect(securityObjectReader, SEQUENCE, element)) {
+        error = "EF.SOD: no data group digests";
+        return false;
+    }
+
+    std::string_view found[MAX_DATA_GROUP + 1];
+    TlvReader hashes(element.value);
+    TlvElement entry, number, digest;
+    while (hashes.next(entry)) {
+        TlvReader fields(entry.value);
+        if (entry.tag != SEQUENCE || !expect(fields, INTEGER, number) || !expect(fields, OCTET_STRING, digest)) {
+            error = "EF.SOD: malformed data group digest";
+            return false;
+        }
+        const int group = smallInteger(number.value);
+        if (group < 1 || group > MAX_DATA_GROUP || digest.value.size() != Sha256::DIGEST_BYTES) {
+            error = "EF.SOD: invalid digest for data group " + std::to_string(group);
+            return false;
+        }
+        found[group] = digest.value;
+    }
+    if (hashes.hasError()) {
+        error = "EF.SOD: malformed data group digests";
+        return false;
+    }
+    for (int group = 1; group <= MAX_DATA_GROUP; ++group) {
+        digests[group] = found[group];
+    }
+    securityObject = true;
+    return true;
+}
+
+bool LdsDocument::parseDataGroup(int number, std::string_view file, std::string& error) {
+    const std::string name = "DG" + std::to_string(number);
+    TlvElement group;
+    if (number < 1 || number > MAX_DATA_GROUP) {
+        error = name + ": no such data group";
+        return false;
+    }
+    if (!TlvReader::parse(file, group) || group.tag != DATA_GROUP_TAGS[number]) {
+        error = name + ": malformed";
+        return false;
+    }
+    if (number == 1 && !parseMrz(group.value, error)) {
+        error = name + ": " + error;
+        return false;
+    }
+    if (number == 2 && !parsePortrait(group.value, error)) {
+        error = name + ": " + error;
+        return false;
+    }
+    // The SOD digest covers the file as read
+    dataGroups[number] = file;
+    return true;
+}
+
+bool LdsDocument::parseMrz(std::string_view group, std::string& error) {
+    TlvReader reader(group);
+    TlvElement element;
+    if (!reader.find(MRZ_TAG, element)) {
+        error = "no MRZ";
+        return false;
+    }
+    // TD1, TD2 or TD3
+    const size_t length = element.value.size();
+    if (length != 90 && length != 72 && length != 88) {
+        error = "MRZ of " + std::to_string(length) + " characters";
+        return false;
+    }
+    mrz = element.value;
+    return true;
+}
+
+bool LdsDocument::parsePortrait(std::string_view group, std::string& error) {
+    TlvElement element;
+    TlvReader outer(group);
+    if (!outer.find(BIOMETRIC_GROUP_TAG, element)) {
+        error = "no biometric information group";
+        return false;
+    }
+    // The first template is the displayed portrait
+    TlvReader templates(element.value);
+    if (!templates.find(BIOMETRIC_TEMPLATE_TAG, element)) {
+        error = "no biometric template";
+        return false;
+    }
+    TlvReader fields(element.value);
+    std::string_view record;
+    while (fields.next(element)) {
+        if (element.tag == BIOMETRIC_DATA_TAG || element.tag == BIOMETRIC_DATA_ENCIPHERED_TAG) {
+            record = element.value;
+            break;
+        }
+    }
+    if (record.empty()) {
+        error = "no biometric data";
+        return false;
+    }
+
+    // Record header, facial information, feature points, image information,
+    // then the image
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(record.data());
+    const size_t size = record.size();
+    if (size < RECORD_HEADER_BYTES + FACIAL_INFO_BYTES + IMAGE_INFO_BYTES || std::memcmp(bytes, "FAC\0", 4) != 0 ||
+        readBigEndian(bytes + 12, 2) == 0) {
+        error = "not a facial record";
+        return false;
+    }
+    const size_t blockLength = readBigEndian(bytes + RECORD_HEADER_BYTES, 4);
+    const size_t points = readBigEndian(bytes + RECORD_HEADER_BYTES + 4, 2);
+    const size_t imageInfo = RECORD_HEADER_BYTES + FACIAL_INFO_BYTES + points * FEATURE_POINT_BYTES;
+    const size_t imageStart = imageInfo + IMAGE_INFO_BYTES;
+    if (blockLength > size - RECORD_HEADER_BYTES || imageStart > RECORD_HEADER_BYTES + blockLength) {
+        error = "truncated facial record";
+        return false;
+    }
+    Portrait found;
+    found.imageType = bytes[imageInfo + 1];
+    found.width = static_cast<int>(readBigEndian(bytes + imageInfo + 2, 2));
+    found.height = static_cast<int>(readBigEndian(bytes + imageInfo + 4, 2));
+    found.image = record.substr(imageStart, RECORD_HEADER_BYTES + blockLength - imageStart);
+    if (found.imageType == IMAGE_RAW_GRAY &&
+        found.image.size() != static_cast<size_t>(found.width) * static_cast<size_t>(found.height)) {
+        error = "portrait size does not match its dimensions";
+        return false;
+    }
+    portrait = found;
+    return true;
+}
+
+unsigned LdsDocument::verify(std::string_view printedMrz, uint32_t* mismatchedGroups) const {
+    unsigned failures = 0;
+    uint32_t mismatched = 0;
+    if (!securityObject) {
+        failures |= NO_SECURITY_OBJECT;
+    } else {
+        for (int number = 1; number <= MAX_DATA_GROUP; ++number) {
+            if (dataGroups[number].empty()) {
+                continue;
+            }
+            if (digests[number].empty()) {
+                failures |= UNSIGNED_GROUP;
+            } else if (!Sha256::matches(dataGroups[number], digests[number])) {
+                failures |= DIGEST_MISMATCH;
+                mismatched |= 1u << number;
+            }
+        }
+    }
+
+    if (!printedMrz.empty()) {
+        if (mrz.empty()) {
+            failures |= NO_MRZ;
+        } else {
+            size_t at = 0;
+            bool same = true;
+            for (char c : printedMrz) {
+                if (c == '\n' || c == '\r') {
+                    continue;
+                }
+                if (at == mrz.size() || mrz[at] != c) {
+                    same = false;
+                    break;
+                }
+                ++at;
+            }
+            if (!same || at != mrz.size()) {
+                failures |= MRZ_MISMATCH;
+            }
+        }
+    }
+
+    if (mismatchedGroups) {
+        *mismatchedGroups = mismatched;
+    }
+    return failures;
+}
+
+std::string LdsDocument::encodeCom(uint32_t groups) {
+    std::string tags;
+    for (int number = 1; number <= MAX_DATA_GROUP; ++number) {
+        if (groups & (1u << number)) {
+            tags.push_back(static_cast<char>(DATA_GROUP_TAGS[number]));
+        }
+    }
+    std::string content;
+    TlvReader::append(content, LDS_VERSION_TAG, "0107");
+    TlvReader::append(content, UNICODE_VERSION_TAG, "040000");
+    TlvReader::append(content, TAG_LIST_TAG, tags);
+    return wrap(COM_TAG, content);
+}
+
+std::string LdsDocument::encodeDataGroup1(std::string_view mrz) {
+    return wrap(DATA_GROUP_TAGS[1], wrap(MRZ_TAG, mrz));
+}
+
+std::string LdsDocument::encodeDataGroup2(const unsigned char* pixels, int width, int height) {
+    const size_t imageBytes = static_cast<size_t>(width) * height;
+    const size_t blockLength = FACIAL_INFO_BYTES + IMAGE_INFO_BYTES + imageBytes;
+
+    std::string record("FAC\0" "010\0", 8);
+    appendBigEndian(record, static_cast<uint32_t>(RECORD_HEADER_BYTES + blockLength), 4);
+    appendBigEndian(record, 1, 2);                      // faces
+    appendBigEndian(record, static_cast<uint32_t>(blockLength), 4);
+    record.append(FACIAL_INFO_BYTES - 4, '\0');         // no feature points, properties unspecified
+    record.push_back(static_cast<char>(FULL_FRONTAL));
+    record.push_back(static_cast<char>(IMAGE_RAW_GRAY));
+    appendBigEndian(record, static_cast<uint32_t>(width), 2);
+    appendBigEndian(record, static_cast<uint32_t>(height), 2);
+    record.append(IMAGE_INFO_BYTES - 6, '\0');
+    record.append(reinterpret_cast<const char*>(pixels), imageBytes);
+
+    std::string header;
+    TlvReader::append(header, 0x87, std::string_view("\x01\x01", 2));   // format owner
+    TlvReader::append(header, 0x88, std::string_view("\x00\x08", 2));   // format type
+    std::string biometricTemplate = wrap(BIOMETRIC_HEADER_TAG, header);
+    TlvReader::append(biometricTemplate, BIOMETRIC_DATA_TAG, record);
+
+    std::string informationGroup = wrap(INTEGER, "\x01");   // template count
+    TlvReader::append(informationGroup, BIOMETRIC_TEMPLATE_TAG, biometricTemplate);
+    return wrap(DATA_GROUP_TAGS[2], wrap(BIOMETRIC_GROUP_TAG, informationGroup));
+}
+
+std::string LdsDocument::encodeSecurityObject(const std::string dataGroups[MAX_DATA_GROUP + 1]) {
+    std::string algorithm = wrap(OBJECT_IDENTIFIER, OID_SHA256);
+    TlvReader::append(algorithm, NULL_VALUE, "");
+    algorithm = wrap(SEQUENCE, algorithm);
+
+    std::string hashes;
+    for (int number = 1; number <= MAX_DATA_GROUP; ++number) {
+        if (dataGroups[number].empty()) {
+            continue;
+        }
+        const Sha256::Digest digest = Sha256::hash(dataGroups[number]);
+        std::string entry = wrap(INTEGER, std::string(1, static_cast<char>(number)));
+        TlvReader::append(entry, OCTET_STRING,
+                          std::string_view(reinterpret_cast<const char*>(digest.data()), digest.size()));
+        TlvReader::append(hashes, SEQUENCE, entry);
+    }
+    std::string securityObject = wrap(INTEGER, std::string(1, '\0'));
+    securityObject += algorithm;
+    TlvReader::append(securityObject, SEQUENCE, hashes);
+
+    std::string content = wrap(OBJECT_IDENTIFIER, OID_LDS_SECURITY_OBJECT);
+    TlvReader::append(content, EXPLICIT_0, wrap(OCTET_STRING, wrap(SEQUENCE, securityObject)));
+
+    std::string signedData = wrap(INTEGER, "\x03");
+    TlvReader::append(signedData, SET, algorithm);
+    TlvReader::append(signedData, SEQUENCE, content);
+    TlvReader::append(signedData, SET, "");                 // signerInfos
+
+    std::string contentInfo = wrap(OBJECT_IDENTIFIER, OID_SIGNED_DATA);
+    TlvReader::append(contentInfo, EXPLICIT_0, wrap(SEQUENCE, signedData));
+    return wrap(SOD_TAG, wrap(SEQUENCE, contentInfo));
+}
@@ -0,0 +1,93 @@
+#ifndef LDS_DOCUMENT_H
+#define LDS_DOCUMENT_H
+
+#include "BerTlv.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// The ICAO 9303 logical data structure read from a passport chip, and
+// its passive authentication.
+//
+//   1. EF.COM lists the LDS version and the data groups on the chip
+//   2. Data groups are kept as read; DG1 gives the MRZ, DG2 the portrait
+//      (ISO 19794-5 facial record inside the biometric templates)
+//   3. EF.SOD carries the LDS security object: the SHA-256 digest of
+//      every data group, wrapped in CMS SignedData
+//   4. verify() hashes each data group read (Sha256) against its SOD
+//      digest and compares DG1 with the MRZ printed on the data page
+//
+// Parsing is in place: the document holds views into the files it was
+// given, which must outlive it. The SOD signature and the document
+// signer's certificate chain are not checked here.
+class LdsDocument {
+public:
+    static const int MAX_DATA_GROUP = 16;
+
+    // Image data types of the DG2 facial record; RAW_GRAY (8-bit
+    // pixels, row by row) is only written by simulated chips
+    static const uint8_t IMAGE_JPEG = 0;
+    static const uint8_t IMAGE_JPEG2000 = 1;
+    static const uint8_t IMAGE_RAW_GRAY = 0x80;
+
+    // verify() failures, or-ed together; 0 is a pass
+    static const unsigned NO_SECURITY_OBJECT = 1;
+    static const unsigned DIGEST_MISMATCH = 2;    // a data group was altered
+    static const unsigned UNSIGNED_GROUP = 4;     // a data group has no SOD digest
+    static const unsigned NO_MRZ = 8;             // DG1 missing
+    static const unsigned MRZ_MISMATCH = 16;      // DG1 differs from the printed MRZ
+
+    struct Portrait {
+        uint8_t imageType;
+        int width;
+        int height;
+        std::string_view image;
+    };
+
+private:
+    std::string_view dataGroups[MAX_DATA_GROUP + 1];   // [n] is DGn as read
+    std::string_view digests[MAX_DATA_GROUP + 1];      // [n] is the SOD digest of DGn
+    std::string_view ldsVersion;
+    uint32_t listedGroups;                              // bit n: DGn on the chip (EF.COM)
+    bool securityObject;
+    std::string_view mrz;
+    Portrait portrait;
+
+    bool parseMrz(std::string_view group, std::string& error);
+    bool parsePortrait(std::string_view group, std::string& error);
+
+public:
+    LdsDocument();
+
+    bool parseCom(std::string_view file, std::string& error);
+    bool parseSecurityObject(std::string_view file, std::string& error);
+    bool parseDataGroup(int number, std::string_view file, std::string& error);
+
+    // Failure bits; printedMrz may contain line breaks, and an empty one
+    // skips the MRZ comparison. mismatchedGroups receives bit n for every
+    // DGn whose digest did not match.
+    unsigned verify(std::string_view printedMrz, uint32_t* mismatchedGroups = nullptr) const;
+
+    std::string_view getLdsVersion() const { return ldsVersion; }
+    uint32_t getListedGroups() const { return listedGroups; }
+    bool hasSecurityObject() const { return securityObject; }
+    std::string_view getDataGroup(int number) const;
+    // DG1 MRZ, lines run together; empty without DG1
+    std::string_view getMrz() const { return mrz; }
+    // Empty image without DG2
+    const Portrait& getPortrait() const { return portrait; }
+
+    // File tag of DGn, 0 outside 1..MAX_DATA_GROUP
+    static uint8_t dataGroupTag(int number);
+
+    // Encoders for simulated chips and tests
+    static std::string encodeCom(uint32_t groups);
+    static std::string encodeDataGroup1(std::string_view mrz);
+    static std::string encodeDataGroup2(const unsigned char* pixels, int width, int height);
+    // Digests of the non-empty dataGroups[1..MAX_DATA_GROUP]; signerInfos
+    // is left empty
+    static std::string encodeSecurityObject(const std::string dataGroups[MAX_DATA_GROUP + 1]);
+};
+
+#endif // LDS_DOCUMENT_H
@@ -0,0 +1,110 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Structured binary log format.
+//
+// A log file is a sequence of records. Each record is a fixed 24-byte
+// header followed by argCount 16-byte argument slots. Timestamps are raw
+// steady-clock nanoseconds. Every logging session starts with a
+// MSG_SESSION_START record carrying the wall clock at that steady time, so
+// the decoder can turn timestamps into local time offline.
+
+const uint32_t BINARY_LOG_MAGIC = 0x474C4250; // "PBLG"
+const uint16_t BINARY_LOG_VERSION = 1;
+const int BINARY_LOG_MAX_ARGS = 4;
+const int BINARY_LOG_TEXT_SIZE = 16;
+
+// Message catalog; the decoder renders records through these formats.
+// Append only: ids are stored in log files.
+enum LogMessageId : uint16_t {
+    MSG_SESSION_START = 0,  // args: magic, version, wall clock ns since epoch
+    MSG_VERIFICATION_RESULT = 1,
+    MSG_DEVICE_STAGES = 2,
+    MSG_LANE_REPORT = 3,
+    MSG_ID_COUNT
+};
+
+enum LogArgumentType : uint8_t {
+    ARG_NONE = 0,
+    ARG_INT = 1,
+    ARG_DOUBLE = 2,
+    ARG_TEXT = 3  // up to 16 bytes, not NUL-terminated when full
+};
+
+struct BinaryLogRecord {
+    int64_t timestamp;       // steady clock, ns
+    uint32_t threadId;
+    uint16_t messageId;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t argTypes[BINARY_LOG_MAX_ARGS];
+    uint32_t reserved;
+
+    union Argument {
+        int64_t intValue;
+        double doubleValue;
+        char text[BINARY_LOG_TEXT_SIZE];
+    } args[BINARY_LOG_MAX_ARGS];
+
+    // Bytes actually written for this record
+    size_t encodedSize() const {
+        return offsetof(BinaryLogRecord, args) + argCount * sizeof(Argument);
+    }
+};
+
+static_assert(std::is_trivially_copyable<BinaryLogRecord>::value,
+              "binary log records are written with a raw copy");
+static_assert(offsetof(BinaryLogRecord, args) == 24, "record header layout changed");
+
+// Format strings for the catalog; "{}" is replaced by the next argument
+inline const char* logMessageFormat(uint16_t messageId) {
+    switch (messageId) {
+        case MSG_SESSION_START:       return "Binary logging session started";
+        case MSG_VERIFICATION_RESULT: return "Verification of {} finished with result {} in {} us";
+        case MSG_DEVICE_STAGES:       return "Device stages completed in {} ms";
+        case MSG_LANE_REPORT:         return "Lane report: {} passengers in {} s ({} passengers/s)";
+        default:                      return nullptr;
+    }
+}
+
+// Argument packing for Logger::logBinary()
+inline void setLogArgument(BinaryLogRecord& record, int index, int64_t value) {
+    record.argTypes[index] = ARG_INT;
+    record.args[index].intValue = value;
+}
+
+inline void setLogArgument(BinaryLogRecord& record, int index, int value) {
+    setLogArgument(record, index, static_cast<int64_t>(value));
+}
+
+inline void setLogArgument(BinaryLogRecord& record, int index, uint64_t value) {
+    setLogArgument(record, index, static_cast<int64_t>(value));
+}
+
+inline void setLogArgument(BinaryLogRecord& record, int index, double value) {
+    record.argTypes[index] = ARG_DOUBLE;
+    record.args[index].doubleValue = value;
+}
+
+inline void setLogArgument(BinaryLogRecord& record, int index, const char* text, size_t length) {
+    record.argTypes[index] = ARG_TEXT;
+    std::memset(record.args[index].text, 0, BINARY_LOG_TEXT_SIZE);
+    std::memcpy(record.args[index].text, text,
+                length < BINARY_LOG_TEXT_SIZE ? length : BINARY_LOG_TEXT_SIZE);
+}
+
+inline void setLogArgument(BinaryLogRecord& record, int index, const std::string& text) {
+    setLogArgument(record, index, text.data(), text.size());
+}
+
+inline void setLogArgument(BinaryLogRecord& record, int index, const char* text) {
+    setLogArgument(record, index, text, std::strlen(text));
+}
+
+#endif // LOG_RECORD_H
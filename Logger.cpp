@@ -1,20 +1,57 @@
 #include "../include/Logger.h"
 #include <iostream>
 #include <chrono>
+#include <ctime>
+#include <functional>
 #include <iomanip>
 #include <sstream>
 
-Logger::Logger(const std::string& filename) : filename(filename), currentLevel(INFO) {
+namespace {
+    // Entries written per batch by the asynchronous writer
+    const size_t WRITER_BATCH_SIZE = 256;
+}
+
+Logger::Logger(const std::string& filename, LogMode mode, size_t queueCapacity,
+               OverflowPolicy overflowPolicy) :
+    currentLevel(INFO),
+    filename(filename),
+    mode(mode),
+    overflowPolicy(overflowPolicy),
+    stopWriter(false),
+    writerSleeping(false),
+    enqueuedCount(0),
+    writtenCount(0),
+    droppedCount(0),
+    reportedDrops(0),
+    binaryLogEnabled(false) {
     logFile.open(filename, std::ios::app);
     if (!logFile.is_open()) {
         std::cerr << "Failed to open log file: " << filename << std::endl;
     }
+    
+    if (mode == ASYNCHRONOUS) {
+        queue = std::make_unique<LogRingBuffer<LogEntry>>(queueCapacity);
+        writerThread = std::thread(&Logger::writerLoop, this);
+    }
 }
 
 Logger::~Logger() {
+    if (writerThread.joinable()) {
+        // The writer drains the queue completely before it exits
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            stopWriter = true;
+        }
+        writerWake.notify_one();
+        writerThread.join();
+    }
+    
     if (logFile.is_open()) {
         logFile.close();
     }
+    if (binaryLogFile.is_open()) {
+        binaryLogFile.close();
+    }
 }
 
 void Logger::setLogLevel(LogLevel level) {
@@ -26,6 +63,12 @@ void Logger::log(LogLevel level, const std::string& message) {
         return; // Don't log messages below the current level
     }
     
+    if (mode == ASYNCHRONOUS) {
+        // Formatting and I/O happen on the writer thread
+        enqueue(LogEntry{level, std::chrono::system_clock::now(), message});
+        return;
+    }
+    
     std::lock_guard<std::mutex> lock(logMutex);
     
     std::string timestamp = getCurrentTimestamp();
@@ -59,6 +102,214 @@ void Logger::error(const std::string& message) {
     log(ERROR, message);
 }
 
+bool Logger::enableBinaryLog(const std::string& path) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (binaryLogFile.is_open()) {
+        return true;
+    }
+    
+    binaryLogFile.open(path, std::ios::binary | std::ios::app);
+    if (!binaryLogFile.is_open()) {
+        std::cerr << "Failed to open binary log file: " << path << std::endl;
+        return false;
+    }
+    
+    // Every session starts with a record pairing steady and wall clock
+    BinaryLogRecord session;
+    beginBinaryRecord(session, INFO, MSG_SESSION_START, 3);
+    setLogArgument(session, 0, static_cast<int64_t>(BINARY_LOG_MAGIC));
+    setLogArgument(session, 1, static_cast<int64_t>(BINARY_LOG_VERSION));
+    setLogArgument(session, 2, static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()));
+    binaryLogFile.write(reinterpret_cast<const char*>(&session), session.encodedSize());
+    
+    if (mode == ASYNCHRONOUS) {
+        binaryQueue = std::make_unique<LogRingBuffer<BinaryLogRecord>>(queue->capacity());
+    }
+    binaryLogEnabled = true;
+    return true;
+}
+
+void Logger::beginBinaryRecord(BinaryLogRecord& record, LogLevel level, LogMessageId messageId,
+                               size_t argCount) {
+    // Computed once per thread; the id only has to tell threads apart
+    thread_local const uint32_t threadId =
+        static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    record.threadId = threadId;
+    record.messageId = messageId;
+    record.level = static_cast<uint8_t>(level);
+    record.argCount = static_cast<uint8_t>(argCount);
+    record.reserved = 0;
+    for (int i = 0; i < BINARY_LOG_MAX_ARGS; ++i) {
+        record.argTypes[i] = ARG_NONE;
+    }
+}
+
+void Logger::writeBinaryRecord(const BinaryLogRecord& record) {
+    if (mode == ASYNCHRONOUS) {
+        BinaryLogRecord copy = record;
+        while (!binaryQueue->tryPush(std::move(copy))) {
+            if (overflowPolicy != BLOCK) {
+                droppedCount++;
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(writerMutex);
+                writerWake.notify_one();
+            }
+            std::this_thread::yield();
+        }
+        
+        enqueuedCount++;
+        if (writerSleeping.load()) {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            writerWake.notify_one();
+        }
+        return;
+    }
+    
+    // Buffered by the stream; flushed by flush() and on shutdown
+    std::lock_guard<std::mutex> lock(logMutex);
+    binaryLogFile.write(reinterpret_cast<const char*>(&record), record.encodedSize());
+}
+
+void Logger::flush() {
+    if (mode != ASYNCHRONOUS) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout.flush();
+        if (logFile.is_open()) {
+            logFile.flush();
+        }
+        if (binaryLogFile.is_open()) {
+            binaryLogFile.flush();
+        }
+        return;
+    }
+    
+    uint64_t target = enqueuedCount.load();
+    std::unique_lock<std::mutex> lock(writerMutex);
+    writerWake.notify_one();
+    writerProgress.wait(lock, [this, target] {
+        return writtenCount.load() >= target;
+    });
+}
+
+void Logger::enqueue(LogEntry&& entry) {
+    while (!queue->tryPush(std::move(entry))) {
+        if (overflowPolicy != BLOCK) {
+            droppedCount++;
+            return;
+        }
+        // Queue is full: make sure the writer is awake and retry
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            writerWake.notify_one();
+        }
+        std::this_thread::yield();
+    }
+    
+    enqueuedCount++;
+    // Only pay for a wake-up when the writer is actually asleep
+    if (writerSleeping.load()) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writerWake.notify_one();
+    }
+}
+
+size_t Logger::drainBatch(std::string& batch) {
+    batch.clear();
+    
+    if (overflowPolicy == DROP_AND_REPORT) {
+        uint64_t dropped = droppedCount.load();
+        if (dropped > reportedDrops) {
+            batch += "[" + formatTimestamp(std::chrono::system_clock::now()) + "] [WARNING] " +
+                     std::to_string(dropped - reportedDrops) + " log messages dropped (queue full)\n";
+            reportedDrops = dropped;
+        }
+    }
+    
+    size_t count = 0;
+    LogEntry entry;
+    while (count < WRITER_BATCH_SIZE && queue->tryPop(entry)) {
+        batch += "[" + formatTimestamp(entry.time) + "] [" + levelToString(entry.level) + "] ";
+        batch += entry.message;
+        batch += '\n';
+        ++count;
+    }
+    return count;
+}
+
+size_t Logger::drainBinaryBatch(std::string& batch) {
+    batch.clear();
+    if (!binaryQueue) {
+        return 0;
+    }
+    
+    size_t count = 0;
+    BinaryLogRecord record;
+    while (count < WRITER_BATCH_SIZE && binaryQueue->tryPop(record)) {
+        batch.append(reinterpret_cast<const char*>(&record), record.encodedSize());
+        ++count;
+    }
+    return count;
+}
+
+void Logger::writerLoop() {
+    std::string batch;
+    std::string binaryBatch;
+    
+    while (true) {
+        size_t count = drainBatch(batch);
+        if (!batch.empty()) {
+            writeLine(batch);
+        }
+        
+        // binaryQueue is set before binaryLogEnabled, which is what
+        // lets producers reach it
+        if (binaryLogEnabled.load()) {
+            size_t binaryCount = drainBinaryBatch(binaryBatch);
+            if (binaryCount > 0) {
+                binaryLogFile.write(binaryBatch.data(), binaryBatch.size());
+                binaryLogFile.flush();
+                count += binaryCount;
+            }
+        }
+        
+        if (count > 0) {
+            writtenCount += count;
+            std::lock_guard<std::mutex> lock(writerMutex);
+            writerProgress.notify_all();
+            continue;
+        }
+        
+        // Queue is empty here, so stopping loses nothing
+        std::unique_lock<std::mutex> lock(writerMutex);
+        if (stopWriter) {
+            break;
+        }
+        writerSleeping = true;
+        writerWake.wait_for(lock, std::chrono::milliseconds(100), [this] {
+            return stopWriter || enqueuedCount.load() != writtenCount.load();
+        });
+        writerSleeping = false;
+    }
+}
+
+void Logger::writeLine(const std::string& line) {
+    // One write and one flush per batch instead of per message
+    std::cout.write(line.data(), line.size());
+    std::cout.flush();
+    
+    if (logFile.is_open()) {
+        logFile.write(line.data(), line.size());
+        logFile.flush();
+    }
+}
+
 std::string Logger::levelToString(LogLevel level) {
     switch (level) {
         case DEBUG:   return "DEBUG";
@@ -70,10 +321,22 @@ std::string Logger::levelToString(LogLevel level) {
 }
 
 std::string Logger::getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
+    return formatTimestamp(std::chrono::system_clock::now());
+}
+
+std::string Logger::formatTimestamp(std::chrono::system_clock::time_point time) {
+    auto time_t = std::chrono::system_clock::to_time_t(time);
+    
+    // Reentrant conversion: the async writer and synchronous loggers may
+    // format timestamps at the same time
+    std::tm localTime;
+#ifdef _WIN32
+    localtime_s(&localTime, &time_t);
+#else
+    localtime_r(&time_t, &localTime);
+#endif
     
     std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+    ss << std::put_time(&localTime, "%Y-%m-%d %H:%M:%S");
     return ss.str();
 }
@@ -1,9 +1,17 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include "LogRingBuffer.h"
+#include "LogRecord.h"
 #include <string>
 #include <fstream>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <initializer_list>
+#include <memory>
+#include <thread>
 
 class Logger {
 public:
@@ -13,15 +21,60 @@ public:
         WARNING,
         ERROR
     };
+    
+    // SYNCHRONOUS writes on the calling thread; ASYNCHRONOUS queues the
+    // message and a background writer formats and writes it in batches
+    enum LogMode {
+        SYNCHRONOUS,
+        ASYNCHRONOUS
+    };
+    
+    // What log() does when the asynchronous queue is full.
+    // Drops are always counted; DROP_AND_REPORT also writes a warning
+    // with the number of lost messages once the queue has room again.
+    enum OverflowPolicy {
+        BLOCK,
+        DROP,
+        DROP_AND_REPORT
+    };
 
 private:
+    struct LogEntry {
+        LogLevel level;
+        std::chrono::system_clock::time_point time;
+        std::string message;
+    };
+    
     std::ofstream logFile;
     LogLevel currentLevel;
     std::mutex logMutex;
     std::string filename;
+    
+    // Asynchronous backend
+    LogMode mode;
+    OverflowPolicy overflowPolicy;
+    std::unique_ptr<LogRingBuffer<LogEntry>> queue;
+    std::thread writerThread;
+    std::atomic<bool> stopWriter;
+    std::atomic<bool> writerSleeping;
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    std::condition_variable writerProgress;
+    std::atomic<uint64_t> enqueuedCount;
+    std::atomic<uint64_t> writtenCount;
+    std::atomic<uint64_t> droppedCount;
+    uint64_t reportedDrops;
+    
+    // Structured binary log (see LogRecord.h)
+    std::ofstream binaryLogFile;
+    std::atomic<bool> binaryLogEnabled;
+    std::unique_ptr<LogRingBuffer<BinaryLogRecord>> binaryQueue;
 
 public:
-    Logger(const std::string& filename = "passport_control.log");
+    Logger(const std::string& filename = "passport_control.log",
+           LogMode mode = SYNCHRONOUS,
+           size_t queueCapacity = 8192,
+           OverflowPolicy overflowPolicy = BLOCK);
     ~Logger();
     
     void setLogLevel(LogLevel level);
@@ -31,9 +84,42 @@ public:
     void warning(const std::string& message);
     void error(const std::string& message);
     
+    // Structured records: no formatting on the calling thread, rendered
+    // to text offline by logdecoder. Enable before logging from threads.
+    bool enableBinaryLog(const std::string& path);
+    bool isBinaryLogEnabled() const { return binaryLogEnabled.load(); }
+    
+    template <typename... Args>
+    void logBinary(LogLevel level, LogMessageId messageId, const Args&... args) {
+        static_assert(sizeof...(Args) <= BINARY_LOG_MAX_ARGS, "too many binary log arguments");
+        if (level < currentLevel || !binaryLogEnabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        
+        BinaryLogRecord record;
+        beginBinaryRecord(record, level, messageId, sizeof...(Args));
+        int index = 0;
+        (void)std::initializer_list<int>{(setLogArgument(record, index++, args), 0)...};
+        (void)index;
+        writeBinaryRecord(record);
+    }
+    
+    // Waits until everything logged so far has been written
+    void flush();
+    LogMode getMode() const { return mode; }
+    uint64_t getDroppedCount() const { return droppedCount.load(); }
+    
 private:
     std::string levelToString(LogLevel level);
     std::string getCurrentTimestamp();
+    std::string formatTimestamp(std::chrono::system_clock::time_point time);
+    void writeLine(const std::string& line);
+    void enqueue(LogEntry&& entry);
+    void writerLoop();
+    size_t drainBatch(std::string& batch);
+    size_t drainBinaryBatch(std::string& batch);
+    void beginBinaryRecord(BinaryLogRecord& record, LogLevel level, LogMessageId messageId, size_t argCount);
+    void writeBinaryRecord(const BinaryLogRecord& record);
 };
 
 #endif // LOGGER_H
@@ -0,0 +1,107 @@
+#include "../include/MappedFile.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), mapped(false) {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = "cannot stat " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    if (info.st_size > 0) {
+        void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (address != MAP_FAILED) {
+            // The mapping keeps the file referenced after the descriptor is closed
+            ::close(fd);
+            bytes = static_cast<const char*>(address);
+            length = static_cast<size_t>(info.st_size);
+            mapped = true;
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    // Empty file, mmap failure or no mmap: read it instead
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0);
+    // One extra byte so data() is never null for an empty file
+    fallback.resize(static_cast<size_t>(size) + 1);
+    if (size > 0 && !file.read(fallback.data(), size)) {
+        error = "cannot read " + path;
+        fallback.clear();
+        return false;
+    }
+    bytes = fallback.data();
+    length = static_cast<size_t>(size);
+    return true;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+    std::vector<char>().swap(fallback);
+}
+
+void MappedFile::advise(size_t offset, size_t size, AccessPattern pattern) const {
+#ifndef _WIN32
+    if (!mapped || offset >= length) {
+        return;
+    }
+
+    // madvise needs a page-aligned start
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset - offset % pageSize;
+    size_t end = offset + (size < length - offset ? size : length - offset);
+
+    int advice = MADV_NORMAL;
+    switch (pattern) {
+        case SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+        case RANDOM: advice = MADV_RANDOM; break;
+        case WILL_NEED: advice = MADV_WILLNEED; break;
+        default: break;
+    }
+    madvise(const_cast<char*>(bytes) + start, end - start, advice);
+#else
+    (void)offset;
+    (void)size;
+    (void)pattern;
+#endif
+}
@@ -0,0 +1,45 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX the file is mapped shared, so
+// every process that opens the same file uses the same page-cache copy.
+// Elsewhere the contents are read into memory.
+class MappedFile {
+public:
+    enum AccessPattern {
+        NORMAL,
+        SEQUENTIAL,
+        RANDOM,
+        WILL_NEED
+    };
+
+private:
+    const char* bytes;
+    size_t length;
+    bool mapped;
+    std::vector<char> fallback;
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    bool isOpen() const { return bytes != nullptr; }
+    bool isMapped() const { return mapped; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Paging hint for part of the file; ignored when not mapped
+    void advise(size_t offset, size_t size, AccessPattern pattern) const;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,250 @@
+#include "../include/MrzCharset.h"
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MRZ_CHARSET_SSE2 1
+#endif
+
+namespace {
+    const unsigned ALPHA = MrzCharset::ALPHA;
+    const unsigned DIGIT = MrzCharset::DIGIT;
+    const unsigned FILLER = MrzCharset::FILLER;
+    const unsigned ALNUM = ALPHA | DIGIT;
+
+    // Lines are padded to three 16-byte chunks; the padding is '<' with a
+    // FILLER mask so it never reports
+    const size_t PADDED_LENGTH = 48;
+
+    enum LineTable {
+        TD1_LINE1, TD1_LINE2, TD1_LINE3,
+        TD2_LINE1, TD2_LINE2,
+        TD3_LINE1, TD3_LINE2,
+        LINE_TABLE_COUNT
+    };
+
+    struct Span {
+        unsigned start;
+        unsigned length;
+        unsigned classes;
+    };
+
+    struct MaskTable {
+        alignas(16) uint8_t masks[LINE_TABLE_COUNT][PADDED_LENGTH];
+        uint8_t lengths[LINE_TABLE_COUNT];
+
+        void fill(LineTable table, size_t length, std::initializer_list<Span> spans) {
+            std::memset(masks[table], FILLER, PADDED_LENGTH);
+            for (const Span& span : spans) {
+                std::memset(masks[table] + span.start, static_cast<int>(span.classes), span.length);
+            }
+            lengths[table] = static_cast<uint8_t>(length);
+        }
+
+        MaskTable() {
+            // Line 1 of TD2/TD3: document code, type, issuing state, name.
+            // Unused type and state positions are fillers ("P<", "D<<").
+            const Span header[] = {{0, 1, ALPHA}, {1, 4, ALPHA | FILLER}};
+
+            fill(TD1_LINE1, MrzParser::TD1_LINE_LENGTH, {
+                header[0], header[1],
+                {5, 9, ALNUM | FILLER},     // document number
+                {14, 1, DIGIT | FILLER},    // check digit, '<' when the number continues in optional data
+                {15, 15, ALNUM | FILLER}    // optional data
+            });
+            fill(TD1_LINE2, MrzParser::TD1_LINE_LENGTH, {
+                {0, 6, DIGIT | FILLER},     // date of birth, unknown parts as '<'
+                {6, 1, DIGIT},
+                {7, 1, ALPHA | FILLER},     // sex
+                {8, 6, DIGIT},              // date of expiry
+                {14, 1, DIGIT},
+                {15, 3, ALPHA | FILLER},    // nationality
+                {18, 11, ALNUM | FILLER},   // optional data
+                {29, 1, DIGIT}              // composite
+            });
+            fill(TD1_LINE3, MrzParser::TD1_LINE_LENGTH, {{0, 30, ALPHA | FILLER}});
+
+            fill(TD2_LINE1, MrzParser::TD2_LINE_LENGTH, {header[0], header[1], {5, 31, ALPHA | FILLER}});
+            fill(TD3_LINE1, MrzParser::TD3_LINE_LENGTH, {header[0], header[1], {5, 39, ALPHA | FILLER}});
+
+            // Line 2 of TD2/TD3 shares the first 28 positions
+            const Span line2[] = {
+                {0, 9, ALNUM | FILLER},     // document number
+                {9, 1, DIGIT},
+                {10, 3, ALPHA | FILLER},    // nationality
+                {13, 6, DIGIT | FILLER},    // date of birth
+                {19, 1, DIGIT},
+                {20, 1, ALPHA | FILLER},    // sex
+                {21, 6, DIGIT},             // date of expiry
+                {27, 1, DIGIT}
+            };
+            fill(TD2_LINE2, MrzParser::TD2_LINE_LENGTH, {
+                line2[0], line2[1], line2[2], line2[3], line2[4], line2[5], line2[6], line2[7],
+                {28, 7, ALNUM | FILLER},    // optional data
+                {35, 1, DIGIT}              // composite
+            });
+            fill(TD3_LINE2, MrzParser::TD3_LINE_LENGTH, {
+                line2[0], line2[1], line2[2], line2[3], line2[4], line2[5], line2[6], line2[7],
+                {28, 14, ALNUM | FILLER},   // personal number
+                {42, 1, DIGIT | FILLER},    // its check digit, '<' when empty
+                {43, 1, DIGIT}              // composite
+            });
+        }
+    };
+
+    const MaskTable& maskTable() {
+        static const MaskTable table;
+        return table;
+    }
+
+    struct FieldTextTable {
+        bool allowed[256];
+
+        FieldTextTable() {
+            for (int c = 0; c < 256; ++c) {
+                allowed[c] = MrzCharset::classify(static_cast<char>(c)) != 0 || c == ' ' || (c >= 'a' && c <= 'z');
+            }
+        }
+    };
+
+    inline int lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        int offset = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            ++offset;
+        }
+        return offset;
+#endif
+    }
+
+#ifdef MRZ_CHARSET_SSE2
+    // Bit i set when character i is not in a class allowed by mask[i]
+    uint64_t violations(const char* padded, const uint8_t* mask) {
+        const __m128i zero = _mm_setzero_si128();
+        uint64_t bad = 0;
+        for (size_t chunk = 0; chunk < PADDED_LENGTH; chunk += 16) {
+            const __m128i chars = _mm_load_si128(reinterpret_cast<const __m128i*>(padded + chunk));
+            const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+            const __m128i letters = _mm_sub_epi8(chars, _mm_set1_epi8('A'));
+            const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+            const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(25)), letters);
+            const __m128i isFiller = _mm_cmpeq_epi8(chars, _mm_set1_epi8('<'));
+
+            const __m128i classes = _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(isLetter, _mm_set1_epi8(static_cast<char>(ALPHA))),
+                             _mm_and_si128(isDigit, _mm_set1_epi8(static_cast<char>(DIGIT)))),
+                _mm_and_si128(isFiller, _mm_set1_epi8(static_cast<char>(FILLER))));
+            const __m128i allowed = _mm_and_si128(
+                classes, _mm_load_si128(reinterpret_cast<const __m128i*>(mask + chunk)));
+            bad |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(allowed, zero))) << chunk;
+        }
+        return bad;
+    }
+#else
+    uint64_t violations(const char* padded, const uint8_t* mask) {
+        uint64_t bad = 0;
+        for (size_t i = 0; i < PADDED_LENGTH; ++i) {
+            if ((MrzCharset::classify(padded[i]) & mask[i]) == 0) {
+                bad |= 1ULL << i;
+            }
+        }
+        return bad;
+    }
+#endif
+
+    LineTable lineTable(MrzFields::Layout layout, unsigned lineIndex) {
+        switch (layout) {
+            case MrzFields::TD1:
+                return lineIndex == 0 ? TD1_LINE1 : lineIndex == 1 ? TD1_LINE2 : TD1_LINE3;
+            case MrzFields::TD2:
+                return lineIndex == 0 ? TD2_LINE1 : TD2_LINE2;
+            case MrzFields::TD3:
+            default:
+                return lineIndex == 0 ? TD3_LINE1 : TD3_LINE2;
+        }
+    }
+}
+
+unsigned MrzCharset::classify(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return ALPHA;
+    }
+    if (c >= '0' && c <= '9') {
+        return DIGIT;
+    }
+    return c == '<' ? FILLER : 0;
+}
+
+unsigned MrzCharset::allowed(MrzFields::Layout layout, unsigned lineIndex, size_t offset) {
+    const MaskTable& table = maskTable();
+    LineTable index = lineTable(layout, lineIndex);
+    return offset < table.lengths[index] ? table.masks[index][offset] : 0;
+}
+
+int MrzCharset::check(std::string_view line, MrzFields::Layout layout, unsigned lineIndex) {
+    const MaskTable& table = maskTable();
+    LineTable index = lineTable(layout, lineIndex);
+    size_t length = table.lengths[index];
+
+    alignas(16) char padded[PADDED_LENGTH];
+    std::memset(padded, '<', PADDED_LENGTH);
+    std::memcpy(padded, line.data(), line.size() < length ? line.size() : length);
+
+    uint64_t bad = violations(padded, table.masks[index]);
+    if (bad != 0) {
+        int offset = lowestBit(bad);
+        // A short line's filler padding is valid at some offsets, so
+        // report whichever comes first: the bad character or the end
+        return line.size() < static_cast<size_t>(offset) ? static_cast<int>(line.size()) : offset;
+    }
+    if (line.size() != length) {
+        return static_cast<int>(line.size() < length ? line.size() : length);
+    }
+    return VALID;
+}
+
+bool MrzCharset::check(std::string_view line1, std::string_view line2, Violation& violation) {
+    MrzFields::Layout layout = line1.size() == MrzParser::TD2_LINE_LENGTH ? MrzFields::TD2 : MrzFields::TD3;
+    const std::string_view lines[2] = {line1, line2};
+    for (int i = 0; i < 2; ++i) {
+        int offset = check(lines[i], layout, static_cast<unsigned>(i));
+        if (offset != VALID) {
+            violation.line = i;
+            violation.offset = offset;
+            return false;
+        }
+    }
+    violation.line = -1;
+    violation.offset = VALID;
+    return true;
+}
+
+bool MrzCharset::check(std::string_view line1, std::string_view line2, std::string_view line3,
+                       Violation& violation) {
+    const std::string_view lines[3] = {line1, line2, line3};
+    for (int i = 0; i < 3; ++i) {
+        int offset = check(lines[i], MrzFields::TD1, static_cast<unsigned>(i));
+        if (offset != VALID) {
+            violation.line = i;
+            violation.offset = offset;
+            return false;
+        }
+    }
+    violation.line = -1;
+    violation.offset = VALID;
+    return true;
+}
+
+bool MrzCharset::isFieldText(std::string_view text) {
+    static const FieldTextTable table;
+    for (char c : text) {
+        if (!table.allowed[static_cast<unsigned char>(c)]) {
+            return false;
+        }
+    }
+    return true;
+}
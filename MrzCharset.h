@@ -0,0 +1,53 @@
+#ifndef MRZ_CHARSET_H
+#define MRZ_CHARSET_H
+
+#include "MrzParser.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Per-position character classes of the ICAO 9303 MRZ layouts.
+//
+// Every offset of every line has a mask of the classes allowed there
+// (e.g. TD3 line 2 offset 9 is the document number check digit, so DIGIT
+// only). A line is classified 16 characters at a time with SSE2 and
+// compared against the precomputed mask table; the result is the first
+// offending offset, so a tampered or shifted layout is caught even when
+// each character on its own is valid MRZ text.
+class MrzCharset {
+public:
+    enum CharacterClass {
+        ALPHA  = 1 << 0,   // A-Z
+        DIGIT  = 1 << 1,   // 0-9
+        FILLER = 1 << 2    // '<'
+    };
+
+    static const int VALID = -1;
+
+    struct Violation {
+        int line;     // 0-based line, -1 if the document is valid
+        int offset;   // first offending offset in that line
+    };
+
+    // Class bit of one character, 0 outside the MRZ alphabet
+    static unsigned classify(char c);
+
+    // Classes allowed at one offset of a layout's line, 0 past its end
+    static unsigned allowed(MrzFields::Layout layout, unsigned lineIndex, size_t offset);
+
+    // First offset whose character is not allowed there, the line length
+    // if the line is too short, or VALID. Characters past the layout's
+    // line length are reported as offending.
+    static int check(std::string_view line, MrzFields::Layout layout, unsigned lineIndex);
+
+    // Two-line documents, layout chosen by the length of line 1 (TD3 or TD2)
+    static bool check(std::string_view line1, std::string_view line2, Violation& violation);
+    // Three-line TD1 documents
+    static bool check(std::string_view line1, std::string_view line2, std::string_view line3,
+                      Violation& violation);
+
+    // Decoded field text: A-Z, a-z, 0-9, '<' and spaces
+    static bool isFieldText(std::string_view text);
+};
+
+#endif // MRZ_CHARSET_H
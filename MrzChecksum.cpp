@@ -0,0 +1,357 @@
+#include "../include/MrzChecksum.h"
+
+// The vector kernels are compiled for their instruction sets whatever
+// the build targets and picked at run time
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define MRZ_CHECKSUM_DISPATCH 1
+#endif
+
+namespace {
+    const int WEIGHTS[3] = {7, 3, 1};
+
+    // TD3 line 2 layout
+    const int TD3_FIELD_COUNT = 5;
+    const int TD3_CHECK_POSITIONS[TD3_FIELD_COUNT] = {9, 19, 27, 42, 43};
+    const unsigned TD3_FIELD_BITS[TD3_FIELD_COUNT] = {
+        MrzChecksum::DOCUMENT_NUMBER, MrzChecksum::DATE_OF_BIRTH, MrzChecksum::EXPIRATION_DATE,
+        MrzChecksum::OPTIONAL_DATA, MrzChecksum::COMPOSITE
+    };
+
+    // Weight of each line position for each check digit, 0 if the
+    // position does not take part
+    struct Td3Weights {
+        int8_t byPosition[TD3_FIELD_COUNT][44];
+
+        Td3Weights() {
+            for (int f = 0; f < TD3_FIELD_COUNT; ++f) {
+                for (int pos = 0; pos < 44; ++pos) {
+                    byPosition[f][pos] = 0;
+                }
+            }
+
+            const int starts[4] = {0, 13, 21, 28};
+            const int ends[4] = {9, 19, 27, 42};
+            for (int f = 0; f < 4; ++f) {
+                for (int pos = starts[f]; pos < ends[f]; ++pos) {
+                    byPosition[f][pos] = static_cast<int8_t>(WEIGHTS[(pos - starts[f]) % 3]);
+                }
+            }
+
+            // Composite: 0-9, 13-19 and 21-42 read as one string
+            int index = 0;
+            for (int pos = 0; pos < 43; ++pos) {
+                if ((pos >= 10 && pos < 13) || pos == 20) {
+                    continue;
+                }
+                byPosition[4][pos] = static_cast<int8_t>(WEIGHTS[index % 3]);
+                ++index;
+            }
+        }
+    };
+
+    const Td3Weights& td3Weights() {
+        static const Td3Weights weights;
+        return weights;
+    }
+
+    // Weighted sum over several MRZ slices read as one string
+    struct WeightedSum {
+        int sum = 0;
+        int index = 0;
+        bool valid = true;
+
+        void add(std::string_view part) {
+            for (char c : part) {
+                int value = MrzChecksum::characterValue(c);
+                if (value < 0) {
+                    valid = false;
+                    value = 0;
+                }
+                sum += value * WEIGHTS[index % 3];
+                ++index;
+            }
+        }
+
+        void add(char c) {
+            add(std::string_view(&c, 1));
+        }
+    };
+
+    bool checkDigitMatches(int digit, char checkDigit) {
+        int expected = MrzChecksum::characterValue(checkDigit);
+        return digit >= 0 && expected >= 0 && expected < 10 && digit == expected;
+    }
+
+    unsigned checkField(std::string_view field, char checkDigit, unsigned failureBit) {
+        return MrzChecksum::verifyCheckDigit(field, checkDigit) ? 0 : failureBit;
+    }
+
+    // Weights laid out for the vector kernels
+    struct Td3VectorWeights {
+        // AVX2: chunks start at 0 and 12; the overlap (12-31) only counts once
+        alignas(32) int8_t wide[TD3_FIELD_COUNT][2][32];
+        // SSSE3: chunks start at 0, 16 and 28; the overlap (28-31) only counts once
+        alignas(16) int8_t narrow[TD3_FIELD_COUNT][3][16];
+
+        Td3VectorWeights() {
+            const Td3Weights& w = td3Weights();
+            const int offsets[3] = {0, 16, 28};
+            for (int f = 0; f < TD3_FIELD_COUNT; ++f) {
+                for (int i = 0; i < 32; ++i) {
+                    wide[f][0][i] = w.byPosition[f][i];
+                    wide[f][1][i] = i < 20 ? 0 : w.byPosition[f][12 + i];
+                }
+                for (int c = 0; c < 3; ++c) {
+                    for (int i = 0; i < 16; ++i) {
+                        narrow[f][c][i] = (c == 2 && i < 4) ? 0 : w.byPosition[f][offsets[c] + i];
+                    }
+                }
+            }
+        }
+    };
+
+    using Td3LineKernel = unsigned (*)(const char* line, const Td3VectorWeights& weights);
+
+    unsigned validateTD3LineScalar(const char* line, const Td3VectorWeights&) {
+        return MrzChecksum::validateTD3Line(std::string_view(line, MrzParser::TD3_LINE_LENGTH));
+    }
+
+#ifdef MRZ_CHECKSUM_DISPATCH
+    __attribute__((target("avx2")))
+    inline __m256i mrzValuesAvx2(__m256i chars, __m256i& invalid) {
+        const __m256i digits = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+        const __m256i letters = _mm256_sub_epi8(chars, _mm256_set1_epi8('A'));
+        const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+        const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(25)), letters);
+        const __m256i isFiller = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('<'));
+
+        invalid = _mm256_or_si256(invalid, _mm256_xor_si256(
+            _mm256_or_si256(_mm256_or_si256(isDigit, isLetter), isFiller), _mm256_set1_epi8(-1)));
+        return _mm256_or_si256(_mm256_and_si256(isDigit, digits),
+                               _mm256_and_si256(isLetter, _mm256_add_epi8(letters, _mm256_set1_epi8(10))));
+    }
+
+    __attribute__((target("avx2")))
+    inline int horizontalSumAvx2(__m256i v) {
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        return _mm_cvtsi128_si32(s);
+    }
+
+    __attribute__((target("avx2")))
+    unsigned validateTD3LineAvx2(const char* line, const Td3VectorWeights& weights) {
+        __m256i invalid = _mm256_setzero_si256();
+        const __m256i v0 = mrzValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(line)), invalid);
+        const __m256i v1 = mrzValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 12)), invalid);
+        const __m256i ones = _mm256_set1_epi16(1);
+
+        unsigned failures = _mm256_movemask_epi8(invalid) != 0 ? MrzChecksum::INVALID_CHARACTER : 0;
+        for (int f = 0; f < TD3_FIELD_COUNT; ++f) {
+            // Values are at most 35 and weights at most 7, so the 16-bit
+            // pair sums from maddubs cannot saturate
+            const __m256i* chunk = reinterpret_cast<const __m256i*>(weights.wide[f]);
+            __m256i sum = _mm256_add_epi32(
+                _mm256_madd_epi16(_mm256_maddubs_epi16(v0, _mm256_load_si256(chunk)), ones),
+                _mm256_madd_epi16(_mm256_maddubs_epi16(v1, _mm256_load_si256(chunk + 1)), ones));
+            if (!checkDigitMatches(horizontalSumAvx2(sum) % 10, line[TD3_CHECK_POSITIONS[f]])) {
+                failures |= TD3_FIELD_BITS[f];
+            }
+        }
+        return failures;
+    }
+
+    __attribute__((target("ssse3")))
+    inline __m128i mrzValuesSsse3(__m128i chars, __m128i& invalid) {
+        const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+        const __m128i letters = _mm_sub_epi8(chars, _mm_set1_epi8('A'));
+        const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+        const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(25)), letters);
+        const __m128i isFiller = _mm_cmpeq_epi8(chars, _mm_set1_epi8('<'));
+
+        invalid = _mm_or_si128(invalid, _mm_xor_si128(
+            _mm_or_si128(_mm_or_si128(isDigit, isLetter), isFiller), _mm_set1_epi8(-1)));
+        return _mm_or_si128(_mm_and_si128(isDigit, digits),
+                            _mm_and_si128(isLetter, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+    }
+
+    __attribute__((target("ssse3")))
+    inline int horizontalSumSsse3(__m128i s) {
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        return _mm_cvtsi128_si32(s);
+    }
+
+    __attribute__((target("ssse3")))
+    unsigned validateTD3LineSsse3(const char* line, const Td3VectorWeights& weights) {
+        __m128i invalid = _mm_setzero_si128();
+        const __m128i v0 = mrzValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line)), invalid);
+        const __m128i v1 = mrzValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 16)), invalid);
+        const __m128i v2 = mrzValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 28)), invalid);
+        const __m128i ones = _mm_set1_epi16(1);
+
+        unsigned failures = _mm_movemask_epi8(invalid) != 0 ? MrzChecksum::INVALID_CHARACTER : 0;
+        for (int f = 0; f < TD3_FIELD_COUNT; ++f) {
+            // Values are at most 35 and weights at most 7, so the 16-bit
+            // pair sums from maddubs cannot saturate
+            const __m128i* chunk = reinterpret_cast<const __m128i*>(weights.narrow[f]);
+            __m128i sum = _mm_madd_epi16(_mm_maddubs_epi16(v0, _mm_load_si128(chunk)), ones);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(v1, _mm_load_si128(chunk + 1)), ones));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(v2, _mm_load_si128(chunk + 2)), ones));
+            if (!checkDigitMatches(horizontalSumSsse3(sum) % 10, line[TD3_CHECK_POSITIONS[f]])) {
+                failures |= TD3_FIELD_BITS[f];
+            }
+        }
+        return failures;
+    }
+#endif
+
+    struct Td3Kernel {
+        Td3LineKernel line;
+        const char* name;
+    };
+
+    // Chosen once from what the CPU supports, whatever the build targets
+    Td3Kernel selectTd3Kernel() {
+#ifdef MRZ_CHECKSUM_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {validateTD3LineAvx2, "AVX2"};
+        }
+        if (__builtin_cpu_supports("ssse3")) {
+            return {validateTD3LineSsse3, "SSSE3"};
+        }
+#endif
+        return {validateTD3LineScalar, "scalar"};
+    }
+
+    const Td3Kernel& td3Kernel() {
+        static const Td3Kernel kernel = selectTd3Kernel();
+        return kernel;
+    }
+
+    const Td3VectorWeights& td3VectorWeights() {
+        static const Td3VectorWeights weights;
+        return weights;
+    }
+}
+
+int MrzChecksum::characterValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A' + 10;
+    }
+    if (c == '<') {
+        return 0;
+    }
+    return -1;
+}
+
+int MrzChecksum::computeCheckDigit(std::string_view field) {
+    WeightedSum sum;
+    sum.add(field);
+    return sum.valid ? sum.sum % 10 : -1;
+}
+
+bool MrzChecksum::verifyCheckDigit(std::string_view field, char checkDigit) {
+    return checkDigitMatches(computeCheckDigit(field), checkDigit);
+}
+
+unsigned MrzChecksum::validate(const MrzFields& fields) {
+    unsigned failures = 0;
+    failures |= checkField(fields.documentNumber, fields.documentNumberCheck, DOCUMENT_NUMBER);
+    failures |= checkField(fields.dateOfBirth, fields.dateOfBirthCheck, DATE_OF_BIRTH);
+    failures |= checkField(fields.expirationDate, fields.expirationDateCheck, EXPIRATION_DATE);
+    if (fields.layout == MrzFields::TD3) {
+        failures |= checkField(fields.optionalData, fields.optionalDataCheck, OPTIONAL_DATA);
+    }
+
+    // Composite digit covers the upper line fields in document order
+    WeightedSum composite;
+    if (fields.layout == MrzFields::TD1) {
+        composite.add(fields.documentNumber);
+        composite.add(fields.documentNumberCheck);
+        composite.add(fields.optionalData);
+        composite.add(fields.dateOfBirth);
+        composite.add(fields.dateOfBirthCheck);
+        composite.add(fields.expirationDate);
+        composite.add(fields.expirationDateCheck);
+        composite.add(fields.optionalData2);
+    } else {
+        composite.add(fields.documentNumber);
+        composite.add(fields.documentNumberCheck);
+        composite.add(fields.dateOfBirth);
+        composite.add(fields.dateOfBirthCheck);
+        composite.add(fields.expirationDate);
+        composite.add(fields.expirationDateCheck);
+        composite.add(fields.optionalData);
+        if (fields.layout == MrzFields::TD3) {
+            composite.add(fields.optionalDataCheck);
+        }
+    }
+    if (!composite.valid || characterValue(fields.compositeCheck) < 0) {
+        failures |= INVALID_CHARACTER;
+    }
+    if (!checkDigitMatches(composite.valid ? composite.sum % 10 : -1, fields.compositeCheck)) {
+        failures |= COMPOSITE;
+    }
+
+    return failures;
+}
+
+unsigned MrzChecksum::validateTD3Line(std::string_view line2) {
+    if (line2.size() != MrzParser::TD3_LINE_LENGTH) {
+        return INVALID_CHARACTER | DOCUMENT_NUMBER | DATE_OF_BIRTH | EXPIRATION_DATE |
+               OPTIONAL_DATA | COMPOSITE;
+    }
+
+    const Td3Weights& weights = td3Weights();
+    unsigned failures = 0;
+    int sums[TD3_FIELD_COUNT] = {0, 0, 0, 0, 0};
+    // The composite check digit (43) has no weight but must still be valid
+    for (size_t pos = 0; pos < MrzParser::TD3_LINE_LENGTH; ++pos) {
+        int value = characterValue(line2[pos]);
+        if (value < 0) {
+            failures |= INVALID_CHARACTER;
+            value = 0;
+        }
+        for (int f = 0; f < TD3_FIELD_COUNT; ++f) {
+            sums[f] += value * weights.byPosition[f][pos];
+        }
+    }
+
+    for (int f = 0; f < TD3_FIELD_COUNT; ++f) {
+        if (!checkDigitMatches(sums[f] % 10, line2[TD3_CHECK_POSITIONS[f]])) {
+            failures |= TD3_FIELD_BITS[f];
+        }
+    }
+    return failures;
+}
+
+void MrzChecksum::validateTD3Batch(const char* lines, size_t count, size_t stride, uint8_t* failures) {
+    const Td3LineKernel kernel = td3Kernel().line;
+    const Td3VectorWeights& weights = td3VectorWeights();
+    for (size_t i = 0; i < count; ++i) {
+        failures[i] = static_cast<uint8_t>(kernel(lines + i * stride, weights));
+    }
+}
+
+void MrzChecksum::validateTD3Batch(const MrzFields* records, size_t count, uint8_t* failures) {
+    const Td3LineKernel kernel = td3Kernel().line;
+    const Td3VectorWeights& weights = td3VectorWeights();
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].layout != MrzFields::TD3) {
+            failures[i] = static_cast<uint8_t>(validate(records[i]));
+            continue;
+        }
+        // The document number view starts line 2 of a TD3 record
+        failures[i] = static_cast<uint8_t>(kernel(records[i].documentNumber.data(), weights));
+    }
+}
+
+const char* MrzChecksum::getBatchKernel() {
+    return td3Kernel().name;
+}
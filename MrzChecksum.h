@@ -0,0 +1,45 @@
+#ifndef MRZ_CHECKSUM_H
+#define MRZ_CHECKSUM_H
+
+#include "MrzParser.h"
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// ICAO 9303 check digits: character values (0-9, A=10 .. Z=35, '<'=0)
+// weighted 7-3-1 repeating, summed modulo 10.
+class MrzChecksum {
+public:
+    // Bits of the failure mask; 0 means every check digit matched
+    enum CheckFailure {
+        DOCUMENT_NUMBER   = 1 << 0,
+        DATE_OF_BIRTH     = 1 << 1,
+        EXPIRATION_DATE   = 1 << 2,
+        OPTIONAL_DATA     = 1 << 3,
+        COMPOSITE         = 1 << 4,
+        INVALID_CHARACTER = 1 << 5
+    };
+
+    // -1 for characters that cannot appear in an MRZ
+    static int characterValue(char c);
+    // -1 if the field contains an invalid character
+    static int computeCheckDigit(std::string_view field);
+    static bool verifyCheckDigit(std::string_view field, char checkDigit);
+
+    // All check digits of a parsed MRZ (TD1, TD2 or TD3)
+    static unsigned validate(const MrzFields& fields);
+    // TD3 line 2 only (44 characters)
+    static unsigned validateTD3Line(std::string_view line2);
+
+    // Validates many TD3 second lines at once; line i starts at
+    // lines + i * stride. Writes one failure mask per line, the same as
+    // validateTD3Line(). Uses AVX2 or SSSE3 when the CPU has them, checked
+    // at run time, scalar code otherwise.
+    static void validateTD3Batch(const char* lines, size_t count, size_t stride, uint8_t* failures);
+    // Same, for TD3 records produced by MrzParser::parseBatch()
+    static void validateTD3Batch(const MrzFields* records, size_t count, uint8_t* failures);
+    // "AVX2", "SSSE3" or "scalar": the kernel validateTD3Batch() runs
+    static const char* getBatchKernel();
+};
+
+#endif // MRZ_CHECKSUM_H
@@ -0,0 +1,469 @@
+#include "../include/MrzCorrector.h"
+#include "../include/MrzCharset.h"
+#include "../include/MrzChecksum.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    const int WEIGHTS[3] = {7, 3, 1};
+    const size_t MAX_LINE_LENGTH = 44;
+    const size_t MAX_SWAPS = 64;
+
+    // A swap costs SWAP_COST, one against the field's majority class more
+    const int SWAP_COST = 2;
+    const int MINORITY_COST = 1;
+
+    const unsigned ALL_FAILURES = MrzChecksum::DOCUMENT_NUMBER | MrzChecksum::DATE_OF_BIRTH |
+                                  MrzChecksum::EXPIRATION_DATE | MrzChecksum::OPTIONAL_DATA |
+                                  MrzChecksum::COMPOSITE | MrzChecksum::INVALID_CHARACTER;
+
+    // Each pair is one digit and the letter OCR mistakes it for
+    const char LOOK_ALIKES[][2] = {{'0', 'O'}, {'1', 'I'}, {'2', 'Z'}, {'5', 'S'}, {'6', 'G'}, {'8', 'B'}};
+
+    struct Segment {
+        uint8_t line;
+        uint8_t start;
+        uint8_t length;
+    };
+
+    // Characters covered by one check digit, read in segment order
+    struct CheckedField {
+        unsigned failureBit;
+        uint8_t segmentCount;
+        Segment segments[4];
+        uint8_t checkLine;
+        uint8_t checkOffset;
+    };
+
+    // The last field of each layout is the composite
+    struct LayoutFields {
+        size_t count;
+        CheckedField fields[5];
+    };
+
+    const LayoutFields TD1_FIELDS = {4, {
+        {MrzChecksum::DOCUMENT_NUMBER, 1, {{0, 5, 9}}, 0, 14},
+        {MrzChecksum::DATE_OF_BIRTH, 1, {{1, 0, 6}}, 1, 6},
+        {MrzChecksum::EXPIRATION_DATE, 1, {{1, 8, 6}}, 1, 14},
+        {MrzChecksum::COMPOSITE, 4, {{0, 5, 25}, {1, 0, 7}, {1, 8, 7}, {1, 18, 11}}, 1, 29}
+    }};
+    const LayoutFields TD2_FIELDS = {4, {
+        {MrzChecksum::DOCUMENT_NUMBER, 1, {{1, 0, 9}}, 1, 9},
+        {MrzChecksum::DATE_OF_BIRTH, 1, {{1, 13, 6}}, 1, 19},
+        {MrzChecksum::EXPIRATION_DATE, 1, {{1, 21, 6}}, 1, 27},
+        {MrzChecksum::COMPOSITE, 3, {{1, 0, 10}, {1, 13, 7}, {1, 21, 14}}, 1, 35}
+    }};
+    const LayoutFields TD3_FIELDS = {5, {
+        {MrzChecksum::DOCUMENT_NUMBER, 1, {{1, 0, 9}}, 1, 9},
+        {MrzChecksum::DATE_OF_BIRTH, 1, {{1, 13, 6}}, 1, 19},
+        {MrzChecksum::EXPIRATION_DATE, 1, {{1, 21, 6}}, 1, 27},
+        {MrzChecksum::OPTIONAL_DATA, 1, {{1, 28, 14}}, 1, 42},
+        {MrzChecksum::COMPOSITE, 3, {{1, 0, 10}, {1, 13, 7}, {1, 21, 22}}, 1, 43}
+    }};
+
+    struct Swap {
+        uint8_t line;
+        uint8_t offset;
+        char replacement;
+        uint8_t residue;            // change of the field's sum, mod 10
+        uint8_t compositeResidue;   // change of the composite sum, mod 10
+        uint8_t cost;
+    };
+
+    struct Answer {
+        Swap swaps[MrzCorrector::MAX_SWAPS_PER_FIELD];
+        uint8_t count;
+        uint8_t cost;
+        uint8_t compositeResidue;
+    };
+
+    struct FieldAnswers {
+        Answer answers[MrzCorrector::MAX_FIELD_ANSWERS];
+        size_t count;
+    };
+
+    struct Lines {
+        char text[3][MAX_LINE_LENGTH];
+        size_t count;
+        size_t length;
+        MrzFields::Layout layout;
+
+        int value(uint8_t line, uint8_t offset) const {
+            return MrzChecksum::characterValue(text[line][offset]);
+        }
+    };
+
+    inline int mod10(int value) {
+        value %= 10;
+        return value < 0 ? value + 10 : value;
+    }
+
+    // Missing residue: what the swaps have to add for the check digit to match
+    int missingResidue(const Lines& lines, const CheckedField& field) {
+        int sum = 0;
+        int index = 0;
+        for (uint8_t s = 0; s < field.segmentCount; ++s) {
+            const Segment& segment = field.segments[s];
+            for (uint8_t i = 0; i < segment.length; ++i) {
+                sum += lines.value(segment.line, static_cast<uint8_t>(segment.start + i)) * WEIGHTS[index % 3];
+                ++index;
+            }
+        }
+        return mod10(lines.value(field.checkLine, field.checkOffset) - sum);
+    }
+
+    // Weight of every position in the composite, 0 outside it
+    void compositeWeights(const CheckedField& composite, uint8_t weights[3][MAX_LINE_LENGTH]) {
+        std::memset(weights, 0, 3 * MAX_LINE_LENGTH);
+        int index = 0;
+        for (uint8_t s = 0; s < composite.segmentCount; ++s) {
+            const Segment& segment = composite.segments[s];
+            for (uint8_t i = 0; i < segment.length; ++i) {
+                weights[segment.line][segment.start + i] = static_cast<uint8_t>(WEIGHTS[index % 3]);
+                ++index;
+            }
+        }
+    }
+
+    // Look-alike swaps over the field's positions that are allowed there
+    // and move its sum; for the composite, only positions no other field
+    // covers
+    size_t collectSwaps(const Lines& lines, const CheckedField& field, const uint8_t composite[3][MAX_LINE_LENGTH],
+                        bool isComposite, const bool covered[3][MAX_LINE_LENGTH], Swap* swaps) {
+        unsigned digits = 0;
+        unsigned letters = 0;
+        for (uint8_t s = 0; s < field.segmentCount; ++s) {
+            const Segment& segment = field.segments[s];
+            for (uint8_t i = 0; i < segment.length; ++i) {
+                unsigned classes = MrzCharset::classify(lines.text[segment.line][segment.start + i]);
+                digits += classes == MrzCharset::DIGIT;
+                letters += classes == MrzCharset::ALPHA;
+            }
+        }
+        const unsigned majority = digits > letters ? MrzCharset::DIGIT : letters > digits ? MrzCharset::ALPHA : 0;
+
+        size_t count = 0;
+        int index = 0;
+        for (uint8_t s = 0; s < field.segmentCount; ++s) {
+            const Segment& segment = field.segments[s];
+            for (uint8_t i = 0; i < segment.length; ++i, ++index) {
+                const uint8_t line = segment.line;
+                const uint8_t offset = static_cast<uint8_t>(segment.start + i);
+                if (isComposite && covered[line][offset]) {
+                    continue;
+                }
+                const char current = lines.text[line][offset];
+                const char replacement = MrzCorrector::lookAlike(current);
+                const unsigned classes = MrzCharset::classify(replacement);
+                if (replacement == '\0' ||
+                    (MrzCharset::allowed(lines.layout, line, offset) & classes) == 0) {
+                    continue;
+                }
+                const int change = MrzChecksum::characterValue(replacement) - MrzChecksum::characterValue(current);
+                const int residue = mod10(WEIGHTS[index % 3] * change);
+                if (residue == 0 || count == MAX_SWAPS) {
+                    // Invisible to the check digit: nothing to go on
+                    continue;
+                }
+                Swap& swap = swaps[count++];
+                swap.line = line;
+                swap.offset = offset;
+                swap.replacement = replacement;
+                swap.residue = static_cast<uint8_t>(residue);
+                swap.compositeResidue = static_cast<uint8_t>(mod10(composite[line][offset] * change));
+                swap.cost = static_cast<uint8_t>(SWAP_COST + (classes == majority ? 0 : MINORITY_COST));
+            }
+        }
+        return count;
+    }
+
+    // Answers with the fewest swaps that make up the missing residue.
+    // Swaps are bucketed by residue, so the second swap of a pair comes
+    // straight from the bucket of what the first leaves missing. False
+    // when there are more answers than can be told apart.
+    bool findAnswers(const Swap* swaps, size_t swapCount, int missing, FieldAnswers& result) {
+        uint8_t buckets[10][MAX_SWAPS];
+        size_t bucketSizes[10] = {};
+        for (size_t i = 0; i < swapCount; ++i) {
+            buckets[swaps[i].residue][bucketSizes[swaps[i].residue]++] = static_cast<uint8_t>(i);
+        }
+
+        result.count = 0;
+        for (size_t k = 0; k < bucketSizes[missing]; ++k) {
+            if (result.count == MrzCorrector::MAX_FIELD_ANSWERS) {
+                return false;
+            }
+            const Swap& swap = swaps[buckets[missing][k]];
+            Answer& answer = result.answers[result.count++];
+            answer.swaps[0] = swap;
+            answer.count = 1;
+            answer.cost = swap.cost;
+            answer.compositeResidue = swap.compositeResidue;
+        }
+        if (result.count > 0) {
+            return true;
+        }
+
+        for (size_t i = 0; i < swapCount; ++i) {
+            const int rest = mod10(missing - swaps[i].residue);
+            for (size_t k = 0; k < bucketSizes[rest]; ++k) {
+                const size_t j = buckets[rest][k];
+                if (j <= i) {
+                    continue;
+                }
+                if (result.count == MrzCorrector::MAX_FIELD_ANSWERS) {
+                    return false;
+                }
+                Answer& answer = result.answers[result.count++];
+                answer.swaps[0] = swaps[i];
+                answer.swaps[1] = swaps[j];
+                answer.count = 2;
+                answer.cost = static_cast<uint8_t>(swaps[i].cost + swaps[j].cost);
+                answer.compositeResidue = static_cast<uint8_t>(
+                    mod10(swaps[i].compositeResidue + swaps[j].compositeResidue));
+            }
+        }
+        return result.count > 0;
+    }
+
+    // Cheapest choice of one answer per field (and at most one swap in
+    // the composite-only positions) that satisfies the composite
+    struct Choice {
+        size_t picks[5];
+        int extra;        // index into the composite-only swaps, -1 for none
+        int cost;
+        size_t ties;
+    };
+
+    void chooseAnswers(const FieldAnswers* fields, size_t fieldCount, size_t field, size_t* picks, int cost,
+                       int compositeMissing, const Swap* extras, size_t extraCount, Choice& best) {
+        if (field == fieldCount) {
+            int extra = -1;
+            size_t ties = 1;
+            if (compositeMissing != 0) {
+                // One swap where only the composite can see it
+                for (size_t i = 0; i < extraCount; ++i) {
+                    if (extras[i].compositeResidue != compositeMissing) {
+                        continue;
+                    }
+                    if (extra < 0 || extras[i].cost < extras[extra].cost) {
+                        extra = static_cast<int>(i);
+                        ties = 1;
+                    } else if (extras[i].cost == extras[extra].cost) {
+                        ++ties;
+                    }
+                }
+                if (extra < 0) {
+                    return;
+                }
+                cost += extras[extra].cost;
+            }
+            if (cost < best.cost) {
+                std::memcpy(best.picks, picks, fieldCount * sizeof(size_t));
+                best.extra = extra;
+                best.cost = cost;
+                best.ties = ties;
+            } else if (cost == best.cost) {
+                best.ties += ties;
+            }
+            return;
+        }
+
+        const FieldAnswers& answers = fields[field];
+        for (size_t i = 0; i < answers.count; ++i) {
+            const Answer& answer = answers.answers[i];
+            if (cost + answer.cost > best.cost) {
+                continue;
+            }
+            picks[field] = i;
+            chooseAnswers(fields, fieldCount, field + 1, picks, cost + answer.cost,
+                          mod10(compositeMissing - answer.compositeResidue), extras, extraCount, best);
+        }
+    }
+
+    unsigned remainingFailures(const Lines& lines) {
+        MrzFields fields;
+        bool parsed = lines.count == 3
+            ? MrzParser::parse(std::string_view(lines.text[0], lines.length), std::string_view(lines.text[1], lines.length),
+                               std::string_view(lines.text[2], lines.length), fields)
+            : MrzParser::parse(std::string_view(lines.text[0], lines.length), std::string_view(lines.text[1], lines.length),
+                               fields);
+        return parsed ? MrzChecksum::validate(fields) : ALL_FAILURES;
+    }
+
+    void copyLines(const Lines& lines, MrzCorrector::Result& result) {
+        for (size_t i = 0; i < lines.count; ++i) {
+            result.lines[i].assign(lines.text[i], lines.length);
+        }
+    }
+}
+
+char MrzCorrector::lookAlike(char c) {
+    for (const char* pair : LOOK_ALIKES) {
+        if (pair[0] == c) {
+            return pair[1];
+        }
+        if (pair[1] == c) {
+            return pair[0];
+        }
+    }
+    return '\0';
+}
+
+MrzCorrector::Result MrzCorrector::correct(const std::string_view* input, size_t lineCount) {
+    Result result;
+    result.valid = false;
+    result.layout = MrzFields::TD3;
+    result.lineCount = lineCount < 3 ? lineCount : 3;
+    result.corrections = 0;
+    result.confidence = 0.0;
+    result.failures = ALL_FAILURES;
+    for (size_t i = 0; i < result.lineCount; ++i) {
+        result.lines[i] = std::string(input[i]);
+    }
+
+    Lines lines;
+    lines.count = lineCount;
+    lines.length = lineCount > 0 ? input[0].size() : 0;
+    if (lineCount == 3 && lines.length == MrzParser::TD1_LINE_LENGTH) {
+        lines.layout = MrzFields::TD1;
+    } else if (lineCount == 2 && lines.length == MrzParser::TD2_LINE_LENGTH) {
+        lines.layout = MrzFields::TD2;
+    } else if (lineCount == 2 && lines.length == MrzParser::TD3_LINE_LENGTH) {
+        lines.layout = MrzFields::TD3;
+    } else {
+        return result;
+    }
+    result.layout = lines.layout;
+    for (size_t i = 0; i < lineCount; ++i) {
+        if (input[i].size() != lines.length) {
+            return result;
+        }
+        std::memcpy(lines.text[i], input[i].data(), lines.length);
+    }
+
+    // 1. Characters of the wrong class; clean lines are passed over by
+    //    the vectorized check
+    double confidence = 1.0;
+    size_t corrections = 0;
+    for (size_t i = 0; i < lineCount; ++i) {
+        const unsigned line = static_cast<unsigned>(i);
+        if (MrzCharset::check(input[i], lines.layout, line) == MrzCharset::VALID) {
+            continue;
+        }
+        for (size_t offset = 0; offset < lines.length; ++offset) {
+            char& c = lines.text[i][offset];
+            const unsigned allowed = MrzCharset::allowed(lines.layout, line, offset);
+            if ((MrzCharset::classify(c) & allowed) != 0) {
+                continue;
+            }
+            const char replacement = lookAlike(c);
+            if (replacement == '\0' || (MrzCharset::classify(replacement) & allowed) == 0) {
+                copyLines(lines, result);
+                result.corrections = corrections;
+                result.failures = remainingFailures(lines) | MrzChecksum::INVALID_CHARACTER;
+                return result;
+            }
+            c = replacement;
+            ++corrections;
+            confidence *= CLASS_REPAIR_CONFIDENCE;
+        }
+    }
+
+    // 2. Check digits; a long TD1 document number ends in the optional
+    //    data with '<' in place of its check digit, and only the
+    //    composite covers it
+    const LayoutFields& layout = lines.layout == MrzFields::TD1 ? TD1_FIELDS
+                               : lines.layout == MrzFields::TD2 ? TD2_FIELDS : TD3_FIELDS;
+    const CheckedField& composite = layout.fields[layout.count - 1];
+    uint8_t weights[3][MAX_LINE_LENGTH];
+    compositeWeights(composite, weights);
+
+    bool covered[3][MAX_LINE_LENGTH] = {};
+    FieldAnswers answers[4];
+    size_t failedCount = 0;
+    int compositeMissing = missingResidue(lines, composite);
+    Swap swaps[MAX_SWAPS];
+    for (size_t f = 0; f + 1 < layout.count; ++f) {
+        const CheckedField& field = layout.fields[f];
+        if (lines.text[field.checkLine][field.checkOffset] == '<' && field.failureBit == MrzChecksum::DOCUMENT_NUMBER) {
+            continue;
+        }
+        for (uint8_t s = 0; s < field.segmentCount; ++s) {
+            const Segment& segment = field.segments[s];
+            std::memset(covered[segment.line] + segment.start, 1, segment.length);
+        }
+        const int missing = missingResidue(lines, field);
+        if (missing == 0) {
+            continue;
+        }
+        const size_t swapCount = collectSwaps(lines, field, weights, false, covered, swaps);
+        if (!findAnswers(swaps, swapCount, missing, answers[failedCount])) {
+            copyLines(lines, result);
+            result.corrections = corrections;
+            result.failures = remainingFailures(lines);
+            return result;
+        }
+        ++failedCount;
+    }
+
+    // 3. One answer per failed field, settled by the composite
+    if (failedCount > 0 || compositeMissing != 0) {
+        Swap extras[MAX_SWAPS];
+        const size_t extraCount = collectSwaps(lines, composite, weights, true, covered, extras);
+        Choice best;
+        best.extra = -1;
+        best.cost = SWAP_COST * MAX_SWAPS_PER_FIELD * 5 + 1;
+        best.ties = 0;
+        size_t picks[5] = {};
+        chooseAnswers(answers, failedCount, 0, picks, 0, compositeMissing, extras, extraCount, best);
+        if (best.ties != 1) {
+            // No repair fits, or more than one fits equally well
+            copyLines(lines, result);
+            result.corrections = corrections;
+            result.failures = remainingFailures(lines);
+            return result;
+        }
+
+        for (size_t f = 0; f < failedCount; ++f) {
+            const Answer& answer = answers[f].answers[best.picks[f]];
+            for (uint8_t s = 0; s < answer.count; ++s) {
+                lines.text[answer.swaps[s].line][answer.swaps[s].offset] = answer.swaps[s].replacement;
+                ++corrections;
+                confidence *= CHECK_DIGIT_REPAIR_CONFIDENCE;
+            }
+        }
+        if (best.extra >= 0) {
+            const Swap& swap = extras[best.extra];
+            lines.text[swap.line][swap.offset] = swap.replacement;
+            ++corrections;
+            confidence *= CHECK_DIGIT_REPAIR_CONFIDENCE;
+        }
+    }
+
+    copyLines(lines, result);
+    result.corrections = corrections;
+    result.failures = remainingFailures(lines);
+    result.valid = result.failures == 0;
+    result.confidence = result.valid ? confidence : 0.0;
+    return result;
+}
+
+MrzCorrector::Result MrzCorrector::correct(std::string_view rawData) {
+    std::string_view lines[3];
+    size_t count = 0;
+    while (!rawData.empty() && count < 3) {
+        size_t lineBreak = rawData.find('\n');
+        std::string_view line = rawData.substr(0, lineBreak);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        lines[count++] = line;
+        rawData = lineBreak == std::string_view::npos ? std::string_view() : rawData.substr(lineBreak + 1);
+    }
+    if (!rawData.empty()) {
+        // More than three lines is not an MRZ
+        count = 4;
+    }
+    return correct(lines, count);
+}
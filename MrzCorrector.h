@@ -0,0 +1,53 @@
+#ifndef MRZ_CORRECTOR_H
+#define MRZ_CORRECTOR_H
+
+#include "MrzParser.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Repairs the usual OCR confusions of an MRZ read (0/O, 1/I, 2/Z, 5/S,
+// 6/G, 8/B) before it is parsed, so a single misread character does not
+// cost another scan.
+//
+//   1. A character outside the classes allowed at its position
+//      (MrzCharset) becomes its look-alike: a letter in a date turns into
+//      a digit, a digit in a name into a letter
+//   2. A field whose check digit fails is searched for one, then two,
+//      look-alike swaps that fix it. A swap moves the weighted sum by
+//      weight * (new - old) mod 10, so swaps are bucketed by that residue
+//      and only those making up the missing residue are tried; the field
+//      is never summed again
+//   3. The composite digit picks between a field's answers and covers
+//      the optional data that has no check digit of its own
+//
+// Swaps towards the field's majority class (digits in a mostly numeric
+// document number) are preferred. A read that stays ambiguous, or needs
+// more swaps than the check digits can vouch for, comes back invalid.
+class MrzCorrector {
+public:
+    static const int MAX_SWAPS_PER_FIELD = 2;
+    static const size_t MAX_FIELD_ANSWERS = 8;
+    static constexpr double CLASS_REPAIR_CONFIDENCE = 0.98;
+    static constexpr double CHECK_DIGIT_REPAIR_CONFIDENCE = 0.9;
+
+    struct Result {
+        bool valid;                 // every check digit matches
+        MrzFields::Layout layout;
+        size_t lineCount;
+        std::string lines[3];
+        size_t corrections;         // characters changed
+        double confidence;          // 1 for an untouched read, 0 if invalid
+        unsigned failures;          // MrzChecksum failure bits left
+    };
+
+    // 2 (TD2, TD3) or 3 (TD1) lines
+    static Result correct(const std::string_view* lines, size_t lineCount);
+    // Scanner data, lines separated by newlines
+    static Result correct(std::string_view rawData);
+
+    // The look-alike of c in the other class, '\0' if there is none
+    static char lookAlike(char c);
+};
+
+#endif // MRZ_CORRECTOR_H
@@ -0,0 +1,167 @@
+#include "../include/MrzDate.h"
+#include <atomic>
+#include <ctime>
+
+namespace {
+    // Today's day number (low half) and the time_t of the next local
+    // midnight (high half), published as one value so the deadline never
+    // moves on without the day; 0 until first computed
+    std::atomic<uint64_t> cachedToday(0);
+    std::atomic<int32_t> overrideToday(MrzDate::INVALID);
+
+    uint64_t packToday(int32_t day, int64_t refreshAt) {
+        return (static_cast<uint64_t>(refreshAt) << 32) | static_cast<uint32_t>(day);
+    }
+
+    int32_t dayOf(uint64_t packed) {
+        return static_cast<int32_t>(static_cast<uint32_t>(packed));
+    }
+
+    // Unsigned 32-bit seconds: good until 2106
+    int64_t refreshTimeOf(uint64_t packed) {
+        return static_cast<int64_t>(packed >> 32);
+    }
+
+    bool isLeapYear(int year) {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    int daysInMonth(int year, int month) {
+        static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+    }
+
+    int twoDigits(std::string_view text, size_t offset) {
+        char high = text[offset];
+        char low = text[offset + 1];
+        if (high < '0' || high > '9' || low < '0' || low > '9') {
+            return -1;
+        }
+        return (high - '0') * 10 + (low - '0');
+    }
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar
+// (H. Hinnant's days_from_civil)
+int32_t MrzDate::daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int32_t>(dayOfEra) - 719468;
+}
+
+void MrzDate::civilFromDays(int32_t days, int& year, int& month, int& day) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    year = static_cast<int>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+int32_t MrzDate::decode(std::string_view yymmdd, Kind kind, int32_t today) {
+    if (yymmdd.size() != 6) {
+        return INVALID;
+    }
+
+    int yy = twoDigits(yymmdd, 0);
+    int month = twoDigits(yymmdd, 2);
+    int day = twoDigits(yymmdd, 4);
+    if (yy < 0 || month < 1 || month > 12 || day < 1) {
+        return INVALID;
+    }
+
+    int todayYear, todayMonth, todayDay;
+    civilFromDays(today, todayYear, todayMonth, todayDay);
+    const int century = todayYear - todayYear % 100;
+
+    // Start in the current century and move back if the rule says so
+    int year = century + yy;
+    if (kind == BIRTH) {
+        if (year > todayYear || (year == todayYear && (month > todayMonth ||
+                                                      (month == todayMonth && day > todayDay)))) {
+            year -= 100;
+        }
+    } else {
+        if (year >= todayYear + 50) {
+            year -= 100;
+        } else if (year < todayYear - 50) {
+            year += 100;
+        }
+    }
+
+    if (day > daysInMonth(year, month)) {
+        return INVALID;
+    }
+    return daysFromCivil(year, month, day);
+}
+
+int32_t MrzDate::decode(std::string_view yymmdd, Kind kind) {
+    return decode(yymmdd, kind, CurrentDate::today());
+}
+
+std::string MrzDate::encode(int32_t days) {
+    if (days == INVALID) {
+        return std::string();
+    }
+
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    const int parts[3] = {year % 100, month, day};
+    std::string text(6, '0');
+    for (int i = 0; i < 3; ++i) {
+        text[i * 2] = static_cast<char>('0' + parts[i] / 10);
+        text[i * 2 + 1] = static_cast<char>('0' + parts[i] % 10);
+    }
+    return text;
+}
+
+int32_t CurrentDate::today() {
+    int32_t pinned = overrideToday.load(std::memory_order_relaxed);
+    if (pinned != MrzDate::INVALID) {
+        return pinned;
+    }
+
+    std::time_t now = std::time(nullptr);
+    uint64_t cached = cachedToday.load(std::memory_order_acquire);
+    while (now >= refreshTimeOf(cached)) {
+        // First call of the day: recompute from local time
+        std::tm local;
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        int32_t day = MrzDate::daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+
+        std::tm midnight = local;
+        midnight.tm_mday += 1;
+        midnight.tm_hour = 0;
+        midnight.tm_min = 0;
+        midnight.tm_sec = 0;
+        midnight.tm_isdst = -1;
+
+        // Losing the race means another thread published; its value is
+        // re-checked rather than overwritten, so a thread that computed
+        // before midnight cannot put yesterday back
+        const uint64_t fresh = packToday(day, static_cast<int64_t>(std::mktime(&midnight)));
+        if (cachedToday.compare_exchange_strong(cached, fresh, std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+            return day;
+        }
+    }
+    return dayOf(cached);
+}
+
+void CurrentDate::setOverride(int32_t day) {
+    overrideToday.store(day, std::memory_order_relaxed);
+}
+
+void CurrentDate::clearOverride() {
+    overrideToday.store(MrzDate::INVALID, std::memory_order_relaxed);
+}
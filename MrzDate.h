@@ -0,0 +1,43 @@
+#ifndef MRZ_DATE_H
+#define MRZ_DATE_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+// MRZ dates (YYMMDD) as day numbers: days since 1970-01-01. Decoded once,
+// after which date checks are plain integer comparisons.
+class MrzDate {
+public:
+    static constexpr int32_t INVALID = std::numeric_limits<int32_t>::min();
+
+    // The century is not in the MRZ, it is chosen per kind of date:
+    // BIRTH is never in the future, EXPIRY lies within 50 years of today.
+    enum Kind {
+        BIRTH,
+        EXPIRY
+    };
+
+    static int32_t daysFromCivil(int year, int month, int day);
+    static void civilFromDays(int32_t days, int& year, int& month, int& day);
+
+    // INVALID for malformed text or impossible dates (e.g. 310231)
+    static int32_t decode(std::string_view yymmdd, Kind kind, int32_t today);
+    static int32_t decode(std::string_view yymmdd, Kind kind);
+    // Back to YYMMDD; empty for INVALID
+    static std::string encode(int32_t days);
+};
+
+// Process-wide "today" as a day number in local time. The value is cached
+// and recomputed only when the clock passes the next local midnight.
+class CurrentDate {
+public:
+    static int32_t today();
+
+    // Pins today() to a fixed day (tests, replaying old manifests)
+    static void setOverride(int32_t day);
+    static void clearOverride();
+};
+
+#endif // MRZ_DATE_H
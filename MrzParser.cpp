@@ -0,0 +1,184 @@
+#include "../include/MrzParser.h"
+
+std::string_view MrzParser::stripLineEnd(std::string_view line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+std::string_view MrzParser::trimFillers(std::string_view field) {
+    size_t end = field.size();
+    while (end > 0 && field[end - 1] == '<') {
+        --end;
+    }
+    return field.substr(0, end);
+}
+
+void MrzParser::splitName(std::string_view nameField, MrzFields& fields) {
+    // Primary identifier, "<<", then the secondary identifier
+    size_t separator = nameField.find("<<");
+    if (separator == std::string_view::npos) {
+        fields.lastName = trimFillers(nameField);
+        fields.firstName = std::string_view();
+        return;
+    }
+
+    fields.lastName = nameField.substr(0, separator);
+    fields.firstName = trimFillers(nameField.substr(separator + 2));
+}
+
+bool MrzParser::parse(std::string_view line1, std::string_view line2, MrzFields& fields) {
+    line1 = stripLineEnd(line1);
+    line2 = stripLineEnd(line2);
+
+    if (line1.size() == TD3_LINE_LENGTH && line2.size() == TD3_LINE_LENGTH) {
+        fields.layout = MrzFields::TD3;
+        fields.documentType = line1.substr(0, 2);
+        fields.issuingCountry = line1.substr(2, 3);
+        splitName(line1.substr(5, 39), fields);
+
+        fields.documentNumber = line2.substr(0, 9);
+        fields.documentNumberCheck = line2[9];
+        fields.nationality = line2.substr(10, 3);
+        fields.dateOfBirth = line2.substr(13, 6);
+        fields.dateOfBirthCheck = line2[19];
+        fields.gender = line2.substr(20, 1);
+        fields.expirationDate = line2.substr(21, 6);
+        fields.expirationDateCheck = line2[27];
+        fields.optionalData = line2.substr(28, 14);
+        fields.optionalData2 = std::string_view();
+        fields.optionalDataCheck = line2[42];
+        fields.compositeCheck = line2[43];
+        return true;
+    }
+
+    if (line1.size() == TD2_LINE_LENGTH && line2.size() == TD2_LINE_LENGTH) {
+        fields.layout = MrzFields::TD2;
+        fields.documentType = line1.substr(0, 2);
+        fields.issuingCountry = line1.substr(2, 3);
+        splitName(line1.substr(5, 31), fields);
+
+        fields.documentNumber = line2.substr(0, 9);
+        fields.documentNumberCheck = line2[9];
+        fields.nationality = line2.substr(10, 3);
+        fields.dateOfBirth = line2.substr(13, 6);
+        fields.dateOfBirthCheck = line2[19];
+        fields.gender = line2.substr(20, 1);
+        fields.expirationDate = line2.substr(21, 6);
+        fields.expirationDateCheck = line2[27];
+        fields.optionalData = line2.substr(28, 7);
+        fields.optionalData2 = std::string_view();
+        fields.optionalDataCheck = '\0';
+        fields.compositeCheck = line2[35];
+        return true;
+    }
+
+    return false;
+}
+
+bool MrzParser::parse(std::string_view line1, std::string_view line2, std::string_view line3,
+                      MrzFields& fields) {
+    line1 = stripLineEnd(line1);
+    line2 = stripLineEnd(line2);
+    line3 = stripLineEnd(line3);
+
+    if (line1.size() != TD1_LINE_LENGTH || line2.size() != TD1_LINE_LENGTH ||
+        line3.size() != TD1_LINE_LENGTH) {
+        return false;
+    }
+
+    fields.layout = MrzFields::TD1;
+    fields.documentType = line1.substr(0, 2);
+    fields.issuingCountry = line1.substr(2, 3);
+    fields.documentNumber = line1.substr(5, 9);
+    fields.documentNumberCheck = line1[14];
+    fields.optionalData = line1.substr(15, 15);
+
+    fields.dateOfBirth = line2.substr(0, 6);
+    fields.dateOfBirthCheck = line2[6];
+    fields.gender = line2.substr(7, 1);
+    fields.expirationDate = line2.substr(8, 6);
+    fields.expirationDateCheck = line2[14];
+    fields.nationality = line2.substr(15, 3);
+    fields.optionalData2 = line2.substr(18, 11);
+    fields.optionalDataCheck = '\0';
+    fields.compositeCheck = line2[29];
+
+    splitName(line3, fields);
+    return true;
+}
+
+size_t MrzParser::parseBatch(std::string_view buffer, MrzFields* out, size_t capacity,
+                             size_t* skipped) {
+    size_t count = 0;
+    size_t bad = 0;
+    size_t pos = 0;
+    std::string_view pending;
+    bool havePending = false;
+
+    while (pos < buffer.size() && count < capacity) {
+        size_t end = buffer.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = buffer.size();
+        }
+        std::string_view line = stripLineEnd(buffer.substr(pos, end - pos));
+        pos = end + 1;
+
+        if (line.empty()) {
+            if (havePending) {
+                // A lone line followed by a blank one is not a record
+                ++bad;
+                havePending = false;
+            }
+            continue;
+        }
+
+        if (!havePending) {
+            pending = line;
+            havePending = true;
+            continue;
+        }
+
+        if (parse(pending, line, out[count])) {
+            ++count;
+        } else {
+            ++bad;
+        }
+        havePending = false;
+    }
+
+    if (havePending && count < capacity) {
+        ++bad;
+    }
+    if (skipped) {
+        *skipped = bad;
+    }
+    return count;
+}
+
+size_t MrzParser::copyField(std::string_view field, char* destination, size_t capacity) {
+    if (capacity == 0) {
+        return 0;
+    }
+
+    field = trimFillers(field);
+    size_t length = field.size() < capacity - 1 ? field.size() : capacity - 1;
+    for (size_t i = 0; i < length; ++i) {
+        destination[i] = field[i] == '<' ? ' ' : field[i];
+    }
+    destination[length] = '\0';
+    return length;
+}
+
+void MrzParser::assignField(std::string& destination, std::string_view field) {
+    field = trimFillers(field);
+    // assign() reuses the existing capacity, so re-parsing into the same
+    // Passport does not allocate for typical field lengths
+    destination.assign(field.data(), field.size());
+    for (char& c : destination) {
+        if (c == '<') {
+            c = ' ';
+        }
+    }
+}
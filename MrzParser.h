@@ -0,0 +1,71 @@
+#ifndef MRZ_PARSER_H
+#define MRZ_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// Field views into the MRZ text; nothing is copied and nothing is
+// allocated. The views stay valid as long as the parsed lines do.
+// Name fields keep their inner '<' separators (e.g. "VAN<DER<BERG") with
+// the trailing fillers removed; every other field is the raw fixed-width
+// slice including fillers.
+struct MrzFields {
+    enum Layout {
+        TD1, // ID card, 3 x 30
+        TD2, // 2 x 36
+        TD3  // Passport, 2 x 44
+    };
+
+    Layout layout;
+    std::string_view documentType;
+    std::string_view issuingCountry;
+    std::string_view lastName;
+    std::string_view firstName;
+    std::string_view documentNumber;
+    char documentNumberCheck;
+    std::string_view nationality;
+    std::string_view dateOfBirth;
+    char dateOfBirthCheck;
+    std::string_view gender;
+    std::string_view expirationDate;
+    char expirationDateCheck;
+    std::string_view optionalData;   // TD1: first optional field (line 1)
+    std::string_view optionalData2;  // TD1 only (line 2)
+    char optionalDataCheck;          // TD3 only, '\0' otherwise
+    char compositeCheck;
+};
+
+class MrzParser {
+public:
+    static const size_t TD1_LINE_LENGTH = 30;
+    static const size_t TD2_LINE_LENGTH = 36;
+    static const size_t TD3_LINE_LENGTH = 44;
+
+    // Two-line documents (TD3 passports, TD2); layout chosen by line length
+    static bool parse(std::string_view line1, std::string_view line2, MrzFields& fields);
+    // Three-line TD1 documents
+    static bool parse(std::string_view line1, std::string_view line2, std::string_view line3,
+                      MrzFields& fields);
+
+    // Parses consecutive two-line MRZs from one buffer ("\n" or "\r\n"
+    // separated, blank lines between records allowed) into a caller-owned
+    // array. Malformed records are skipped and counted in *skipped.
+    // Returns the number of records written to out.
+    static size_t parseBatch(std::string_view buffer, MrzFields* out, size_t capacity,
+                             size_t* skipped = nullptr);
+
+    // Drops trailing fillers
+    static std::string_view trimFillers(std::string_view field);
+
+    // Copies a field as text ('<' becomes ' ', trailing fillers dropped)
+    // into a fixed buffer; returns the length written, NUL-terminated
+    static size_t copyField(std::string_view field, char* destination, size_t capacity);
+    static void assignField(std::string& destination, std::string_view field);
+
+private:
+    static void splitName(std::string_view nameField, MrzFields& fields);
+    static std::string_view stripLineEnd(std::string_view line);
+};
+
+#endif // MRZ_PARSER_H
@@ -0,0 +1,515 @@
+#include "../include/MrzReader.h"
+#include "../include/MrzParser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MRZ_READER_SSE2 1
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define MRZ_READER_SSSE3 1
+#endif
+
+namespace {
+    const size_t GLYPH_COUNT = 37;
+    const char GLYPH_CHARACTERS[GLYPH_COUNT + 1] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789<";
+    // 8 x 8 cell, glyph in the top left 5 x 7; a multiple of 16 for SSE2
+    const int CELL_STRIDE = 8;
+    const int CELL_BYTES = 64;
+
+    // Every glyph spans all five columns, so character cells are uniform
+    const char* const GLYPHS[GLYPH_COUNT][MrzReader::GLYPH_ROWS] = {
+        {".###.", "#...#", "#...#", "#####", "#...#", "#...#", "#...#"},   // A
+        {"####.", "#...#", "#...#", "####.", "#...#", "#...#", "####."},   // B
+        {".###.", "#...#", "#....", "#....", "#....", "#...#", ".###."},   // C
+        {"###..", "#..#.", "#...#", "#...#", "#...#", "#..#.", "###.."},   // D
+        {"#####", "#....", "#....", "####.", "#....", "#....", "#####"},   // E
+        {"#####", "#....", "#....", "####.", "#....", "#....", "#...."},   // F
+        {".###.", "#...#", "#....", "#.###", "#...#", "#...#", ".####"},   // G
+        {"#...#", "#...#", "#...#", "#####", "#...#", "#...#", "#...#"},   // H
+        {"#####", "..#..", "..#..", "..#..", "..#..", "..#..", "#####"},   // I
+        {"#####", "...#.", "...#.", "...#.", "...#.", "#..#.", ".##.."},   // J
+        {"#...#", "#..#.", "#.#..", "##...", "#.#..", "#..#.", "#...#"},   // K
+        {"#....", "#....", "#....", "#....", "#....", "#....", "#####"},   // L
+        {"#...#", "##.##", "#.#.#", "#.#.#", "#...#", "#...#", "#...#"},   // M
+        {"#...#", "#...#", "##..#", "#.#.#", "#..##", "#...#", "#...#"},   // N
+        {".###.", "#...#", "#...#", "#...#", "#...#", "#...#", ".###."},   // O
+        {"####.", "#...#", "#...#", "####.", "#....", "#....", "#...."},   // P
+        {".###.", "#...#", "#...#", "#...#", "#.#.#", "#..#.", ".##.#"},   // Q
+        {"####.", "#...#", "#...#", "####.", "#.#..", "#..#.", "#...#"},   // R
+        {".####", "#....", "#....", ".###.", "....#", "....#", "####."},   // S
+        {"#####", "..#..", "..#..", "..#..", "..#..", "..#..", "..#.."},   // T
+        {"#...#", "#...#", "#...#", "#...#", "#...#", "#...#", ".###."},   // U
+        {"#...#", "#...#", "#...#", "#...#", "#...#", ".#.#.", "..#.."},   // V
+        {"#...#", "#...#", "#...#", "#.#.#", "#.#.#", "#.#.#", ".#.#."},   // W
+        {"#...#", "#...#", ".#.#.", "..#..", ".#.#.", "#...#", "#...#"},   // X
+        {"#...#", "#...#", ".#.#.", "..#..", "..#..", "..#..", "..#.."},   // Y
+        {"#####", "....#", "...#.", "..#..", ".#...", "#....", "#####"},   // Z
+        {".###.", "#...#", "#..##", "#.#.#", "##..#", "#...#", ".###."},   // 0
+        {"..#..", ".##..", "#.#..", "..#..", "..#..", "..#..", "#####"},   // 1
+        {".###.", "#...#", "....#", "...#.", "..#..", ".#...", "#####"},   // 2
+        {"#####", "...#.", "..#..", "...#.", "....#", "#...#", ".###."},   // 3
+        {"...#.", "..##.", ".#.#.", "#..#.", "#####", "...#.", "...#."},   // 4
+        {"#####", "#....", "####.", "....#", "....#", "#...#", ".###."},   // 5
+        {"..##.", ".#...", "#....", "####.", "#...#", "#...#", ".###."},   // 6
+        {"#####", "....#", "...#.", "..#..", ".#...", ".#...", ".#..."},   // 7
+        {".###.", "#...#", "#...#", ".###.", "#...#", "#...#", ".###."},   // 8
+        {".###.", "#...#", "#...#", ".####", "....#", "...#.", ".##.."},   // 9
+        {"....#", "..##.", ".#...", "#....", ".#...", "..##.", "....#"}    // <
+    };
+
+    struct Templates {
+        alignas(16) unsigned char cells[GLYPH_COUNT][CELL_BYTES];
+        int8_t index[256];
+
+        Templates() {
+            std::memset(cells, 0, sizeof(cells));
+            std::memset(index, -1, sizeof(index));
+            for (size_t g = 0; g < GLYPH_COUNT; ++g) {
+                for (int row = 0; row < MrzReader::GLYPH_ROWS; ++row) {
+                    for (int column = 0; column < MrzReader::GLYPH_COLUMNS; ++column) {
+                        cells[g][row * CELL_STRIDE + column] = GLYPHS[g][row][column] == '#' ? 255 : 0;
+                    }
+                }
+                index[static_cast<unsigned char>(GLYPH_CHARACTERS[g])] = static_cast<int8_t>(g);
+            }
+        }
+    };
+
+    const Templates& templates() {
+        static const Templates instance;
+        return instance;
+    }
+
+    // Sum of absolute differences between two cells
+    uint32_t cellDistance(const unsigned char* a, const unsigned char* b) {
+#ifdef MRZ_READER_SSE2
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < CELL_BYTES; i += 16) {
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_load_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                                  _mm_load_si128(reinterpret_cast<const __m128i*>(b + i))));
+        }
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#else
+        uint32_t sum = 0;
+        for (int i = 0; i < CELL_BYTES; ++i) {
+            sum += static_cast<uint32_t>(std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+        }
+        return sum;
+#endif
+    }
+
+    // Writes 1 for pixels darker than threshold (at least 1), 0 otherwise;
+    // returns the number of dark pixels
+    uint32_t binarizeRow(const unsigned char* source, unsigned char* target, int count, unsigned char threshold) {
+        int x = 0;
+        uint32_t ink = 0;
+#ifdef MRZ_READER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold - 1));
+        __m128i total = zero;
+        for (; x + 16 <= count; x += 16) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+            // pixel < threshold  <=>  min(pixel, threshold - 1) == pixel
+            const __m128i dark = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(pixels, limit), pixels), one);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), dark);
+            total = _mm_add_epi64(total, _mm_sad_epu8(dark, zero));
+        }
+        ink = static_cast<uint32_t>(_mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+#endif
+        for (; x < count; ++x) {
+            target[x] = source[x] < threshold ? 1 : 0;
+            ink += target[x];
+        }
+        return ink;
+    }
+
+#ifdef MRZ_READER_SSSE3
+    // pshufb masks gathering channel c of 16 RGB pixels from each of the
+    // three 16-byte blocks they span
+    struct DeinterleaveMasks {
+        alignas(16) unsigned char masks[3][3][16];
+
+        DeinterleaveMasks() {
+            for (int channel = 0; channel < 3; ++channel) {
+                for (int block = 0; block < 3; ++block) {
+                    for (int pixel = 0; pixel < 16; ++pixel) {
+                        int byte = pixel * 3 + channel;
+                        masks[channel][block][pixel] = byte / 16 == block ? static_cast<unsigned char>(byte % 16) : 0x80;
+                    }
+                }
+            }
+        }
+    };
+
+    const DeinterleaveMasks& deinterleaveMasks() {
+        static const DeinterleaveMasks instance;
+        return instance;
+    }
+
+    __m128i gatherChannel(const __m128i* blocks, const unsigned char (*masks)[16]) {
+        __m128i result = _mm_shuffle_epi8(blocks[0], _mm_load_si128(reinterpret_cast<const __m128i*>(masks[0])));
+        result = _mm_or_si128(result, _mm_shuffle_epi8(blocks[1], _mm_load_si128(reinterpret_cast<const __m128i*>(masks[1]))));
+        return _mm_or_si128(result, _mm_shuffle_epi8(blocks[2], _mm_load_si128(reinterpret_cast<const __m128i*>(masks[2]))));
+    }
+
+    // (77 R + 150 G + 29 B) >> 8 on eight 16-bit lanes; at most 65280
+    __m128i weightedLuma(__m128i r, __m128i g, __m128i b) {
+        __m128i sum = _mm_mullo_epi16(r, _mm_set1_epi16(77));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(g, _mm_set1_epi16(150)));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(29)));
+        return _mm_srli_epi16(sum, 8);
+    }
+#endif
+
+    // Integer BT.601 luma; the fixed pixel sizes let the compiler unroll
+    template <int CHANNELS>
+    void lumaRow(const unsigned char* row, unsigned char* out, int count) {
+        int start = 0;
+#ifdef MRZ_READER_SSSE3
+        if (CHANNELS == 3) {
+            const DeinterleaveMasks& shuffle = deinterleaveMasks();
+            const __m128i zero = _mm_setzero_si128();
+            for (; start + 16 <= count; start += 16) {
+                __m128i blocks[3];
+                for (int block = 0; block < 3; ++block) {
+                    blocks[block] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + start * 3 + block * 16));
+                }
+                const __m128i r = gatherChannel(blocks, shuffle.masks[0]);
+                const __m128i g = gatherChannel(blocks, shuffle.masks[1]);
+                const __m128i b = gatherChannel(blocks, shuffle.masks[2]);
+                const __m128i low = weightedLuma(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero),
+                                                 _mm_unpacklo_epi8(b, zero));
+                const __m128i high = weightedLuma(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero),
+                                                  _mm_unpackhi_epi8(b, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + start), _mm_packus_epi16(low, high));
+            }
+        }
+#endif
+        for (int x = start; x < count; ++x) {
+            const unsigned char* p = row + x * CHANNELS;
+            out[x] = static_cast<unsigned char>((77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8);
+        }
+    }
+
+    // Otsu's method; returns the first gray level counted as background
+    unsigned char otsuThreshold(const uint32_t* histogram) {
+        uint64_t total = 0;
+        double sum = 0;
+        for (int level = 0; level < 256; ++level) {
+            total += histogram[level];
+            sum += static_cast<double>(level) * histogram[level];
+        }
+
+        uint64_t darkCount = 0;
+        double darkSum = 0;
+        double bestVariance = -1;
+        int threshold = 128;
+        for (int level = 0; level < 255; ++level) {
+            darkCount += histogram[level];
+            darkSum += static_cast<double>(level) * histogram[level];
+            if (darkCount == 0) {
+                continue;
+            }
+            uint64_t lightCount = total - darkCount;
+            if (lightCount == 0) {
+                break;
+            }
+            double darkMean = darkSum / static_cast<double>(darkCount);
+            double lightMean = (sum - darkSum) / static_cast<double>(lightCount);
+            double variance = static_cast<double>(darkCount) * static_cast<double>(lightCount) *
+                              (darkMean - lightMean) * (darkMean - lightMean);
+            if (variance > bestVariance) {
+                bestVariance = variance;
+                threshold = level + 1;
+            }
+        }
+        return static_cast<unsigned char>(threshold);
+    }
+}
+
+MrzReader::MrzReader() : width(0), height(0) {
+}
+
+int MrzReader::glyphIndex(char c) {
+    return templates().index[static_cast<unsigned char>(c)];
+}
+
+int MrzReader::segment(const Band& band) {
+    columnInk.assign(static_cast<size_t>(width), 0);
+    for (int y = band.top; y <= band.bottom; ++y) {
+        const unsigned char* row = binary.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            columnInk[x] = static_cast<uint16_t>(columnInk[x] + row[x]);
+        }
+    }
+
+    // A column belongs to a glyph if more than stray noise is inked in it
+    const int bandHeight = band.bottom - band.top + 1;
+    const uint16_t minInk = static_cast<uint16_t>(std::max(1, bandHeight / 8));
+    runs.clear();
+    int start = -1;
+    for (int x = 0; x <= width; ++x) {
+        bool inked = x < width && columnInk[x] >= minInk;
+        if (inked && start < 0) {
+            start = x;
+        } else if (!inked && start >= 0) {
+            runs.emplace_back(start, x - 1);
+            start = -1;
+        }
+    }
+    if (runs.empty()) {
+        return 0;
+    }
+
+    std::vector<int> widths;
+    widths.reserve(runs.size());
+    for (const auto& run : runs) {
+        widths.push_back(run.second - run.first + 1);
+    }
+    std::nth_element(widths.begin(), widths.begin() + widths.size() / 2, widths.end());
+    const int glyphWidth = widths[widths.size() / 2];
+
+    // Specks narrower than half a glyph are noise
+    runs.erase(std::remove_if(runs.begin(), runs.end(), [glyphWidth](const std::pair<int, int>& run) {
+        return (run.second - run.first + 1) * 2 < glyphWidth;
+    }), runs.end());
+    return glyphWidth;
+}
+
+bool MrzReader::decodeLine(const Band& band, size_t expectedLength, std::string& line, double& confidence,
+                           size_t& uncertain) {
+    const int glyphWidth = segment(band);
+    if (glyphWidth == 0 || runs.size() < 2) {
+        return false;
+    }
+
+    // Character count from the extent and the glyph pitch, which holds
+    // even when touching glyphs merged runs
+    const int first = runs.front().first;
+    const int last = runs.back().second;
+    const double pitchEstimate = static_cast<double>(glyphWidth) * GLYPH_PITCH / GLYPH_COLUMNS;
+    const long estimated = std::lround((last - first + 1 - glyphWidth) / pitchEstimate) + 1;
+    if (std::labs(estimated - static_cast<long>(expectedLength)) > 2) {
+        return false;
+    }
+
+    // One run per character if segmentation was clean, otherwise a grid
+    const bool useRuns = runs.size() == expectedLength;
+    const double pitch = static_cast<double>(last - first + 1 - glyphWidth) / static_cast<double>(expectedLength - 1);
+    const int bandHeight = band.bottom - band.top + 1;
+    const Templates& font = templates();
+
+    line.clear();
+    line.reserve(expectedLength);
+    alignas(16) unsigned char cell[CELL_BYTES];
+    for (size_t i = 0; i < expectedLength; ++i) {
+        const int left = useRuns ? runs[i].first : first + static_cast<int>(std::lround(i * pitch));
+
+        // Area-average the cell down to the 5 x 7 glyph grid
+        std::memset(cell, 0, sizeof(cell));
+        for (int row = 0; row < GLYPH_ROWS; ++row) {
+            const int y0 = band.top + row * bandHeight / GLYPH_ROWS;
+            const int y1 = std::max(y0 + 1, band.top + (row + 1) * bandHeight / GLYPH_ROWS);
+            for (int column = 0; column < GLYPH_COLUMNS; ++column) {
+                const int x0 = std::min(width - 1, left + column * glyphWidth / GLYPH_COLUMNS);
+                const int x1 = std::min(width, std::max(x0 + 1, left + (column + 1) * glyphWidth / GLYPH_COLUMNS));
+                uint32_t ink = 0;
+                for (int y = y0; y < y1; ++y) {
+                    const unsigned char* inkRow = binary.data() + static_cast<size_t>(y) * width;
+                    for (int x = x0; x < x1; ++x) {
+                        ink += inkRow[x];
+                    }
+                }
+                cell[row * CELL_STRIDE + column] =
+                    static_cast<unsigned char>(ink * 255 / static_cast<uint32_t>((y1 - y0) * (x1 - x0)));
+            }
+        }
+
+        uint32_t best = UINT32_MAX;
+        size_t bestGlyph = 0;
+        for (size_t g = 0; g < GLYPH_COUNT; ++g) {
+            uint32_t distance = cellDistance(cell, font.cells[g]);
+            if (distance < best) {
+                best = distance;
+                bestGlyph = g;
+            }
+        }
+        const double score = 1.0 - static_cast<double>(best) / (GLYPH_COLUMNS * GLYPH_ROWS * 255.0);
+        line += GLYPH_CHARACTERS[bestGlyph];
+        confidence = std::min(confidence, score);
+        uncertain += score < LOW_CONFIDENCE;
+    }
+    return true;
+}
+
+MrzReader::Result MrzReader::read(const unsigned char* pixels, int frameWidth, int frameHeight, int channels,
+                                  size_t stride) {
+    Result result;
+    result.found = false;
+    result.lineCount = 0;
+    result.confidence = 0;
+    result.uncertainCharacters = 0;
+    if (!pixels || frameWidth < GLYPH_PITCH || frameHeight < GLYPH_ROWS ||
+        (channels != 1 && channels != 3 && channels != 4)) {
+        return result;
+    }
+    width = frameWidth;
+    height = frameHeight;
+    if (stride == 0) {
+        stride = static_cast<size_t>(width) * channels;
+    }
+    const size_t size = static_cast<size_t>(width) * height;
+
+    // Grayscale: integer BT.601 luma
+    const unsigned char* source = pixels;
+    size_t sourceStride = stride;
+    if (channels != 1) {
+        gray.resize(size);
+        for (int y = 0; y < height; ++y) {
+            const unsigned char* row = pixels + static_cast<size_t>(y) * stride;
+            unsigned char* out = gray.data() + static_cast<size_t>(y) * width;
+            if (channels == 3) {
+                lumaRow<3>(row, out, width);
+            } else {
+                lumaRow<4>(row, out, width);
+            }
+        }
+        source = gray.data();
+        sourceStride = static_cast<size_t>(width);
+    }
+
+    // Threshold from every fourth row and column; four partial histograms
+    // so runs of equal paper pixels do not serialize on one counter
+    uint32_t partial[4][256] = {};
+    for (int y = 0; y < height; y += 4) {
+        const unsigned char* row = source + static_cast<size_t>(y) * sourceStride;
+        for (int x = 0; x < width; x += 4) {
+            ++partial[(x >> 2) & 3][row[x]];
+        }
+    }
+    uint32_t histogram[256];
+    for (int level = 0; level < 256; ++level) {
+        histogram[level] = partial[0][level] + partial[1][level] + partial[2][level] + partial[3][level];
+    }
+    const unsigned char threshold = otsuThreshold(histogram);
+
+    binary.resize(size);
+    rowInk.resize(static_cast<size_t>(height));
+    for (int y = 0; y < height; ++y) {
+        rowInk[y] = binarizeRow(source + static_cast<size_t>(y) * sourceStride,
+                                binary.data() + static_cast<size_t>(y) * width, width, threshold);
+    }
+
+    // Text bands: runs of rows with more ink than scattered noise
+    const uint32_t minRowInk = std::max<uint32_t>(4, static_cast<uint32_t>(width) / 50);
+    bands.clear();
+    int start = -1;
+    for (int y = 0; y <= height; ++y) {
+        bool text = y < height && rowInk[y] >= minRowInk;
+        if (text && start < 0) {
+            start = y;
+        } else if (!text && start >= 0) {
+            if (y - start >= GLYPH_ROWS) {
+                bands.push_back(Band{start, y - 1});
+            }
+            start = -1;
+        }
+    }
+
+    // The MRZ is at the bottom of the page: try TD1, then TD2/TD3
+    for (size_t lineCount : {static_cast<size_t>(3), static_cast<size_t>(2)}) {
+        if (bands.size() < lineCount) {
+            continue;
+        }
+        const Band* mrz = &bands[bands.size() - lineCount];
+        const int firstHeight = mrz[0].bottom - mrz[0].top + 1;
+        bool aligned = true;
+        for (size_t i = 1; i < lineCount; ++i) {
+            const int bandHeight = mrz[i].bottom - mrz[i].top + 1;
+            const int gap = mrz[i].top - mrz[i - 1].bottom - 1;
+            aligned = aligned && std::abs(bandHeight - firstHeight) * 4 <= firstHeight && gap <= 2 * firstHeight;
+        }
+        if (!aligned) {
+            continue;
+        }
+
+        size_t lengths[2] = {MrzParser::TD3_LINE_LENGTH, MrzParser::TD2_LINE_LENGTH};
+        size_t lengthCount = 2;
+        if (lineCount == 3) {
+            lengths[0] = MrzParser::TD1_LINE_LENGTH;
+            lengthCount = 1;
+        }
+        for (size_t c = 0; c < lengthCount; ++c) {
+            const size_t length = lengths[c];
+            double confidence = 1.0;
+            size_t uncertain = 0;
+            bool decoded = true;
+            for (size_t i = 0; i < lineCount && decoded; ++i) {
+                decoded = decodeLine(mrz[i], length, result.lines[i], confidence, uncertain);
+            }
+            if (decoded) {
+                result.found = true;
+                result.lineCount = lineCount;
+                result.confidence = confidence;
+                result.uncertainCharacters = uncertain;
+                return result;
+            }
+        }
+    }
+    for (std::string& line : result.lines) {
+        line.clear();
+    }
+    return result;
+}
+
+bool MrzReader::render(const std::vector<std::string>& lines, unsigned char* pixels, int width, int height,
+                       int channels, int scale, int left, int top) {
+    if (!pixels || lines.empty() || scale <= 0 || channels <= 0 || left < 0 || top < 0) {
+        return false;
+    }
+    size_t longest = 0;
+    for (const std::string& line : lines) {
+        longest = std::max(longest, line.size());
+        for (char c : line) {
+            if (c != ' ' && glyphIndex(c) < 0) {
+                return false;
+            }
+        }
+    }
+    const long textWidth = (static_cast<long>(longest) * GLYPH_PITCH - (GLYPH_PITCH - GLYPH_COLUMNS)) * scale;
+    const long textHeight = (static_cast<long>(lines.size() - 1) * LINE_PITCH + GLYPH_ROWS) * scale;
+    if (left + textWidth > width || top + textHeight > height) {
+        return false;
+    }
+
+    const Templates& font = templates();
+    const size_t stride = static_cast<size_t>(width) * channels;
+    for (size_t l = 0; l < lines.size(); ++l) {
+        for (size_t i = 0; i < lines[l].size(); ++i) {
+            if (lines[l][i] == ' ') {
+                continue;
+            }
+            const unsigned char* glyph = font.cells[glyphIndex(lines[l][i])];
+            for (int row = 0; row < GLYPH_ROWS; ++row) {
+                for (int column = 0; column < GLYPH_COLUMNS; ++column) {
+                    if (glyph[row * CELL_STRIDE + column] == 0) {
+                        continue;
+                    }
+                    const size_t x = left + (i * GLYPH_PITCH + column) * scale;
+                    const size_t y = top + (l * LINE_PITCH + row) * scale;
+                    for (int dy = 0; dy < scale; ++dy) {
+                        std::memset(pixels + (y + dy) * stride + x * channels, 0,
+                                    static_cast<size_t>(scale) * channels);
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
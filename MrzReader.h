@@ -0,0 +1,79 @@
+#ifndef MRZ_READER_H
+#define MRZ_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Reads the MRZ from a camera frame of the passport data page, for
+// e-gates without a dedicated document scanner.
+//
+//   1. Grayscale (RGB frames), Otsu threshold from a sampled histogram
+//   2. SSE2 binarization and per-row ink counts over the whole frame
+//   3. The MRZ is the bottom run of 2 (TD2/TD3) or 3 (TD1) text bands
+//      of the same height that segment into 44, 36 or 30 characters
+//   4. Characters are cut from the column ink profile; when touching or
+//      broken glyphs spoil the count, a fixed pitch grid is used instead
+//   5. Each cell is sampled down to the 5x7 glyph grid and matched
+//      against the OCR-B templates by sum of absolute differences
+//
+// The templates are 5x7 reductions of the OCR-B glyphs for A-Z, 0-9 and
+// '<'; the zero carries a bar to stay apart from O at that size. A
+// reader keeps its scratch buffers between frames, so use one per thread.
+class MrzReader {
+public:
+    static const int GLYPH_COLUMNS = 5;
+    static const int GLYPH_ROWS = 7;
+    static const int GLYPH_PITCH = 6;   // glyph dots per character, including the gap
+    static const int LINE_PITCH = 10;   // glyph dots per line, including the gap
+    static constexpr double LOW_CONFIDENCE = 0.8;
+
+    struct Result {
+        bool found;
+        size_t lineCount;
+        std::string lines[3];
+        double confidence;            // lowest character score, 0..1
+        size_t uncertainCharacters;   // characters scoring below LOW_CONFIDENCE
+    };
+
+private:
+    struct Band {
+        int top;
+        int bottom;   // inclusive
+    };
+
+    std::vector<unsigned char> gray;
+    std::vector<unsigned char> binary;   // 1 = ink, width bytes per row
+    std::vector<uint32_t> rowInk;
+    std::vector<uint16_t> columnInk;
+    std::vector<std::pair<int, int>> runs;
+    std::vector<Band> bands;
+    int width;
+    int height;
+
+    // Column runs of the band into runs; returns the median glyph width
+    int segment(const Band& band);
+    bool decodeLine(const Band& band, size_t expectedLength, std::string& line, double& confidence,
+                    size_t& uncertain);
+
+public:
+    MrzReader();
+
+    // pixels: 1 (gray), 3 (RGB) or 4 (RGBA) bytes per pixel; stride 0
+    // means tightly packed rows
+    Result read(const unsigned char* pixels, int width, int height, int channels, size_t stride = 0);
+
+    // Prints MRZ lines in the template font, scale pixels per glyph dot,
+    // top left corner at (left, top); spaces are left blank. False if a
+    // character has no glyph or the text does not fit. For the simulated
+    // camera and tests.
+    static bool render(const std::vector<std::string>& lines, unsigned char* pixels, int width, int height,
+                       int channels, int scale, int left, int top);
+
+    // Index of the template for c, -1 if there is none
+    static int glyphIndex(char c);
+};
+
+#endif // MRZ_READER_H
@@ -0,0 +1,402 @@
+#include "../include/NameWatchlist.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+    // U+00C0..U+00FF
+    const char* const LATIN1[64] = {
+        "A", "A", "A", "A", "AE", "AA", "AE", "C", "E", "E", "E", "E", "I", "I", "I", "I",
+        "D", "N", "O", "O", "O", "O", "OE", "", "OE", "U", "U", "U", "UE", "Y", "TH", "SS",
+        "A", "A", "A", "A", "AE", "AA", "AE", "C", "E", "E", "E", "E", "I", "I", "I", "I",
+        "D", "N", "O", "O", "O", "O", "OE", "", "OE", "U", "U", "U", "UE", "Y", "TH", "Y"
+    };
+
+    // U+0100..U+017F base letters; '#' is IJ, '%' is OE
+    const char LATIN_EXTENDED_A[] =
+        "AAAAAACCCCCCCCDDDDEEEEEEEEEEGGGGGGGGHHHHIIIIIIIIII##JJKKKLLLLLLLLLLNNNNNNNNNOOOOOO"
+        "%%RRRRRRSSSSSSSSTTTTTTUUUUUUUUUUUUWWYYYZZZZZZS";
+
+    // A-Z = 0..25, space = 26, anything else = 27
+    inline uint32_t symbol(char c) {
+        if (c >= 'A' && c <= 'Z') {
+            return static_cast<uint32_t>(c - 'A');
+        }
+        return c == ' ' ? 26 : 27;
+    }
+
+    void appendLetters(std::string& out, const char* letters) {
+        for (; *letters; ++letters) {
+            out.push_back(*letters);
+        }
+    }
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    // Bit-parallel Levenshtein distance (Myers 1999, Hyyrö's global form).
+    // Pattern bits are DP rows; each text character advances one column.
+    class MyersPattern {
+    private:
+        uint64_t peq[28];
+        uint32_t length;
+
+    public:
+        explicit MyersPattern(std::string_view pattern) {
+            length = static_cast<uint32_t>(std::min(pattern.size(), NameWatchlist::MAX_NAME_LENGTH));
+            std::fill(peq, peq + 28, 0);
+            for (uint32_t i = 0; i < length; ++i) {
+                peq[symbol(pattern[i])] |= 1ULL << i;
+            }
+        }
+
+        uint32_t distance(std::string_view text, uint32_t bound) const {
+            const uint32_t n = static_cast<uint32_t>(text.size());
+            if (length == 0) {
+                return std::min(n, bound + 1);
+            }
+            if ((n > length ? n - length : length - n) > bound) {
+                return bound + 1;
+            }
+
+            const uint64_t high = 1ULL << (length - 1);
+            uint64_t pv = length == 64 ? ~0ULL : (1ULL << length) - 1;
+            uint64_t mv = 0;
+            uint32_t score = length;
+            for (uint32_t j = 0; j < n; ++j) {
+                const uint64_t eq = peq[symbol(text[j])];
+                const uint64_t xv = eq | mv;
+                const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+                uint64_t ph = mv | ~(xh | pv);
+                uint64_t mh = pv & xh;
+                if (ph & high) {
+                    ++score;
+                } else if (mh & high) {
+                    --score;
+                }
+                // Row 0 is D[0][j] = j: every horizontal step there is +1
+                ph = (ph << 1) | 1;
+                mh <<= 1;
+                pv = mh | ~(xv | ph);
+                mv = ph & xv;
+
+                // The last row can drop by at most one per remaining column
+                if (score > bound + (n - j - 1)) {
+                    return bound + 1;
+                }
+            }
+            return score <= bound ? score : bound + 1;
+        }
+    };
+}
+
+NameWatchlist::NameWatchlist() : nameOffsets(1, 0), built(false) {
+}
+
+std::string NameWatchlist::normalize(std::string_view name) {
+    std::string out;
+    out.reserve(name.size());
+    bool pendingSpace = false;
+
+    auto emit = [&](const char* letters) {
+        if (*letters == '\0') {
+            return;
+        }
+        if (pendingSpace && !out.empty()) {
+            out.push_back(' ');
+        }
+        pendingSpace = false;
+        appendLetters(out, letters);
+    };
+
+    for (size_t i = 0; i < name.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(name[i]);
+        if (c < 0x80) {
+            if (c >= 'a' && c <= 'z') {
+                const char letter[2] = {static_cast<char>(c - 'a' + 'A'), '\0'};
+                emit(letter);
+            } else if (c >= 'A' && c <= 'Z') {
+                const char letter[2] = {static_cast<char>(c), '\0'};
+                emit(letter);
+            } else if (c == ' ' || c == '<' || c == '-' || c == '\'' || c == ',' || c == '.' || c == '\t') {
+                pendingSpace = true;
+            }
+            continue;
+        }
+
+        // UTF-8: two-byte Latin letters are transliterated, anything else is dropped
+        size_t extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        if (extra == 1 && i + 1 < name.size()) {
+            uint32_t codePoint = ((c & 0x1Fu) << 6) | (static_cast<unsigned char>(name[i + 1]) & 0x3Fu);
+            if (codePoint >= 0xC0 && codePoint <= 0xFF) {
+                emit(LATIN1[codePoint - 0xC0]);
+            } else if (codePoint >= 0x100 && codePoint <= 0x17F) {
+                char base = LATIN_EXTENDED_A[codePoint - 0x100];
+                const char letter[2] = {base, '\0'};
+                emit(base == '#' ? "IJ" : base == '%' ? "OE" : letter);
+            }
+        }
+        i += std::min(extra, name.size() - 1 - i);
+    }
+    return out;
+}
+
+std::string NameWatchlist::fullName(std::string_view lastName, std::string_view firstName) {
+    std::string last = normalize(lastName);
+    std::string first = normalize(firstName);
+    if (!last.empty() && !first.empty()) {
+        last.push_back(' ');
+    }
+    last += first;
+    if (last.size() > MAX_NAME_LENGTH) {
+        last.resize(MAX_NAME_LENGTH);
+    }
+    return last;
+}
+
+uint32_t NameWatchlist::maxDistance(size_t length) {
+    if (length <= 4) {
+        return 0;
+    }
+    if (length <= 8) {
+        return 1;
+    }
+    return length <= 16 ? 2 : 3;
+}
+
+uint32_t NameWatchlist::editDistance(std::string_view pattern, std::string_view text, uint32_t bound) {
+    return MyersPattern(pattern).distance(text, bound);
+}
+
+void NameWatchlist::collectGrams(std::string_view name, std::vector<uint32_t>& grams) {
+    grams.clear();
+    // Padded with a space on both sides so name boundaries form grams too
+    uint32_t previous = 26;
+    uint32_t current = name.empty() ? 26 : symbol(name[0]);
+    for (size_t i = 1; i <= name.size() + 1; ++i) {
+        uint32_t next = i < name.size() ? symbol(name[i]) : 26;
+        grams.push_back((previous * 28 + current) * 28 + next);
+        previous = current;
+        current = next;
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+void NameWatchlist::add(const std::string& id, std::string_view lastName, std::string_view firstName) {
+    std::string key = fullName(lastName, firstName);
+    ids.push_back(id);
+    names.insert(names.end(), key.begin(), key.end());
+    nameOffsets.push_back(static_cast<uint32_t>(names.size()));
+    built = false;
+}
+
+void NameWatchlist::build() {
+    // Entries by name length, so each posting list is ordered by length and
+    // a query only scans the length window it can match
+    std::vector<uint32_t> byLength(ids.size());
+    std::vector<uint32_t> lengthStart(MAX_NAME_LENGTH + 2, 0);
+    for (uint32_t entry = 0; entry < ids.size(); ++entry) {
+        ++lengthStart[getName(entry).size() + 1];
+    }
+    for (size_t length = 0; length <= MAX_NAME_LENGTH; ++length) {
+        lengthStart[length + 1] += lengthStart[length];
+    }
+    for (uint32_t entry = 0; entry < ids.size(); ++entry) {
+        byLength[lengthStart[getName(entry).size()]++] = entry;
+    }
+
+    // Counting sort into CSR form: count, prefix sum, fill
+    std::vector<uint32_t> grams;
+    gramOffsets.assign(GRAM_COUNT + 1, 0);
+    for (uint32_t entry = 0; entry < ids.size(); ++entry) {
+        collectGrams(getName(entry), grams);
+        for (uint32_t gram : grams) {
+            ++gramOffsets[gram + 1];
+        }
+    }
+    for (uint32_t gram = 0; gram < GRAM_COUNT; ++gram) {
+        gramOffsets[gram + 1] += gramOffsets[gram];
+    }
+
+    postings.assign(gramOffsets[GRAM_COUNT], 0);
+    postingLengths.assign(gramOffsets[GRAM_COUNT], 0);
+    std::vector<uint32_t> fill(gramOffsets.begin(), gramOffsets.end() - 1);
+    for (uint32_t entry : byLength) {
+        std::string_view name = getName(entry);
+        collectGrams(name, grams);
+        for (uint32_t gram : grams) {
+            postingLengths[fill[gram]] = static_cast<uint8_t>(name.size());
+            postings[fill[gram]++] = entry;
+        }
+    }
+    built = true;
+}
+
+bool NameWatchlist::loadFromFile(const std::string& filename, std::string& error) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        error = "cannot open " + filename;
+        return false;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') {
+            continue;
+        }
+        size_t first = text.find(',');
+        if (first == std::string_view::npos) {
+            error = filename + ":" + std::to_string(lineNumber) + ": expected ID,LAST NAME[,FIRST NAME]";
+            return false;
+        }
+        size_t second = text.find(',', first + 1);
+        std::string_view lastName = text.substr(first + 1, second == std::string_view::npos ? second : second - first - 1);
+        std::string_view firstName = second == std::string_view::npos ? std::string_view() : text.substr(second + 1);
+        add(std::string(trim(text.substr(0, first))), trim(lastName), trim(firstName));
+    }
+
+    build();
+    return true;
+}
+
+size_t NameWatchlist::screen(std::string_view lastName, std::string_view firstName,
+                             std::vector<WatchlistMatch>& matches) const {
+    const std::string key = fullName(lastName, firstName);
+    if (!built || key.empty()) {
+        return 0;
+    }
+    const uint32_t bound = maxDistance(key.size());
+    const MyersPattern pattern(key);
+    const size_t before = matches.size();
+
+    auto score = [&](uint32_t entry) {
+        std::string_view name = getName(entry);
+        uint32_t distance = pattern.distance(name, bound);
+        if (distance <= bound) {
+            double longer = static_cast<double>(std::max(name.size(), key.size()));
+            matches.push_back(WatchlistMatch{entry, distance, 1.0 - distance / longer});
+        }
+    };
+
+    // Per-thread scratch so screening does not allocate
+    thread_local std::vector<uint32_t> grams;
+    thread_local std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    thread_local std::vector<std::pair<uint64_t, uint32_t>> heap;
+    collectGrams(key, grams);
+
+    // Count filter: k edits destroy at most 3k of the query's distinct
+    // trigrams, so a match shares at least grams - 3k of them
+    if (grams.size() <= 3 * bound) {
+        // Too few grams to filter on (e.g. "AAAA"): check every entry
+        for (uint32_t entry = 0; entry < ids.size(); ++entry) {
+            score(entry);
+        }
+    } else {
+        const size_t minShared = grams.size() - 3 * bound;
+
+        // Part of each posting list with names of a matching length
+        const uint8_t shortest = static_cast<uint8_t>(key.size() > bound ? key.size() - bound : 0);
+        const uint8_t longest = static_cast<uint8_t>(key.size() + bound);
+        ranges.clear();
+        for (uint32_t gram : grams) {
+            auto first = postingLengths.begin() + gramOffsets[gram];
+            auto last = postingLengths.begin() + gramOffsets[gram + 1];
+            auto low = std::lower_bound(first, last, shortest);
+            auto high = std::upper_bound(low, last, longest);
+            if (low != high) {
+                ranges.emplace_back(static_cast<uint32_t>(low - postingLengths.begin()),
+                                    static_cast<uint32_t>(high - postingLengths.begin()));
+            }
+        }
+
+        // Any prefixLists of the lists contain every match at least once, so
+        // candidates come from merging the shortest ones. The longer lists
+        // are then probed in step with the ascending candidates, with
+        // galloping cursors; all reads are sequential and only candidates
+        // that pass the count touch the name data.
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+                      return a.second - a.first < b.second - b.first;
+                  });
+        if (ranges.size() < minShared) {
+            return 0;
+        }
+        const size_t prefixLists = ranges.size() - minShared + 1;
+
+        auto postingKey = [this](uint32_t p) {
+            return (static_cast<uint64_t>(postingLengths[p]) << 32) | postings[p];
+        };
+        auto later = [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+            return a.first > b.first;
+        };
+        heap.clear();
+        for (uint32_t i = 0; i < prefixLists; ++i) {
+            heap.emplace_back(postingKey(ranges[i].first), i);
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        while (!heap.empty()) {
+            const uint64_t candidate = heap.front().first;
+            size_t count = 0;
+            while (!heap.empty() && heap.front().first == candidate) {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                uint32_t list = heap.back().second;
+                if (++ranges[list].first < ranges[list].second) {
+                    heap.back().first = postingKey(ranges[list].first);
+                    std::push_heap(heap.begin(), heap.end(), later);
+                } else {
+                    heap.pop_back();
+                }
+                ++count;
+            }
+
+            for (size_t list = prefixLists; list < ranges.size() && count < minShared; ++list) {
+                if (count + (ranges.size() - list) < minShared) {
+                    break;
+                }
+                // Gallop to the first posting >= candidate, then binary search
+                uint32_t& position = ranges[list].first;
+                const uint32_t end = ranges[list].second;
+                uint32_t step = 1;
+                uint32_t low = position;
+                while (position + step < end && postingKey(position + step) < candidate) {
+                    low = position + step;
+                    step *= 2;
+                }
+                uint32_t high = std::min(position + step, end);
+                while (low < high) {
+                    uint32_t middle = low + (high - low) / 2;
+                    if (postingKey(middle) < candidate) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+                position = low;
+                if (position < end && postingKey(position) == candidate) {
+                    ++count;
+                }
+            }
+
+            if (count >= minShared) {
+                score(static_cast<uint32_t>(candidate));
+            }
+        }
+    }
+
+    std::sort(matches.begin() + static_cast<long>(before), matches.end(),
+              [](const WatchlistMatch& a, const WatchlistMatch& b) {
+                  return a.distance != b.distance ? a.distance < b.distance : a.entry < b.entry;
+              });
+    return matches.size() - before;
+}
@@ -0,0 +1,74 @@
+#ifndef NAME_WATCHLIST_H
+#define NAME_WATCHLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct WatchlistMatch {
+    uint32_t entry;      // index into the watchlist
+    uint32_t distance;   // edit distance between the normalized names
+    double score;        // 1 - distance / longer name length
+};
+
+// Approximate name screening against a watchlist.
+//
+// Names are normalized to the MRZ alphabet (A-Z and single spaces), with
+// accented Latin letters transliterated as in ICAO 9303 (e.g. U-umlaut ->
+// UE), so "Müller", "MUELLER" and "MULLER" end up at most one edit apart.
+// Candidates come from a trigram inverted index; they are then scored with
+// a bit-parallel (Myers/Hyyrö) bounded Levenshtein distance that updates
+// 64 cells of the DP column per step.
+//
+// Built once and immutable afterwards; screen() is safe from any thread.
+class NameWatchlist {
+public:
+    static constexpr size_t MAX_NAME_LENGTH = 64;   // one machine word in the distance kernel
+
+private:
+    static const uint32_t GRAM_COUNT = 28 * 28 * 28;
+
+    std::vector<std::string> ids;
+    std::vector<char> names;             // normalized "LAST FIRST", concatenated
+    std::vector<uint32_t> nameOffsets;   // size() + 1 entries
+    std::vector<uint32_t> gramOffsets;   // GRAM_COUNT + 1 entries, CSR over postings
+    std::vector<uint32_t> postings;      // entry indices per trigram, by name length
+    std::vector<uint8_t> postingLengths; // name length of each posting
+    bool built;
+
+    // Trigram codes of " NAME ", sorted and unique
+    static void collectGrams(std::string_view name, std::vector<uint32_t>& grams);
+
+public:
+    NameWatchlist();
+
+    // ICAO 9303 style transliteration; input is UTF-8 or MRZ text ('<' as space)
+    static std::string normalize(std::string_view name);
+    // "LAST FIRST" key used for both the list and the passenger
+    static std::string fullName(std::string_view lastName, std::string_view firstName);
+    // Allowed edits for a normalized name length
+    static uint32_t maxDistance(size_t length);
+    // Levenshtein distance, or bound + 1 once it is known to exceed bound.
+    // The pattern is truncated to MAX_NAME_LENGTH characters.
+    static uint32_t editDistance(std::string_view pattern, std::string_view text, uint32_t bound);
+
+    // Building
+    void add(const std::string& id, std::string_view lastName, std::string_view firstName);
+    void build();
+    // CSV lines: ID,LAST NAME,FIRST NAME ('#' comments allowed)
+    bool loadFromFile(const std::string& filename, std::string& error);
+
+    // Appends matches within maxDistance() of the passenger name, best first
+    size_t screen(std::string_view lastName, std::string_view firstName,
+                  std::vector<WatchlistMatch>& matches) const;
+
+    size_t size() const { return ids.size(); }
+    const std::string& getId(uint32_t entry) const { return ids[entry]; }
+    std::string_view getName(uint32_t entry) const {
+        return std::string_view(names.data() + nameOffsets[entry], nameOffsets[entry + 1] - nameOffsets[entry]);
+    }
+};
+
+#endif // NAME_WATCHLIST_H
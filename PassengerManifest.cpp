@@ -0,0 +1,429 @@
+#include "../include/PassengerManifest.h"
+#include "../include/MappedFile.h"
+#include "../include/MrzCharset.h"
+#include "../include/NameWatchlist.h"
+#include "../include/StolenDocumentIndex.h"
+#include <cstring>
+
+namespace {
+    const size_t CSV_FIELD_COUNT = 9;
+    const char SEGMENT_TERMINATOR = '\'';
+    const char ELEMENT_SEPARATOR = '+';
+    const char COMPONENT_SEPARATOR = ':';
+    const char RELEASE_CHARACTER = '?';
+
+    uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t' ||
+                                 text.front() == '\r' || text.front() == '\n')) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' ||
+                                 text.back() == '\r' || text.back() == '\n')) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    // Next CSV field or line: up to the separator, no escapes (a '?' is
+    // data). Consumes the token and its separator.
+    std::string_view nextCsvToken(std::string_view& text, char separator) {
+        size_t i = text.find(separator);
+        i = i == std::string_view::npos ? text.size() : i;
+        std::string_view token = text.substr(0, i);
+        text.remove_prefix(i < text.size() ? i + 1 : i);
+        return token;
+    }
+
+    // Next PAXLST separator-delimited token; separators after the release
+    // character do not count. Consumes the token and its separator.
+    std::string_view nextToken(std::string_view& text, char separator) {
+        size_t i = 0;
+        while (i < text.size() && text[i] != separator) {
+            i += text[i] == RELEASE_CHARACTER ? 2 : 1;
+        }
+        i = i < text.size() ? i : text.size();
+        std::string_view token = text.substr(0, i);
+        text.remove_prefix(i < text.size() ? i + 1 : i);
+        return token;
+    }
+
+    // Appends text to a fixed record field in MRZ form: upper case letters
+    // and digits, runs of anything else as one space. With released
+    // (PAXLST), release characters are dropped. Non-ASCII names are
+    // transliterated first.
+    void appendField(char* field, size_t size, std::string_view text, bool released) {
+        for (char c : text) {
+            if (static_cast<unsigned char>(c) >= 0x80) {
+                // Rare; the normalized name fits the small string buffer
+                std::string normalized = NameWatchlist::normalize(text);
+                appendField(field, size, normalized, released);
+                return;
+            }
+        }
+
+        size_t length = 0;
+        while (length < size && field[length] != '\0') {
+            ++length;
+        }
+        bool pendingSpace = length > 0;
+        for (size_t i = 0; i < text.size() && length < size; ++i) {
+            char c = text[i];
+            if (released && c == RELEASE_CHARACTER && i + 1 < text.size()) {
+                c = text[++i];
+            }
+            if (c >= 'a' && c <= 'z') {
+                c = static_cast<char>(c - 'a' + 'A');
+            }
+            if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                if (pendingSpace && length > 0) {
+                    field[length++] = ' ';
+                    if (length == size) {
+                        break;
+                    }
+                }
+                field[length++] = c;
+                pendingSpace = false;
+            } else {
+                pendingSpace = true;
+            }
+        }
+        // A trailing separator space never reaches the field
+        if (length > 0 && field[length - 1] == ' ') {
+            --length;
+        }
+        std::memset(field + length, 0, size - length);
+    }
+
+    uint16_t countryCode(std::string_view text) {
+        text = trim(text);
+        char code[3];
+        if (text.empty() || text.size() > 3) {
+            return INVALID_COUNTRY_CODE;
+        }
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            code[i] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+        return packCountryCode(std::string_view(code, text.size()));
+    }
+
+    // YYMMDD, or CCYYMMDD as PAXLST format 102 sends it
+    int32_t manifestDate(std::string_view text, MrzDate::Kind kind, int32_t today) {
+        text = trim(text);
+        if (text.size() == 8) {
+            text.remove_prefix(2);
+        }
+        return MrzDate::decode(text, kind, today);
+    }
+
+    char sexCode(std::string_view text) {
+        text = trim(text);
+        char c = text.empty() ? '<' : text[0];
+        c = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+        return (c == 'M' || c == 'F' || c == 'X') ? c : '<';
+    }
+
+    void clearRecord(PassportRecord& record) {
+        std::memset(&record, 0, sizeof(record));
+        record.birthDay = MrzDate::INVALID;
+        record.expiryDay = MrzDate::INVALID;
+        record.issuingCountry = INVALID_COUNTRY_CODE;
+        record.nationality = INVALID_COUNTRY_CODE;
+        record.gender = '<';
+    }
+
+    bool sameText(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+    }
+}
+
+PassengerManifest::PassengerManifest()
+    : verified(false), ruleDataVersion(0), verifiedDay(MrzDate::INVALID),
+      lookups(0), confirmed(0), mismatched(0), stale(0) {
+}
+
+PassengerManifest::Format PassengerManifest::detectFormat(std::string_view data) {
+    data = trim(data);
+    return (data.substr(0, 3) == "UNA" || data.substr(0, 3) == "UNB") ? PAXLST : CSV;
+}
+
+bool PassengerManifest::addRecord(PassportRecord& record) {
+    // Document numbers are 1-9 letters and digits
+    std::string_view number = record.getPassportNumber();
+    if (number.empty() || number.find(' ') != std::string_view::npos ||
+        record.issuingCountry == INVALID_COUNTRY_CODE || record.getLastName().empty()) {
+        return false;
+    }
+    if (record.documentType[0] == '\0') {
+        record.documentType[0] = 'P';
+    }
+    // The manifest has no MRZ; generated check digits let the record go
+    // through the same rules as a scanned passport
+    record.computeCheckDigits();
+    passengers.add(record);
+    return true;
+}
+
+size_t PassengerManifest::parseCsv(std::string_view data, size_t* skipped) {
+    const int32_t today = CurrentDate::today();
+    size_t added = 0;
+    bool firstRow = true;
+    PassportRecord record;
+
+    while (!data.empty()) {
+        std::string_view line = trim(nextCsvToken(data, '\n'));
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        if (firstRow) {
+            firstRow = false;
+            if (line.size() >= 8 && (line.substr(0, 8) == "document" || line.substr(0, 8) == "DOCUMENT")) {
+                continue;
+            }
+        }
+
+        std::string_view fields[CSV_FIELD_COUNT];
+        size_t count = 0;
+        while (!line.empty() && count < CSV_FIELD_COUNT) {
+            fields[count++] = trim(nextCsvToken(line, ','));
+        }
+        if (count != CSV_FIELD_COUNT || !line.empty()) {
+            ++*skipped;
+            continue;
+        }
+
+        clearRecord(record);
+        appendField(record.documentType, 2, fields[0], false);
+        appendField(record.passportNumber, PassportRecord::NUMBER_SIZE, fields[1], false);
+        record.issuingCountry = countryCode(fields[2]);
+        record.nationality = countryCode(fields[3]);
+        appendField(record.lastName, PassportRecord::NAME_SIZE, fields[4], false);
+        appendField(record.firstName, PassportRecord::NAME_SIZE, fields[5], false);
+        record.birthDay = manifestDate(fields[6], MrzDate::BIRTH, today);
+        record.gender = sexCode(fields[7]);
+        record.expiryDay = manifestDate(fields[8], MrzDate::EXPIRY, today);
+        if (addRecord(record)) {
+            ++added;
+        } else {
+            ++*skipped;
+        }
+    }
+    return added;
+}
+
+size_t PassengerManifest::parsePaxlst(std::string_view data, size_t* skipped) {
+    const int32_t today = CurrentDate::today();
+    size_t added = 0;
+    bool open = false;
+    PassportRecord record;
+
+    auto finishPassenger = [&]() {
+        if (open) {
+            if (addRecord(record)) {
+                ++added;
+            } else {
+                ++*skipped;
+            }
+            open = false;
+        }
+    };
+
+    while (!data.empty()) {
+        std::string_view segment = trim(nextToken(data, SEGMENT_TERMINATOR));
+        std::string_view tag = nextToken(segment, ELEMENT_SEPARATOR);
+        if (tag == "NAD") {
+            // NAD+FL+++SURNAME:GIVEN:MORE GIVEN NAMES (FL passenger, FM crew)
+            finishPassenger();
+            clearRecord(record);
+            open = true;
+            for (int i = 0; i < 3; ++i) {
+                nextToken(segment, ELEMENT_SEPARATOR);
+            }
+            std::string_view name = nextToken(segment, ELEMENT_SEPARATOR);
+            appendField(record.lastName, PassportRecord::NAME_SIZE, nextToken(name, COMPONENT_SEPARATOR), true);
+            while (!name.empty()) {
+                appendField(record.firstName, PassportRecord::NAME_SIZE, nextToken(name, COMPONENT_SEPARATOR), true);
+            }
+        } else if (tag == "UNT" || tag == "UNZ") {
+            // End of message or interchange
+            finishPassenger();
+        } else if (!open) {
+            continue;
+        } else if (tag == "ATT") {
+            // ATT+2++M
+            if (nextToken(segment, ELEMENT_SEPARATOR) == "2") {
+                nextToken(segment, ELEMENT_SEPARATOR);
+                record.gender = sexCode(nextToken(segment, ELEMENT_SEPARATOR));
+            }
+        } else if (tag == "DTM") {
+            // DTM+329:800101 (birth), DTM+36:301231 (expiry)
+            std::string_view element = nextToken(segment, ELEMENT_SEPARATOR);
+            std::string_view qualifier = nextToken(element, COMPONENT_SEPARATOR);
+            std::string_view date = nextToken(element, COMPONENT_SEPARATOR);
+            if (qualifier == "329") {
+                record.birthDay = manifestDate(date, MrzDate::BIRTH, today);
+            } else if (qualifier == "36") {
+                record.expiryDay = manifestDate(date, MrzDate::EXPIRY, today);
+            }
+        } else if (tag == "NAT") {
+            // NAT+2+USA
+            if (nextToken(segment, ELEMENT_SEPARATOR) == "2") {
+                record.nationality = countryCode(nextToken(segment, ELEMENT_SEPARATOR));
+            }
+        } else if (tag == "DOC") {
+            // DOC+P:110:111+P12345678
+            std::string_view type = nextToken(segment, ELEMENT_SEPARATOR);
+            appendField(record.documentType, 2, nextToken(type, COMPONENT_SEPARATOR), true);
+            appendField(record.passportNumber, PassportRecord::NUMBER_SIZE, nextToken(segment, ELEMENT_SEPARATOR), true);
+        } else if (tag == "LOC") {
+            // LOC+91+USA (place of document issue)
+            if (nextToken(segment, ELEMENT_SEPARATOR) == "91") {
+                record.issuingCountry = countryCode(nextToken(segment, ELEMENT_SEPARATOR));
+            }
+        }
+    }
+    finishPassenger();
+    return added;
+}
+
+size_t PassengerManifest::ingest(std::string_view data, Format format, size_t* skipped) {
+    size_t ignored = 0;
+    size_t* malformed = skipped ? skipped : &ignored;
+    *malformed = 0;
+    if (format == AUTO) {
+        format = detectFormat(data);
+    }
+
+    size_t added = format == PAXLST ? parsePaxlst(data, malformed) : parseCsv(data, malformed);
+    // New passengers have no verdicts yet
+    verified = false;
+    buildIndex();
+    return added;
+}
+
+bool PassengerManifest::ingestFile(const std::string& path, std::string& error, Format format,
+                                   size_t* skipped) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    // Read once, front to back
+    file.advise(0, file.size(), MappedFile::SEQUENTIAL);
+    ingest(std::string_view(file.data(), file.size()), format, skipped);
+    return true;
+}
+
+void PassengerManifest::buildIndex() {
+    size_t capacity = 16;
+    while (capacity < passengers.size() * 2) {
+        capacity *= 2;
+    }
+    slots.assign(capacity, Slot{StolenDocumentIndex::INVALID_KEY, 0});
+
+    const size_t mask = capacity - 1;
+    for (size_t row = 0; row < passengers.size(); ++row) {
+        PassportRecord record = passengers.getRecord(row);
+        uint64_t key = StolenDocumentIndex::makeKey(unpackCountryCode(record.issuingCountry),
+                                                    record.getPassportNumber());
+        if (key == StolenDocumentIndex::INVALID_KEY) {
+            continue;
+        }
+        // A document listed twice keeps its latest row
+        size_t i = mix(key) & mask;
+        while (slots[i].key != StolenDocumentIndex::INVALID_KEY && slots[i].key != key) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = Slot{key, static_cast<uint32_t>(row)};
+    }
+}
+
+const PassengerManifest::Slot* PassengerManifest::findSlot(uint64_t key) const {
+    if (key == StolenDocumentIndex::INVALID_KEY || slots.empty()) {
+        return nullptr;
+    }
+    const size_t mask = slots.size() - 1;
+    for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+        if (slots[i].key == key) {
+            return &slots[i];
+        }
+        if (slots[i].key == StolenDocumentIndex::INVALID_KEY) {
+            return nullptr;
+        }
+    }
+}
+
+bool PassengerManifest::verify(const VerificationSystem& verifier, const OperatorSession& session) {
+    if (!session.isValid(PersonnelStore::now())) {
+        return false;
+    }
+
+    // Read before verifying: a change made meanwhile marks the verdicts stale
+    ruleDataVersion = verifier.getRuleDataVersion();
+    verifiedDay = CurrentDate::today();
+
+    std::vector<Passport> list;
+    list.reserve(passengers.size());
+    for (size_t row = 0; row < passengers.size(); ++row) {
+        list.push_back(passengers.getPassport(row));
+    }
+    std::vector<VerificationSystem::VerificationResult> results = verifier.verifyBatch(list, session);
+    verdicts.assign(results.begin(), results.end());
+    verified = true;
+    return true;
+}
+
+PassengerManifest::Match PassengerManifest::lookup(const Passport& scanned, uint64_t currentRuleDataVersion,
+                                                   int32_t today,
+                                                   VerificationSystem::VerificationResult& verdict) const {
+    lookups.fetch_add(1, std::memory_order_relaxed);
+    const Slot* slot = findSlot(StolenDocumentIndex::makeKey(scanned.getIssuingCountry(),
+                                                             scanned.getPassportNumber()));
+    if (!slot) {
+        return NOT_LISTED;
+    }
+    if (!verified || ruleDataVersion != currentRuleDataVersion || verifiedDay != today) {
+        stale.fetch_add(1, std::memory_order_relaxed);
+        return STALE;
+    }
+
+    // Confirmation scan: the presented document is the listed one and its
+    // MRZ stands on its own (check digits and layout were generated for
+    // the manifest, so they were not really tested by verify())
+    PassportRecord listed = passengers.getRecord(slot->row);
+    PassportRecord presented = PassportRecord::fromPassport(scanned);
+    MrzCharset::Violation violation;
+    // MRZ names are cut at 39 characters, so the listed given names only
+    // need to start with the scanned ones
+    bool same = presented.hasMrz() &&
+                presented.birthDay == listed.birthDay && presented.expiryDay == listed.expiryDay &&
+                presented.nationality == listed.nationality && presented.gender == listed.gender &&
+                sameText(presented.getLastName(), listed.getLastName()) &&
+                !presented.getFirstName().empty() &&
+                listed.getFirstName().substr(0, presented.getFirstName().size()) == presented.getFirstName() &&
+                std::memcmp(presented.documentType, listed.documentType, sizeof(listed.documentType)) == 0 &&
+                scanned.validateMRZChecksum() &&
+                MrzCharset::check(scanned.getMrzLine1(), scanned.getMrzLine2(), violation);
+    if (!same) {
+        mismatched.fetch_add(1, std::memory_order_relaxed);
+        return MISMATCH;
+    }
+
+    confirmed.fetch_add(1, std::memory_order_relaxed);
+    verdict = static_cast<VerificationSystem::VerificationResult>(verdicts[slot->row]);
+    return CONFIRMED;
+}
+
+PassengerManifest::Statistics PassengerManifest::getStatistics() const {
+    Statistics statistics;
+    statistics.lookups = lookups.load();
+    statistics.confirmed = confirmed.load();
+    statistics.mismatched = mismatched.load();
+    statistics.stale = stale.load();
+    return statistics;
+}
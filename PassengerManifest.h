@@ -0,0 +1,113 @@
+#ifndef PASSENGER_MANIFEST_H
+#define PASSENGER_MANIFEST_H
+
+#include "PassportRecord.h"
+#include "VerificationSystem.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Advance passenger manifest (APIS), ingested and verified before the
+// flight lands.
+//
+// Manifest files are memory-mapped and read front to back; each passenger
+// is parsed into a PassportRecord in place, without per-line allocation,
+// and appended to a PassportBatch. verify() runs the whole list through
+// VerificationSystem::verifyBatch() and indexes the verdicts by document
+// (issuing country and number, packed as in StolenDocumentIndex).
+//
+// At the booth, lookup() is one hash probe plus a confirmation that the
+// scanned document is the one on the manifest (same fields, valid MRZ).
+// A verdict computed under older rule data, or on another day, is not
+// used; the booth then verifies the passenger in full.
+//
+// Supported formats:
+//   CSV, one passenger per line:
+//     document_type,document_number,issuing_country,nationality,
+//     last_name,first_name,birth_date,sex,expiry_date
+//   with dates as YYMMDD; '#' comments and a header line are skipped.
+//   No quoting or escapes: a field ends at the next comma.
+//   PAXLST style EDIFACT segments ("'" terminated, '+' elements, ':'
+//   components, '?' release character). A passenger starts at NAD and
+//   uses ATT (sex), DTM 329 (birth), NAT, DOC, DTM 36 (expiry) and LOC 91
+//   (issuing country); other segments are ignored.
+class PassengerManifest {
+public:
+    enum Format {
+        AUTO,   // PAXLST if the data starts with UNA or UNB, CSV otherwise
+        CSV,
+        PAXLST
+    };
+
+    enum Match {
+        NOT_LISTED,   // document not on the manifest
+        MISMATCH,     // listed, but the scanned document differs or its MRZ is invalid
+        STALE,        // rule data or the date changed since verify()
+        CONFIRMED     // the precomputed verdict applies
+    };
+
+    struct Statistics {
+        uint64_t lookups;
+        uint64_t confirmed;
+        uint64_t mismatched;
+        uint64_t stale;
+    };
+
+private:
+    struct Slot {
+        uint64_t key;   // StolenDocumentIndex::INVALID_KEY (0) = empty
+        uint32_t row;
+    };
+
+    PassportBatch passengers;
+    std::vector<uint8_t> verdicts;   // VerificationResult per row
+    std::vector<Slot> slots;         // power-of-two size, linear probing
+    bool verified;
+    uint64_t ruleDataVersion;        // VerificationSystem version when verified
+    int32_t verifiedDay;
+
+    mutable std::atomic<uint64_t> lookups;
+    mutable std::atomic<uint64_t> confirmed;
+    mutable std::atomic<uint64_t> mismatched;
+    mutable std::atomic<uint64_t> stale;
+
+    size_t parseCsv(std::string_view data, size_t* skipped);
+    size_t parsePaxlst(std::string_view data, size_t* skipped);
+    bool addRecord(PassportRecord& record);
+    void buildIndex();
+    const Slot* findSlot(uint64_t key) const;
+
+public:
+    PassengerManifest();
+
+    PassengerManifest(const PassengerManifest&) = delete;
+    PassengerManifest& operator=(const PassengerManifest&) = delete;
+
+    static Format detectFormat(std::string_view data);
+
+    // Appends the passengers in data; malformed records are counted in
+    // *skipped. Returns the number of passengers added.
+    size_t ingest(std::string_view data, Format format = AUTO, size_t* skipped = nullptr);
+    bool ingestFile(const std::string& path, std::string& error, Format format = AUTO,
+                    size_t* skipped = nullptr);
+
+    // Verifies every passenger ahead of arrival; false (and no verdicts)
+    // if the session is not valid
+    bool verify(const VerificationSystem& verifier, const OperatorSession& session);
+
+    Match lookup(const Passport& scanned, uint64_t currentRuleDataVersion, int32_t today,
+                 VerificationSystem::VerificationResult& verdict) const;
+
+    size_t size() const { return passengers.size(); }
+    bool isVerified() const { return verified; }
+    const PassportBatch& getPassengers() const { return passengers; }
+    VerificationSystem::VerificationResult getVerdict(size_t row) const {
+        return static_cast<VerificationSystem::VerificationResult>(verdicts[row]);
+    }
+    Statistics getStatistics() const;
+};
+
+#endif // PASSENGER_MANIFEST_H
@@ -5,6 +5,10 @@
 #include "VerificationSystem.h"
 #include "Logger.h"
 #include "HardwareInterface.h"
+#include "LaneScheduler.h"
+#include "EpochManager.h"
+#include "PassengerManifest.h"
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -14,31 +18,75 @@ private:
     std::unique_ptr<Logger> logger;
     std::unique_ptr<HardwareInterface> hardware;
     bool systemActive;
+    bool pipelinedMode; // Run scan, photo and RFID concurrently
+    OperatorSession operatorSession; // Officer signed in at this booth
+    EpochPointer<PassengerManifest> manifest; // Pre-verified arriving passengers, null until loaded
     
 public:
     PassportControlSystem();
+    // With other devices than the booth's simulated ones (tests)
+    explicit PassportControlSystem(std::unique_ptr<HardwareInterface> devices);
     ~PassportControlSystem();
     
     // System management
     bool initialize();
     void shutdown();
     bool isSystemActive() const { return systemActive; }
+    void setPipelinedMode(bool enabled) { pipelinedMode = enabled; }
+    bool isPipelinedMode() const { return pipelinedMode; }
+    
+    // Operator sign-in; passports are then verified against the session
+    bool signInOperator(const std::string& personnelId);
+    
+    // Advance passenger manifest; verified now, looked up at the booth
+    bool loadManifest(const std::string& path);
+    PassengerManifest::Statistics getManifestStatistics() const;
     
     // Main processing functions
     bool processPassport();
     VerificationSystem::VerificationResult verifyPassport(const Passport& passport, 
                                                          const std::string& personnelId);
+    // faceSimilarity: live face against the chip portrait (HardwareInterface::matchFace);
+    // faceListed: the live face hit the face watchlist;
+    // chipFailures: VerificationSystem::verifyChip, 0 if passed or no chip was read
+    VerificationSystem::VerificationResult verifyPassport(const Passport& passport,
+                                                         const OperatorSession& session,
+                                                         double faceSimilarity = FaceMatcher::NOT_COMPARED,
+                                                         bool faceListed = false,
+                                                         unsigned chipFailures = 0);
+    // 1:N search of the live face; logs the candidates, true on a hit
+    bool screenFaceWatchlist(const FaceMatcher::Descriptor& face);
     
     // Hardware integration
     std::shared_ptr<Passport> scanPassport();
-    bool capturePassengerPhoto(const std::string& passportNumber);
-    bool readRFIDChip();
+    // Empty image if the camera failed
+    HardwareInterface::CameraImage capturePassengerPhoto(const std::string& passportNumber);
+    // Queues the photo; storage is confirmed in the log once it is durable
+    bool savePassengerPhoto(const HardwareInterface::CameraImage& image, const std::string& passportNumber);
+    std::shared_ptr<HardwareInterface::RFIDData> readRFIDChip();
+    
+    // What the booth's devices read from one passenger
+    struct DeviceReadings {
+        std::shared_ptr<Passport> passport;
+        HardwareInterface::CameraImage photo;
+        std::shared_ptr<HardwareInterface::RFIDData> chip;
+    };
+    
+    // Pipelined device stages; latency is that of the slowest stage.
+    // An exception thrown by a stage is rethrown here once all stages
+    // have finished.
+    DeviceReadings runDevicePipeline();
     
     // Reporting
     void generateReport() const;
     
     // Simulation mode
     void runSimulation();
+    void runLaneSimulation(size_t laneCount, size_t passengerCount);
+    
+private:
+    void recordVerification(const Passport& passport, VerificationSystem::VerificationResult result,
+                            std::chrono::steady_clock::time_point start);
 };
 
 #endif // PASSPORT_CONTROL_SYSTEM_H
@@ -0,0 +1,335 @@
+#include "../include/PassportRecord.h"
+#include "../include/MrzChecksum.h"
+#include <cstring>
+
+namespace {
+    const size_t CHECK_DIGITS_PER_ROW = 6;
+
+    // Copies text into a fixed field: fillers become spaces, trailing
+    // fillers are dropped, the rest is '\0' padded
+    void fillField(char* destination, size_t size, std::string_view text) {
+        text = MrzParser::trimFillers(text);
+        size_t length = text.size() < size ? text.size() : size;
+        for (size_t i = 0; i < length; ++i) {
+            destination[i] = text[i] == '<' ? ' ' : text[i];
+        }
+        std::memset(destination + length, 0, size - length);
+    }
+
+    // Writes a fixed field back in MRZ form, '<' padded to width
+    void appendMrzField(std::string& line, std::string_view text, size_t width) {
+        for (size_t i = 0; i < width; ++i) {
+            char c = i < text.size() ? text[i] : '<';
+            line += (c == ' ' || c == '\0') ? '<' : c;
+        }
+    }
+
+    // Country code as Passport stores it, trailing fillers dropped
+    std::string countryText(uint16_t packed) {
+        std::string code = unpackCountryCode(packed);
+        return std::string(MrzParser::trimFillers(code));
+    }
+
+    template <typename T>
+    void appendColumn(std::vector<T>& column, const T* values, size_t count) {
+        column.insert(column.end(), values, values + count);
+    }
+}
+
+std::string_view PassportRecord::view(const char* field, size_t size) {
+    size_t length = 0;
+    while (length < size && field[length] != '\0') {
+        ++length;
+    }
+    return std::string_view(field, length);
+}
+
+PassportRecord PassportRecord::fromMrz(const MrzFields& fields) {
+    PassportRecord record;
+    int32_t today = CurrentDate::today();
+    record.birthDay = MrzDate::decode(fields.dateOfBirth, MrzDate::BIRTH, today);
+    record.expiryDay = MrzDate::decode(fields.expirationDate, MrzDate::EXPIRY, today);
+    record.issuingCountry = packCountryCode(fields.issuingCountry);
+    record.nationality = packCountryCode(fields.nationality);
+    fillField(record.passportNumber, NUMBER_SIZE, fields.documentNumber);
+    fillField(record.lastName, NAME_SIZE, fields.lastName);
+    fillField(record.firstName, NAME_SIZE, fields.firstName);
+    fillField(record.optionalData, OPTIONAL_DATA_SIZE, fields.optionalData);
+    fillField(record.documentType, 2, fields.documentType);
+    record.gender = fields.gender.empty() ? '<' : fields.gender[0];
+    record.numberCheck = fields.documentNumberCheck;
+    record.birthCheck = fields.dateOfBirthCheck;
+    record.expiryCheck = fields.expirationDateCheck;
+    record.optionalCheck = fields.optionalDataCheck;
+    record.compositeCheck = fields.compositeCheck;
+    return record;
+}
+
+PassportRecord PassportRecord::fromPassport(const Passport& passport) {
+    std::string line1 = passport.getMrzLine1();
+    std::string line2 = passport.getMrzLine2();
+    MrzFields fields;
+    if (MrzParser::parse(line1, line2, fields) && fields.layout == MrzFields::TD3) {
+        return fromMrz(fields);
+    }
+
+    // Entered without an MRZ: keep the fields, no check digits
+    PassportRecord record;
+    record.birthDay = passport.getBirthDay();
+    record.expiryDay = passport.getExpiryDay();
+    record.issuingCountry = packCountryCode(passport.getIssuingCountry());
+    record.nationality = packCountryCode(passport.getNationality());
+    fillField(record.passportNumber, NUMBER_SIZE, passport.getPassportNumber());
+    fillField(record.lastName, NAME_SIZE, passport.getLastName());
+    fillField(record.firstName, NAME_SIZE, passport.getFirstName());
+    fillField(record.optionalData, OPTIONAL_DATA_SIZE, std::string_view());
+    fillField(record.documentType, 2, passport.getDocumentType());
+    std::string gender = passport.getGender();
+    record.gender = gender.empty() ? '<' : gender[0];
+    record.numberCheck = '\0';
+    record.birthCheck = '\0';
+    record.expiryCheck = '\0';
+    record.optionalCheck = '\0';
+    record.compositeCheck = '\0';
+    return record;
+}
+
+void PassportRecord::buildMrz(std::string& line1, std::string& line2) const {
+    line1.clear();
+    line2.clear();
+    line1.reserve(MrzParser::TD3_LINE_LENGTH);
+    line2.reserve(MrzParser::TD3_LINE_LENGTH);
+
+    // Line 1: type, issuing state, SURNAME<<GIVEN<NAMES
+    appendMrzField(line1, view(documentType, 2), 2);
+    appendMrzField(line1, unpackCountryCode(issuingCountry), 3);
+    std::string name(getLastName());
+    name += "<<";
+    name += getFirstName();
+    appendMrzField(line1, name, NAME_SIZE);
+
+    // Line 2
+    appendMrzField(line2, getPassportNumber(), NUMBER_SIZE);
+    line2 += numberCheck;
+    appendMrzField(line2, unpackCountryCode(nationality), 3);
+    appendMrzField(line2, MrzDate::encode(birthDay), 6);
+    line2 += birthCheck;
+    line2 += gender;
+    appendMrzField(line2, MrzDate::encode(expiryDay), 6);
+    line2 += expiryCheck;
+    appendMrzField(line2, view(optionalData, OPTIONAL_DATA_SIZE), OPTIONAL_DATA_SIZE);
+    line2 += optionalCheck;
+    line2 += compositeCheck;
+}
+
+void PassportRecord::computeCheckDigits() {
+    // Line 2 as buildMrz() lays it out, in a fixed buffer
+    char line[MrzParser::TD3_LINE_LENGTH];
+    size_t position = 0;
+    auto put = [&](std::string_view text, size_t width) {
+        for (size_t i = 0; i < width; ++i) {
+            char c = i < text.size() ? text[i] : '<';
+            line[position++] = (c == ' ' || c == '\0') ? '<' : c;
+        }
+    };
+    auto checkDigit = [&](const char* field, size_t width) {
+        int digit = MrzChecksum::computeCheckDigit(std::string_view(field, width));
+        return digit < 0 ? '<' : static_cast<char>('0' + digit);
+    };
+
+    put(getPassportNumber(), NUMBER_SIZE);
+    numberCheck = checkDigit(line, NUMBER_SIZE);
+    line[position++] = numberCheck;
+    put(unpackCountryCode(nationality), 3);
+    put(MrzDate::encode(birthDay), 6);
+    birthCheck = checkDigit(line + 13, 6);
+    line[position++] = birthCheck;
+    line[position++] = gender;
+    put(MrzDate::encode(expiryDay), 6);
+    expiryCheck = checkDigit(line + 21, 6);
+    line[position++] = expiryCheck;
+    put(view(optionalData, OPTIONAL_DATA_SIZE), OPTIONAL_DATA_SIZE);
+    // An empty personal number may have '<' as its check digit
+    optionalCheck = view(optionalData, OPTIONAL_DATA_SIZE).empty() ? '<' : checkDigit(line + 28, OPTIONAL_DATA_SIZE);
+    line[position++] = optionalCheck;
+
+    // Composite: number, birth date and expiry through optional data, with checks
+    char composite[10 + 7 + 22];
+    std::memcpy(composite, line, 10);
+    std::memcpy(composite + 10, line + 13, 7);
+    std::memcpy(composite + 17, line + 21, 22);
+    compositeCheck = checkDigit(composite, sizeof(composite));
+}
+
+Passport PassportRecord::toPassport() const {
+    if (hasMrz()) {
+        std::string line1, line2;
+        buildMrz(line1, line2);
+        return Passport(line1, line2);
+    }
+
+    Passport passport;
+    passport.setPassportNumber(std::string(getPassportNumber()));
+    passport.setFirstName(std::string(getFirstName()));
+    passport.setLastName(std::string(getLastName()));
+    passport.setNationality(countryText(nationality));
+    passport.setDateOfBirth(MrzDate::encode(birthDay));
+    passport.setGender(gender == '<' ? std::string() : std::string(1, gender));
+    passport.setExpirationDate(MrzDate::encode(expiryDay));
+    passport.setIssuingCountry(countryText(issuingCountry));
+    return passport;
+}
+
+void PassportBatch::reserve(size_t count) {
+    birthDays.reserve(count);
+    expiryDays.reserve(count);
+    issuingCountries.reserve(count);
+    nationalities.reserve(count);
+    passportNumbers.reserve(count * PassportRecord::NUMBER_SIZE);
+    lastNames.reserve(count * PassportRecord::NAME_SIZE);
+    firstNames.reserve(count * PassportRecord::NAME_SIZE);
+    optionalData.reserve(count * PassportRecord::OPTIONAL_DATA_SIZE);
+    documentTypes.reserve(count * 2);
+    genders.reserve(count);
+    checkDigits.reserve(count * CHECK_DIGITS_PER_ROW);
+}
+
+void PassportBatch::clear() {
+    birthDays.clear();
+    expiryDays.clear();
+    issuingCountries.clear();
+    nationalities.clear();
+    passportNumbers.clear();
+    lastNames.clear();
+    firstNames.clear();
+    optionalData.clear();
+    documentTypes.clear();
+    genders.clear();
+    checkDigits.clear();
+}
+
+void PassportBatch::add(const PassportRecord& record) {
+    birthDays.push_back(record.birthDay);
+    expiryDays.push_back(record.expiryDay);
+    issuingCountries.push_back(record.issuingCountry);
+    nationalities.push_back(record.nationality);
+    appendColumn(passportNumbers, record.passportNumber, PassportRecord::NUMBER_SIZE);
+    appendColumn(lastNames, record.lastName, PassportRecord::NAME_SIZE);
+    appendColumn(firstNames, record.firstName, PassportRecord::NAME_SIZE);
+    appendColumn(optionalData, record.optionalData, PassportRecord::OPTIONAL_DATA_SIZE);
+    appendColumn(documentTypes, record.documentType, 2);
+    genders.push_back(record.gender);
+    const char checks[CHECK_DIGITS_PER_ROW] = {
+        record.numberCheck, record.birthCheck, record.expiryCheck,
+        record.optionalCheck, record.compositeCheck, '\0'
+    };
+    appendColumn(checkDigits, checks, CHECK_DIGITS_PER_ROW);
+}
+
+void PassportBatch::add(const Passport& passport) {
+    add(PassportRecord::fromPassport(passport));
+}
+
+PassportRecord PassportBatch::getRecord(size_t index) const {
+    PassportRecord record;
+    record.birthDay = birthDays[index];
+    record.expiryDay = expiryDays[index];
+    record.issuingCountry = issuingCountries[index];
+    record.nationality = nationalities[index];
+    std::memcpy(record.passportNumber, &passportNumbers[index * PassportRecord::NUMBER_SIZE],
+                PassportRecord::NUMBER_SIZE);
+    std::memcpy(record.lastName, &lastNames[index * PassportRecord::NAME_SIZE], PassportRecord::NAME_SIZE);
+    std::memcpy(record.firstName, &firstNames[index * PassportRecord::NAME_SIZE], PassportRecord::NAME_SIZE);
+    std::memcpy(record.optionalData, &optionalData[index * PassportRecord::OPTIONAL_DATA_SIZE],
+                PassportRecord::OPTIONAL_DATA_SIZE);
+    std::memcpy(record.documentType, &documentTypes[index * 2], 2);
+    record.gender = genders[index];
+    const char* checks = &checkDigits[index * CHECK_DIGITS_PER_ROW];
+    record.numberCheck = checks[0];
+    record.birthCheck = checks[1];
+    record.expiryCheck = checks[2];
+    record.optionalCheck = checks[3];
+    record.compositeCheck = checks[4];
+    return record;
+}
+
+Passport PassportBatch::getPassport(size_t index) const {
+    return getRecord(index).toPassport();
+}
+
+std::string_view PassportBatch::getPassportNumber(size_t index) const {
+    const char* field = &passportNumbers[index * PassportRecord::NUMBER_SIZE];
+    size_t length = 0;
+    while (length < PassportRecord::NUMBER_SIZE && field[length] != '\0') {
+        ++length;
+    }
+    return std::string_view(field, length);
+}
+
+size_t PassportBatch::selectByNationality(uint16_t nationality, std::vector<uint32_t>& rows) const {
+    size_t matched = 0;
+    for (size_t i = 0; i < nationalities.size(); ++i) {
+        if (nationalities[i] == nationality) {
+            rows.push_back(static_cast<uint32_t>(i));
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+size_t PassportBatch::selectByIssuingCountry(uint16_t country, std::vector<uint32_t>& rows) const {
+    size_t matched = 0;
+    for (size_t i = 0; i < issuingCountries.size(); ++i) {
+        if (issuingCountries[i] == country) {
+            rows.push_back(static_cast<uint32_t>(i));
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+void PassportBatch::markExpired(int32_t today, uint8_t* flags) const {
+    // MrzDate::INVALID is INT32_MIN, so unknown dates compare as expired
+    const int32_t* expiry = expiryDays.data();
+    const size_t count = expiryDays.size();
+    for (size_t i = 0; i < count; ++i) {
+        flags[i] = static_cast<uint8_t>(expiry[i] < today);
+    }
+}
+
+size_t PassportBatch::countExpired(int32_t today) const {
+    const int32_t* expiry = expiryDays.data();
+    const size_t count = expiryDays.size();
+    size_t expired = 0;
+    for (size_t i = 0; i < count; ++i) {
+        expired += expiry[i] < today;
+    }
+    return expired;
+}
+
+size_t PassportBatch::selectExpired(int32_t today, std::vector<uint32_t>& rows) const {
+    size_t matched = 0;
+    for (size_t i = 0; i < expiryDays.size(); ++i) {
+        if (expiryDays[i] < today) {
+            rows.push_back(static_cast<uint32_t>(i));
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+long PassportBatch::findPassportNumber(std::string_view number) const {
+    if (number.size() > PassportRecord::NUMBER_SIZE) {
+        return -1;
+    }
+
+    char key[PassportRecord::NUMBER_SIZE];
+    fillField(key, PassportRecord::NUMBER_SIZE, number);
+    for (size_t i = 0; i < size(); ++i) {
+        if (std::memcmp(&passportNumbers[i * PassportRecord::NUMBER_SIZE], key,
+                        PassportRecord::NUMBER_SIZE) == 0) {
+            return static_cast<long>(i);
+        }
+    }
+    return -1;
+}
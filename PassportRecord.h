@@ -0,0 +1,114 @@
+#ifndef PASSPORT_RECORD_H
+#define PASSPORT_RECORD_H
+
+#include "Passport.h"
+#include "MrzParser.h"
+#include "CountryCode.h"
+#include "MrzDate.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Packed, trivially copyable form of a passport for bulk storage.
+// Text fields are fixed width, sized to the TD3 MRZ, padded with '\0' and
+// not NUL-terminated when full. Country codes are packed (CountryCode.h),
+// dates are day numbers (MrzDate.h, MrzDate::INVALID = unknown). The MRZ
+// check digits are kept so the original MRZ can be rebuilt exactly; '\0'
+// means the record was not created from an MRZ.
+struct PassportRecord {
+    static const size_t NUMBER_SIZE = 9;
+    static const size_t NAME_SIZE = 39;
+    static const size_t OPTIONAL_DATA_SIZE = 14;
+
+    int32_t birthDay;
+    int32_t expiryDay;
+    uint16_t issuingCountry;
+    uint16_t nationality;
+    char passportNumber[NUMBER_SIZE];
+    char lastName[NAME_SIZE];
+    char firstName[NAME_SIZE];
+    char optionalData[OPTIONAL_DATA_SIZE];
+    char documentType[2];
+    char gender;
+    char numberCheck;
+    char birthCheck;
+    char expiryCheck;
+    char optionalCheck;
+    char compositeCheck;
+
+    // Conversion
+    static PassportRecord fromMrz(const MrzFields& fields);
+    static PassportRecord fromPassport(const Passport& passport);
+    Passport toPassport() const;
+
+    bool hasMrz() const { return compositeCheck != '\0'; }
+    // Fills the check digits from the fields, for records built from data
+    // that carries no MRZ (advance passenger manifests); hasMrz() is then true
+    void computeCheckDigits();
+    // Rebuilds the TD3 MRZ lines; only meaningful when hasMrz()
+    void buildMrz(std::string& line1, std::string& line2) const;
+
+    // Field views without the '\0' padding
+    std::string_view getPassportNumber() const { return view(passportNumber, NUMBER_SIZE); }
+    std::string_view getLastName() const { return view(lastName, NAME_SIZE); }
+    std::string_view getFirstName() const { return view(firstName, NAME_SIZE); }
+
+private:
+    static std::string_view view(const char* field, size_t size);
+};
+
+static_assert(std::is_trivially_copyable<PassportRecord>::value,
+              "PassportRecord is stored and copied as raw bytes");
+static_assert(sizeof(PassportRecord) <= 128, "PassportRecord grew past two cache lines");
+
+// Structure-of-arrays container: each field is one contiguous column so
+// filters and verification passes only touch the columns they need.
+class PassportBatch {
+private:
+    std::vector<int32_t> birthDays;
+    std::vector<int32_t> expiryDays;
+    std::vector<uint16_t> issuingCountries;
+    std::vector<uint16_t> nationalities;
+    std::vector<char> passportNumbers;   // NUMBER_SIZE per row
+    std::vector<char> lastNames;         // NAME_SIZE per row
+    std::vector<char> firstNames;        // NAME_SIZE per row
+    std::vector<char> optionalData;      // OPTIONAL_DATA_SIZE per row
+    std::vector<char> documentTypes;     // 2 per row
+    std::vector<char> genders;
+    std::vector<char> checkDigits;       // 6 per row: number, birth, expiry, optional, composite, spare
+
+public:
+    size_t size() const { return nationalities.size(); }
+    bool empty() const { return nationalities.empty(); }
+    void reserve(size_t count);
+    void clear();
+
+    // Rows
+    void add(const PassportRecord& record);
+    void add(const Passport& passport);
+    PassportRecord getRecord(size_t index) const;
+    Passport getPassport(size_t index) const;
+
+    // Columns
+    const int32_t* getBirthDays() const { return birthDays.data(); }
+    const int32_t* getExpiryDays() const { return expiryDays.data(); }
+    const uint16_t* getIssuingCountries() const { return issuingCountries.data(); }
+    const uint16_t* getNationalities() const { return nationalities.data(); }
+    std::string_view getPassportNumber(size_t index) const;
+
+    // Filters; append matching row indices and return how many matched
+    size_t selectByNationality(uint16_t nationality, std::vector<uint32_t>& rows) const;
+    size_t selectByIssuingCountry(uint16_t country, std::vector<uint32_t>& rows) const;
+    // Expiry over the whole batch: one flag per row (1 = expired or no
+    // valid expiry date). The loop is plain integer compares over one
+    // column, which the compiler vectorizes.
+    void markExpired(int32_t today, uint8_t* flags) const;
+    size_t countExpired(int32_t today) const;
+    size_t selectExpired(int32_t today, std::vector<uint32_t>& rows) const;
+    // Row index of a document number, or -1
+    long findPassportNumber(std::string_view number) const;
+};
+
+#endif // PASSPORT_RECORD_H
@@ -0,0 +1,132 @@
+#include "../include/PersonnelStore.h"
+#include <chrono>
+
+uint64_t PersonnelStore::hashId(const std::string& id) {
+    // FNV-1a; 0 marks an empty slot
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : id) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+const PersonnelStore::Entry* PersonnelStore::Snapshot::find(const std::string& id, uint64_t hash) const {
+    const size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Entry& entry = slots[i];
+        if (entry.hash == 0) {
+            return nullptr;
+        }
+        if (entry.hash == hash && entry.id == id) {
+            return &entry;
+        }
+    }
+}
+
+PersonnelStore::PersonnelStore() : current(nullptr), version(0) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    rebuild();
+}
+
+int64_t PersonnelStore::now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void PersonnelStore::rebuild() {
+    // Load factor at most 1/2 so probe sequences stay short
+    size_t capacity = 16;
+    while (capacity < people.size() * 2) {
+        capacity *= 2;
+    }
+
+    auto snapshot = new Snapshot();
+    snapshot->slots.resize(capacity, Entry{0, std::string(), 0, 0, 0, nullptr, 0});
+    snapshot->count = 0;
+
+    const size_t mask = capacity - 1;
+    for (const auto& person : people) {
+        if (person.second.revoked) {
+            continue;
+        }
+        uint64_t hash = hashId(person.first);
+        size_t i = hash & mask;
+        while (snapshot->slots[i].hash != 0) {
+            i = (i + 1) & mask;
+        }
+        snapshot->slots[i] = Entry{hash, person.first, person.second.roles, person.second.shiftStart,
+                                   person.second.shiftEnd, person.second.revision,
+                                   person.second.revision->load(std::memory_order_relaxed)};
+        ++snapshot->count;
+    }
+
+    current.publish(snapshot);
+    version.fetch_add(1, std::memory_order_release);
+}
+
+bool PersonnelStore::addPersonnel(const std::string& id, uint8_t roles, int64_t shiftStart, int64_t shiftEnd) {
+    if (id.empty() || (roles & ANY_ROLE) == 0 || shiftStart >= shiftEnd) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(writerMutex);
+    auto it = people.find(id);
+    if (it == people.end()) {
+        revisions.emplace_back(0);
+        people.emplace(id, Person{roles, shiftStart, shiftEnd, false, &revisions.back()});
+    } else {
+        it->second.roles = roles;
+        it->second.shiftStart = shiftStart;
+        it->second.shiftEnd = shiftEnd;
+        it->second.revoked = false;
+        // Sessions opened under the old record must re-validate
+        it->second.revision->fetch_add(1, std::memory_order_release);
+    }
+    rebuild();
+    return true;
+}
+
+bool PersonnelStore::revoke(const std::string& id) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    auto it = people.find(id);
+    if (it == people.end() || it->second.revoked) {
+        return false;
+    }
+
+    // Bump before publishing: a booth still reading the old table sees a
+    // revision that no longer matches and cannot open a session from it
+    it->second.revoked = true;
+    it->second.revision->fetch_add(1, std::memory_order_release);
+    rebuild();
+    return true;
+}
+
+bool PersonnelStore::isAuthorized(const std::string& id, int64_t now, uint8_t requiredRoles) const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const Entry* entry = current.load()->find(id, hashId(id));
+    return entry && (entry->roles & requiredRoles) != 0 &&
+           now >= entry->shiftStart && now < entry->shiftEnd &&
+           entry->revision->load(std::memory_order_acquire) == entry->builtRevision;
+}
+
+OperatorSession PersonnelStore::openSession(const std::string& id, int64_t now) const {
+    OperatorSession session;
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const Entry* entry = current.load()->find(id, hashId(id));
+    if (!entry || now < entry->shiftStart || now >= entry->shiftEnd ||
+        entry->revision->load(std::memory_order_acquire) != entry->builtRevision) {
+        return session;
+    }
+
+    session.revision = entry->revision;
+    session.expectedRevision = entry->builtRevision;
+    session.validUntil = entry->shiftEnd;
+    session.roles = entry->roles;
+    session.personnelId = entry->id;
+    return session;
+}
+
+size_t PersonnelStore::size() const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return current.load()->count;
+}
@@ -0,0 +1,116 @@
+#ifndef PERSONNEL_STORE_H
+#define PERSONNEL_STORE_H
+
+#include "EpochManager.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Validated sign-in of one officer at a booth. Checking it per passport is
+// one atomic load and a compare: any change to the officer's record
+// (revocation, new roles or shift) bumps their revision and invalidates
+// every open session. A session must not outlive the store that opened it.
+class OperatorSession {
+private:
+    const std::atomic<uint32_t>* revision;
+    uint32_t expectedRevision;
+    int64_t validUntil;   // end of the shift, seconds since the Unix epoch
+    uint8_t roles;
+    std::string personnelId;
+
+    friend class PersonnelStore;
+
+public:
+    OperatorSession() : revision(nullptr), expectedRevision(0), validUntil(0), roles(0) {}
+
+    bool isValid(int64_t now) const {
+        return revision && revision->load(std::memory_order_acquire) == expectedRevision && now < validUntil;
+    }
+    bool hasRole(uint8_t role) const { return (roles & role) != 0; }
+    const std::string& getPersonnelId() const { return personnelId; }
+    int64_t getValidUntil() const { return validUntil; }
+};
+
+// Authorized personnel, read by every booth and changed rarely. Readers
+// probe an immutable open-addressing hash table without locking; writers
+// rebuild the table under a mutex and publish it with EpochPointer.
+class PersonnelStore {
+public:
+    enum Role {
+        OFFICER = 1,
+        SUPERVISOR = 2,
+        ADMINISTRATOR = 4,
+        ANY_ROLE = OFFICER | SUPERVISOR | ADMINISTRATOR
+    };
+
+    static const int64_t NO_SHIFT_START = std::numeric_limits<int64_t>::min();
+    static const int64_t NO_SHIFT_END = std::numeric_limits<int64_t>::max();
+
+private:
+    struct Entry {
+        uint64_t hash;              // 0 = empty slot
+        std::string id;
+        uint8_t roles;
+        int64_t shiftStart;
+        int64_t shiftEnd;
+        const std::atomic<uint32_t>* revision;
+        uint32_t builtRevision;     // value of *revision when this table was built
+    };
+
+    struct Snapshot {
+        std::vector<Entry> slots;   // power-of-two size, linear probing
+        size_t count;
+
+        const Entry* find(const std::string& id, uint64_t hash) const;
+    };
+
+    // Writer-side master copy; revision counters live as long as the store
+    struct Person {
+        uint8_t roles;
+        int64_t shiftStart;
+        int64_t shiftEnd;
+        bool revoked;
+        std::atomic<uint32_t>* revision;
+    };
+
+    EpochPointer<Snapshot> current;
+    std::mutex writerMutex;
+    std::unordered_map<std::string, Person> people;
+    std::deque<std::atomic<uint32_t>> revisions;
+    std::atomic<uint64_t> version;   // bumped on every published change
+
+    static uint64_t hashId(const std::string& id);
+    void rebuild();
+
+public:
+    PersonnelStore();
+
+    PersonnelStore(const PersonnelStore&) = delete;
+    PersonnelStore& operator=(const PersonnelStore&) = delete;
+
+    // Seconds since the Unix epoch, the time base of shift windows
+    static int64_t now();
+
+    // Adds or updates; a revoked id is reinstated. Shift end is exclusive.
+    bool addPersonnel(const std::string& id, uint8_t roles = OFFICER,
+                      int64_t shiftStart = NO_SHIFT_START, int64_t shiftEnd = NO_SHIFT_END);
+    bool revoke(const std::string& id);
+
+    // Lock-free checks
+    bool isAuthorized(const std::string& id, int64_t now, uint8_t requiredRoles = ANY_ROLE) const;
+    bool isAuthorized(const std::string& id) const { return isAuthorized(id, now()); }
+    // Session valid until the end of the current shift; invalid (isValid()
+    // false) when the id is not authorized right now
+    OperatorSession openSession(const std::string& id, int64_t now) const;
+    OperatorSession openSession(const std::string& id) const { return openSession(id, now()); }
+
+    size_t size() const;
+    uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
+};
+
+#endif // PERSONNEL_STORE_H
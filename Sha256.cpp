@@ -0,0 +1,186 @@
+#include "../include/Sha256.h"
+#include <cstring>
+
+// The SHA-NI rounds are compiled for the SHA extensions whatever the
+// build targets and picked at run time
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SHA256_DISPATCH 1
+#endif
+
+namespace {
+    alignas(16) const uint32_t ROUND_CONSTANTS[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t INITIAL_STATE[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    using CompressFunction = void (*)(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+#ifdef SHA256_DISPATCH
+    __attribute__((target("sha,sse4.1")))
+    void compressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+#ifdef __AVX__
+        // The SHA instructions have no VEX form; with dirty upper halves
+        // every switch between them and the VEX code around them stalls
+        _mm256_zeroupper();
+#endif
+        // Big-endian words within each 32-bit lane
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        // The round instructions take the state as ABEF and CDGH
+        __m128i swapped = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+        __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+        __m128i abef = _mm_alignr_epi8(swapped, cdgh, 8);
+        cdgh = _mm_blend_epi16(cdgh, swapped, 0xF0);
+
+        for (; blocks > 0; --blocks, data += Sha256::BLOCK_BYTES) {
+            const __m128i abefSaved = abef;
+            const __m128i cdghSaved = cdgh;
+            __m128i schedule[4];
+            // 16 groups of four rounds; from the fifth on, the message
+            // schedule extends itself four words at a time
+            for (int group = 0; group < 16; ++group) {
+                __m128i& words = schedule[group & 3];
+                if (group < 4) {
+                    words = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + group * 16)), byteSwap);
+                } else {
+                    const __m128i previous = schedule[(group + 3) & 3];
+                    words = _mm_sha256msg1_epu32(words, schedule[(group + 1) & 3]);
+                    words = _mm_add_epi32(words, _mm_alignr_epi8(previous, schedule[(group + 2) & 3], 4));
+                    words = _mm_sha256msg2_epu32(words, previous);
+                }
+                __m128i message = _mm_add_epi32(
+                    words, _mm_load_si128(reinterpret_cast<const __m128i*>(ROUND_CONSTANTS + group * 4)));
+                cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+                message = _mm_shuffle_epi32(message, 0x0E);
+                abef = _mm_sha256rnds2_epu32(abef, cdgh, message);
+            }
+            abef = _mm_add_epi32(abef, abefSaved);
+            cdgh = _mm_add_epi32(cdgh, cdghSaved);
+        }
+
+        // Back to ABCD and EFGH
+        const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+        const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+    }
+#endif
+
+    uint32_t rotateRight(uint32_t value, int bits) {
+        return (value >> bits) | (value << (32 - bits));
+    }
+
+    void compressPortable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        uint32_t w[64];
+        for (; blocks > 0; --blocks, data += Sha256::BLOCK_BYTES) {
+            for (int i = 0; i < 16; ++i) {
+                w[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16) |
+                       (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
+            }
+            for (int i = 16; i < 64; ++i) {
+                const uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                const uint32_t t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) +
+                                    ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i];
+                const uint32_t t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) +
+                                    ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+    // Chosen once from what the CPU supports
+    CompressFunction selectCompress() {
+#ifdef SHA256_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+            return compressShaNi;
+        }
+#endif
+        return compressPortable;
+    }
+
+    CompressFunction compressFunction() {
+        static const CompressFunction compress = selectCompress();
+        return compress;
+    }
+}
+
+Sha256::Digest Sha256::hash(std::string_view data) {
+    uint32_t state[8];
+    std::memcpy(state, INITIAL_STATE, sizeof(state));
+    const CompressFunction compress = compressFunction();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    const size_t fullBlocks = data.size() / BLOCK_BYTES;
+    compress(state, bytes, fullBlocks);
+
+    // Tail, 0x80, zeros and the bit length: one block, or two when the
+    // length does not fit after the tail
+    uint8_t tail[2 * BLOCK_BYTES] = {0};
+    const size_t remaining = data.size() - fullBlocks * BLOCK_BYTES;
+    std::memcpy(tail, bytes + fullBlocks * BLOCK_BYTES, remaining);
+    tail[remaining] = 0x80;
+    const size_t tailBlocks = remaining + 9 > BLOCK_BYTES ? 2 : 1;
+    const uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tailBlocks * BLOCK_BYTES - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    compress(state, tail, tailBlocks);
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+    return digest;
+}
+
+bool Sha256::matches(std::string_view data, std::string_view digest) {
+    if (digest.size() != DIGEST_BYTES) {
+        return false;
+    }
+    const Digest computed = hash(data);
+    return std::memcmp(computed.data(), digest.data(), DIGEST_BYTES) == 0;
+}
+
+bool Sha256::isAccelerated() {
+#ifdef SHA256_DISPATCH
+    return compressFunction() == compressShaNi;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,28 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// SHA-256 (FIPS 180-4) for passive authentication of chip data groups.
+// Full blocks are compressed straight from the caller's buffer; only the
+// padded tail is copied. On a CPU with the SHA extensions, checked at run
+// time, a block takes the sha256rnds2/sha256msg1/sha256msg2 instructions;
+// otherwise the portable rounds run.
+class Sha256 {
+public:
+    static const size_t DIGEST_BYTES = 32;
+    static const size_t BLOCK_BYTES = 64;
+
+    using Digest = std::array<uint8_t, DIGEST_BYTES>;
+
+    static Digest hash(std::string_view data);
+    static bool matches(std::string_view data, std::string_view digest);
+
+    // True when hash() runs the SHA extension rounds on this CPU
+    static bool isAccelerated();
+};
+
+#endif // SHA256_H
@@ -0,0 +1,252 @@
+#include "../include/StolenDocumentIndex.h"
+#include "../include/CountryCode.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const char MAGIC[8] = {'S', 'L', 'T', 'D', 'I', 'D', 'X', '\0'};
+    const size_t NUMBER_DIGITS = 9;
+    const unsigned MAX_BLOOM_HASHES = 8;
+
+    // splitmix64 finalizer
+    uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    int numberDigit(char c) {
+        if (c == '<') {
+            return 0;
+        }
+        if (c >= '0' && c <= '9') {
+            return 1 + (c - '0');
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return 11 + (c - 'A');
+        }
+        return -1;
+    }
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Block and in-block bit positions of a key; all k bits share one
+    // 64-byte block so a lookup touches a single cache line
+    struct BloomProbe {
+        uint64_t block;
+        uint32_t first;
+        uint32_t step;
+
+        BloomProbe(uint64_t key, uint64_t blocks) {
+            uint64_t hash = mix(key);
+            block = ((hash >> 32) * blocks) >> 32;
+            uint32_t low = static_cast<uint32_t>(hash);
+            first = low & 511;
+            step = (low >> 9) | 1;
+        }
+
+        uint32_t bit(unsigned i) const { return (first + i * step) & 511; }
+    };
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+}
+
+StolenDocumentIndex::StolenDocumentIndex() : header(nullptr), bloom(nullptr), keys(nullptr) {
+}
+
+uint64_t StolenDocumentIndex::makeKey(std::string_view issuingCountry, std::string_view documentNumber) {
+    uint16_t country = packCountryCode(issuingCountry);
+    while (!documentNumber.empty() && (documentNumber.back() == '<' || documentNumber.back() == ' ')) {
+        documentNumber.remove_suffix(1);
+    }
+    if (country == INVALID_COUNTRY_CODE || documentNumber.empty() || documentNumber.size() > NUMBER_DIGITS) {
+        return INVALID_KEY;
+    }
+
+    uint64_t number = 0;
+    for (size_t i = 0; i < NUMBER_DIGITS; ++i) {
+        int digit = i < documentNumber.size() ? numberDigit(documentNumber[i]) : 0;
+        if (digit < 0) {
+            return INVALID_KEY;
+        }
+        number = number * 37 + static_cast<uint64_t>(digit);
+    }
+    // 37^9 < 2^47
+    return (static_cast<uint64_t>(country) << 47) | number;
+}
+
+bool StolenDocumentIndex::build(std::vector<uint64_t> keys, const std::string& path, std::string& error,
+                                unsigned bitsPerKey) {
+    keys.erase(std::remove(keys.begin(), keys.end(), static_cast<uint64_t>(INVALID_KEY)), keys.end());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    if (bitsPerKey < 4) {
+        bitsPerKey = 4;
+    }
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    // k = ln 2 * bits per key, capped: more probes in one block stop helping
+    header.bloomHashes = std::min(MAX_BLOOM_HASHES, std::max(1u, bitsPerKey * 69 / 100));
+    header.keyCount = keys.size();
+    header.bloomBlocks = std::max<uint64_t>(1, (keys.size() * bitsPerKey + 511) / 512);
+    header.bloomOffset = alignUp(sizeof(Header), BLOCK_BYTES);
+    header.keysOffset = header.bloomOffset + header.bloomBlocks * BLOCK_BYTES;
+    header.buildTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    std::vector<uint64_t> filter(header.bloomBlocks * (BLOCK_BYTES / sizeof(uint64_t)), 0);
+    for (uint64_t key : keys) {
+        BloomProbe probe(key, header.bloomBlocks);
+        uint64_t* block = &filter[probe.block * (BLOCK_BYTES / sizeof(uint64_t))];
+        for (unsigned i = 0; i < header.bloomHashes; ++i) {
+            uint32_t bit = probe.bit(i);
+            block[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+
+    // Write to a temporary name and rename, so booths never map a half-written index
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            error = "cannot create " + temporary;
+            return false;
+        }
+        const char padding[BLOCK_BYTES] = {0};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(padding, static_cast<std::streamsize>(header.bloomOffset - sizeof(header)));
+        out.write(reinterpret_cast<const char*>(filter.data()),
+                  static_cast<std::streamsize>(filter.size() * sizeof(uint64_t)));
+        out.write(reinterpret_cast<const char*>(keys.data()),
+                  static_cast<std::streamsize>(keys.size() * sizeof(uint64_t)));
+        if (!out.flush()) {
+            error = "cannot write " + temporary;
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "cannot rename " + temporary + " to " + path;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool StolenDocumentIndex::buildFromCsv(const std::string& csvPath, const std::string& path,
+                                       std::string& error, size_t* skipped) {
+    std::ifstream input(csvPath);
+    if (!input.is_open()) {
+        error = "cannot open " + csvPath;
+        return false;
+    }
+
+    std::vector<uint64_t> keys;
+    size_t invalid = 0;
+    std::string line;
+    while (std::getline(input, line)) {
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') {
+            continue;
+        }
+        size_t comma = text.find(',');
+        uint64_t key = comma == std::string_view::npos ? INVALID_KEY :
+            makeKey(trim(text.substr(0, comma)), trim(text.substr(comma + 1)));
+        if (key == INVALID_KEY) {
+            ++invalid;
+            continue;
+        }
+        keys.push_back(key);
+    }
+
+    if (skipped) {
+        *skipped = invalid;
+    }
+    return build(std::move(keys), path, error);
+}
+
+bool StolenDocumentIndex::open(const std::string& path, std::string& error) {
+    header = nullptr;
+    bloom = nullptr;
+    keys = nullptr;
+    fences.clear();
+    if (!file.open(path, error)) {
+        return false;
+    }
+
+    const Header* candidate = reinterpret_cast<const Header*>(file.data());
+    if (file.size() < sizeof(Header) || std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a stolen document index";
+        return false;
+    }
+    if (candidate->version != FORMAT_VERSION) {
+        error = path + ": unsupported index version " + std::to_string(candidate->version);
+        return false;
+    }
+    if (candidate->bloomBlocks == 0 || candidate->bloomHashes == 0 || candidate->bloomHashes > MAX_BLOOM_HASHES ||
+        candidate->bloomOffset % BLOCK_BYTES != 0 || candidate->keysOffset % sizeof(uint64_t) != 0 ||
+        candidate->bloomOffset + candidate->bloomBlocks * BLOCK_BYTES > candidate->keysOffset ||
+        candidate->keysOffset > file.size() ||
+        (file.size() - candidate->keysOffset) / sizeof(uint64_t) < candidate->keyCount) {
+        error = path + ": corrupt index header";
+        return false;
+    }
+
+    header = candidate;
+    bloom = reinterpret_cast<const uint64_t*>(file.data() + header->bloomOffset);
+    keys = reinterpret_cast<const uint64_t*>(file.data() + header->keysOffset);
+
+    // The filter is hit on every lookup, the keys only on filter hits
+    file.advise(header->bloomOffset, header->bloomBlocks * BLOCK_BYTES, MappedFile::WILL_NEED);
+    file.advise(header->keysOffset, header->keyCount * sizeof(uint64_t), MappedFile::RANDOM);
+
+    fences.reserve(header->keyCount / FENCE_STRIDE + 1);
+    for (uint64_t i = 0; i < header->keyCount; i += FENCE_STRIDE) {
+        fences.push_back(keys[i]);
+    }
+    return true;
+}
+
+bool StolenDocumentIndex::bloomMayContain(uint64_t key) const {
+    BloomProbe probe(key, header->bloomBlocks);
+    const uint64_t* block = bloom + probe.block * (BLOCK_BYTES / sizeof(uint64_t));
+    for (unsigned i = 0; i < header->bloomHashes; ++i) {
+        uint32_t bit = probe.bit(i);
+        if ((block[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StolenDocumentIndex::keysContain(uint64_t key) const {
+    // Last fence <= key picks the FENCE_STRIDE keys to search
+    auto fence = std::upper_bound(fences.begin(), fences.end(), key);
+    if (fence == fences.begin()) {
+        return false;
+    }
+    size_t first = static_cast<size_t>(fence - fences.begin() - 1) * FENCE_STRIDE;
+    size_t last = std::min<size_t>(first + FENCE_STRIDE, header->keyCount);
+    return std::binary_search(keys + first, keys + last, key);
+}
+
+bool StolenDocumentIndex::contains(uint64_t key) const {
+    if (!header || key == INVALID_KEY) {
+        return false;
+    }
+    return bloomMayContain(key) && keysContain(key);
+}
@@ -0,0 +1,84 @@
+#ifndef STOLEN_DOCUMENT_INDEX_H
+#define STOLEN_DOCUMENT_INDEX_H
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lost/stolen travel document index, built offline and opened read-only.
+//
+// A document is keyed by (issuing country, document number) packed into
+// 64 bits: the packed country code (CountryCode.h) above bit 47 and the
+// document number, filler padded to 9 characters, in base 37 below it.
+// The file holds a blocked Bloom filter followed by the sorted keys, so a
+// clean document is usually rejected with one cache line of the filter
+// and never touches the keys.
+//
+// File layout (little-endian, offsets 64-byte aligned):
+//   Header | Bloom filter (bloomBlocks x 64 bytes) | keys (keyCount x uint64)
+class StolenDocumentIndex {
+public:
+    static const uint64_t INVALID_KEY = 0;
+    static const uint32_t FORMAT_VERSION = 1;
+    static const size_t BLOCK_BYTES = 64;
+
+    struct Header {
+        char magic[8];          // "SLTDIDX\0"
+        uint32_t version;
+        uint32_t bloomHashes;   // bits set per key, all in one block
+        uint64_t keyCount;
+        uint64_t bloomBlocks;
+        uint64_t bloomOffset;
+        uint64_t keysOffset;
+        uint64_t buildTime;     // seconds since the Unix epoch
+        uint64_t reserved;
+    };
+
+private:
+    MappedFile file;
+    const Header* header;
+    const uint64_t* bloom;
+    const uint64_t* keys;
+    // Every FENCE_STRIDE-th key, copied into memory: a small, cache
+    // resident top level for the search over the mapped keys
+    static const size_t FENCE_STRIDE = 128;
+    std::vector<uint64_t> fences;
+
+    bool bloomMayContain(uint64_t key) const;
+    bool keysContain(uint64_t key) const;
+
+public:
+    StolenDocumentIndex();
+
+    StolenDocumentIndex(const StolenDocumentIndex&) = delete;
+    StolenDocumentIndex& operator=(const StolenDocumentIndex&) = delete;
+
+    // Keys; INVALID_KEY for document numbers that are not 1-9 characters
+    // of A-Z, 0-9 and '<' (trailing fillers are ignored)
+    static uint64_t makeKey(std::string_view issuingCountry, std::string_view documentNumber);
+
+    // Offline build; duplicates are removed. About 0.1% false positives at
+    // the default 16 bits per key.
+    static bool build(std::vector<uint64_t> keys, const std::string& path, std::string& error,
+                      unsigned bitsPerKey = 16);
+    // Input lines: COUNTRY,DOCUMENT_NUMBER ('#' comments allowed)
+    static bool buildFromCsv(const std::string& csvPath, const std::string& path, std::string& error,
+                             size_t* skipped = nullptr);
+
+    bool open(const std::string& path, std::string& error);
+    bool isOpen() const { return header != nullptr; }
+
+    bool contains(uint64_t key) const;
+    bool contains(std::string_view issuingCountry, std::string_view documentNumber) const {
+        return contains(makeKey(issuingCountry, documentNumber));
+    }
+
+    uint64_t getKeyCount() const { return header ? header->keyCount : 0; }
+    uint64_t getBuildTime() const { return header ? header->buildTime : 0; }
+    bool isMapped() const { return file.isMapped(); }
+};
+
+#endif // STOLEN_DOCUMENT_INDEX_H
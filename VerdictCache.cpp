@@ -0,0 +1,149 @@
+#include "../include/VerdictCache.h"
+
+namespace {
+    // Length-prefixed, so no field content can shift the boundaries
+    void appendPart(std::string& key, const std::string& part) {
+        key += std::to_string(part.size());
+        key += ':';
+        key += part;
+    }
+}
+
+VerdictCache::VerdictCache(size_t capacity, std::chrono::milliseconds timeToLive)
+    : shardCapacity(capacity / SHARD_COUNT > 0 ? capacity / SHARD_COUNT : 1), enabled(false),
+      timeToLiveMs(timeToLive.count()), hits(0), misses(0), invalidated(0), expired(0),
+      insertions(0), evictions(0) {
+}
+
+uint64_t VerdictCache::hashKey(std::string_view key) {
+    // FNV-1a, then a final mix so the top bits (shard choice) depend on every byte
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+std::string VerdictCache::makeKey(const Passport& passport) {
+    std::string key;
+    const std::string line1 = passport.getMrzLine1();
+    const std::string line2 = passport.getMrzLine2();
+    if (!line1.empty() || !line2.empty()) {
+        key.reserve(line1.size() + line2.size() + 12);
+        key = "MRZ";
+        appendPart(key, line1);
+        appendPart(key, line2);
+        return key;
+    }
+
+    // No MRZ: the fields the checks read, in a form no MRZ can take
+    const std::string fields[] = {
+        passport.getDocumentType(), passport.getPassportNumber(), passport.getLastName(),
+        passport.getFirstName(), passport.getNationality(), passport.getIssuingCountry(),
+        passport.getDateOfBirth(), passport.getGender(), passport.getExpirationDate()
+    };
+    key = "FIELDS";
+    for (const auto& field : fields) {
+        appendPart(key, field);
+    }
+    return key;
+}
+
+void VerdictCache::setEnabled(bool enable) {
+    enabled.store(enable);
+    if (!enable) {
+        clear();
+    }
+}
+
+void VerdictCache::setTimeToLive(std::chrono::milliseconds timeToLive) {
+    timeToLiveMs.store(timeToLive.count());
+}
+
+bool VerdictCache::lookup(std::string_view key, uint64_t version, int& verdict) {
+    if (!isEnabled()) {
+        return false;
+    }
+
+    uint64_t hash = hashKey(key);
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(hash);
+    if (found == shard.index.end() || found->second->key != key) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto entry = found->second;
+    if (entry->version != version || entry->expiresAt <= Clock::now()) {
+        (entry->version != version ? invalidated : expired).fetch_add(1, std::memory_order_relaxed);
+        misses.fetch_add(1, std::memory_order_relaxed);
+        shard.index.erase(found);
+        shard.entries.erase(entry);
+        return false;
+    }
+
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+    verdict = entry->verdict;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void VerdictCache::insert(std::string_view key, uint64_t version, int verdict) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    uint64_t hash = hashKey(key);
+    Clock::time_point expiresAt = Clock::now() + std::chrono::milliseconds(timeToLiveMs.load());
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(hash);
+    if (found != shard.index.end()) {
+        // Same document re-verified, or a hash collision: the newer verdict wins
+        auto entry = found->second;
+        entry->key.assign(key.data(), key.size());
+        entry->version = version;
+        entry->verdict = verdict;
+        entry->expiresAt = expiresAt;
+        shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+    } else {
+        if (shard.entries.size() >= shardCapacity) {
+            shard.index.erase(shard.entries.back().hash);
+            shard.entries.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.entries.push_front(Entry{hash, std::string(key), version, verdict, expiresAt});
+        shard.index.emplace(hash, shard.entries.begin());
+    }
+    insertions.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VerdictCache::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.index.clear();
+    }
+}
+
+VerdictCache::Statistics VerdictCache::getStatistics() const {
+    Statistics statistics;
+    statistics.hits = hits.load();
+    statistics.misses = misses.load();
+    statistics.invalidated = invalidated.load();
+    statistics.expired = expired.load();
+    statistics.insertions = insertions.load();
+    statistics.evictions = evictions.load();
+    statistics.size = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        statistics.size += shard.entries.size();
+    }
+    return statistics;
+}
@@ -0,0 +1,96 @@
+#ifndef VERDICT_CACHE_H
+#define VERDICT_CACHE_H
+
+#include "Passport.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Recent verification verdicts, for documents presented again (rescans,
+// supervisor overrides, a second booth after a transfer).
+//
+// Entries are keyed by the MRZ as the rules see it and carry the version
+// of the rule data they were computed with. A lookup with a different version
+// drops the entry, so replacing the visa table, the watchlist or the
+// personnel list invalidates every cached verdict without a sweep.
+// Entries also expire after a time to live.
+//
+// The cache is split into shards, each an LRU list under its own mutex,
+// so booths rarely contend. Disabled until setEnabled(true).
+class VerdictCache {
+public:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Statistics {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t invalidated;   // dropped because the rule data changed
+        uint64_t expired;       // dropped because the time to live passed
+        uint64_t insertions;
+        uint64_t evictions;     // dropped to make room (least recently used)
+        size_t size;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        uint64_t hash;
+        std::string key;
+        uint64_t version;
+        int verdict;
+        Clock::time_point expiresAt;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;   // most recently used first
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    };
+
+    Shard shards[SHARD_COUNT];
+    size_t shardCapacity;
+    std::atomic<bool> enabled;
+    std::atomic<int64_t> timeToLiveMs;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> invalidated;
+    std::atomic<uint64_t> expired;
+    std::atomic<uint64_t> insertions;
+    std::atomic<uint64_t> evictions;
+
+    static uint64_t hashKey(std::string_view key);
+    Shard& shardFor(uint64_t hash) { return shards[hash >> 60]; }
+
+public:
+    explicit VerdictCache(size_t capacity = 65536,
+                          std::chrono::milliseconds timeToLive = std::chrono::minutes(5));
+
+    VerdictCache(const VerdictCache&) = delete;
+    VerdictCache& operator=(const VerdictCache&) = delete;
+
+    // The MRZ lines exactly as stored, since the rules check that text
+    // (a lowercase or padded misread must not share a genuine document's
+    // verdict); documents entered without an MRZ are keyed by their fields
+    static std::string makeKey(const Passport& passport);
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void setTimeToLive(std::chrono::milliseconds timeToLive);
+
+    // True and the verdict if a live entry with this version exists
+    bool lookup(std::string_view key, uint64_t version, int& verdict);
+    void insert(std::string_view key, uint64_t version, int verdict);
+    void clear();
+
+    Statistics getStatistics() const;
+};
+
+#endif // VERDICT_CACHE_H
@@ -1,51 +1,162 @@
 #include "../include/VerificationSystem.h"
-#include <iostream>
-#include <fstream>
+#include "../include/MrzCharset.h"
+#include "../include/FaceMatcher.h"
 #include <algorithm>
+#include <iostream>
+#include <thread>
 
-VerificationSystem::VerificationSystem() {
-    // Initialize with some default visa requirements
-    visaRequirements["USA"] = true;  // US citizens need visa for most countries
-    visaRequirements["CAN"] = true;  // Canadian citizens
-    visaRequirements["GBR"] = true;  // UK citizens
-    visaRequirements["AUS"] = true;  // Australian citizens
-    visaRequirements["DEU"] = false; // German citizens (EU)
-    visaRequirements["FRA"] = false; // French citizens (EU)
-    // Add more as needed
+namespace {
+    // Built-in rules for the default host country, used until a rule file is loaded
+    std::unique_ptr<VisaRuleSet> defaultVisaRules(uint16_t host) {
+        auto rules = std::make_unique<VisaRuleSet>();
+        const VisaRule visa = {0, VisaRule::VISA_REQUIRED, 0};
+        const VisaRule visaFree = {90, 0, 0};
+        rules->setRule(packCountryCode("USA"), host, visa);     // US citizens need visa for most countries
+        rules->setRule(packCountryCode("CAN"), host, visa);     // Canadian citizens
+        rules->setRule(packCountryCode("GBR"), host, visa);     // UK citizens
+        rules->setRule(packCountryCode("AUS"), host, visa);     // Australian citizens
+        rules->setRule(packCountryCode("DEU"), host, visaFree); // German citizens (EU)
+        rules->setRule(packCountryCode("FRA"), host, visaFree); // French citizens (EU)
+        return rules;
+    }
+    
+    bool visaStatusAllows(const Passport& passport, const VisaRuleSet& rules, uint16_t hostCountry) {
+        std::string nationality = passport.getNationality();
+        
+        // Citizens of the issuing country don't need a visa
+        if (nationality == passport.getIssuingCountry()) {
+            return true;
+        }
+        
+        // Check if visa is required for this nationality
+        const VisaRule& rule = rules.lookup(packCountryCode(nationality), hostCountry);
+        if (!rule.visaRequired()) {
+            return true;
+        }
+        
+        // Diplomatic and service passports may be exempt
+        const std::string documentType = passport.getDocumentType();
+        if (documentType == "PD") {
+            return (rule.flags & VisaRule::DIPLOMATIC_EXEMPT) != 0;
+        }
+        if (documentType == "PS" || documentType == "PO") {
+            return (rule.flags & VisaRule::SERVICE_EXEMPT) != 0;
+        }
+        return false;
+    }
+    
+    bool listedAsStolen(const StolenDocumentIndex* index, const Passport& passport) {
+        return index && index->contains(passport.getIssuingCountry(), passport.getPassportNumber());
+    }
     
+    bool matchesWatchlist(const NameWatchlist* list, const Passport& passport,
+                          std::vector<std::string>* matchedIds) {
+        if (!list) {
+            return false;
+        }
+        
+        std::vector<WatchlistMatch> matches;
+        if (list->screen(passport.getLastName(), passport.getFirstName(), matches) == 0) {
+            return false;
+        }
+        if (matchedIds) {
+            for (const auto& match : matches) {
+                matchedIds->push_back(list->getId(match.entry));
+            }
+        }
+        return true;
+    }
+}
+
+VerificationSystem::VerificationSystem()
+    : visaRules(defaultVisaRules(packCountryCode("TUR"))), hostCountry(packCountryCode("TUR")),
+      referenceDataVersion(0) {
     // Add some default authorized personnel
-    authorizedPersonnel.push_back("SEC001");
-    authorizedPersonnel.push_back("SEC002");
-    authorizedPersonnel.push_back("ADM001");
+    authorizedPersonnel.addPersonnel("SEC001", PersonnelStore::OFFICER);
+    authorizedPersonnel.addPersonnel("SEC002", PersonnelStore::OFFICER);
+    authorizedPersonnel.addPersonnel("ADM001", PersonnelStore::ADMINISTRATOR);
+    
+    registerDocumentRules();
 }
 
-void VerificationSystem::loadVisaRequirements() {
-    // In a real implementation, this would load from a file or database
-    // For now, we're using hardcoded values
-    std::cout << "Loading visa requirements from database...\n";
+void VerificationSystem::registerDocumentRules() {
+    // Severity follows the old fixed chain: an invalid document outranks a
+    // counterfeit, which outranks anything that only needs an officer.
+    // The estimates only matter until the pipeline has timed each rule.
+    enum Severity { REVIEW = 1, REJECT = 2, MALFORMED = 3 };
+    
+    documentRules.addRule("required-fields", INVALID_DOCUMENT, MALFORMED, 5,
+        [](const VerificationContext& context) {
+            const Passport& passport = context.passport;
+            return !passport.getPassportNumber().empty() && !passport.getFirstName().empty() &&
+                   !passport.getLastName().empty();
+        });
+    documentRules.addRule("mrz-checksum", INVALID_DOCUMENT, MALFORMED, 300,
+        [](const VerificationContext& context) { return context.passport.validateMRZChecksum(); });
+    documentRules.addRule("dates", INVALID_DOCUMENT, MALFORMED, 2,
+        [](const VerificationContext& context) { return context.passport.validateDates(); });
+    
+    // Reference data comes from the snapshot taken for the document or batch
+    documentRules.addRule("expired", DENIED, REJECT, 2,
+        [](const VerificationContext& context) { return !context.passport.isExpired(context.reference.today); });
+    documentRules.addRule("mrz-charset", DENIED, REJECT, 100,
+        [this](const VerificationContext& context) { return hasValidCharacters(context.passport); });
+    documentRules.addRule("stolen-document", DENIED, REJECT, 100,
+        [](const VerificationContext& context) {
+            return !listedAsStolen(context.reference.stolenDocuments, context.passport);
+        });
+    
+    documentRules.addRule("watchlist", MANUAL_REVIEW, REVIEW, 2000,
+        [](const VerificationContext& context) {
+            return !matchesWatchlist(context.reference.watchlist, context.passport, nullptr);
+        });
+    documentRules.addRule("visa", MANUAL_REVIEW, REVIEW, 20,
+        [](const VerificationContext& context) {
+            return visaStatusAllows(context.passport, *context.reference.visaRules, context.reference.hostCountry);
+        });
 }
 
-bool VerificationSystem::requiresVisa(const std::string& countryCode) const {
-    auto it = visaRequirements.find(countryCode);
-    if (it != visaRequirements.end()) {
-        return it->second;
+bool VerificationSystem::loadVisaRequirements(const std::string& filename) {
+    std::cout << "Loading visa requirements from " << filename << "...\n";
+    
+    // Verification keeps running on the previous rules until the swap
+    std::string error;
+    if (!visaRules.reload(filename, error)) {
+        std::cerr << "Visa requirements not loaded: " << error << std::endl;
+        return false;
     }
-    // Default: require visa if not in our list
     return true;
 }
 
+void VerificationSystem::setHostCountry(const std::string& countryCode) {
+    uint16_t packed = packCountryCode(countryCode);
+    if (packed != INVALID_COUNTRY_CODE) {
+        hostCountry.store(packed);
+        referenceDataVersion.fetch_add(1);
+    }
+}
+
+std::string VerificationSystem::getHostCountry() const {
+    return unpackCountryCode(hostCountry.load());
+}
+
+uint64_t VerificationSystem::getVisaRulesVersion() const {
+    return visaRules.getVersion();
+}
+
+VisaRule VerificationSystem::getVisaRule(const std::string& nationality) const {
+    return visaRules.lookup(packCountryCode(nationality), hostCountry.load());
+}
+
+bool VerificationSystem::requiresVisa(const std::string& countryCode) const {
+    // Unlisted nationalities get the default rule: visa required
+    return getVisaRule(countryCode).visaRequired();
+}
+
 bool VerificationSystem::checkVisaStatus(const Passport& passport) const {
     // In a real implementation, this would check against a visa database
-    // For now, we'll simulate a check
-    std::string nationality = passport.getNationality();
-    
-    // Citizens of the issuing country don't need a visa
-    if (nationality == passport.getIssuingCountry()) {
-        return true;
-    }
-    
-    // Check if visa is required for this nationality
-    return !requiresVisa(nationality);
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return visaStatusAllows(passport, *visaRules.snapshot(), hostCountry.load());
 }
 
 bool VerificationSystem::verifyDocumentAuthenticity(const Passport& passport) const {
@@ -72,32 +183,151 @@ bool VerificationSystem::detectCounterfeit(const Passport& passport) const {
         return true;
     }
     
-    // 2. Check for invalid characters in fields
-    const std::string validChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789< ";
-    std::string passportData = passport.getPassportNumber() + passport.getFirstName() + 
-                              passport.getLastName() + passport.getNationality();
+    // 2. Check for characters outside their field's class
+    if (!hasValidCharacters(passport)) {
+        return true;
+    }
     
-    for (char c : passportData) {
-        if (validChars.find(toupper(c)) == std::string::npos) {
-            return true; // Invalid character found
-        }
+    // 3. Check against the lost/stolen document index
+    if (isReportedStolen(passport)) {
+        return true;
     }
     
-    // 3. Additional checks would go here in a real implementation
-    // - Check against databases of stolen passports
+    // 4. Additional checks would go here in a real implementation
     // - Verify security features
     // - Check for tampering
     
     return false; // Not counterfeit
 }
 
-void VerificationSystem::addAuthorizedPersonnel(const std::string& id) {
-    authorizedPersonnel.push_back(id);
+bool VerificationSystem::hasValidCharacters(const Passport& passport) const {
+    // Check every MRZ position against the character class its field
+    // allows, which also catches shifted or spliced layouts
+    const std::string mrzLine1 = passport.getMrzLine1();
+    const std::string mrzLine2 = passport.getMrzLine2();
+    if (!mrzLine1.empty() || !mrzLine2.empty()) {
+        MrzCharset::Violation violation;
+        if (!MrzCharset::check(mrzLine1, mrzLine2, violation)) {
+            return false;
+        }
+    }
+    
+    // Fields entered without an MRZ still need to be plain MRZ text
+    return MrzCharset::isFieldText(passport.getPassportNumber()) &&
+           MrzCharset::isFieldText(passport.getFirstName()) &&
+           MrzCharset::isFieldText(passport.getLastName()) &&
+           MrzCharset::isFieldText(passport.getNationality());
+}
+
+bool VerificationSystem::attachStolenDocumentIndex(const std::string& path) {
+    auto index = std::make_unique<StolenDocumentIndex>();
+    std::string error;
+    if (!index->open(path, error)) {
+        std::cerr << "Stolen document index not attached: " << error << std::endl;
+        return false;
+    }
+    
+    std::cout << "Stolen document index attached: " << index->getKeyCount() << " documents\n";
+    std::lock_guard<std::mutex> lock(referenceDataMutex);
+    stolenDocuments.publish(index.release());
+    referenceDataVersion.fetch_add(1);
+    return true;
+}
+
+void VerificationSystem::detachStolenDocumentIndex() {
+    std::lock_guard<std::mutex> lock(referenceDataMutex);
+    stolenDocuments.publish(nullptr);
+    referenceDataVersion.fetch_add(1);
+}
+
+bool VerificationSystem::isReportedStolen(const Passport& passport) const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return listedAsStolen(stolenDocuments.load(), passport);
+}
+
+bool VerificationSystem::loadWatchlist(const std::string& filename) {
+    auto list = std::make_unique<NameWatchlist>();
+    std::string error;
+    if (!list->loadFromFile(filename, error)) {
+        std::cerr << "Watchlist not loaded: " << error << std::endl;
+        return false;
+    }
+    
+    std::cout << "Watchlist loaded: " << list->size() << " entries\n";
+    std::lock_guard<std::mutex> lock(referenceDataMutex);
+    watchlist.publish(list.release());
+    referenceDataVersion.fetch_add(1);
+    return true;
+}
+
+bool VerificationSystem::screenWatchlist(const Passport& passport, std::vector<std::string>* matchedIds) const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return matchesWatchlist(watchlist.load(), passport, matchedIds);
+}
+
+bool VerificationSystem::attachFaceWatchlist(const std::string& path) {
+    auto index = std::make_unique<FaceWatchlistIndex>();
+    std::string error;
+    if (!index->open(path, error)) {
+        std::cerr << "Face watchlist not attached: " << error << std::endl;
+        return false;
+    }
+    
+    std::cout << "Face watchlist attached: " << index->size() << " faces\n";
+    std::lock_guard<std::mutex> lock(referenceDataMutex);
+    faceWatchlist.publish(index.release());
+    return true;
+}
+
+void VerificationSystem::detachFaceWatchlist() {
+    std::lock_guard<std::mutex> lock(referenceDataMutex);
+    faceWatchlist.publish(nullptr);
+}
+
+bool VerificationSystem::screenFaceWatchlist(const FaceMatcher::Descriptor& face,
+                                             std::vector<FaceCandidate>& candidates, size_t k) const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const FaceWatchlistIndex* index = faceWatchlist.load();
+    if (!index) {
+        return false;
+    }
+    
+    // Ids are copied out: the mapping may be retired once the guard is gone
+    std::vector<FaceWatchlistMatch> matches;
+    index->search(face, k, matches);
+    for (const FaceWatchlistMatch& match : matches) {
+        candidates.push_back({std::string(index->getId(match.entry)), match.score});
+    }
+    return !matches.empty() && matches.front().score >= FaceWatchlistIndex::HIT_THRESHOLD;
+}
+
+uint64_t VerificationSystem::getFaceWatchlistSize() const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const FaceWatchlistIndex* index = faceWatchlist.load();
+    return index ? index->size() : 0;
+}
+
+FaceWatchlistIndex::Statistics VerificationSystem::getFaceWatchlistStatistics() const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const FaceWatchlistIndex* index = faceWatchlist.load();
+    return index ? index->getStatistics() : FaceWatchlistIndex::Statistics{0, 0, 0, 0};
+}
+
+bool VerificationSystem::addAuthorizedPersonnel(const std::string& id, uint8_t roles,
+                                                int64_t shiftStart, int64_t shiftEnd) {
+    return authorizedPersonnel.addPersonnel(id, roles, shiftStart, shiftEnd);
+}
+
+bool VerificationSystem::revokeAuthorizedPersonnel(const std::string& id) {
+    return authorizedPersonnel.revoke(id);
 }
 
 bool VerificationSystem::isAuthorizedPersonnel(const std::string& id) const {
-    return std::find(authorizedPersonnel.begin(), authorizedPersonnel.end(), id) != 
-           authorizedPersonnel.end();
+    return authorizedPersonnel.isAuthorized(id);
+}
+
+OperatorSession VerificationSystem::openOperatorSession(const std::string& id) const {
+    return authorizedPersonnel.openSession(id);
 }
 
 VerificationSystem::VerificationResult VerificationSystem::verifyPassport(
@@ -108,25 +338,175 @@ VerificationSystem::VerificationResult VerificationSystem::verifyPassport(
         return DENIED;
     }
     
-    // Check if passport data is valid
-    if (!passport.isValid()) {
-        return INVALID_DOCUMENT;
-    }
+    return verifyDocument(passport);
+}
+
+VerificationSystem::VerificationResult VerificationSystem::verifyPassport(
+    const Passport& passport, const OperatorSession& session) const {
     
-    // Check for counterfeit
-    if (detectCounterfeit(passport)) {
+    // Session was validated at sign-in; only revocation and shift end matter here
+    if (!session.isValid(PersonnelStore::now())) {
         return DENIED;
     }
     
-    // Check document authenticity
-    if (!verifyDocumentAuthenticity(passport)) {
-        return INVALID_DOCUMENT;
+    return verifyDocument(passport);
+}
+
+VerificationSystem::VerificationResult VerificationSystem::verifyPassport(
+    const Passport& passport, const OperatorSession& session, double faceSimilarity) const {
+    return applyFaceMatch(verifyPassport(passport, session), faceSimilarity);
+}
+
+VerificationSystem::VerificationResult VerificationSystem::applyFaceMatch(
+    VerificationResult documentResult, double faceSimilarity) {
+    // Only an approval is in question; a denial stands whoever holds the document
+    if (documentResult != APPROVED || faceSimilarity == FaceMatcher::NOT_COMPARED) {
+        return documentResult;
+    }
+    return faceSimilarity >= FaceMatcher::MATCH_THRESHOLD ? APPROVED : MANUAL_REVIEW;
+}
+
+unsigned VerificationSystem::verifyChip(const LdsDocument& chip, const Passport& passport) {
+    return chip.verify(passport.getMrzLine1() + passport.getMrzLine2());
+}
+
+VerificationSystem::VerificationResult VerificationSystem::applyChipCheck(
+    VerificationResult documentResult, unsigned chipFailures) {
+    if (chipFailures == 0 || documentResult == DENIED) {
+        return documentResult;
     }
+    return INVALID_DOCUMENT;
+}
+
+VerificationSystem::VerificationResult VerificationSystem::verifyDocument(const Passport& passport) const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const ReferenceSnapshot snapshot = takeSnapshot();
+    VerificationPipeline::Tally tally;
+    VerificationResult result = verifyDocument(passport, snapshot, tally);
+    documentRules.flush(tally);
+    return result;
+}
+
+VerificationSystem::VerificationResult VerificationSystem::verifyDocument(
+    const Passport& passport, const ReferenceSnapshot& snapshot, VerificationPipeline::Tally& tally) const {
+    
+    // Expiry depends on the day, so it is part of the key; everything else
+    // the rules read is covered by the version
+    std::string cacheKey;
+    const bool cached = verdictCache.isEnabled();
+    if (cached) {
+        cacheKey = VerdictCache::makeKey(passport) + "@" + std::to_string(snapshot.today);
+        int verdict;
+        if (verdictCache.lookup(cacheKey, snapshot.version, verdict)) {
+            return static_cast<VerificationResult>(verdict);
+        }
+    }
+    
+    // Each check runs at most once, cheapest and most selective first; the
+    // outcome is the same as checking validity, counterfeit, authenticity,
+    // watchlist and visa in that order
+    VerificationContext context(passport, snapshot);
+    int verdict = documentRules.evaluate(context, tally);
+    VerificationResult result = verdict == VerificationPipeline::PASSED ? APPROVED :
+                                static_cast<VerificationResult>(verdict);
+    
+    if (cached) {
+        verdictCache.insert(cacheKey, snapshot.version, result);
+    }
+    return result;
+}
+
+void VerificationSystem::verifyBatch(const Passport* passports, size_t count, const OperatorSession& session,
+                                     VerificationResult* results, size_t threadCount) const {
+    if (count == 0) {
+        return;
+    }
+    if (!session.isValid(PersonnelStore::now())) {
+        std::fill(results, results + count, DENIED);
+        return;
+    }
+    
+    // One pin and one snapshot for the whole batch: every passenger is
+    // checked against the same rules, and nothing the workers read can be
+    // reclaimed until the batch is done
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const ReferenceSnapshot snapshot = takeSnapshot();
+    
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min(threadCount, (count + BATCH_CHUNK - 1) / BATCH_CHUNK);
     
-    // Check visa status
-    if (!checkVisaStatus(passport)) {
-        return MANUAL_REVIEW; // Might need manual verification for visa
+    // Workers claim small chunks so a slow passenger (a long watchlist
+    // candidate list) does not hold up a whole share of the batch
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        VerificationPipeline::Tally tally;
+        for (;;) {
+            size_t begin = next.fetch_add(BATCH_CHUNK, std::memory_order_relaxed);
+            if (begin >= count) {
+                break;
+            }
+            size_t end = std::min(begin + BATCH_CHUNK, count);
+            for (size_t i = begin; i < end; ++i) {
+                results[i] = verifyDocument(passports[i], snapshot, tally);
+            }
+        }
+        documentRules.flush(tally);
+    };
+    
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
     }
+}
+
+std::vector<VerificationSystem::VerificationResult> VerificationSystem::verifyBatch(
+    const std::vector<Passport>& passports, const OperatorSession& session) const {
+    std::vector<VerificationResult> results(passports.size());
+    verifyBatch(passports.data(), passports.size(), session, results.data());
+    return results;
+}
+
+std::vector<VerificationPipeline::RuleStatistics> VerificationSystem::getRuleStatistics() const {
+    return documentRules.getStatistics();
+}
+
+uint64_t VerificationSystem::getRuleDataVersion() const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return takeSnapshot().version;
+}
+
+ReferenceSnapshot VerificationSystem::takeSnapshot() const {
+    // Counters are read before the data: anything published in between is
+    // newer than the version, so a verdict cached under it only goes stale.
+    // Every counter only grows, so the sum changes whenever any of them does.
+    const uint64_t version = referenceDataVersion.load() + authorizedPersonnel.getVersion();
     
-    return APPROVED;
+    ReferenceSnapshot snapshot;
+    snapshot.today = CurrentDate::today();
+    snapshot.hostCountry = hostCountry.load();
+    snapshot.visaRules = visaRules.snapshot();
+    snapshot.stolenDocuments = stolenDocuments.load();
+    snapshot.watchlist = watchlist.load();
+    snapshot.version = version + snapshot.visaRules->getVersion();
+    return snapshot;
+}
+
+void VerificationSystem::enableVerdictCache(std::chrono::milliseconds timeToLive) {
+    verdictCache.setTimeToLive(timeToLive);
+    verdictCache.setEnabled(true);
+}
+
+void VerificationSystem::disableVerdictCache() {
+    verdictCache.setEnabled(false);
+}
+
+VerdictCache::Statistics VerificationSystem::getVerdictCacheStatistics() const {
+    return verdictCache.getStatistics();
 }
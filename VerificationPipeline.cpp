@@ -0,0 +1,188 @@
+#include "../include/VerificationPipeline.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    const unsigned ORDER_BITS = 4;
+    const uint64_t ORDER_MASK = (1u << ORDER_BITS) - 1;
+
+    uint64_t identityOrder(size_t count) {
+        uint64_t order = 0;
+        for (size_t i = 0; i < count; ++i) {
+            order |= static_cast<uint64_t>(i) << (i * ORDER_BITS);
+        }
+        return order;
+    }
+}
+
+VerificationPipeline::VerificationPipeline() : maxSeverity(0), order(0), evaluated(0) {
+}
+
+bool VerificationPipeline::addRule(const std::string& name, int verdict, unsigned severity,
+                                   double estimatedNanoseconds, Check check) {
+    if (rules.size() >= MAX_RULES) {
+        return false;
+    }
+    auto rule = std::make_unique<Rule>();
+    rule->name = name;
+    rule->verdict = verdict;
+    rule->severity = severity;
+    rule->estimatedNanoseconds = estimatedNanoseconds;
+    rule->check = std::move(check);
+    rules.push_back(std::move(rule));
+    maxSeverity = std::max(maxSeverity, severity);
+    order.store(identityOrder(rules.size()));
+    reorder();
+    return true;
+}
+
+int VerificationPipeline::evaluate(const VerificationContext& context) const {
+    Tally tally;
+    int verdict = evaluate(context, tally);
+    flush(tally);
+    return verdict;
+}
+
+int VerificationPipeline::evaluate(const VerificationContext& context, Tally& tally) const {
+    // Per-thread sampling keeps the clock off most evaluations
+    thread_local unsigned sampleCounter = 0;
+    const bool timed = (sampleCounter++ % TIMING_SAMPLE_RATE) == 0;
+
+    const uint64_t currentOrder = order.load(std::memory_order_relaxed);
+    int verdict = PASSED;
+    unsigned severity = 0;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const size_t index = (currentOrder >> (i * ORDER_BITS)) & ORDER_MASK;
+        const Rule& rule = *rules[index];
+        // A rule that cannot outrank the current verdict is not worth running
+        if (verdict != PASSED && rule.severity <= severity) {
+            continue;
+        }
+
+        bool passed;
+        if (timed) {
+            auto start = std::chrono::steady_clock::now();
+            passed = rule.check(context);
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+            ++tally.timedEvaluations[index];
+            tally.timedNanoseconds[index] += static_cast<uint64_t>(elapsed.count());
+        } else {
+            passed = rule.check(context);
+        }
+        ++tally.evaluations[index];
+
+        if (!passed) {
+            ++tally.rejections[index];
+            verdict = rule.verdict;
+            severity = rule.severity;
+            if (severity == maxSeverity) {
+                break;
+            }
+        }
+    }
+    ++tally.documents;
+    return verdict;
+}
+
+void VerificationPipeline::flush(Tally& tally) const {
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (tally.evaluations[i] == 0) {
+            continue;
+        }
+        Rule::Counters& counters = rules[i]->counters;
+        counters.evaluations.fetch_add(tally.evaluations[i], std::memory_order_relaxed);
+        counters.rejections.fetch_add(tally.rejections[i], std::memory_order_relaxed);
+        if (tally.timedEvaluations[i] != 0) {
+            counters.timedEvaluations.fetch_add(tally.timedEvaluations[i], std::memory_order_relaxed);
+            counters.timedNanoseconds.fetch_add(tally.timedNanoseconds[i], std::memory_order_relaxed);
+        }
+    }
+    countDocuments(tally.documents);
+    tally = Tally();
+}
+
+void VerificationPipeline::countDocuments(uint64_t documents) const {
+    if (documents == 0) {
+        return;
+    }
+    uint64_t before = evaluated.fetch_add(documents, std::memory_order_relaxed);
+    // Re-sort whenever the count crosses a multiple of the interval
+    if ((before + documents) / REORDER_INTERVAL != before / REORDER_INTERVAL) {
+        reorder();
+    }
+}
+
+double VerificationPipeline::averageNanoseconds(const Rule& rule) const {
+    uint64_t samples = rule.counters.timedEvaluations.load(std::memory_order_relaxed);
+    if (samples < TIMING_SAMPLE_RATE) {
+        return rule.estimatedNanoseconds;
+    }
+    return static_cast<double>(rule.counters.timedNanoseconds.load(std::memory_order_relaxed)) /
+           static_cast<double>(samples);
+}
+
+void VerificationPipeline::reorder() const {
+    // One thread re-sorts; the others keep using the current order
+    std::unique_lock<std::mutex> lock(reorderMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    std::vector<double> expectedCost(rules.size());
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const Rule& rule = *rules[i];
+        // Smoothed so rules that have not rejected anything yet still rank by cost
+        double evaluations = static_cast<double>(rule.counters.evaluations.load(std::memory_order_relaxed));
+        double rejections = static_cast<double>(rule.counters.rejections.load(std::memory_order_relaxed));
+        double rejectionRate = (rejections + 1.0) / (evaluations + 2.0);
+        expectedCost[i] = averageNanoseconds(rule) / rejectionRate;
+    }
+
+    std::vector<size_t> indices(rules.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = i;
+    }
+    std::stable_sort(indices.begin(), indices.end(), [&](size_t a, size_t b) {
+        return expectedCost[a] < expectedCost[b];
+    });
+
+    uint64_t newOrder = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        newOrder |= static_cast<uint64_t>(indices[i]) << (i * ORDER_BITS);
+    }
+    order.store(newOrder, std::memory_order_relaxed);
+}
+
+std::vector<VerificationPipeline::RuleStatistics> VerificationPipeline::getStatistics() const {
+    std::vector<RuleStatistics> statistics;
+    statistics.reserve(rules.size());
+    for (const auto& rule : rules) {
+        RuleStatistics entry;
+        entry.name = rule->name;
+        entry.verdict = rule->verdict;
+        entry.severity = rule->severity;
+        entry.evaluations = rule->counters.evaluations.load();
+        entry.rejections = rule->counters.rejections.load();
+        entry.averageNanoseconds = averageNanoseconds(*rule);
+        entry.position = 0;
+        statistics.push_back(entry);
+    }
+
+    uint64_t currentOrder = order.load();
+    for (size_t i = 0; i < rules.size(); ++i) {
+        statistics[(currentOrder >> (i * ORDER_BITS)) & ORDER_MASK].position = i;
+    }
+    return statistics;
+}
+
+void VerificationPipeline::resetStatistics() {
+    for (auto& rule : rules) {
+        rule->counters.evaluations.store(0);
+        rule->counters.rejections.store(0);
+        rule->counters.timedEvaluations.store(0);
+        rule->counters.timedNanoseconds.store(0);
+    }
+    evaluated.store(0);
+    reorder();
+}
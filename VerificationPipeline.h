@@ -0,0 +1,134 @@
+#ifndef VERIFICATION_PIPELINE_H
+#define VERIFICATION_PIPELINE_H
+
+#include "Passport.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class VisaRuleSet;
+class StolenDocumentIndex;
+class NameWatchlist;
+
+// Reference data read once per document or per batch. The pointers stay
+// valid while the thread that took the snapshot holds an EpochManager pin.
+struct ReferenceSnapshot {
+    int32_t today;                                  // day number (MrzDate)
+    uint16_t hostCountry;                           // packed country code
+    const VisaRuleSet* visaRules;
+    const StolenDocumentIndex* stolenDocuments;     // null when not attached
+    const NameWatchlist* watchlist;                 // null when not loaded
+    uint64_t version;                               // rule data version (VerdictCache)
+};
+
+// Per-document state shared by the rules of one evaluation
+struct VerificationContext {
+    const Passport& passport;
+    const ReferenceSnapshot& reference;
+
+    VerificationContext(const Passport& passport, const ReferenceSnapshot& reference)
+        : passport(passport), reference(reference) {}
+};
+
+// Document checks as a list of registered rules.
+//
+// Each rule rejects with a verdict of some severity. The outcome is the
+// verdict of the most severe failing rule, which matches running the
+// rules as a fixed chain ordered by severity. Rules are free to run in
+// any order, though: once a rule has failed only more severe rules can
+// still change the outcome, and evaluation stops when nothing can.
+//
+// The order adapts to the traffic. Every rule counts evaluations and
+// rejections and samples its run time; every REORDER_INTERVAL documents
+// rules are re-sorted by expected cost per rejection (cost / rejection
+// rate), so cheap and selective checks run first.
+//
+// Rules are registered before the first evaluation; evaluate() is safe
+// from any number of threads.
+class VerificationPipeline {
+public:
+    static const int PASSED = -1;
+    static const size_t MAX_RULES = 16;
+    static const uint64_t REORDER_INTERVAL = 4096;
+    static const unsigned TIMING_SAMPLE_RATE = 16;   // time one evaluation in 16
+
+    // True if the document passes the rule
+    using Check = std::function<bool(const VerificationContext&)>;
+
+    // Counters kept by one thread over many evaluations and added to the
+    // shared ones by flush(), so batch workers do not contend on them
+    struct Tally {
+        uint64_t documents = 0;
+        uint64_t evaluations[MAX_RULES] = {};
+        uint64_t rejections[MAX_RULES] = {};
+        uint64_t timedEvaluations[MAX_RULES] = {};
+        uint64_t timedNanoseconds[MAX_RULES] = {};
+    };
+
+    struct RuleStatistics {
+        std::string name;
+        int verdict;
+        unsigned severity;
+        uint64_t evaluations;
+        uint64_t rejections;
+        double averageNanoseconds;   // sampled, or the registered estimate
+        size_t position;             // current place in the evaluation order
+    };
+
+private:
+    struct Rule {
+        std::string name;
+        int verdict;
+        unsigned severity;
+        double estimatedNanoseconds;
+        Check check;
+
+        // Written by every verifying thread; one cache line per rule
+        struct alignas(64) Counters {
+            std::atomic<uint64_t> evaluations{0};
+            std::atomic<uint64_t> rejections{0};
+            std::atomic<uint64_t> timedEvaluations{0};
+            std::atomic<uint64_t> timedNanoseconds{0};
+        };
+        mutable Counters counters;
+    };
+
+    std::vector<std::unique_ptr<Rule>> rules;
+    unsigned maxSeverity;
+    // Evaluation order, 4 bits per rule index
+    mutable std::atomic<uint64_t> order;
+    mutable std::atomic<uint64_t> evaluated;
+    mutable std::mutex reorderMutex;
+
+    double averageNanoseconds(const Rule& rule) const;
+    void reorder() const;
+    void countDocuments(uint64_t documents) const;
+
+public:
+    VerificationPipeline();
+
+    VerificationPipeline(const VerificationPipeline&) = delete;
+    VerificationPipeline& operator=(const VerificationPipeline&) = delete;
+
+    // Higher severity wins. estimatedNanoseconds orders the rule until
+    // timing samples exist. Returns false once MAX_RULES are registered.
+    bool addRule(const std::string& name, int verdict, unsigned severity, double estimatedNanoseconds,
+                 Check check);
+
+    // Verdict of the most severe failing rule, or PASSED
+    int evaluate(const VerificationContext& context) const;
+    // Same, counting into a thread-local tally
+    int evaluate(const VerificationContext& context, Tally& tally) const;
+    void flush(Tally& tally) const;
+
+    size_t size() const { return rules.size(); }
+    std::vector<RuleStatistics> getStatistics() const;
+    void resetStatistics();
+};
+
+#endif // VERIFICATION_PIPELINE_H
@@ -2,20 +2,42 @@
 #define VERIFICATION_SYSTEM_H
 
 #include "Passport.h"
+#include "VisaRules.h"
+#include "PersonnelStore.h"
+#include "StolenDocumentIndex.h"
+#include "NameWatchlist.h"
+#include "FaceWatchlistIndex.h"
+#include "LdsDocument.h"
+#include "VerificationPipeline.h"
+#include "VerdictCache.h"
+#include <chrono>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
-#include <map>
 
 class VerificationSystem {
 private:
-    std::map<std::string, bool> visaRequirements; // Country codes and their visa requirements
-    std::vector<std::string> authorizedPersonnel; // IDs of authorized personnel
+    VisaRuleTable visaRules; // Nationality x destination rules, reloadable while verifying
+    std::atomic<uint16_t> hostCountry; // Packed code of the country we control entry to
+    PersonnelStore authorizedPersonnel; // Roles and shifts of authorized personnel
+    EpochPointer<StolenDocumentIndex> stolenDocuments; // Lost/stolen index, null until attached
+    EpochPointer<NameWatchlist> watchlist; // Name watchlist, null until loaded
+    EpochPointer<FaceWatchlistIndex> faceWatchlist; // Face watchlist index, null until attached
+    std::mutex referenceDataMutex; // Serializes replacing the index and the watchlist
+    VerificationPipeline documentRules; // Document checks, ordered by measured cost
+    mutable VerdictCache verdictCache; // Verdicts of recently verified documents, off by default
+    std::atomic<uint64_t> referenceDataVersion; // Bumped when the index, watchlist or host country changes
     
 public:
     VerificationSystem();
     
     // Visa status checking
-    void loadVisaRequirements(); // Load from file/database
+    bool loadVisaRequirements(const std::string& filename = "visa_requirements.csv");
+    void setHostCountry(const std::string& countryCode);
+    std::string getHostCountry() const;
+    uint64_t getVisaRulesVersion() const;
+    VisaRule getVisaRule(const std::string& nationality) const;
     bool requiresVisa(const std::string& countryCode) const;
     bool checkVisaStatus(const Passport& passport) const;
     
@@ -25,9 +47,40 @@ public:
     // Counterfeit detection
     bool detectCounterfeit(const Passport& passport) const;
     
-    // Personnel authorization
-    void addAuthorizedPersonnel(const std::string& id);
+    // Lost/stolen documents; the index file is built offline with
+    // stolen_index_builder and can be replaced while booths are verifying
+    bool attachStolenDocumentIndex(const std::string& path);
+    void detachStolenDocumentIndex();
+    bool isReportedStolen(const Passport& passport) const;
+    
+    // Watchlist screening by approximate name match; hits go to manual review
+    bool loadWatchlist(const std::string& filename);
+    bool screenWatchlist(const Passport& passport, std::vector<std::string>* matchedIds = nullptr) const;
+    
+    // 1:N face screening; the index file is built offline with
+    // face_index_builder and can be replaced while booths are screening
+    struct FaceCandidate {
+        std::string id;
+        double score;   // FaceMatcher similarity
+    };
+    bool attachFaceWatchlist(const std::string& path);
+    void detachFaceWatchlist();
+    // Appends the k closest enrolled faces, best first; true if the best
+    // is a hit (FaceWatchlistIndex::HIT_THRESHOLD)
+    bool screenFaceWatchlist(const FaceMatcher::Descriptor& face, std::vector<FaceCandidate>& candidates,
+                             size_t k = 5) const;
+    uint64_t getFaceWatchlistSize() const;
+    FaceWatchlistIndex::Statistics getFaceWatchlistStatistics() const;
+    
+    // Personnel authorization; safe to change while booths are verifying
+    bool addAuthorizedPersonnel(const std::string& id,
+                                uint8_t roles = PersonnelStore::OFFICER,
+                                int64_t shiftStart = PersonnelStore::NO_SHIFT_START,
+                                int64_t shiftEnd = PersonnelStore::NO_SHIFT_END);
+    bool revokeAuthorizedPersonnel(const std::string& id);
     bool isAuthorizedPersonnel(const std::string& id) const;
+    // Signed-in operator for a booth; valid until revoked or the shift ends
+    OperatorSession openOperatorSession(const std::string& id) const;
     
     // Main verification process
     enum VerificationResult {
@@ -38,6 +91,56 @@ public:
     };
     
     VerificationResult verifyPassport(const Passport& passport, const std::string& personnelId) const;
+    VerificationResult verifyPassport(const Passport& passport, const OperatorSession& session) const;
+    // With the live face compared to the chip portrait (FaceMatcher): a
+    // document that would pass but whose face does not match goes to
+    // manual review
+    VerificationResult verifyPassport(const Passport& passport, const OperatorSession& session,
+                                      double faceSimilarity) const;
+    // The face check on its own, for verdicts reached without the photo
+    // (batch pre-clearance); NOT_COMPARED leaves the verdict as it is
+    static VerificationResult applyFaceMatch(VerificationResult documentResult, double faceSimilarity);
+    
+    // Passive authentication of the chip read from the passport: data
+    // group digests against the SOD and DG1 against the scanned MRZ.
+    // LdsDocument failure bits, 0 if the chip passed
+    static unsigned verifyChip(const LdsDocument& chip, const Passport& passport);
+    // A chip that fails makes a passing document invalid; a denial stands
+    static VerificationResult applyChipCheck(VerificationResult documentResult, unsigned chipFailures);
+    
+    // Pre-clearance of a whole passenger list: results[i] is the verdict for
+    // passports[i]. The session, today's date and the reference data are
+    // read once for the batch; the work is spread over threadCount threads
+    // (0 = one per core), the calling thread included.
+    void verifyBatch(const Passport* passports, size_t count, const OperatorSession& session,
+                     VerificationResult* results, size_t threadCount = 0) const;
+    std::vector<VerificationResult> verifyBatch(const std::vector<Passport>& passports,
+                                                const OperatorSession& session) const;
+    
+    // Changes whenever the visa table, stolen document index, watchlist,
+    // host country or personnel list does; verdicts computed under an
+    // older version may be out of date
+    uint64_t getRuleDataVersion() const;
+    
+    // Per-rule evaluation counts, rejections and sampled timings
+    std::vector<VerificationPipeline::RuleStatistics> getRuleStatistics() const;
+    
+    // Re-presented documents reuse their verdict until the time to live
+    // passes or any rule data changes. The operator check always runs.
+    void enableVerdictCache(std::chrono::milliseconds timeToLive = std::chrono::minutes(5));
+    void disableVerdictCache();
+    VerdictCache::Statistics getVerdictCacheStatistics() const;
+    
+private:
+    static const size_t BATCH_CHUNK = 8;   // passports claimed at a time by a batch worker
+    
+    // Caller must hold an EpochManager pin while using the snapshot
+    ReferenceSnapshot takeSnapshot() const;
+    void registerDocumentRules();
+    bool hasValidCharacters(const Passport& passport) const;
+    VerificationResult verifyDocument(const Passport& passport) const;
+    VerificationResult verifyDocument(const Passport& passport, const ReferenceSnapshot& snapshot,
+                                      VerificationPipeline::Tally& tally) const;
 };
 
 #endif // VERIFICATION_SYSTEM_H
@@ -0,0 +1,181 @@
+#include "../include/VisaRules.h"
+#include <cctype>
+#include <fstream>
+#include <string_view>
+
+namespace {
+    // Unknown nationality or destination: visa required, no exemptions
+    const VisaRule DEFAULT_RULE = {0, VisaRule::VISA_REQUIRED, 0};
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    size_t splitFields(std::string_view line, std::string_view* fields, size_t maxFields) {
+        size_t count = 0;
+        while (count < maxFields) {
+            size_t comma = line.find(',');
+            fields[count++] = trim(line.substr(0, comma));
+            if (comma == std::string_view::npos) {
+                break;
+            }
+            line.remove_prefix(comma + 1);
+        }
+        return count;
+    }
+
+    bool parseExemptions(std::string_view text, uint8_t& flags) {
+        while (!text.empty()) {
+            size_t bar = text.find('|');
+            std::string_view name = trim(text.substr(0, bar));
+            if (name == "DIPLOMATIC") {
+                flags |= VisaRule::DIPLOMATIC_EXEMPT;
+            } else if (name == "SERVICE") {
+                flags |= VisaRule::SERVICE_EXEMPT;
+            } else if (!name.empty()) {
+                return false;
+            }
+            if (bar == std::string_view::npos) {
+                break;
+            }
+            text.remove_prefix(bar + 1);
+        }
+        return true;
+    }
+}
+
+VisaRuleSet::VisaRuleSet()
+    : version(0), destinationTable(COUNTRY_CODE_SLOTS, 0), rules(COUNTRY_CODE_SLOTS, DEFAULT_RULE) {
+}
+
+bool VisaRuleSet::setRule(uint16_t nationality, uint16_t destination, const VisaRule& rule) {
+    if (nationality == INVALID_COUNTRY_CODE || nationality >= COUNTRY_CODE_SLOTS ||
+        destination == INVALID_COUNTRY_CODE || destination >= COUNTRY_CODE_SLOTS) {
+        return false;
+    }
+
+    uint16_t table = destinationTable[destination];
+    if (table == 0) {
+        table = static_cast<uint16_t>(rules.size() / COUNTRY_CODE_SLOTS);
+        rules.resize(rules.size() + COUNTRY_CODE_SLOTS, DEFAULT_RULE);
+        destinationTable[destination] = table;
+    }
+
+    VisaRule& slot = rules[static_cast<size_t>(table) * COUNTRY_CODE_SLOTS + nationality];
+    slot = rule;
+    slot.flags |= VisaRule::KNOWN;
+    return true;
+}
+
+std::unique_ptr<VisaRuleSet> VisaRuleSet::loadFromFile(const std::string& filename, std::string& error) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        error = "cannot open " + filename;
+        return nullptr;
+    }
+
+    auto rules = std::make_unique<VisaRuleSet>();
+    std::string line;
+    size_t lineNumber = 0;
+    bool firstRow = true;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') {
+            continue;
+        }
+
+        std::string_view fields[5];
+        size_t count = splitFields(text, fields, 5);
+        if (firstRow) {
+            firstRow = false;
+            if (fields[0] == "nationality") {
+                continue;
+            }
+        }
+
+        std::string where = filename + ":" + std::to_string(lineNumber) + ": ";
+        if (count < 3) {
+            error = where + "expected nationality,destination,visa_required[,visa_free_days[,exemptions]]";
+            return nullptr;
+        }
+
+        uint16_t nationality = packCountryCode(fields[0]);
+        uint16_t destination = packCountryCode(fields[1]);
+        if (nationality == INVALID_COUNTRY_CODE || destination == INVALID_COUNTRY_CODE) {
+            error = where + "invalid country code";
+            return nullptr;
+        }
+
+        VisaRule rule = {0, 0, 0};
+        if (fields[2] == "1") {
+            rule.flags |= VisaRule::VISA_REQUIRED;
+        } else if (fields[2] != "0") {
+            error = where + "visa_required must be 0 or 1";
+            return nullptr;
+        }
+
+        if (count > 3 && !fields[3].empty()) {
+            unsigned long days = 0;
+            for (char c : fields[3]) {
+                if (c < '0' || c > '9' || days > 6553) {
+                    error = where + "invalid visa_free_days";
+                    return nullptr;
+                }
+                days = days * 10 + static_cast<unsigned long>(c - '0');
+            }
+            if (days > 65535) {
+                error = where + "invalid visa_free_days";
+                return nullptr;
+            }
+            rule.visaFreeDays = static_cast<uint16_t>(days);
+        }
+
+        if (count > 4 && !parseExemptions(fields[4], rule.flags)) {
+            error = where + "unknown exemption";
+            return nullptr;
+        }
+
+        rules->setRule(nationality, destination, rule);
+    }
+
+    return rules;
+}
+
+VisaRuleTable::VisaRuleTable(std::unique_ptr<VisaRuleSet> initial) : current(nullptr), nextVersion(1) {
+    publish(std::move(initial));
+}
+
+VisaRule VisaRuleTable::lookup(uint16_t nationality, uint16_t destination) const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return current.load()->lookup(nationality, destination);
+}
+
+uint64_t VisaRuleTable::getVersion() const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    return current.load()->getVersion();
+}
+
+uint64_t VisaRuleTable::publish(std::unique_ptr<VisaRuleSet> rules) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    uint64_t version = nextVersion++;
+    rules->setVersion(version);
+    current.publish(rules.release());
+    return version;
+}
+
+bool VisaRuleTable::reload(const std::string& filename, std::string& error) {
+    // Parse outside the writer lock; booths keep using the current set
+    std::unique_ptr<VisaRuleSet> rules = VisaRuleSet::loadFromFile(filename, error);
+    if (!rules) {
+        return false;
+    }
+    publish(std::move(rules));
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef VISA_RULES_H
+#define VISA_RULES_H
+
+#include "CountryCode.h"
+#include "EpochManager.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Entry requirement for one nationality at one destination
+struct VisaRule {
+    enum Flag {
+        KNOWN = 1,               // present in the rule set
+        VISA_REQUIRED = 2,
+        DIPLOMATIC_EXEMPT = 4,   // diplomatic passports (PD) enter without a visa
+        SERVICE_EXEMPT = 8       // service / official passports (PS, PO)
+    };
+
+    uint16_t visaFreeDays;       // permitted stay without a visa, 0 = none
+    uint8_t flags;
+    uint8_t reserved;
+
+    bool isKnown() const { return (flags & KNOWN) != 0; }
+    bool visaRequired() const { return (flags & VISA_REQUIRED) != 0; }
+};
+
+// Immutable once published. One dense table of COUNTRY_CODE_SLOTS rules
+// per destination, indexed by packed nationality. Table 0 holds the
+// default rule (visa required) and every unlisted destination maps to it,
+// so a lookup is two loads and no branches.
+class VisaRuleSet {
+private:
+    uint64_t version;
+    std::vector<uint16_t> destinationTable;   // packed destination -> table number
+    std::vector<VisaRule> rules;              // table number * COUNTRY_CODE_SLOTS + nationality
+
+public:
+    VisaRuleSet();
+
+    const VisaRule& lookup(uint16_t nationality, uint16_t destination) const {
+        return rules[static_cast<size_t>(destinationTable[destination]) * COUNTRY_CODE_SLOTS + nationality];
+    }
+
+    // Building, before the set is published
+    bool setRule(uint16_t nationality, uint16_t destination, const VisaRule& rule);
+    void setVersion(uint64_t value) { version = value; }
+
+    uint64_t getVersion() const { return version; }
+    size_t getDestinationCount() const { return rules.size() / COUNTRY_CODE_SLOTS - 1; }
+
+    // CSV, one rule per line:
+    //   nationality,destination,visa_required,visa_free_days,exemptions
+    // visa_required is 0/1, exemptions is empty or DIPLOMATIC|SERVICE.
+    // Blank lines, '#' comments and a header line are skipped.
+    static std::unique_ptr<VisaRuleSet> loadFromFile(const std::string& filename, std::string& error);
+};
+
+// Current rule set, swapped RCU style: booths read without locking while a
+// reload builds a new set and publishes it with one pointer swap. The old
+// set is freed by the epoch manager once no booth is still reading it.
+class VisaRuleTable {
+private:
+    EpochPointer<VisaRuleSet> current;
+    std::mutex writerMutex;
+    uint64_t nextVersion;
+
+public:
+    explicit VisaRuleTable(std::unique_ptr<VisaRuleSet> initial);
+
+    VisaRule lookup(uint16_t nationality, uint16_t destination) const;
+    uint64_t getVersion() const;
+    // Current set; only valid while the caller holds an EpochManager pin
+    const VisaRuleSet* snapshot() const { return current.load(); }
+
+    // Replaces the current set; returns the new version
+    uint64_t publish(std::unique_ptr<VisaRuleSet> rules);
+    // On error the current set stays in place
+    bool reload(const std::string& filename, std::string& error);
+};
+
+#endif // VISA_RULES_H
@@ -0,0 +1,62 @@
+#include "../include/BinaryLogReader.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+
+// Offline decoder for the structured binary log written by
+// Logger::logBinary(). Renders each record as a text log line.
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: logdecoder <binary log file>\n";
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open binary log file: " << argv[1] << "\n";
+        return 1;
+    }
+
+    BinaryLogReader reader(in);
+    BinaryLogRecord record;
+    size_t records = 0;
+
+    while (true) {
+        const uint64_t offset = reader.getOffset();
+        const BinaryLogReader::Status status = reader.next(record);
+        if (status == BinaryLogReader::END) {
+            break;
+        }
+        if (status == BinaryLogReader::TRUNCATED) {
+            std::cerr << "Truncated record at end of file\n";
+            break;
+        }
+        if (status == BinaryLogReader::CORRUPT) {
+            std::cerr << "Corrupt record at offset " << offset << "\n";
+            return 1;
+        }
+        if (status == BinaryLogReader::NOT_A_LOG) {
+            std::cerr << "Not a passport control binary log: " << argv[1] << "\n";
+            return 1;
+        }
+        if (status == BinaryLogReader::UNSUPPORTED_VERSION) {
+            std::cerr << "Unsupported binary log version " << record.args[1].intValue << "\n";
+            return 1;
+        }
+        if (status == BinaryLogReader::NO_SESSION) {
+            std::cerr << "Binary log does not start with a session record\n";
+            return 1;
+        }
+
+        std::cout << "[" << BinaryLogReader::formatWallClock(reader.wallClock(record)) << "] ["
+                  << BinaryLogReader::levelName(record.level) << "] [T" << std::hex << std::setw(8)
+                  << std::setfill('0') << record.threadId << std::dec << std::setfill(' ') << "] "
+                  << BinaryLogReader::renderMessage(record) << "\n";
+        ++records;
+    }
+
+    std::cerr << records << " records decoded\n";
+    return 0;
+}
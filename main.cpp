@@ -1,8 +1,9 @@
 #include "../include/PassportControlSystem.h"
 #include <iostream>
 #include <memory>
+#include <cstdlib>
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "Airport Passport Control System\n";
     std::cout << "===============================\n\n";
     
@@ -16,8 +17,17 @@ int main() {
     
     std::cout << "System initialized successfully.\n\n";
     
-    // Run simulation
-    system->runSimulation();
+    // Overlap the scanner, camera and RFID reader for each passenger
+    system->setPipelinedMode(true);
+    
+    // Run simulation; "main <lanes> [passengers]" runs several booths at once
+    if (argc > 1) {
+        size_t lanes = std::strtoul(argv[1], nullptr, 10);
+        size_t passengers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : lanes * 4;
+        system->runLaneSimulation(lanes > 0 ? lanes : 1, passengers);
+    } else {
+        system->runSimulation();
+    }
     
     // Shutdown system
     system->shutdown();
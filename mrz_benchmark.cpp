@@ -0,0 +1,308 @@
+#include "../include/MrzParser.h"
+#include "../include/MrzChecksum.h"
+#include "../include/MrzCharset.h"
+#include "../include/MrzCorrector.h"
+#include "../include/MrzReader.h"
+#include "../include/FaceMatcher.h"
+#include "../include/LdsDocument.h"
+#include "../include/Sha256.h"
+#include "../include/Passport.h"
+#include "../include/VerificationSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compares the allocation-free MRZ parser with the previous
+// substr/replace based Passport::parseMRZ implementation, and the scalar
+// check-digit validation with the batch kernel. Also times MRZ OCR and
+// the correction of misread characters, the face comparison of the live
+// frame against the chip portrait, and chip parsing and passive
+// authentication.
+// Usage: mrz_benchmark [record count]
+
+namespace {
+    // Previous parsing path, kept here as the baseline
+    struct LegacyFields {
+        std::string documentType, issuingCountry, lastName, firstName;
+        std::string passportNumber, nationality, dateOfBirth, gender, expirationDate;
+    };
+    
+    bool legacyParse(const std::string& line1, const std::string& line2, LegacyFields& f) {
+        std::string mrzLine1 = line1;
+        std::string mrzLine2 = line2;
+        if (mrzLine1.length() < 44 || mrzLine2.length() < 44) {
+            return false;
+        }
+        f.documentType = mrzLine1.substr(0, 2);
+        f.issuingCountry = mrzLine1.substr(2, 3);
+        f.lastName = mrzLine1.substr(5, mrzLine1.find("<<", 5) - 5);
+        size_t firstNameStart = mrzLine1.find("<<", 5) + 2;
+        f.firstName = mrzLine1.substr(firstNameStart, 39 - firstNameStart);
+        std::replace(f.lastName.begin(), f.lastName.end(), '<', ' ');
+        std::replace(f.firstName.begin(), f.firstName.end(), '<', ' ');
+        f.passportNumber = mrzLine2.substr(0, 9);
+        f.nationality = mrzLine2.substr(10, 3);
+        f.dateOfBirth = mrzLine2.substr(13, 6);
+        f.gender = mrzLine2.substr(20, 1);
+        f.expirationDate = mrzLine2.substr(21, 6);
+        return true;
+    }
+    
+    template <typename Fn>
+    double measureSeconds(Fn fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    void report(const char* name, double seconds, size_t records) {
+        std::cout << name << ": " << seconds * 1e3 << " ms, "
+                  << seconds * 1e9 / records << " ns/record\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t recordCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    
+    // Build one contiguous manifest-style buffer
+    const char* surnames[] = {"SMITH", "VAN<DER<BERG", "OZTURK", "NGUYEN", "GARCIA<LOPEZ"};
+    const char* givenNames[] = {"JOHN", "ANNA<MARIA", "MEHMET", "LAN", "JOSE<LUIS"};
+    std::string buffer;
+    std::vector<std::string> lines1, lines2;
+    buffer.reserve(recordCount * 90);
+    for (size_t i = 0; i < recordCount; ++i) {
+        std::string line1 = std::string("P<UTO") + surnames[i % 5] + "<<" + givenNames[(i / 5) % 5];
+        line1.resize(44, '<');
+        std::string number = std::to_string(100000000 + i % 900000000);
+        std::string line2 = number + char('0' + MrzChecksum::computeCheckDigit(number)) +
+                            "UTO8001014M301231" +
+                            char('0' + MrzChecksum::computeCheckDigit("301231")) + "<<<<<<<<<<<<<<<";
+        std::string composite = line2.substr(0, 10) + line2.substr(13, 7) + line2.substr(21, 22);
+        line2 += char('0' + MrzChecksum::computeCheckDigit(composite));
+        if (i % 100 == 99) {
+            line2[15] = '9'; // Some corrupted records for the pre-screen
+        }
+        buffer += line1 + "\n" + line2 + "\n";
+        lines1.push_back(line1);
+        lines2.push_back(line2);
+    }
+    
+    size_t checksum = 0;
+    
+    double legacySeconds = measureSeconds([&] {
+        LegacyFields fields;
+        for (size_t i = 0; i < recordCount; ++i) {
+            legacyParse(lines1[i], lines2[i], fields);
+            checksum += fields.lastName.size();
+        }
+    });
+    
+    double passportSeconds = measureSeconds([&] {
+        Passport passport;
+        for (size_t i = 0; i < recordCount; ++i) {
+            passport.parseMRZ(lines1[i], lines2[i]);
+            checksum += passport.getPassportNumber().size();
+        }
+    });
+    
+    std::vector<MrzFields> parsed(recordCount);
+    size_t parsedCount = 0;
+    double batchSeconds = measureSeconds([&] {
+        parsedCount = MrzParser::parseBatch(buffer, parsed.data(), parsed.size());
+        for (size_t i = 0; i < parsedCount; ++i) {
+            checksum += parsed[i].lastName.size();
+        }
+    });
+    
+    size_t scalarRejected = 0;
+    double scalarCheckSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < parsedCount; ++i) {
+            scalarRejected += MrzChecksum::validate(parsed[i]) != 0;
+        }
+    });
+    
+    std::vector<uint8_t> failures(parsedCount);
+    size_t batchRejected = 0;
+    double batchCheckSeconds = measureSeconds([&] {
+        MrzChecksum::validateTD3Batch(parsed.data(), parsedCount, failures.data());
+        for (size_t i = 0; i < parsedCount; ++i) {
+            batchRejected += failures[i] != 0;
+        }
+    });
+    
+    // Previous character screen: find() in a 38-character string per byte
+    const std::string validChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789< ";
+    size_t scanRejected = 0;
+    double scanSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < recordCount; ++i) {
+            for (const std::string* line : {&lines1[i], &lines2[i]}) {
+                bool invalid = false;
+                for (char c : *line) {
+                    invalid |= validChars.find(c) == std::string::npos;
+                }
+                scanRejected += invalid;
+            }
+        }
+    });
+    
+    size_t layoutRejected = 0;
+    double layoutSeconds = measureSeconds([&] {
+        MrzCharset::Violation violation;
+        for (size_t i = 0; i < recordCount; ++i) {
+            layoutRejected += !MrzCharset::check(lines1[i], lines2[i], violation);
+        }
+    });
+    
+    std::cout << "=== MRZ Parser Benchmark (" << recordCount << " records, " << MrzChecksum::getBatchKernel()
+              << " check-digit kernel) ===\n";
+    report("Legacy substr parser    ", legacySeconds, recordCount);
+    report("Passport::parseMRZ      ", passportSeconds, recordCount);
+    report("MrzParser::parseBatch   ", batchSeconds, recordCount);
+    report("MrzChecksum::validate   ", scalarCheckSeconds, recordCount);
+    report("MrzChecksum batch kernel", batchCheckSeconds, recordCount);
+    report("validChars.find scan    ", scanSeconds, recordCount);
+    report("MrzCharset layout check ", layoutSeconds, recordCount);
+    std::cout << "Rejected by character screen: " << scanRejected << " scan, "
+              << layoutRejected << " layout\n";
+    std::cout << "Rejected by check digits: " << scalarRejected << " scalar, "
+              << batchRejected << " batch\n";
+    std::cout << "Parsed " << parsedCount << " records (checksum " << checksum << ")\n";
+    
+    // MRZ OCR on a full HD camera frame of the data page
+    const int frameWidth = 1920, frameHeight = 1080;
+    std::vector<unsigned char> frame(static_cast<size_t>(frameWidth) * frameHeight * 3, 0xE8);
+    MrzReader::render({lines1[0], lines2[0]}, frame.data(), frameWidth, frameHeight, 3, 4, 400, 900);
+    MrzReader reader;
+    const size_t frameCount = 20;
+    size_t framesRead = 0;
+    double ocrSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < frameCount; ++i) {
+            MrzReader::Result result = reader.read(frame.data(), frameWidth, frameHeight, 3);
+            framesRead += result.found && result.lines[1] == lines2[0];
+        }
+    });
+    std::cout << "=== MRZ OCR (" << frameWidth << "x" << frameHeight << " RGB) ===\n";
+    std::cout << ocrSeconds * 1e3 / frameCount << " ms/frame, " << framesRead << " of " << frameCount
+              << " frames read\n";
+    
+    // OCR look-alikes: a date digit read as a letter (class repair) in
+    // even records, a document number digit (check digit search) in odd.
+    // The corrupted records above have a wrong digit no look-alike
+    // explains and stay unrepaired.
+    std::vector<std::string> misread(recordCount);
+    for (size_t i = 0; i < recordCount; ++i) {
+        misread[i] = lines1[i] + "\n" + lines2[i];
+        size_t line2 = lines1[i].size() + 1;
+        size_t start = line2 + (i % 2 == 0 ? 13 : 1);
+        for (size_t pos = start; pos < start + 6; ++pos) {
+            char replacement = MrzCorrector::lookAlike(misread[i][pos]);
+            if (replacement != '\0' && misread[i][pos] != '6') {
+                misread[i][pos] = replacement;
+                break;
+            }
+        }
+    }
+    size_t repaired = 0;
+    double correctionSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < recordCount; ++i) {
+            MrzCorrector::Result result = MrzCorrector::correct(misread[i]);
+            repaired += result.valid && result.lines[1] == lines2[i];
+        }
+    });
+    std::cout << "=== MRZ correction (" << recordCount << " misread records) ===\n";
+    report("MrzCorrector::correct   ", correctionSeconds, recordCount);
+    std::cout << "Repaired " << repaired << " of " << recordCount << " records\n";
+    
+    // Face comparison: chip portrait against the face near the booth guide
+    const int portraitWidth = 240, portraitHeight = 320;
+    const FaceMatcher::Region portraitFace = FaceMatcher::portraitRegion(portraitWidth, portraitHeight);
+    std::vector<unsigned char> portrait(static_cast<size_t>(portraitWidth) * portraitHeight, 215);
+    FaceMatcher::renderFace(7, portrait.data(), portraitWidth, portraitHeight, 1, portraitFace);
+    const FaceMatcher::Region guide = {720, 180, 480, 600};
+    FaceMatcher::renderFace(7, frame.data(), frameWidth, frameHeight, 3, {728, 172, 490, 612}, -20);
+    const size_t faceCount = 50;
+    FaceMatcher::Descriptor reference, live;
+    double extractSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < faceCount; ++i) {
+            FaceMatcher::extract(portrait.data(), portraitWidth, portraitHeight, 1, portraitFace, reference);
+        }
+    });
+    double similarity = 0;
+    double matchSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < faceCount; ++i) {
+            similarity = FaceMatcher::match(reference, frame.data(), frameWidth, frameHeight, 3, guide, &live);
+        }
+    });
+    const size_t distanceCount = 100000;
+    uint64_t distanceSum = 0;
+    double distanceSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < distanceCount; ++i) {
+            live.values[i % FaceMatcher::DESCRIPTOR_BYTES] ^= 1;
+            distanceSum += FaceMatcher::distance(reference, live);
+        }
+    });
+    std::cout << "=== Face comparison (" << FaceMatcher::DESCRIPTOR_BYTES << "-byte descriptors) ===\n";
+    std::cout << "FaceMatcher::extract    : " << extractSeconds * 1e6 / faceCount << " us/portrait\n";
+    std::cout << "FaceMatcher::match      : " << matchSeconds * 1e6 / faceCount << " us/frame, similarity "
+              << similarity << "\n";
+    std::cout << "FaceMatcher::distance   : " << distanceSeconds * 1e9 / distanceCount << " ns/pair (sum "
+              << distanceSum << ")\n";
+    
+    // Chip: parse the LDS files, then hash the data groups against the SOD
+    std::string groups[LdsDocument::MAX_DATA_GROUP + 1];
+    groups[1] = LdsDocument::encodeDataGroup1(lines1[0] + lines2[0]);
+    groups[2] = LdsDocument::encodeDataGroup2(portrait.data(), portraitWidth, portraitHeight);
+    const std::string com = LdsDocument::encodeCom((1u << 1) | (1u << 2));
+    const std::string sod = LdsDocument::encodeSecurityObject(groups);
+    const size_t chipCount = 1000;
+    std::string error;
+    size_t chipsParsed = 0, authenticated = 0;
+    double parseSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < chipCount; ++i) {
+            LdsDocument document;
+            chipsParsed += document.parseCom(com, error) && document.parseSecurityObject(sod, error) &&
+                      document.parseDataGroup(1, groups[1], error) && document.parseDataGroup(2, groups[2], error);
+        }
+    });
+    LdsDocument chip;
+    chip.parseSecurityObject(sod, error);
+    chip.parseDataGroup(1, groups[1], error);
+    chip.parseDataGroup(2, groups[2], error);
+    double authenticateSeconds = measureSeconds([&] {
+        for (size_t i = 0; i < chipCount; ++i) {
+            authenticated += chip.verify(lines1[0] + "\n" + lines2[0]) == 0;
+        }
+    });
+    std::cout << "=== Chip (" << groups[1].size() + groups[2].size() << " bytes of data groups, SHA-256 "
+              << (Sha256::isAccelerated() ? "SHA-NI" : "portable") << ") ===\n";
+    std::cout << "LdsDocument parse       : " << parseSeconds * 1e6 / chipCount << " us/chip (" << chipsParsed
+              << " parsed)\n";
+    std::cout << "LdsDocument::verify     : " << authenticateSeconds * 1e6 / chipCount << " us/chip ("
+              << authenticated << " authenticated)\n";
+    
+    // Pre-clearance throughput by thread count
+    VerificationSystem verifier;
+    OperatorSession session = verifier.openOperatorSession("SEC001");
+    std::vector<Passport> passports;
+    passports.reserve(recordCount);
+    for (size_t i = 0; i < recordCount; ++i) {
+        passports.emplace_back(lines1[i], lines2[i]);
+    }
+    std::vector<VerificationSystem::VerificationResult> results(recordCount);
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "=== Batch verification (" << recordCount << " passports) ===\n";
+    double singleSeconds = 0;
+    for (size_t threads = 1; threads <= cores; threads *= 2) {
+        double seconds = measureSeconds([&] {
+            verifier.verifyBatch(passports.data(), passports.size(), session, results.data(), threads);
+        });
+        singleSeconds = threads == 1 ? seconds : singleSeconds;
+        std::cout << threads << " thread(s): " << seconds * 1e9 / recordCount << " ns/passport, "
+                  << recordCount / seconds << " passports/s, speedup " << singleSeconds / seconds << "\n";
+    }
+    return parsedCount == recordCount ? 0 : 1;
+}
@@ -1,13 +1,15 @@
 #include "../include/Passport.h"
+#include "../include/MrzParser.h"
+#include "../include/MrzChecksum.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
-#include <ctime>
 
-Passport::Passport() {}
+Passport::Passport() : birthDay(MrzDate::INVALID), expiryDay(MrzDate::INVALID) {}
 
-Passport::Passport(const std::string& mrzLine1, const std::string& mrzLine2) {
+Passport::Passport(const std::string& mrzLine1, const std::string& mrzLine2) :
+    birthDay(MrzDate::INVALID), expiryDay(MrzDate::INVALID) {
     parseMRZ(mrzLine1, mrzLine2);
 }
 
@@ -16,76 +18,52 @@ bool Passport::parseMRZ(const std::string& mrzLine1, const std::string& mrzLine2
     this->mrzLine1 = mrzLine1;
     this->mrzLine2 = mrzLine2;
     
-    try {
-        // Parse MRZ according to ICAO 9303 standard
-        if (mrzLine1.length() >= 44 && mrzLine2.length() >= 44) {
-            // Line 1 parsing
-            documentType = mrzLine1.substr(0, 2);
-            issuingCountry = mrzLine1.substr(2, 3);
-            lastName = mrzLine1.substr(5, mrzLine1.find("<<", 5) - 5);
-            
-            // Handle names with multiple parts
-            size_t firstNameStart = mrzLine1.find("<<", 5) + 2;
-            firstName = mrzLine1.substr(firstNameStart, 39 - firstNameStart);
-            
-            // Replace '<' with spaces in names
-            std::replace(lastName.begin(), lastName.end(), '<', ' ');
-            std::replace(firstName.begin(), firstName.end(), '<', ' ');
-            
-            // Line 2 parsing
-            passportNumber = mrzLine2.substr(0, 9);
-            nationality = mrzLine2.substr(10, 3);
-            dateOfBirth = mrzLine2.substr(13, 6);
-            gender = mrzLine2.substr(20, 1);
-            expirationDate = mrzLine2.substr(21, 6);
-            countryCode = issuingCountry; // Usually same as issuing country
-            
-            return true;
-        }
-    } catch (...) {
+    // Parse MRZ according to ICAO 9303 standard (TD3, or TD2 by line length)
+    MrzFields fields;
+    if (!MrzParser::parse(this->mrzLine1, this->mrzLine2, fields)) {
         return false;
     }
     
-    return false;
-}
-
-bool Passport::validateMRZChecksum() const {
-    // Simplified checksum validation
-    // In a real implementation, this would check the actual MRZ check digits
+    // Line 1
+    MrzParser::assignField(documentType, fields.documentType);
+    MrzParser::assignField(issuingCountry, fields.issuingCountry);
+    MrzParser::assignField(lastName, fields.lastName);
+    MrzParser::assignField(firstName, fields.firstName);
+    
+    // Line 2
+    MrzParser::assignField(passportNumber, fields.documentNumber);
+    MrzParser::assignField(nationality, fields.nationality);
+    dateOfBirth.assign(fields.dateOfBirth.data(), fields.dateOfBirth.size());
+    MrzParser::assignField(gender, fields.gender);
+    expirationDate.assign(fields.expirationDate.data(), fields.expirationDate.size());
+    optionalData.assign(fields.optionalData.data(), fields.optionalData.size());
+    compositeCheckDigit.assign(1, fields.compositeCheck);
+    countryCode = issuingCountry; // Usually same as issuing country
+    
+    // Decode the dates once; later checks compare day numbers
+    int32_t today = CurrentDate::today();
+    birthDay = MrzDate::decode(fields.dateOfBirth, MrzDate::BIRTH, today);
+    expiryDay = MrzDate::decode(fields.expirationDate, MrzDate::EXPIRY, today);
+    
     return true;
 }
 
-bool Passport::validateDates() const {
-    // Check if dates are valid
-    if (dateOfBirth.length() != 6 || expirationDate.length() != 6) {
+bool Passport::validateMRZChecksum() const {
+    // Without the raw MRZ there are no check digits to verify
+    MrzFields fields;
+    if (!MrzParser::parse(mrzLine1, mrzLine2, fields)) {
         return false;
     }
     
-    // Simple date validation (format YYMMDD)
-    try {
-        int birthYear = std::stoi(dateOfBirth.substr(0, 2));
-        int birthMonth = std::stoi(dateOfBirth.substr(2, 2));
-        int birthDay = std::stoi(dateOfBirth.substr(4, 2));
-        
-        int expYear = std::stoi(expirationDate.substr(0, 2));
-        int expMonth = std::stoi(expirationDate.substr(2, 2));
-        int expDay = std::stoi(expirationDate.substr(4, 2));
-        
-        // Basic range checks
-        if (birthMonth < 1 || birthMonth > 12 || birthDay < 1 || birthDay > 31 ||
-            expMonth < 1 || expMonth > 12 || expDay < 1 || expDay > 31) {
-            return false;
-        }
-        
-        // Check if expiration date is after birth date
-        if (expYear < birthYear) {
-            return false;
-        }
-        
-        return true;
-    } catch (...) {
-        return false;
-    }
+    // Document number, birth date, expiry date, optional data and composite
+    return MrzChecksum::validate(fields) == 0;
+}
+
+bool Passport::validateDates() const {
+    // Both dates must exist (month lengths and leap years are checked when
+    // decoding) and the document must expire after the holder was born
+    return birthDay != MrzDate::INVALID && expiryDay != MrzDate::INVALID &&
+           expiryDay > birthDay;
 }
 
 bool Passport::isValid() const {
@@ -94,25 +72,7 @@ bool Passport::isValid() const {
 }
 
 bool Passport::isExpired() const {
-    // Get current date
-    time_t t = time(0);
-    tm* now = localtime(&t);
-    
-    int currentYear = now->tm_year % 100; // Last two digits of year
-    int currentMonth = now->tm_mon + 1;   // tm_mon is 0-11
-    int currentDay = now->tm_mday;
-    
-    // Extract expiration date components
-    int expYear = std::stoi(expirationDate.substr(0, 2));
-    int expMonth = std::stoi(expirationDate.substr(2, 2));
-    int expDay = std::stoi(expirationDate.substr(4, 2));
-    
-    // Compare dates (simplified)
-    if (expYear < currentYear) return true;
-    if (expYear > currentYear) return false;
-    if (expMonth < currentMonth) return true;
-    if (expMonth > currentMonth) return false;
-    return expDay < currentDay;
+    return isExpired(CurrentDate::today());
 }
 
 std::string Passport::toJSON() const {
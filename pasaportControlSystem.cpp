@@ -1,11 +1,44 @@
 #include "../include/PassportControlSystem.h"
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
 #include <memory>
+#include <thread>
+#include <future>
+#include <chrono>
 
-PassportControlSystem::PassportControlSystem() : systemActive(false) {
+namespace {
+    std::string describeChipFailures(unsigned failures) {
+        static const struct {
+            unsigned bit;
+            const char* text;
+        } REASONS[] = {
+            {LdsDocument::NO_SECURITY_OBJECT, "no security object"},
+            {LdsDocument::DIGEST_MISMATCH, "data group altered"},
+            {LdsDocument::UNSIGNED_GROUP, "unsigned data group"},
+            {LdsDocument::NO_MRZ, "no MRZ on chip"},
+            {LdsDocument::MRZ_MISMATCH, "chip MRZ differs from data page"},
+        };
+        std::string text;
+        for (const auto& reason : REASONS) {
+            if (failures & reason.bit) {
+                text += (text.empty() ? "" : ", ") + std::string(reason.text);
+            }
+        }
+        return text;
+    }
+}
+
+PassportControlSystem::PassportControlSystem() :
+    PassportControlSystem(std::make_unique<HardwareInterface>()) {}
+
+PassportControlSystem::PassportControlSystem(std::unique_ptr<HardwareInterface> devices) :
+    hardware(std::move(devices)), systemActive(false), pipelinedMode(false) {
     verifier = std::make_unique<VerificationSystem>();
-    logger = std::make_unique<Logger>("passport_system.log");
-    hardware = std::make_unique<HardwareInterface>();
+    // Booths log from several threads; keep file and console I/O off their path
+    logger = std::make_unique<Logger>("passport_system.log", Logger::ASYNCHRONOUS);
+    // Per-passenger records go to the binary log; decode with logdecoder
+    logger->enableBinaryLog("passport_system.blog");
 }
 
 PassportControlSystem::~PassportControlSystem() {
@@ -20,8 +53,39 @@ bool PassportControlSystem::initialize() {
         return false;
     }
     
-    // Initialize hardware
-    hardware->simulateHardwareConnection();
+    // Visa rules; without the file the built-in defaults stay active
+    if (!verifier->loadVisaRequirements()) {
+        logger->warning("Using built-in visa requirements");
+    }
+    if (!verifier->attachStolenDocumentIndex("stolen_documents.idx")) {
+        logger->warning("Lost/stolen document check disabled");
+    }
+    if (!verifier->loadWatchlist("watchlist.csv")) {
+        logger->warning("Watchlist screening disabled");
+    }
+    if (!verifier->attachFaceWatchlist("face_watchlist.idx")) {
+        logger->warning("Face watchlist screening disabled");
+    }
+    // Re-scanned documents (misreads, overrides) reuse their verdict
+    verifier->enableVerdictCache();
+    
+    // Initialize hardware; devices come up in parallel and only once.
+    // Scanning can start as soon as the scanner is ready, the camera and
+    // RFID reader are waited for on first use.
+    hardware->startHardwareInitialization();
+    if (!hardware->scannerReady().get()) {
+        logger->error("Document scanner failed to initialize");
+        return false;
+    }
+    
+    // In a real system the operator would sign in at the booth
+    if (!signInOperator("SEC001")) {
+        return false;
+    }
+    // Arriving flight, verified under the officer's session before landing
+    if (!loadManifest("passenger_manifest.csv")) {
+        logger->warning("Manifest pre-clearance disabled");
+    }
     
     systemActive = true;
     logger->info("Passport Control System initialized successfully");
@@ -44,28 +108,79 @@ bool PassportControlSystem::processPassport() {
     
     logger->info("Starting passport processing...");
     
-    // Scan passport
-    auto passport = scanPassport();
-    if (!passport) {
-        logger->error("Failed to scan passport");
-        return false;
+    DeviceReadings readings;
+    if (pipelinedMode) {
+        // Scan, photo and RFID run concurrently and are joined here
+        readings = runDevicePipeline();
+        if (!readings.passport) {
+            logger->error("Failed to scan passport");
+            return false;
+        }
+    } else {
+        // Scan passport
+        readings.passport = scanPassport();
+        if (!readings.passport) {
+            logger->error("Failed to scan passport");
+            return false;
+        }
+        
+        // Capture passenger photo
+        readings.photo = capturePassengerPhoto(readings.passport->getPassportNumber());
+        if (!readings.photo) {
+            logger->warning("Failed to capture passenger photo");
+            // Continue processing even if photo capture fails
+        }
+        
+        // Read RFID chip
+        readings.chip = readRFIDChip();
+        if (!readings.chip) {
+            logger->warning("Failed to read RFID chip");
+            // Continue processing even if RFID read fails
+        }
     }
+    const std::shared_ptr<Passport>& passport = readings.passport;
     
-    // Capture passenger photo
-    if (!capturePassengerPhoto(passport->getPassportNumber())) {
-        logger->warning("Failed to capture passenger photo");
-        // Continue processing even if photo capture fails
+    // Compare the passenger with the chip portrait; without either the
+    // document checks decide alone
+    double faceSimilarity = FaceMatcher::NOT_COMPARED;
+    FaceMatcher::Descriptor liveFace;
+    bool haveFace = false;
+    if (readings.photo && readings.chip) {
+        faceSimilarity = hardware->matchFace(readings.photo, *readings.chip, &liveFace);
+        haveFace = faceSimilarity > 0;
+        if (faceSimilarity == FaceMatcher::NOT_COMPARED) {
+            logger->warning("Face not compared: chip portrait unusable");
+        } else if (faceSimilarity < FaceMatcher::MATCH_THRESHOLD) {
+            logger->warning("Face does not match chip portrait (similarity " + std::to_string(faceSimilarity) + ")");
+        } else {
+            logger->info("Face matches chip portrait (similarity " + std::to_string(faceSimilarity) + ")");
+        }
     }
     
-    // Read RFID chip
-    if (!readRFIDChip()) {
-        logger->warning("Failed to read RFID chip");
-        // Continue processing even if RFID read fails
+    // Screen the live face against the face watchlist, aligned to the
+    // portrait when there is one
+    if (readings.photo && !haveFace) {
+        haveFace = hardware->describeFace(readings.photo, liveFace);
+    }
+    const bool faceListed = haveFace && screenFaceWatchlist(liveFace);
+    
+    // Passive authentication: the chip's data groups against its SOD and
+    // its MRZ against the scanned one
+    unsigned chipFailures = 0;
+    if (readings.chip) {
+        auto chipStart = std::chrono::steady_clock::now();
+        chipFailures = VerificationSystem::verifyChip(readings.chip->document, *passport);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - chipStart);
+        if (chipFailures == 0) {
+            logger->info("Chip authenticated in " + std::to_string(elapsed.count()) + " us");
+        } else {
+            logger->warning("Chip authentication failed: " + describeChipFailures(chipFailures));
+        }
     }
     
     // Verify passport
-    std::string personnelId = "SEC001"; // In a real system, this would be entered by operator
-    auto result = verifyPassport(*passport, personnelId);
+    auto result = verifyPassport(*passport, operatorSession, faceSimilarity, faceListed, chipFailures);
     
     // Log result
     switch (result) {
@@ -86,24 +201,141 @@ bool PassportControlSystem::processPassport() {
     return true;
 }
 
+bool PassportControlSystem::signInOperator(const std::string& personnelId) {
+    operatorSession = verifier->openOperatorSession(personnelId);
+    if (!operatorSession.isValid(PersonnelStore::now())) {
+        logger->error("Operator " + personnelId + " is not authorized");
+        return false;
+    }
+    
+    logger->info("Operator " + personnelId + " signed in");
+    return true;
+}
+
 VerificationSystem::VerificationResult PassportControlSystem::verifyPassport(
     const Passport& passport, const std::string& personnelId) {
     
     logger->info("Verifying passport for " + passport.getFirstName() + " " + passport.getLastName());
+    auto start = std::chrono::steady_clock::now();
     auto result = verifier->verifyPassport(passport, personnelId);
+    recordVerification(passport, result, start);
+    return result;
+}
+
+bool PassportControlSystem::loadManifest(const std::string& path) {
+    logger->info("Loading passenger manifest " + path + "...");
+    
+    auto next = std::make_unique<PassengerManifest>();
+    std::string error;
+    size_t skipped = 0;
+    if (!next->ingestFile(path, error, PassengerManifest::AUTO, &skipped)) {
+        logger->error("Failed to load passenger manifest: " + error);
+        return false;
+    }
+    if (skipped > 0) {
+        logger->warning(std::to_string(skipped) + " malformed manifest records skipped");
+    }
+    if (!next->verify(*verifier, operatorSession)) {
+        logger->error("Passenger manifest not verified: no valid operator session");
+        return false;
+    }
+    
+    logger->info("Passenger manifest verified: " + std::to_string(next->size()) + " passengers");
+    manifest.publish(next.release());
+    return true;
+}
+
+PassengerManifest::Statistics PassportControlSystem::getManifestStatistics() const {
+    EpochManager::Guard guard = EpochManager::instance().pin();
+    const PassengerManifest* current = manifest.load();
+    return current ? current->getStatistics() : PassengerManifest::Statistics{0, 0, 0, 0};
+}
+
+VerificationSystem::VerificationResult PassportControlSystem::verifyPassport(
+    const Passport& passport, const OperatorSession& session, double faceSimilarity, bool faceListed,
+    unsigned chipFailures) {
+    
+    logger->info("Verifying passport for " + passport.getFirstName() + " " + passport.getLastName());
+    auto start = std::chrono::steady_clock::now();
+    
+    // Passengers on the manifest were verified before landing; the booth
+    // only confirms the document is the listed one and its holder
+    if (session.isValid(PersonnelStore::now())) {
+        uint64_t ruleDataVersion = verifier->getRuleDataVersion();
+        EpochManager::Guard guard = EpochManager::instance().pin();
+        const PassengerManifest* current = manifest.load();
+        VerificationSystem::VerificationResult result;
+        if (current && current->lookup(passport, ruleDataVersion, CurrentDate::today(), result) ==
+                           PassengerManifest::CONFIRMED) {
+            logger->info("Passenger pre-cleared on manifest: " + passport.getPassportNumber());
+            result = VerificationSystem::applyFaceMatch(result, faceSimilarity);
+            if (faceListed && result == VerificationSystem::APPROVED) {
+                result = VerificationSystem::MANUAL_REVIEW;
+            }
+            result = VerificationSystem::applyChipCheck(result, chipFailures);
+            recordVerification(passport, result, start);
+            return result;
+        }
+    }
+    
+    auto result = verifier->verifyPassport(passport, session, faceSimilarity);
+    if (result == VerificationSystem::DENIED && !session.isValid(PersonnelStore::now())) {
+        logger->warning("Operator session for " + session.getPersonnelId() + " is no longer valid");
+    }
+    // Like a name watchlist hit, a face hit goes to an officer
+    if (faceListed && result == VerificationSystem::APPROVED) {
+        result = VerificationSystem::MANUAL_REVIEW;
+    }
+    result = VerificationSystem::applyChipCheck(result, chipFailures);
+    recordVerification(passport, result, start);
+    return result;
+}
+
+bool PassportControlSystem::screenFaceWatchlist(const FaceMatcher::Descriptor& face) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<VerificationSystem::FaceCandidate> candidates;
+    const bool hit = verifier->screenFaceWatchlist(face, candidates);
+    if (candidates.empty()) {
+        return false;
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::string summary;
+    for (const auto& candidate : candidates) {
+        summary += (summary.empty() ? "" : ", ") + candidate.id + " " + std::to_string(candidate.score);
+    }
+    if (hit) {
+        logger->warning("Face watchlist hit: " + summary);
+    } else {
+        logger->debug("Face watchlist candidates (" + std::to_string(elapsed.count()) + " us): " + summary);
+    }
+    return hit;
+}
+
+void PassportControlSystem::recordVerification(const Passport& passport,
+                                               VerificationSystem::VerificationResult result,
+                                               std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    logger->logBinary(Logger::INFO, MSG_VERIFICATION_RESULT, passport.getPassportNumber(),
+                      static_cast<int>(result), static_cast<int64_t>(elapsed.count()));
     
     // Log verification details
     logger->debug("Passport Number: " + passport.getPassportNumber());
     logger->debug("Nationality: " + passport.getNationality());
     logger->debug("Expiration Date: " + passport.getExpirationDate());
-    
-    return result;
 }
 
 std::shared_ptr<Passport> PassportControlSystem::scanPassport() {
     logger->info("Scanning passport document...");
     
     auto scanData = hardware->scanDocument();
+    if (!scanData) {
+        // E-gates can read the MRZ from the camera instead
+        logger->warning("Document scanner failed, reading MRZ from camera");
+        scanData = hardware->readMrzFromImage(hardware->captureDocumentImage());
+    }
     if (!scanData) {
         logger->error("Failed to scan document");
         return nullptr;
@@ -119,36 +351,97 @@ std::shared_ptr<Passport> PassportControlSystem::scanPassport() {
     return passport;
 }
 
-bool PassportControlSystem::capturePassengerPhoto(const std::string& passportNumber) {
+PassportControlSystem::DeviceReadings PassportControlSystem::runDevicePipeline() {
+    auto start = std::chrono::steady_clock::now();
+    
+    std::shared_future<std::shared_ptr<Passport>> scanFuture =
+        std::async(std::launch::async, [this] { return scanPassport(); }).share();
+    
+    // The photo can be taken while the document is still being scanned;
+    // only the file name has to wait for the passport number
+    auto photoFuture = std::async(std::launch::async, [this, scanFuture] {
+        logger->info("Capturing passenger photo...");
+        auto image = hardware->captureImage();
+        if (!image) {
+            logger->error("Failed to capture passenger photo");
+            return image;
+        }
+        auto passport = scanFuture.get();
+        if (passport) {
+            savePassengerPhoto(image, passport->getPassportNumber());
+        }
+        return image;
+    });
+    
+    auto rfidFuture = std::async(std::launch::async, [this] { return readRFIDChip(); });
+    
+    DeviceReadings readings;
+    readings.passport = scanFuture.get();
+    readings.photo = photoFuture.get();
+    readings.chip = rfidFuture.get();
+    
+    if (readings.passport && !readings.photo) {
+        logger->warning("Failed to capture passenger photo");
+        // Continue processing even if photo capture fails
+    }
+    if (readings.passport && !readings.chip) {
+        logger->warning("Failed to read RFID chip");
+        // Continue processing even if RFID read fails
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    logger->logBinary(Logger::DEBUG, MSG_DEVICE_STAGES, static_cast<int64_t>(elapsed.count()));
+    return readings;
+}
+
+HardwareInterface::CameraImage PassportControlSystem::capturePassengerPhoto(const std::string& passportNumber) {
     logger->info("Capturing passenger photo...");
     
     auto image = hardware->captureImage();
     if (!image) {
         logger->error("Failed to capture passenger photo");
-        return false;
+        return image;
     }
     
-    std::string filename = "photo_" + passportNumber + ".jpg";
-    if (!hardware->saveImage(*image, filename)) {
+    // A photo that could not be queued is still good for the face check
+    savePassengerPhoto(image, passportNumber);
+    return image;
+}
+
+bool PassportControlSystem::savePassengerPhoto(const HardwareInterface::CameraImage& image,
+                                               const std::string& passportNumber) {
+    // The booth moves on once the photo is queued; every visit is kept
+    Logger* log = logger.get();
+    std::future<bool> queued = hardware->saveImage(image, passportNumber,
+        [log, passportNumber](bool stored, const std::string& contentId) {
+            if (stored) {
+                log->info("Passenger photo for " + passportNumber + " stored as " + contentId);
+            } else {
+                log->error("Failed to store passenger photo for " + passportNumber);
+            }
+        });
+    // Only an empty image is refused before it reaches the writer
+    if (queued.wait_for(std::chrono::seconds(0)) == std::future_status::ready && !queued.get()) {
         logger->error("Failed to save passenger photo");
         return false;
     }
     
-    logger->info("Passenger photo captured and saved as " + filename);
+    logger->info("Passenger photo captured and queued for storage");
     return true;
 }
 
-bool PassportControlSystem::readRFIDChip() {
+std::shared_ptr<HardwareInterface::RFIDData> PassportControlSystem::readRFIDChip() {
     logger->info("Reading RFID chip...");
     
     auto rfidData = hardware->readRFIDChip();
     if (!rfidData) {
         logger->error("Failed to read RFID chip");
-        return false;
+        return nullptr;
     }
     
     logger->info("RFID chip read successfully");
-    return true;
+    return rfidData;
 }
 
 void PassportControlSystem::generateReport() const {
@@ -158,6 +451,31 @@ void PassportControlSystem::generateReport() const {
     std::cout << "System Status: " << (systemActive ? "ACTIVE" : "INACTIVE") << "\n";
     std::cout << "Hardware Status: CONNECTED\n";
     std::cout << "Logs saved to: passport_system.log\n";
+    std::cout << "Verification rules (in evaluation order):\n";
+    auto rules = verifier->getRuleStatistics();
+    std::sort(rules.begin(), rules.end(), [](const auto& a, const auto& b) { return a.position < b.position; });
+    for (const auto& rule : rules) {
+        std::cout << "  " << rule.name << ": " << rule.evaluations << " run, " << rule.rejections
+                  << " rejected, " << rule.averageNanoseconds << " ns avg\n";
+    }
+    auto cache = verifier->getVerdictCacheStatistics();
+    std::cout << "Verdict cache: " << cache.hits << " hits, " << cache.misses << " misses ("
+              << cache.invalidated << " invalidated, " << cache.expired << " expired), "
+              << cache.size << " entries\n";
+    auto frames = hardware->getFramePoolStatistics();
+    std::cout << "Camera frames: " << frames.acquisitions << " captured, peak " << frames.peakInUse << " of "
+              << frames.capacity << " pooled in use, " << frames.exhausted << " beyond the pool\n";
+    auto images = hardware->getImageStoreStatistics();
+    std::cout << "Photo storage: " << images.written << " written, " << images.duplicates << " duplicates, "
+              << images.failed << " failed, " << images.pending << " pending, " << images.batches << " batches\n";
+    auto manifestStats = getManifestStatistics();
+    std::cout << "Passenger manifest: " << manifestStats.lookups << " lookups, " << manifestStats.confirmed
+              << " pre-cleared, " << manifestStats.mismatched << " mismatched, " << manifestStats.stale
+              << " stale\n";
+    auto faceStats = verifier->getFaceWatchlistStatistics();
+    std::cout << "Face watchlist: " << verifier->getFaceWatchlistSize() << " faces, " << faceStats.searches
+              << " searches, p50 " << faceStats.p50Microseconds << " us, p99 " << faceStats.p99Microseconds
+              << " us\n";
     std::cout << "=====================================\n";
 }
 
@@ -176,3 +494,49 @@ void PassportControlSystem::runSimulation() {
     
     logger->info("Simulation completed");
 }
+
+void PassportControlSystem::runLaneSimulation(size_t laneCount, size_t passengerCount) {
+    logger->info("Starting lane simulation with " + std::to_string(laneCount) + " lanes and " +
+                 std::to_string(passengerCount) + " passengers...");
+    
+    LaneScheduler scheduler(laneCount);
+    scheduler.start();
+    
+    for (size_t i = 0; i < passengerCount; ++i) {
+        // Simulated passenger mix: a few crew and diplomats, some e-gate users
+        LaneScheduler::PriorityClass priority = LaneScheduler::STANDARD;
+        if (i % 20 == 0) {
+            priority = LaneScheduler::CREW;
+        } else if (i % 25 == 0) {
+            priority = LaneScheduler::DIPLOMATIC;
+        } else if (i % 3 == 0) {
+            priority = LaneScheduler::EGATE;
+        }
+        
+        // Every lane works the same HardwareInterface; it is safe to call
+        // from several lanes at once
+        scheduler.submit(i % laneCount, priority, [this] { return processPassport(); });
+    }
+    
+    scheduler.waitIdle();
+    scheduler.stop();
+    
+    auto stats = scheduler.getStatistics();
+    std::cout << "=== Lane Scheduler Report ===\n";
+    std::cout << "Lanes: " << stats.laneCount << ", Workers: " << stats.workerCount
+              << ", Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    std::cout << "Passengers processed: " << stats.processed << " (" << stats.succeeded
+              << " succeeded, " << stats.stolen << " served by another lane)\n";
+    for (size_t i = 0; i < stats.processedPerClass.size(); ++i) {
+        std::cout << "  " << LaneScheduler::priorityToString(static_cast<LaneScheduler::PriorityClass>(i))
+                  << ": " << stats.processedPerClass[i] << "\n";
+    }
+    std::cout << std::fixed << std::setprecision(2)
+              << "Elapsed: " << stats.elapsedSeconds << " s, Throughput: "
+              << stats.passengersPerSecond << " passengers/s\n";
+    std::cout << "=============================\n";
+    
+    logger->logBinary(Logger::INFO, MSG_LANE_REPORT, stats.processed, stats.elapsedSeconds,
+                      stats.passengersPerSecond);
+    logger->info("Lane simulation completed");
+}
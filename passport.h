@@ -1,6 +1,8 @@
 #ifndef PASSPORT_H
 #define PASSPORT_H
 
+#include "MrzDate.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -24,6 +26,10 @@ private:
     std::string passportIdentifier;
     std::string optionalData;
     std::string compositeCheckDigit;
+    
+    // Dates decoded once as day numbers (MrzDate::INVALID if malformed)
+    int32_t birthDay;
+    int32_t expiryDay;
 
 public:
     Passport();
@@ -42,15 +48,24 @@ public:
     std::string getMrzLine2() const { return mrzLine2; }
     std::string getDocumentType() const { return documentType; }
     std::string getCountryCode() const { return countryCode; }
+    int32_t getBirthDay() const { return birthDay; }
+    int32_t getExpiryDay() const { return expiryDay; }
     
     // Setters
+    void setDocumentType(const std::string& type) { documentType = type; }
     void setPassportNumber(const std::string& number) { passportNumber = number; }
     void setFirstName(const std::string& name) { firstName = name; }
     void setLastName(const std::string& name) { lastName = name; }
     void setNationality(const std::string& nation) { nationality = nation; }
-    void setDateOfBirth(const std::string& dob) { dateOfBirth = dob; }
+    void setDateOfBirth(const std::string& dob) {
+        dateOfBirth = dob;
+        birthDay = MrzDate::decode(dob, MrzDate::BIRTH);
+    }
     void setGender(const std::string& g) { gender = g; }
-    void setExpirationDate(const std::string& exp) { expirationDate = exp; }
+    void setExpirationDate(const std::string& exp) {
+        expirationDate = exp;
+        expiryDay = MrzDate::decode(exp, MrzDate::EXPIRY);
+    }
     void setIssuingCountry(const std::string& country) { issuingCountry = country; }
     
     // MRZ Processing
@@ -61,6 +76,7 @@ public:
     // Validation
     bool isValid() const;
     bool isExpired() const;
+    bool isExpired(int32_t today) const { return expiryDay == MrzDate::INVALID || expiryDay < today; }
     
     // Utility
     std::string toJSON() const;
@@ -0,0 +1,102 @@
+#include "../include/StolenDocumentIndex.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Offline builder for the lost/stolen document index read by
+// VerificationSystem::attachStolenDocumentIndex().
+//
+//   stolen_index_builder <input.csv> <output.idx>
+//   stolen_index_builder --synthetic <key count> <output.idx>
+//
+// After building, the index is opened and lookup latency is measured for
+// clean documents and for listed ones.
+
+namespace {
+    uint64_t randomKey(std::mt19937_64& rng) {
+        static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        static const char* countries[] = {"USA", "DEU", "FRA", "GBR", "TUR", "NLD", "CAN", "AUS"};
+        char number[9];
+        for (char& c : number) {
+            c = alphabet[rng() % 36];
+        }
+        return StolenDocumentIndex::makeKey(countries[rng() % 8], std::string_view(number, 9));
+    }
+
+    double measureLookups(const StolenDocumentIndex& index, const std::vector<uint64_t>& probes, size_t& hits) {
+        hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t key : probes) {
+            hits += index.contains(key) ? 1 : 0;
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        return elapsed.count() / static_cast<double>(probes.size());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || (std::string(argv[1]) == "--synthetic" && argc < 4)) {
+        std::cerr << "Usage: stolen_index_builder <input.csv> <output.idx>\n"
+                  << "       stolen_index_builder --synthetic <key count> <output.idx>\n";
+        return 1;
+    }
+
+    std::string error;
+    std::string output;
+    std::mt19937_64 rng(20240601);
+    std::vector<uint64_t> sample;   // listed keys to probe afterwards
+
+    auto buildStart = std::chrono::steady_clock::now();
+    if (std::string(argv[1]) == "--synthetic") {
+        output = argv[3];
+        size_t count = std::stoul(argv[2]);
+        std::vector<uint64_t> keys;
+        keys.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back(randomKey(rng));
+        }
+        for (size_t i = 0; i < keys.size() && sample.size() < 100000; i += keys.size() / 100000 + 1) {
+            sample.push_back(keys[i]);
+        }
+        if (!StolenDocumentIndex::build(std::move(keys), output, error)) {
+            std::cerr << "Build failed: " << error << "\n";
+            return 1;
+        }
+    } else {
+        output = argv[2];
+        size_t skipped = 0;
+        if (!StolenDocumentIndex::buildFromCsv(argv[1], output, error, &skipped)) {
+            std::cerr << "Build failed: " << error << "\n";
+            return 1;
+        }
+        if (skipped > 0) {
+            std::cerr << "Skipped " << skipped << " malformed lines\n";
+        }
+    }
+    auto buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    StolenDocumentIndex index;
+    if (!index.open(output, error)) {
+        std::cerr << "Cannot open built index: " << error << "\n";
+        return 1;
+    }
+    std::cout << "Built " << output << ": " << index.getKeyCount() << " documents in "
+              << buildSeconds << " s" << (index.isMapped() ? " (memory-mapped)" : "") << "\n";
+
+    std::vector<uint64_t> clean(1000000);
+    for (uint64_t& key : clean) {
+        key = randomKey(rng);
+    }
+    size_t hits = 0;
+    double cleanNs = measureLookups(index, clean, hits);
+    std::cout << "Clean lookups: " << cleanNs << " ns each, " << hits << " of " << clean.size()
+              << " reported (false positives or listed)\n";
+
+    if (!sample.empty()) {
+        double listedNs = measureLookups(index, sample, hits);
+        std::cout << "Listed lookups: " << listedNs << " ns each, " << hits << " of " << sample.size() << " found\n";
+    }
+    return 0;
+}
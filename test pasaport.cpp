@@ -1,5 +1,43 @@
 #include "../include/Passport.h"
 #include "../include/Logger.h"
+#include "../include/MrzParser.h"
+#include "../include/MrzChecksum.h"
+#include "../include/MrzCharset.h"
+#include "../include/MrzCorrector.h"
+#include "../include/MrzReader.h"
+#include "../include/PassportRecord.h"
+#include "../include/VerificationSystem.h"
+#include "../include/VerificationPipeline.h"
+#include "../include/VerdictCache.h"
+#include "../include/StolenDocumentIndex.h"
+#include "../include/NameWatchlist.h"
+#include "../include/PassengerManifest.h"
+#include "../include/FramePool.h"
+#include "../include/ImageStore.h"
+#include "../include/FaceMatcher.h"
+#include "../include/FaceWatchlistIndex.h"
+#include "../include/Sha256.h"
+#include "../include/BerTlv.h"
+#include "../include/LdsDocument.h"
+#include "../include/BinaryLogReader.h"
+#include "../include/LaneScheduler.h"
+#include "../include/PassportControlSystem.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include <cassert>
 
@@ -11,8 +49,8 @@ void testPassportCreation() {
     assert(!p1.isValid());
     
     // Test MRZ parsing
-    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<";
-    std::string mrz2 = "P12345678<8USA800101<M251231<<<<<<<<<<";
+    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    std::string mrz2 = "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8";
     
     Passport p2(mrz1, mrz2);
     
@@ -31,8 +69,8 @@ void testPassportCreation() {
 void testJSONOutput() {
     std::cout << "Testing JSON Output...\n";
     
-    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<";
-    std::string mrz2 = "P12345678<8USA800101<M251231<<<<<<<<<<";
+    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    std::string mrz2 = "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8";
     
     Passport p(mrz1, mrz2);
     std::string json = p.toJSON();
@@ -48,8 +86,8 @@ void testJSONOutput() {
 void testXMLOutput() {
     std::cout << "Testing XML Output...\n";
     
-    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<";
-    std::string mrz2 = "P12345678<8USA800101<M251231<<<<<<<<<<";
+    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    std::string mrz2 = "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8";
     
     Passport p(mrz1, mrz2);
     std::string xml = p.toXML();
@@ -65,27 +103,2212 @@ void testXMLOutput() {
 void testValidation() {
     std::cout << "Testing Validation...\n";
     
-    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<";
-    std::string mrz2 = "P12345678<8USA800101<M251231<<<<<<<<<<";
+    std::string mrz1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    std::string mrz2 = "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8";
     
     Passport p(mrz1, mrz2);
     
     // Valid passport should pass validation
     assert(p.isValid());
     
-    // Check if passport is expired (depends on current date)
-    // This test might fail in the future when the passport expires
-    assert(!p.isExpired()); // Assuming current date is before 2025-12-31
+    // Check if passport is expired; "today" is pinned so the result does
+    // not depend on when the test runs
+    CurrentDate::setOverride(MrzDate::daysFromCivil(2025, 6, 1));
+    assert(!p.isExpired()); // Current date is before 2025-12-31
+    CurrentDate::setOverride(MrzDate::daysFromCivil(2026, 1, 1));
+    assert(p.isExpired());
+    CurrentDate::clearOverride();
     
     std::cout << "✓ Validation tests passed\n";
 }
 
+void testMrzParser() {
+    std::cout << "Testing MRZ Parser...\n";
+    
+    // TD3 with multi-part names
+    MrzFields td3;
+    assert(MrzParser::parse("P<NLDVAN<DER<BERG<<ANNA<MARIA<<<<<<<<<<<<<<<",
+                            "XN01234565NLD8507192F3001019<<<<<<<<<<<<<<<6", td3));
+    assert(td3.layout == MrzFields::TD3);
+    assert(td3.lastName == "VAN<DER<BERG");
+    assert(td3.firstName == "ANNA<MARIA");
+    assert(td3.documentNumber == "XN0123456");
+    assert(td3.documentNumberCheck == '5');
+    assert(td3.expirationDate == "300101");
+    assert(td3.compositeCheck == '6');
+    
+    char name[40];
+    assert(MrzParser::copyField(td3.lastName, name, sizeof(name)) == 12);
+    assert(std::string(name) == "VAN DER BERG");
+    
+    // TD1 identity card
+    MrzFields td1;
+    assert(MrzParser::parse("I<UTOD231458907<<<<<<<<<<<<<<<",
+                            "7408122F1204159UTO<<<<<<<<<<<6",
+                            "ERIKSSON<<ANNA<MARIA<<<<<<<<<<", td1));
+    assert(td1.layout == MrzFields::TD1);
+    assert(td1.documentNumber == "D23145890");
+    assert(td1.nationality == "UTO");
+    assert(td1.lastName == "ERIKSSON");
+    
+    // Wrong line lengths are rejected
+    MrzFields bad;
+    assert(!MrzParser::parse("P<USASMITH<<JOHN", "P12345678", bad));
+    
+    // Batch parsing from one buffer, skipping a malformed record
+    std::string buffer =
+        "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<\r\n"
+        "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8\r\n"
+        "\n"
+        "P<USATRUNCATED\n"
+        "P12345678\n"
+        "P<NLDVAN<DER<BERG<<ANNA<MARIA<<<<<<<<<<<<<<<\n"
+        "XN01234565NLD8507192F3001019<<<<<<<<<<<<<<<6\n";
+    MrzFields batch[4];
+    size_t skipped = 0;
+    assert(MrzParser::parseBatch(buffer, batch, 4, &skipped) == 2);
+    assert(skipped == 1);
+    assert(batch[0].documentNumber == "P12345678");
+    assert(batch[1].nationality == "NLD");
+    
+    std::cout << "✓ MRZ parser tests passed\n";
+}
+
+void testMrzChecksum() {
+    std::cout << "Testing MRZ Checksum...\n";
+    
+    // ICAO 9303 specimen
+    assert(MrzChecksum::computeCheckDigit("L898902C3") == 6);
+    assert(MrzChecksum::computeCheckDigit("740812") == 2);
+    assert(MrzChecksum::computeCheckDigit("120415") == 9);
+    assert(MrzChecksum::computeCheckDigit("ab1") == -1);
+    
+    std::string specimen1 = "P<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<";
+    std::string specimen2 = "L898902C36UTO7408122F1204159ZE184226B<<<<<10";
+    MrzFields fields;
+    assert(MrzParser::parse(specimen1, specimen2, fields));
+    assert(MrzChecksum::validate(fields) == 0);
+    assert(MrzChecksum::validateTD3Line(specimen2) == 0);
+    
+    // A single wrong digit is caught by its field and the composite
+    std::string tampered = specimen2;
+    tampered[15] = '5';
+    assert(MrzChecksum::validateTD3Line(tampered) ==
+           (MrzChecksum::DATE_OF_BIRTH | MrzChecksum::COMPOSITE));
+    
+    Passport valid(specimen1, specimen2);
+    assert(valid.validateMRZChecksum());
+    Passport invalid(specimen1, tampered);
+    assert(!invalid.validateMRZChecksum());
+    
+    // Batch kernel agrees with the scalar path
+    std::vector<std::string> lines = {specimen2, tampered,
+                                      "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8",
+                                      "P123456789USA8001014M2512314<<<<<<<<<<<<<<<9",
+                                      "P12345678 USA8001014M2512314<<<<<<<<<<<<<<<8",
+                                      "P123456789USA8001014M2512314<<<<<<<<<<<<<<<?"};
+    std::string packed;
+    for (const auto& line : lines) {
+        packed += line;
+    }
+    std::vector<uint8_t> failures(lines.size());
+    MrzChecksum::validateTD3Batch(packed.data(), lines.size(), 44, failures.data());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        assert(failures[i] == MrzChecksum::validateTD3Line(lines[i]));
+    }
+    assert(failures[2] == 0);
+    assert(failures[3] == MrzChecksum::COMPOSITE);
+    assert(failures[4] & MrzChecksum::INVALID_CHARACTER);
+    // A bad composite digit is an invalid character too, on every path
+    assert(failures[5] == (MrzChecksum::INVALID_CHARACTER | MrzChecksum::COMPOSITE));
+    MrzFields badComposite;
+    assert(MrzParser::parse(specimen1, lines[5], badComposite));
+    assert(MrzChecksum::validate(badComposite) == failures[5]);
+    std::cout << "Batch kernel: " << MrzChecksum::getBatchKernel() << "\n";
+    
+    std::cout << "✓ MRZ checksum tests passed\n";
+}
+
+void testMrzCharset() {
+    std::cout << "Testing MRZ Charset...\n";
+    
+    std::string line1 = "P<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<";
+    std::string line2 = "L898902C36UTO7408122F1204159ZE184226B<<<<<10";
+    MrzCharset::Violation violation;
+    assert(MrzCharset::check(line1, line2, violation) && violation.line == -1);
+    assert(MrzCharset::check(line2, MrzFields::TD3, 1) == MrzCharset::VALID);
+    
+    // Valid MRZ characters in the wrong field are reported at their offset
+    std::string letterInDate = line2;
+    letterInDate[15] = 'O';
+    assert(MrzCharset::check(letterInDate, MrzFields::TD3, 1) == 15);
+    std::string digitInName = line1;
+    digitInName[7] = '0';
+    assert(!MrzCharset::check(digitInName, line2, violation) && violation.line == 0 && violation.offset == 7);
+    std::string fillerCheckDigit = line2;
+    fillerCheckDigit[9] = '<';
+    assert(MrzCharset::check(fillerCheckDigit, MrzFields::TD3, 1) == 9);
+    std::string lowercase = line2;
+    lowercase[40] = 'b';
+    assert(!MrzCharset::check(line1, lowercase, violation) && violation.line == 1 && violation.offset == 40);
+    
+    // Shifted or truncated lines
+    assert(MrzCharset::check(line2.substr(1) + "<", MrzFields::TD3, 1) != MrzCharset::VALID);
+    assert(MrzCharset::check(line1.substr(0, 30), MrzFields::TD3, 0) == 30);
+    assert(MrzCharset::check(line1 + "<", MrzFields::TD3, 0) == 44);
+    
+    // TD1 and TD2 layouts (ICAO 9303 specimens)
+    assert(MrzCharset::check("I<UTOD231458907<<<<<<<<<<<<<<<", "7408122F1204159UTO<<<<<<<<<<<6",
+                             "ERIKSSON<<ANNA<MARIA<<<<<<<<<<", violation));
+    assert(MrzCharset::check("I<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<",
+                             "D231458907UTO7408122F1204159<<<<<<<6", violation));
+    
+    // Decoded fields
+    assert(MrzCharset::isFieldText("VAN DER BERG"));
+    assert(!MrzCharset::isFieldText("SMITH;"));
+    
+    VerificationSystem verifier;
+    Passport valid("P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+                   "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(!verifier.detectCounterfeit(valid));
+    
+    std::cout << "✓ MRZ charset tests passed\n";
+}
+
+void testMrzReader() {
+    std::cout << "Testing MRZ Reader...\n";
+    
+    const int width = 1920, height = 1080;
+    std::vector<unsigned char> frame(static_cast<size_t>(width) * height * 3, 0xE8);
+    std::vector<std::string> td3 = {"P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+                                    "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6"};
+    // Printed page text above the MRZ must not be taken for it
+    assert(MrzReader::render({"PASSPORT", "UNITED STATES OF AMERICA"}, frame.data(), width, height, 3, 3, 200, 300));
+    assert(MrzReader::render(td3, frame.data(), width, height, 3, 4, 400, 900));
+    assert(!MrzReader::render({"lower case"}, frame.data(), width, height, 3, 4, 0, 0));
+    assert(!MrzReader::render(td3, frame.data(), width, height, 3, 4, 1000, 900)); // does not fit
+    
+    MrzReader reader;
+    MrzReader::Result result = reader.read(frame.data(), width, height, 3);
+    assert(result.found && result.lineCount == 2);
+    assert(result.lines[0] == td3[0] && result.lines[1] == td3[1]);
+    assert(result.confidence == 1.0 && result.uncertainCharacters == 0);
+    
+    // Sensor noise: 2% of the pixels flipped
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<size_t> pixel(0, static_cast<size_t>(width) * height - 1);
+    for (int i = 0; i < width * height / 50; ++i) {
+        size_t p = pixel(generator) * 3;
+        unsigned char value = frame[p] < 128 ? 0xE8 : 0x10;
+        frame[p] = frame[p + 1] = frame[p + 2] = value;
+    }
+    result = reader.read(frame.data(), width, height, 3);
+    assert(result.found && result.lines[0] == td3[0] && result.lines[1] == td3[1]);
+    assert(result.confidence < 1.0);
+    
+    // TD1 on a grayscale frame, covering every glyph
+    std::vector<std::string> td1 = {"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123",
+                                    "456789<<<<<<<<<<<<<<<<<<<<<<<<",
+                                    "I<UTOD231458907<<<<<<<<<<<<<<<"};
+    std::vector<unsigned char> gray(640 * 240, 0xFF);
+    assert(MrzReader::render(td1, gray.data(), 640, 240, 1, 2, 20, 100));
+    result = reader.read(gray.data(), 640, 240, 1);
+    assert(result.found && result.lineCount == 3);
+    for (size_t i = 0; i < 3; ++i) {
+        assert(result.lines[i] == td1[i]);
+    }
+    
+    // TD2 lines are 36 characters
+    std::vector<std::string> td2 = {"I<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<",
+                                    "D231458907UTO7408122F1204159<<<<<<<6"};
+    std::fill(gray.begin(), gray.end(), 0xFF);
+    assert(MrzReader::render(td2, gray.data(), 640, 240, 1, 2, 40, 150));
+    result = reader.read(gray.data(), 640, 240, 1);
+    assert(result.found && result.lineCount == 2 && result.lines[0] == td2[0] && result.lines[1] == td2[1]);
+    
+    // Nothing to read
+    std::fill(gray.begin(), gray.end(), 0xFF);
+    assert(!reader.read(gray.data(), 640, 240, 1).found);
+    assert(!reader.read(nullptr, 640, 240, 1).found);
+    
+    std::cout << "✓ MRZ reader tests passed\n";
+}
+
+void testMrzCorrector() {
+    std::cout << "Testing MRZ Corrector...\n";
+    
+    const std::string line1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    const std::string line2 = "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6";
+    assert(MrzCorrector::lookAlike('0') == 'O' && MrzCorrector::lookAlike('B') == '8');
+    assert(MrzCorrector::lookAlike('A') == '\0' && MrzCorrector::lookAlike('<') == '\0');
+    
+    // A clean read is left alone
+    MrzCorrector::Result result = MrzCorrector::correct(line1 + "\n" + line2);
+    assert(result.valid && result.layout == MrzFields::TD3 && result.lineCount == 2);
+    assert(result.corrections == 0 && result.confidence == 1.0 && result.failures == 0);
+    assert(result.lines[0] == line1 && result.lines[1] == line2);
+    
+    // Wrong class: digits in the name, letters in the dates
+    result = MrzCorrector::correct("P<USASM1TH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<\r\n"
+                                   "P123456789USA80O1O14M3O12316<<<<<<<<<<<<<<<6");
+    assert(result.valid && result.corrections == 4);
+    assert(result.lines[0] == line1 && result.lines[1] == line2);
+    assert(result.confidence < 1.0 && result.confidence > 0.9);
+    
+    // Letters are allowed in the document number; the check digit finds
+    // the misread ones, one or two per field
+    result = MrzCorrector::correct(line1 + "\nP1234S6789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(result.valid && result.corrections == 1 && result.lines[1] == line2);
+    result = MrzCorrector::correct(line1 + "\nP1234S67B9USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(result.valid && result.corrections == 2 && result.lines[1] == line2);
+    assert(result.confidence < MrzCorrector::CHECK_DIGIT_REPAIR_CONFIDENCE);
+    
+    // A wrong digit no look-alike explains is not guessed at
+    result = MrzCorrector::correct(line1 + "\nP127456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(!result.valid && result.confidence == 0.0);
+    assert(result.failures & MrzChecksum::DOCUMENT_NUMBER);
+    result = MrzCorrector::correct(line1 + "\nP123456789USA80010#4M3012316<<<<<<<<<<<<<<<6");
+    assert(!result.valid && (result.failures & MrzChecksum::INVALID_CHARACTER));
+    
+    // TD1, three lines
+    const std::string td1[3] = {"I<UTOD231458907<<<<<<<<<<<<<<<",
+                                "7408122F1204159UTO<<<<<<<<<<<6",
+                                "ERIKSSON<<ANNA<MARIA<<<<<<<<<<"};
+    result = MrzCorrector::correct("I<UTOD23I458907<<<<<<<<<<<<<<<\n"
+                                   "74O8122F12O4159UTO<<<<<<<<<<<6\n"
+                                   "ERIKSS0N<<ANNA<MARIA<<<<<<<<<<");
+    assert(result.valid && result.layout == MrzFields::TD1 && result.lineCount == 3);
+    assert(result.corrections == 4);
+    for (size_t i = 0; i < 3; ++i) {
+        assert(result.lines[i] == td1[i]);
+    }
+    
+    // Not an MRZ
+    assert(!MrzCorrector::correct(td1[0] + "\n" + td1[1]).valid);
+    assert(!MrzCorrector::correct(line1 + "\n" + line2.substr(1)).valid);
+    assert(!MrzCorrector::correct("").valid);
+    
+    std::cout << "✓ MRZ corrector tests passed\n";
+}
+
+void testPassportRecord() {
+    std::cout << "Testing Passport Record...\n";
+    
+    assert(packCountryCode("USA") != INVALID_COUNTRY_CODE);
+    assert(unpackCountryCode(packCountryCode("USA")) == "USA");
+    assert(packCountryCode("D") == packCountryCode("D<<"));
+    assert(packCountryCode("U1A") == INVALID_COUNTRY_CODE);
+    
+    std::string mrz1 = "P<NLDVAN<DER<BERG<<ANNA<MARIA<<<<<<<<<<<<<<<";
+    std::string mrz2 = "XN01234565NLD8507192F3001019<<<<<<<<<<<<<<<6";
+    Passport original(mrz1, mrz2);
+    
+    // Record keeps enough to rebuild the exact MRZ
+    PassportRecord record = PassportRecord::fromPassport(original);
+    assert(record.hasMrz());
+    assert(record.getLastName() == "VAN DER BERG");
+    assert(record.birthDay == MrzDate::daysFromCivil(1985, 7, 19));
+    assert(record.expiryDay == MrzDate::daysFromCivil(2030, 1, 1));
+    assert(record.nationality == packCountryCode("NLD"));
+    std::string line1, line2;
+    record.buildMrz(line1, line2);
+    assert(line1 == mrz1);
+    assert(line2 == mrz2);
+    
+    Passport restored = record.toPassport();
+    assert(restored.getPassportNumber() == original.getPassportNumber());
+    assert(restored.getFirstName() == "ANNA MARIA");
+    assert(restored.validateMRZChecksum());
+    
+    // Structure-of-arrays batch
+    PassportBatch batch;
+    batch.add(original);
+    batch.add(Passport("P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+                       "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8"));
+    assert(batch.size() == 2);
+    assert(batch.getPassportNumber(1) == "P12345678");
+    assert(batch.findPassportNumber("XN0123456") == 0);
+    assert(batch.findPassportNumber("NOPE") == -1);
+    
+    std::vector<uint32_t> rows;
+    assert(batch.selectByNationality(packCountryCode("USA"), rows) == 1);
+    assert(rows[0] == 1);
+    assert(batch.getPassport(0).getLastName() == "VAN DER BERG");
+    
+    std::cout << "✓ Passport record tests passed\n";
+}
+
+void testDates() {
+    std::cout << "Testing Dates...\n";
+    
+    int32_t today = MrzDate::daysFromCivil(2026, 10, 17);
+    
+    // Century pivot: births are never in the future, expiry dates stay
+    // within 50 years of today
+    assert(MrzDate::decode("800101", MrzDate::BIRTH, today) == MrzDate::daysFromCivil(1980, 1, 1));
+    assert(MrzDate::decode("050101", MrzDate::BIRTH, today) == MrzDate::daysFromCivil(2005, 1, 1));
+    assert(MrzDate::decode("261018", MrzDate::BIRTH, today) == MrzDate::daysFromCivil(1926, 10, 18));
+    assert(MrzDate::decode("310101", MrzDate::EXPIRY, today) == MrzDate::daysFromCivil(2031, 1, 1));
+    assert(MrzDate::decode("990101", MrzDate::EXPIRY, today) == MrzDate::daysFromCivil(1999, 1, 1));
+    
+    // Impossible dates
+    assert(MrzDate::decode("310231", MrzDate::EXPIRY, today) == MrzDate::INVALID);
+    assert(MrzDate::decode("250229", MrzDate::EXPIRY, today) == MrzDate::INVALID);
+    assert(MrzDate::decode("240229", MrzDate::EXPIRY, today) != MrzDate::INVALID);
+    assert(MrzDate::decode("24A229", MrzDate::EXPIRY, today) == MrzDate::INVALID);
+    assert(MrzDate::encode(MrzDate::daysFromCivil(2031, 1, 1)) == "310101");
+    
+    // Threads asking at once all see the same cached day
+    std::vector<int32_t> seen(8, MrzDate::INVALID);
+    std::vector<std::thread> callers;
+    for (size_t i = 0; i < seen.size(); ++i) {
+        callers.emplace_back([&seen, i] { seen[i] = CurrentDate::today(); });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    assert(seen[0] != MrzDate::INVALID);
+    assert(std::count(seen.begin(), seen.end(), seen[0]) == static_cast<long>(seen.size()));
+    assert(CurrentDate::today() == seen[0]);
+    
+    // 2031 and 1931 are no longer the same expiry
+    CurrentDate::setOverride(today);
+    Passport p;
+    p.setDateOfBirth("800101");
+    p.setExpirationDate("310101");
+    assert(!p.isExpired());
+    assert(p.validateDates());
+    p.setExpirationDate("251231");
+    assert(p.isExpired());
+    
+    // Batch expiry check over the expiry column
+    PassportBatch batch;
+    batch.add(PassportRecord::fromPassport(p));
+    p.setExpirationDate("310101");
+    batch.add(PassportRecord::fromPassport(p));
+    uint8_t flags[2];
+    batch.markExpired(today, flags);
+    assert(flags[0] == 1 && flags[1] == 0);
+    assert(batch.countExpired(today) == 1);
+    CurrentDate::clearOverride();
+    
+    std::cout << "✓ Date tests passed\n";
+}
+
+void testVisaRules() {
+    std::cout << "Testing Visa Rules...\n";
+    
+    VerificationSystem verifier;
+    // Built-in defaults until a file is loaded
+    assert(verifier.requiresVisa("USA"));
+    assert(!verifier.requiresVisa("DEU"));
+    assert(verifier.requiresVisa("XYZ"));
+    assert(verifier.getVisaRule("DEU").visaFreeDays == 90);
+    
+    {
+        std::ofstream file("test_visa_requirements.csv");
+        file << "nationality,destination,visa_required,visa_free_days,exemptions\n"
+             << "# comment\n"
+             << "USA,TUR,0,30,\n"
+             << "NLD,TUR,1,0,DIPLOMATIC\n"
+             << "NLD,DEU,0,90,\n";
+    }
+    uint64_t version = verifier.getVisaRulesVersion();
+    assert(verifier.loadVisaRequirements("test_visa_requirements.csv"));
+    assert(verifier.getVisaRulesVersion() == version + 1);
+    assert(!verifier.requiresVisa("USA"));
+    assert(verifier.getVisaRule("USA").visaFreeDays == 30);
+    assert(verifier.requiresVisa("DEU")); // no longer listed
+    assert(verifier.requiresVisa("NLD"));
+    verifier.setHostCountry("DEU");
+    assert(!verifier.requiresVisa("NLD"));
+    assert(verifier.requiresVisa("USA")); // unknown destination table
+    verifier.setHostCountry("TUR");
+    
+    // Diplomatic exemption
+    Passport p;
+    p.setNationality("NLD");
+    p.setIssuingCountry("USA");
+    p.setDocumentType("P");
+    assert(!verifier.checkVisaStatus(p));
+    p.setDocumentType("PD");
+    assert(verifier.checkVisaStatus(p));
+    
+    // A bad file leaves the current rules in place
+    {
+        std::ofstream file("test_visa_requirements.csv");
+        file << "USA,TUR,maybe\n";
+    }
+    assert(!verifier.loadVisaRequirements("test_visa_requirements.csv"));
+    assert(verifier.getVisaRule("USA").visaFreeDays == 30);
+    
+    // Lookups keep running while rules are swapped
+    std::atomic<bool> done(false);
+    std::atomic<size_t> lookups(0);
+    std::thread reader([&] {
+        while (!done.load()) {
+            VisaRule rule = verifier.getVisaRule("USA");
+            assert(rule.isKnown());
+            lookups.fetch_add(1);
+        }
+    });
+    {
+        std::ofstream file("test_visa_requirements.csv");
+        file << "USA,TUR,0,30,\n";
+    }
+    for (int i = 0; i < 20; ++i) {
+        assert(verifier.loadVisaRequirements("test_visa_requirements.csv"));
+    }
+    done.store(true);
+    reader.join();
+    std::remove("test_visa_requirements.csv");
+    
+    std::cout << "✓ Visa rule tests passed\n";
+}
+
+void testVerificationPipeline() {
+    std::cout << "Testing Verification Pipeline...\n";
+    
+    // Generic engine: most severe failing rule wins, whatever the order
+    VerificationPipeline pipeline;
+    std::atomic<int> slowRuns{0};
+    bool failCheap = false, failSlow = false, failSevere = false;
+    pipeline.addRule("slow", 10, 1, 1000, [&](const VerificationContext&) { ++slowRuns; return !failSlow; });
+    pipeline.addRule("cheap", 11, 1, 1, [&](const VerificationContext&) { return !failCheap; });
+    pipeline.addRule("severe", 20, 2, 50, [&](const VerificationContext&) { return !failSevere; });
+    
+    Passport empty;
+    ReferenceSnapshot reference = {0, 0, nullptr, nullptr, nullptr, 0};
+    VerificationContext context(empty, reference);
+    assert(pipeline.evaluate(context) == VerificationPipeline::PASSED);
+    
+    // Cheap rule runs first and decides; the slow rule of the same severity is skipped
+    failCheap = true;
+    slowRuns = 0;
+    assert(pipeline.evaluate(context) == 11);
+    assert(slowRuns == 0);
+    
+    // A more severe failure outranks a less severe one
+    failSevere = true;
+    assert(pipeline.evaluate(context) == 20);
+    failCheap = failSevere = false;
+    
+    auto statistics = pipeline.getStatistics();
+    assert(statistics.size() == 3);
+    assert(statistics[1].name == "cheap" && statistics[1].position == 0);
+    assert(statistics[1].rejections == 2);
+    
+    // Once the slow rule starts rejecting most documents it moves up
+    failSlow = true;
+    for (uint64_t i = 0; i < VerificationPipeline::REORDER_INTERVAL * 2; ++i) {
+        assert(pipeline.evaluate(context) == 10);
+    }
+    statistics = pipeline.getStatistics();
+    assert(statistics[0].rejections >= VerificationPipeline::REORDER_INTERVAL * 2);
+    assert(statistics[0].position == 0);
+    
+    // Full verifier: verdicts match the old fixed chain
+    VerificationSystem verifier;
+    std::string line1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    Passport valid(line1, "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    Passport corrupted(line1, "P123456789USA8001014M3012316<<<<<<<<<<<<<<<5");
+    Passport expired(line1, "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8");
+    CurrentDate::setOverride(MrzDate::daysFromCivil(2026, 6, 1));
+    assert(verifier.verifyPassport(valid, "SEC001") == VerificationSystem::APPROVED);
+    assert(verifier.verifyPassport(corrupted, "SEC001") == VerificationSystem::INVALID_DOCUMENT);
+    assert(verifier.verifyPassport(expired, "SEC001") == VerificationSystem::DENIED);
+    assert(verifier.verifyPassport(valid, "NOBODY") == VerificationSystem::DENIED);
+    CurrentDate::clearOverride();
+    
+    // No rule ran more than once per document
+    for (const auto& rule : verifier.getRuleStatistics()) {
+        assert(rule.evaluations <= 3);
+    }
+    
+    std::cout << "✓ Verification pipeline tests passed\n";
+}
+
+void testVerdictCache() {
+    std::cout << "Testing Verdict Cache...\n";
+    
+    std::string line1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    std::string line2 = "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6";
+    Passport p(line1, line2);
+    
+    // The same document scanned again shares the key; a lowercase or
+    // padded misread is different text to the rules, so it does not
+    Passport rescanned(line1, line2);
+    Passport misread("p<usasmith<<john<<<<<<<<<<<<<<<<<<<<<<<<<<<< ", line2 + "\r");
+    assert(VerdictCache::makeKey(p) == VerdictCache::makeKey(rescanned));
+    assert(VerdictCache::makeKey(p) != VerdictCache::makeKey(misread));
+    
+    VerdictCache cache(64, std::chrono::milliseconds(50));
+    int verdict = -1;
+    cache.insert("A", 1, 2);
+    assert(!cache.lookup("A", 1, verdict)); // disabled
+    cache.setEnabled(true);
+    cache.insert("A", 1, 2);
+    assert(cache.lookup("A", 1, verdict) && verdict == 2);
+    assert(!cache.lookup("A", 2, verdict));   // rule data changed
+    assert(!cache.lookup("A", 1, verdict));   // and the entry is gone
+    cache.insert("B", 1, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    assert(!cache.lookup("B", 1, verdict));   // expired
+    for (int i = 0; i < 200; ++i) {
+        cache.insert("K" + std::to_string(i), 1, 0);
+    }
+    VerdictCache::Statistics stats = cache.getStatistics();
+    assert(stats.hits == 1 && stats.invalidated == 1 && stats.expired == 1);
+    assert(stats.size <= 64 && stats.evictions > 0);
+    
+    // Through the verifier: hits skip the rules, any data change invalidates
+    VerificationSystem uncached;
+    const auto misreadVerdict = uncached.verifyPassport(misread, "SEC001");
+    assert(misreadVerdict != VerificationSystem::APPROVED);
+    VerificationSystem verifier;
+    verifier.enableVerdictCache();
+    assert(verifier.verifyPassport(p, "SEC001") == VerificationSystem::APPROVED);
+    assert(verifier.verifyPassport(rescanned, "SEC001") == VerificationSystem::APPROVED);
+    assert(verifier.getVerdictCacheStatistics().hits == 1);
+    for (const auto& rule : verifier.getRuleStatistics()) {
+        assert(rule.evaluations <= 1);
+    }
+    // Whichever is presented first, each gets its uncached verdict
+    assert(verifier.verifyPassport(misread, "SEC001") == misreadVerdict);
+    VerificationSystem misreadFirst;
+    misreadFirst.enableVerdictCache();
+    assert(misreadFirst.verifyPassport(misread, "SEC001") == misreadVerdict);
+    assert(misreadFirst.verifyPassport(p, "SEC001") == VerificationSystem::APPROVED);
+    assert(misreadFirst.getVerdictCacheStatistics().hits == 0);
+    
+    // Operator check is never cached
+    assert(verifier.verifyPassport(p, "NOBODY") == VerificationSystem::DENIED);
+    
+    {
+        std::ofstream file("test_cache_watchlist.csv");
+        file << "W1,SMITH,JOHN\n";
+    }
+    assert(verifier.loadWatchlist("test_cache_watchlist.csv"));
+    assert(verifier.verifyPassport(p, "SEC001") == VerificationSystem::MANUAL_REVIEW);
+    assert(verifier.addAuthorizedPersonnel("SEC009"));
+    assert(verifier.verifyPassport(p, "SEC009") == VerificationSystem::MANUAL_REVIEW);
+    stats = verifier.getVerdictCacheStatistics();
+    assert(stats.hits == 1 && stats.invalidated == 2);
+    std::remove("test_cache_watchlist.csv");
+    
+    std::cout << "✓ Verdict cache tests passed\n";
+}
+
+void testBatchVerification() {
+    std::cout << "Testing Batch Verification...\n";
+    
+    VerificationSystem verifier;
+    std::string line1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    Passport approved(line1, "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    Passport corrupted(line1, "P123456789USA8001014M3012316<<<<<<<<<<<<<<<5");
+    Passport expired(line1, "P123456789USA8001014M2512314<<<<<<<<<<<<<<<8");
+    const Passport* samples[] = {&approved, &corrupted, &expired};
+    
+    std::vector<Passport> flight;
+    for (int i = 0; i < 400; ++i) {
+        flight.push_back(*samples[i % 3]);
+    }
+    
+    CurrentDate::setOverride(MrzDate::daysFromCivil(2026, 6, 1));
+    OperatorSession session = verifier.openOperatorSession("SEC001");
+    
+    // Same verdicts as one at a time, for any thread count
+    std::vector<VerificationSystem::VerificationResult> expected;
+    for (const auto& passport : flight) {
+        expected.push_back(verifier.verifyPassport(passport, session));
+    }
+    assert(expected[0] == VerificationSystem::APPROVED);
+    assert(expected[1] == VerificationSystem::INVALID_DOCUMENT);
+    assert(expected[2] == VerificationSystem::DENIED);
+    for (size_t threads : {1, 3, 8}) {
+        std::vector<VerificationSystem::VerificationResult> results(flight.size());
+        verifier.verifyBatch(flight.data(), flight.size(), session, results.data(), threads);
+        assert(results == expected);
+    }
+    assert(verifier.verifyBatch(flight, session) == expected);
+    
+    // Statistics from every worker are merged
+    uint64_t dateChecks = 0;
+    for (const auto& rule : verifier.getRuleStatistics()) {
+        if (rule.name == "expired") {
+            dateChecks = rule.evaluations;
+        }
+    }
+    assert(dateChecks > 0 && dateChecks <= flight.size() * 5);
+    
+    // A revoked operator gets nothing verified
+    assert(verifier.revokeAuthorizedPersonnel("SEC001"));
+    std::vector<VerificationSystem::VerificationResult> denied = verifier.verifyBatch(flight, session);
+    assert(std::count(denied.begin(), denied.end(), VerificationSystem::DENIED) ==
+           static_cast<long>(flight.size()));
+    CurrentDate::clearOverride();
+    
+    std::cout << "✓ Batch verification tests passed\n";
+}
+
+void testPassengerManifest() {
+    std::cout << "Testing Passenger Manifest...\n";
+    
+    std::string line1 = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<";
+    std::string line2 = "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6";
+    CurrentDate::setOverride(MrzDate::daysFromCivil(2026, 6, 1));
+    
+    {
+        std::ofstream file("test_manifest.csv");
+        file << "document_type,document_number,issuing_country,nationality,last_name,first_name,birth_date,sex,expiry_date\n";
+        file << "# flight TK1\n";
+        file << "P,P12345678,USA,USA,Smith,John,800101,M,301231\n";
+        file << "P,L898902C3,UTO,UTO,Eriksson,Anna Maria,740812,F,120415\n";
+        file << "P,X1,USA,USA,Short\n";
+    }
+    PassengerManifest manifest;
+    std::string error;
+    size_t skipped = 0;
+    assert(manifest.ingestFile("test_manifest.csv", error, PassengerManifest::AUTO, &skipped));
+    assert(manifest.size() == 2 && skipped == 1);
+    assert(!manifest.ingestFile("missing_manifest.csv", error) && !error.empty());
+    std::remove("test_manifest.csv");
+    
+    // Generated check digits give the MRZ the passport itself carries
+    PassportRecord listed = manifest.getPassengers().getRecord(0);
+    assert(listed.hasMrz());
+    std::string built1, built2;
+    listed.buildMrz(built1, built2);
+    assert(built1 == line1 && built2 == line2);
+    
+    VerificationSystem verifier;
+    OperatorSession session = verifier.openOperatorSession("SEC001");
+    Passport scanned(line1, line2);
+    VerificationSystem::VerificationResult verdict = VerificationSystem::DENIED;
+    assert(manifest.lookup(scanned, verifier.getRuleDataVersion(), CurrentDate::today(), verdict) ==
+           PassengerManifest::STALE);
+    assert(!manifest.verify(verifier, OperatorSession()));
+    assert(manifest.verify(verifier, session) && manifest.isVerified());
+    assert(manifest.getVerdict(0) == VerificationSystem::APPROVED);
+    assert(manifest.getVerdict(1) == VerificationSystem::DENIED); // expired
+    
+    const uint64_t version = verifier.getRuleDataVersion();
+    const int32_t today = CurrentDate::today();
+    assert(manifest.lookup(scanned, version, today, verdict) == PassengerManifest::CONFIRMED);
+    assert(verdict == VerificationSystem::APPROVED);
+    
+    // Listed number, but not the listed document
+    Passport corrupted(line1, "P123456789USA8001014M3012316<<<<<<<<<<<<<<<5");
+    Passport otherName("P<USASMITH<<JANE<<<<<<<<<<<<<<<<<<<<<<<<<<<<", line2);
+    assert(manifest.lookup(corrupted, version, today, verdict) == PassengerManifest::MISMATCH);
+    assert(manifest.lookup(otherName, version, today, verdict) == PassengerManifest::MISMATCH);
+    Passport unlisted(line1, "P987654321USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(manifest.lookup(unlisted, version, today, verdict) == PassengerManifest::NOT_LISTED);
+    
+    // Verdicts do not outlive the rule data or the day they were computed for
+    verifier.setHostCountry("GBR");
+    assert(manifest.lookup(scanned, verifier.getRuleDataVersion(), today, verdict) == PassengerManifest::STALE);
+    assert(manifest.lookup(scanned, version, today + 1, verdict) == PassengerManifest::STALE);
+    
+    PassengerManifest::Statistics stats = manifest.getStatistics();
+    assert(stats.lookups == 7 && stats.confirmed == 1 && stats.mismatched == 2 && stats.stale == 3);
+    
+    // PAXLST segments, with a release character in the surname
+    std::string paxlst =
+        "UNA:+.? 'UNB+UNOA:4+AIRLINE+USCBP+260601:1200+1'UNH+1+PAXLST:D:05B:UN:IATA'"
+        "NAD+FL+++O?'BRIEN:MARY:ANNE'ATT+2++F'DTM+329:19850320'NAT+2+IRL'"
+        "DOC+P:110:111+PA1234567'DTM+36:20310101'LOC+91+IRL'"
+        "NAD+FL+++NONUMBER:BOB'ATT+2++M'"
+        "UNT+9+1'UNZ+1+1'";
+    PassengerManifest arrivals;
+    assert(PassengerManifest::detectFormat(paxlst) == PassengerManifest::PAXLST);
+    assert(arrivals.ingest(paxlst, PassengerManifest::AUTO, &skipped) == 1 && skipped == 1);
+    PassportRecord irish = arrivals.getPassengers().getRecord(0);
+    assert(irish.getLastName() == "O BRIEN" && irish.getFirstName() == "MARY ANNE");
+    assert(irish.getPassportNumber() == "PA1234567" && irish.gender == 'F');
+    assert(irish.nationality == packCountryCode("IRL") && irish.issuingCountry == packCountryCode("IRL"));
+    assert(irish.birthDay == MrzDate::daysFromCivil(1985, 3, 20));
+    assert(irish.expiryDay == MrzDate::daysFromCivil(2031, 1, 1));
+    
+    // CSV has no release character: a '?' is data and never joins fields
+    // or lines
+    std::string csv =
+        "P,PB7654321,IRL,IRL,O?Brien,Sean,850320,M,310101\n"
+        "P,PC1111111,USA,USA,Doe?,Jane?,900101,F,300101?\n"
+        "P,PD2222222,USA,USA,Roe,Rick,700101,M,300101\n";
+    PassengerManifest charter;
+    skipped = 0;
+    assert(charter.ingest(csv, PassengerManifest::CSV, &skipped) == 3 && skipped == 0);
+    PassportRecord sean = charter.getPassengers().getRecord(0);
+    assert(sean.getLastName() == "O BRIEN" && sean.getFirstName() == "SEAN");
+    assert(sean.getPassportNumber() == "PB7654321" && sean.gender == 'M');
+    assert(sean.birthDay == MrzDate::daysFromCivil(1985, 3, 20));
+    PassportRecord jane = charter.getPassengers().getRecord(1);
+    assert(jane.getLastName() == "DOE" && jane.getFirstName() == "JANE");
+    assert(jane.nationality == packCountryCode("USA") && jane.gender == 'F');
+    assert(jane.birthDay == MrzDate::daysFromCivil(1990, 1, 1));
+    PassportRecord rick = charter.getPassengers().getRecord(2);
+    assert(rick.getPassportNumber() == "PD2222222" && rick.getLastName() == "ROE");
+    CurrentDate::clearOverride();
+    
+    std::cout << "✓ Passenger manifest tests passed\n";
+}
+
+void testFramePool() {
+    std::cout << "Testing Frame Pool...\n";
+    
+    FramePool pool(64, 48, 3, 2);
+    assert(pool.getFrameBytes() == 64 * 48 * 3 && pool.getCapacity() == 2);
+    
+    FramePool::Handle first = pool.acquire();
+    assert(first && first.isPooled() && first.size() == pool.getFrameBytes());
+    assert(reinterpret_cast<uintptr_t>(first.data()) % FramePool::ALIGNMENT == 0);
+    
+    // Copies share the buffer
+    first.data()[0] = 42;
+    FramePool::Handle shared = first;
+    assert(shared.data() == first.data() && shared.data()[0] == 42);
+    assert(first.useCount() == 2);
+    
+    FramePool::Handle second = pool.acquire();
+    assert(second.data() != first.data());
+    
+    // Beyond the pool: still a usable frame, counted as exhausted
+    FramePool::Handle overflow = pool.acquire();
+    assert(overflow && !overflow.isPooled() && overflow.size() == pool.getFrameBytes());
+    assert(reinterpret_cast<uintptr_t>(overflow.data()) % FramePool::ALIGNMENT == 0);
+    overflow.reset();
+    
+    // The frame goes back only when the last handle is dropped
+    unsigned char* firstData = first.data();
+    first.reset();
+    assert(shared.useCount() == 1 && pool.getStatistics().inUse == 2);
+    shared = FramePool::Handle();
+    FramePool::Handle recycled = pool.acquire();
+    assert(recycled.data() == firstData && recycled.isPooled());
+    recycled.reset();
+    second.reset();
+    
+    FramePool::Statistics stats = pool.getStatistics();
+    assert(stats.acquisitions == 4 && stats.exhausted == 1);
+    assert(stats.inUse == 0 && stats.peakInUse == 3);
+    
+    // Handles passed between threads return every frame
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool] {
+            for (int i = 0; i < 1000; ++i) {
+                FramePool::Handle frame = pool.acquire();
+                std::thread([frame] { frame.data()[1] = 1; }).join();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stats = pool.getStatistics();
+    assert(stats.inUse == 0 && stats.acquisitions == 4004);
+    
+    std::cout << "✓ Frame pool tests passed\n";
+}
+
+void testImageStore() {
+    std::cout << "Testing Image Store...\n";
+    
+    const std::string directory = "test_image_store";
+    std::filesystem::remove_all(directory);
+    FramePool pool(32, 16, 3, 4);
+    
+    ImageStore::Image first;
+    first.pixels = pool.acquire();
+    first.width = 32;
+    first.height = 16;
+    first.channels = 3;
+    first.format = "JPEG";
+    for (size_t i = 0; i < first.pixels.size(); ++i) {
+        first.pixels.data()[i] = static_cast<unsigned char>(i * 7);
+    }
+    ImageStore::Image second = first;
+    second.pixels = pool.acquire();
+    std::memcpy(second.pixels.data(), first.pixels.data(), first.pixels.size());
+    second.pixels.data()[100] ^= 1;
+    
+    // Ids follow the content and the geometry
+    assert(ImageStore::contentId(first) != ImageStore::contentId(second));
+    ImageStore::Image reshaped = first;
+    reshaped.width = 16;
+    reshaped.height = 32;
+    assert(ImageStore::contentId(first) != ImageStore::contentId(reshaped));
+    reshaped.pixels.reset();
+    
+    std::string firstId = ImageStore::contentId(first);
+    std::atomic<int> callbacks(0);
+    {
+        ImageStore store(directory);
+        std::future<bool> a = store.save(first, "P12345678", [&](bool stored, const std::string& id) {
+            assert(stored && id == firstId);
+            ++callbacks;
+        });
+        std::future<bool> b = store.save(second, "X98765432");
+        std::future<bool> repeat = store.save(first, "P12345678");
+        
+        assert(a.get() && b.get() && repeat.get());
+        store.flush();
+        
+        ImageStore::Statistics stats = store.getStatistics();
+        assert(stats.queued == 3 && stats.written == 2 && stats.duplicates == 1 && stats.failed == 0);
+        assert(stats.pending == 0 && stats.batches >= 1);
+        assert(stats.bytesWritten > 2 * first.pixels.size());
+        assert(std::filesystem::file_size(store.objectPath(firstId)) > first.pixels.size());
+        
+        // An empty image is refused at once
+        assert(!store.save(ImageStore::Image(), "EMPTY").get());
+    }
+    // Queued images shared the frames and gave them back
+    assert(callbacks == 1);
+    assert(first.pixels.useCount() == 1 && pool.getStatistics().inUse == 2);
+    
+    // Objects persist across stores; every visit is in the log
+    {
+        ImageStore store(directory);
+        assert(store.save(first, "P12345678").get());
+        assert(store.getStatistics().duplicates == 1 && store.getStatistics().written == 0);
+    }
+    std::ifstream log(directory + "/photos.log");
+    std::string line;
+    int visits = 0;
+    while (std::getline(log, line)) {
+        assert(line.find(' ') != std::string::npos);
+        visits += line.find(firstId) != std::string::npos;
+    }
+    assert(visits == 3);
+    std::filesystem::remove_all(directory);
+    
+    std::cout << "✓ Image store tests passed\n";
+}
+
+void testFaceMatcher() {
+    std::cout << "Testing Face Matcher...\n";
+    
+    // Chip portraits: gray, ICAO framing
+    const int portraitWidth = 240;
+    const int portraitHeight = 320;
+    const FaceMatcher::Region portraitFace = FaceMatcher::portraitRegion(portraitWidth, portraitHeight);
+    assert(portraitFace.width >= 2 * FaceMatcher::FACE_WIDTH && portraitFace.height >= 2 * FaceMatcher::FACE_HEIGHT);
+    std::vector<unsigned char> portrait(portraitWidth * portraitHeight);
+    auto describePortrait = [&](uint64_t identity, FaceMatcher::Descriptor& descriptor) {
+        std::fill(portrait.begin(), portrait.end(), 215);
+        FaceMatcher::renderFace(identity, portrait.data(), portraitWidth, portraitHeight, 1, portraitFace);
+        return FaceMatcher::extract(portrait.data(), portraitWidth, portraitHeight, 1, portraitFace, descriptor);
+    };
+    
+    FaceMatcher::Descriptor a, b;
+    assert(describePortrait(1, a) && describePortrait(2, b));
+    assert(FaceMatcher::distance(a, a) == 0 && FaceMatcher::similarity(a, a) == 1.0);
+    assert(FaceMatcher::distance(a, b) == FaceMatcher::distance(b, a) && FaceMatcher::distance(a, b) > 0);
+    assert(FaceMatcher::similarity(a, b) < FaceMatcher::MATCH_THRESHOLD);
+    
+    // LBP codes ignore exposure
+    FaceMatcher::Descriptor brighter;
+    std::fill(portrait.begin(), portrait.end(), 215);
+    FaceMatcher::renderFace(1, portrait.data(), portraitWidth, portraitHeight, 1, portraitFace, 25);
+    assert(FaceMatcher::extract(portrait.data(), portraitWidth, portraitHeight, 1, portraitFace, brighter));
+    assert(FaceMatcher::similarity(a, brighter) > 0.9);
+    
+    // Live frames: RGB sensor noise, the face off the guide by a few
+    // pixels and percent, different light
+    const int width = 800;
+    const int height = 800;
+    const FaceMatcher::Region guide = {160, 100, 480, 600};
+    std::vector<unsigned char> frame(width * height * 3);
+    std::mt19937 generator(23);
+    for (uint64_t identity = 1; identity <= 6; ++identity) {
+        for (auto& value : frame) {
+            value = static_cast<unsigned char>(generator());
+        }
+        std::uniform_int_distribution<int> offset(-12, 12);
+        std::uniform_int_distribution<int> lighting(-30, 30);
+        const double scale = identity % 2 ? 1.03 : 0.97;
+        FaceMatcher::Region face = {guide.left + offset(generator), guide.top + offset(generator),
+                                    static_cast<int>(guide.width * scale), static_cast<int>(guide.height * scale)};
+        FaceMatcher::renderFace(identity, frame.data(), width, height, 3, face, lighting(generator));
+        
+        FaceMatcher::Descriptor genuine, impostor, best;
+        assert(describePortrait(identity, genuine) && describePortrait(identity + 100, impostor));
+        const double same = FaceMatcher::match(genuine, frame.data(), width, height, 3, guide, &best);
+        assert(same >= FaceMatcher::MATCH_THRESHOLD);
+        assert(FaceMatcher::similarity(genuine, best) == same);
+        assert(FaceMatcher::match(impostor, frame.data(), width, height, 3, guide) < FaceMatcher::MATCH_THRESHOLD);
+    }
+    
+    // Regions outside the image or too small for the cells are refused
+    FaceMatcher::Descriptor unused;
+    assert(!FaceMatcher::extract(frame.data(), width, height, 3, {700, 100, 480, 600}, unused));
+    assert(!FaceMatcher::extract(frame.data(), width, height, 3, {0, 0, 100, 120}, unused));
+    assert(!FaceMatcher::extract(nullptr, width, height, 3, guide, unused));
+    assert(FaceMatcher::match(a, frame.data(), width, height, 3, {-10, 0, 480, 600}) == 0.0);
+    
+    // Only an approval is overturned, and only by a face that was compared
+    assert(VerificationSystem::applyFaceMatch(VerificationSystem::APPROVED, 0.9) == VerificationSystem::APPROVED);
+    assert(VerificationSystem::applyFaceMatch(VerificationSystem::APPROVED, 0.3) == VerificationSystem::MANUAL_REVIEW);
+    assert(VerificationSystem::applyFaceMatch(VerificationSystem::APPROVED, FaceMatcher::NOT_COMPARED) ==
+           VerificationSystem::APPROVED);
+    assert(VerificationSystem::applyFaceMatch(VerificationSystem::DENIED, 0.9) == VerificationSystem::DENIED);
+    
+    std::cout << "✓ Face matcher tests passed\n";
+}
+
+void testFaceWatchlistIndex() {
+    std::cout << "Testing Face Watchlist Index...\n";
+    
+    const int portraitWidth = 240;
+    const int portraitHeight = 320;
+    const FaceMatcher::Region portraitFace = FaceMatcher::portraitRegion(portraitWidth, portraitHeight);
+    std::vector<unsigned char> portrait(portraitWidth * portraitHeight);
+    auto describePortrait = [&](uint64_t identity, FaceMatcher::Descriptor& descriptor) {
+        std::fill(portrait.begin(), portrait.end(), 215);
+        FaceMatcher::renderFace(identity, portrait.data(), portraitWidth, portraitHeight, 1, portraitFace);
+        assert(FaceMatcher::extract(portrait.data(), portraitWidth, portraitHeight, 1, portraitFace, descriptor));
+    };
+    
+    // Booth captures with sensor noise, aligned against the passenger's
+    // own chip portrait
+    const int width = 800;
+    const int height = 800;
+    const FaceMatcher::Region guide = {160, 100, 480, 600};
+    std::vector<unsigned char> frame(width * height * 3);
+    std::mt19937 generator(29);
+    auto describeCapture = [&](uint64_t identity, FaceMatcher::Descriptor& live) {
+        for (auto& value : frame) {
+            value = static_cast<unsigned char>(generator());
+        }
+        std::uniform_int_distribution<int> offset(-10, 10);
+        std::uniform_int_distribution<int> noise(-8, 8);
+        FaceMatcher::Region face = {guide.left + offset(generator), guide.top + offset(generator), 490, 612};
+        FaceMatcher::renderFace(identity, frame.data(), width, height, 3, face, 15);
+        for (int y = face.top; y < face.top + face.height; ++y) {
+            for (int x = face.left * 3; x < (face.left + face.width) * 3; ++x) {
+                unsigned char& value = frame[y * width * 3 + x];
+                value = static_cast<unsigned char>(std::clamp(value + noise(generator), 0, 255));
+            }
+        }
+        FaceMatcher::Descriptor chip;
+        describePortrait(identity, chip);
+        FaceMatcher::match(chip, frame.data(), width, height, 3, guide, &live);
+    };
+    
+    // Pooled codes keep the descriptor's scale
+    FaceMatcher::Descriptor descriptor;
+    describePortrait(7, descriptor);
+    FaceWatchlistIndex::Code code;
+    FaceWatchlistIndex::encode(descriptor, code);
+    assert(code.mass > descriptor.mass / 5 && code.mass < descriptor.mass / 3);
+    
+    std::vector<FaceWatchlistIndex::Entry> entries(240);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        entries[i].id = "FW" + std::to_string(1000 + i);
+        describePortrait(5000 + i, entries[i].descriptor);
+    }
+    const std::string flatPath = "test_faces_flat.idx";
+    const std::string listPath = "test_faces_ivf.idx";
+    std::string error;
+    assert(FaceWatchlistIndex::build(std::vector<FaceWatchlistIndex::Entry>(entries.begin(), entries.begin() + 60),
+                                     flatPath, error));
+    assert(FaceWatchlistIndex::build(entries, listPath, error, 16));
+    
+    FaceWatchlistIndex flat, lists;
+    assert(flat.open(flatPath, error) && flat.size() == 60 && flat.getListCount() == FaceWatchlistIndex::FLAT);
+    assert(lists.open(listPath, error) && lists.size() == 240 && lists.getListCount() == 16);
+    
+    // Enrolled faces come back first, best first, k at most
+    std::vector<FaceWatchlistMatch> matches;
+    assert(flat.search(entries[12].descriptor, 3, matches) == 3);
+    assert(flat.getId(matches[0].entry) == "FW1012" && matches[0].score == 1.0);
+    assert(matches[0].score >= matches[1].score && matches[1].score >= matches[2].score);
+    
+    // Live captures: listed passengers are hits, others are not
+    const size_t listed[] = {3, 57, 121, 230};
+    for (size_t i : listed) {
+        FaceMatcher::Descriptor live;
+        describeCapture(5000 + i, live);
+        matches.clear();
+        assert(lists.search(live, 5, matches) == 5);
+        assert(lists.getId(matches[0].entry) == entries[i].id);
+        assert(matches[0].score >= FaceWatchlistIndex::HIT_THRESHOLD);
+        // Scanning every list finds the same face
+        matches.clear();
+        lists.search(live, 1, matches, 16);
+        assert(lists.getId(matches[0].entry) == entries[i].id);
+    }
+    for (uint64_t identity = 90000; identity < 90004; ++identity) {
+        FaceMatcher::Descriptor live;
+        describeCapture(identity, live);
+        matches.clear();
+        lists.search(live, 1, matches);
+        assert(matches.size() == 1 && matches[0].score < FaceWatchlistIndex::HIT_THRESHOLD);
+    }
+    
+    // Concurrent searches share the mapped index
+    std::vector<std::thread> threads;
+    std::atomic<int> found(0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<FaceWatchlistMatch> local;
+            for (int i = 0; i < 25; ++i) {
+                local.clear();
+                const size_t entry = (t * 25 + i) % entries.size();
+                lists.search(entries[entry].descriptor, 1, local);
+                found += lists.getId(local[0].entry) == entries[entry].id;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(found == 100);
+    FaceWatchlistIndex::Statistics stats = lists.getStatistics();
+    assert(stats.searches == 112 && stats.scanned > 0 && stats.scanned < stats.searches * entries.size());
+    assert(stats.p50Microseconds > 0 && stats.p99Microseconds >= stats.p50Microseconds);
+    
+    // Through the verification system; ids outlive the index
+    VerificationSystem verifier;
+    std::vector<VerificationSystem::FaceCandidate> candidates;
+    assert(!verifier.screenFaceWatchlist(entries[5].descriptor, candidates) && candidates.empty());
+    assert(verifier.attachFaceWatchlist(listPath) && verifier.getFaceWatchlistSize() == 240);
+    assert(verifier.screenFaceWatchlist(entries[5].descriptor, candidates, 2));
+    verifier.detachFaceWatchlist();
+    assert(candidates.size() == 2 && candidates[0].id == "FW1005" && candidates[0].score == 1.0);
+    assert(verifier.getFaceWatchlistSize() == 0);
+    
+    // Other files are refused
+    FaceWatchlistIndex other;
+    {
+        std::ofstream out("test_faces_bad.idx", std::ios::binary);
+        out << "not a face index, just some text padded out to a header's length";
+    }
+    assert(!other.open("test_faces_bad.idx", error) && !other.isOpen());
+    assert(!other.open("missing_faces.idx", error));
+    matches.clear();
+    assert(other.search(descriptor, 5, matches) == 0);
+    std::remove("test_faces_bad.idx");
+    std::remove(flatPath.c_str());
+    std::remove(listPath.c_str());
+    
+    std::cout << "✓ Face watchlist index tests passed\n";
+}
+
+void testSha256() {
+    std::cout << "Testing SHA-256...\n";
+    
+    auto hex = [](const Sha256::Digest& digest) {
+        static const char DIGITS[] = "0123456789abcdef";
+        std::string text;
+        for (uint8_t byte : digest) {
+            text += DIGITS[byte >> 4];
+            text += DIGITS[byte & 15];
+        }
+        return text;
+    };
+    
+    // The rounds are picked at run time: the SHA extensions whenever the
+    // CPU has them, whatever the build flags. The vectors below run
+    // through that path.
+    std::cout << "SHA-256 rounds: " << (Sha256::isAccelerated() ? "SHA-NI" : "portable") << "\n";
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();
+    assert(Sha256::isAccelerated() ==
+           (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")));
+#endif
+    
+    // FIPS 180-4 examples, and padding that spills into a second block
+    assert(hex(Sha256::hash("")) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    assert(hex(Sha256::hash("abc")) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    assert(hex(Sha256::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")) ==
+           "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    assert(hex(Sha256::hash(std::string(1000000, 'a'))) ==
+           "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    // Two-block FIPS example: full blocks from the input, then the tail
+    assert(hex(Sha256::hash("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu")) ==
+           "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+    
+    const Sha256::Digest digest = Sha256::hash("abc");
+    std::string bytes(reinterpret_cast<const char*>(digest.data()), digest.size());
+    assert(Sha256::matches("abc", bytes));
+    assert(!Sha256::matches("abd", bytes));
+    assert(!Sha256::matches("abc", bytes.substr(1)));
+    
+    std::cout << "✓ SHA-256 tests passed\n";
+}
+
+void testLdsDocument() {
+    std::cout << "Testing LDS document...\n";
+    
+    // BER-TLV: one, two and three byte tags, short and long lengths
+    std::string encoded;
+    TlvReader::append(encoded, 0x61, "abc");
+    TlvReader::append(encoded, 0x5F1F, std::string(200, 'x'));
+    TlvReader::append(encoded, 0x7F8102, std::string(70000, 'y'));
+    TlvReader reader(encoded);
+    TlvElement element;
+    assert(reader.next(element) && element.tag == 0x61 && element.constructed && element.value == "abc");
+    assert(element.encoded.size() == 5);
+    assert(reader.next(element) && element.tag == 0x5F1F && !element.constructed && element.value.size() == 200);
+    assert(reader.next(element) && element.tag == 0x7F8102 && element.value.size() == 70000);
+    assert(element.value.data() == encoded.data() + encoded.size() - 70000);
+    assert(!reader.next(element) && reader.atEnd() && !reader.hasError());
+    TlvReader search(encoded);
+    assert(search.find(0x7F8102, element) && !search.find(0x61, element));
+    
+    // Truncated values, indefinite lengths and runaway tags are refused
+    const std::string malformed[] = {
+        std::string("\x61\x05" "abc"), std::string("\x61\x80" "abc\0\0", 7), std::string("\x61\x82\x01"),
+        std::string("\x5F\x81\x81\x81\x01" "a"), std::string("\x5F"), std::string("\x61\x85\0\0\0\0\1" "a", 8)
+    };
+    for (const std::string& bad : malformed) {
+        TlvReader broken(bad);
+        assert(!broken.next(element) && broken.hasError());
+    }
+    
+    // A simulated chip: DG1, DG2 and the SOD over both
+    const std::string mrz = "P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<"
+                            "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6";
+    const int width = 240, height = 320;
+    std::vector<unsigned char> pixels(width * height, 215);
+    FaceMatcher::renderFace(3, pixels.data(), width, height, 1, FaceMatcher::portraitRegion(width, height));
+    std::string groups[LdsDocument::MAX_DATA_GROUP + 1];
+    groups[1] = LdsDocument::encodeDataGroup1(mrz);
+    groups[2] = LdsDocument::encodeDataGroup2(pixels.data(), width, height);
+    const std::string com = LdsDocument::encodeCom((1u << 1) | (1u << 2));
+    const std::string sod = LdsDocument::encodeSecurityObject(groups);
+    
+    LdsDocument document;
+    std::string error;
+    assert(document.verify("") == LdsDocument::NO_SECURITY_OBJECT);
+    assert(document.parseCom(com, error) && document.getLdsVersion() == "0107");
+    assert(document.getListedGroups() == ((1u << 1) | (1u << 2)));
+    assert(document.parseSecurityObject(sod, error) && document.hasSecurityObject());
+    assert(document.parseDataGroup(1, groups[1], error) && document.getMrz() == mrz);
+    assert(document.parseDataGroup(2, groups[2], error));
+    const LdsDocument::Portrait& portrait = document.getPortrait();
+    assert(portrait.imageType == LdsDocument::IMAGE_RAW_GRAY && portrait.width == width && portrait.height == height);
+    assert(std::memcmp(portrait.image.data(), pixels.data(), pixels.size()) == 0);
+    assert(portrait.image.data() >= groups[2].data() && portrait.image.data() < groups[2].data() + groups[2].size());
+    
+    // Passive authentication, with and without the printed MRZ
+    Passport holder(mrz.substr(0, 44), mrz.substr(44));
+    assert(document.verify("") == 0);
+    assert(document.verify(mrz.substr(0, 44) + "\n" + mrz.substr(44)) == 0);
+    assert(VerificationSystem::verifyChip(document, holder) == 0);
+    std::string otherMrz = mrz;
+    otherMrz[60] = '8';
+    assert(document.verify(otherMrz) == LdsDocument::MRZ_MISMATCH);
+    assert(document.verify(mrz.substr(0, 44)) == LdsDocument::MRZ_MISMATCH);
+    
+    // A portrait swapped after signing
+    std::string altered = groups[2];
+    altered[altered.size() - 1000] ^= 0x40;
+    LdsDocument tampered;
+    uint32_t mismatched = 0;
+    assert(tampered.parseSecurityObject(sod, error) && tampered.parseDataGroup(1, groups[1], error));
+    assert(tampered.parseDataGroup(2, altered, error));
+    assert(tampered.verify(mrz, &mismatched) == LdsDocument::DIGEST_MISMATCH && mismatched == (1u << 2));
+    assert(VerificationSystem::verifyChip(tampered, holder) == LdsDocument::DIGEST_MISMATCH);
+    
+    // A group the SOD does not cover, and a chip without DG1
+    const std::string group11("\x6B\x03\x5F\x0E\x00", 5);
+    assert(LdsDocument::dataGroupTag(11) == 0x6B);
+    LdsDocument unsigned11;
+    assert(unsigned11.parseSecurityObject(sod, error) && unsigned11.parseDataGroup(11, group11, error));
+    assert(unsigned11.verify("") == LdsDocument::UNSIGNED_GROUP);
+    assert(unsigned11.verify(mrz) == (LdsDocument::UNSIGNED_GROUP | LdsDocument::NO_MRZ));
+    
+    // The verdict: a failed chip invalidates a passing document
+    assert(VerificationSystem::applyChipCheck(VerificationSystem::APPROVED, 0) == VerificationSystem::APPROVED);
+    assert(VerificationSystem::applyChipCheck(VerificationSystem::APPROVED, LdsDocument::DIGEST_MISMATCH) ==
+           VerificationSystem::INVALID_DOCUMENT);
+    assert(VerificationSystem::applyChipCheck(VerificationSystem::MANUAL_REVIEW, LdsDocument::MRZ_MISMATCH) ==
+           VerificationSystem::INVALID_DOCUMENT);
+    assert(VerificationSystem::applyChipCheck(VerificationSystem::DENIED, LdsDocument::DIGEST_MISMATCH) ==
+           VerificationSystem::DENIED);
+    
+    // Wrong or broken files
+    LdsDocument broken;
+    assert(!broken.parseCom(groups[1], error));
+    assert(!broken.parseDataGroup(1, groups[2], error));
+    assert(!broken.parseDataGroup(17, groups[1], error));
+    assert(!broken.parseDataGroup(2, groups[2].substr(0, groups[2].size() - 1), error));
+    assert(!broken.parseSecurityObject(sod.substr(0, sod.size() / 2), error));
+    assert(!broken.parseSecurityObject(com, error) && !broken.hasSecurityObject());
+    
+    std::cout << "✓ LDS document tests passed\n";
+}
+
+void testPersonnelStore() {
+    std::cout << "Testing Personnel Store...\n";
+    
+    PersonnelStore store;
+    const int64_t now = 1000000;
+    assert(store.addPersonnel("SEC001"));
+    assert(store.addPersonnel("SUP001", PersonnelStore::SUPERVISOR, now - 60, now + 3600));
+    assert(!store.addPersonnel("BAD001", PersonnelStore::OFFICER, now, now)); // empty shift
+    assert(store.size() == 2);
+    
+    assert(store.isAuthorized("SEC001", now));
+    assert(!store.isAuthorized("SEC999", now));
+    assert(store.isAuthorized("SUP001", now, PersonnelStore::SUPERVISOR));
+    assert(!store.isAuthorized("SUP001", now, PersonnelStore::ADMINISTRATOR));
+    assert(!store.isAuthorized("SUP001", now + 3600)); // shift over
+    
+    // Sessions end with the shift, on revocation and on any record change
+    OperatorSession session = store.openSession("SUP001", now);
+    assert(session.isValid(now) && session.hasRole(PersonnelStore::SUPERVISOR));
+    assert(!session.isValid(now + 3600));
+    assert(!store.openSession("SUP001", now + 7200).isValid(now + 7200));
+    
+    OperatorSession officer = store.openSession("SEC001", now);
+    assert(officer.isValid(now));
+    assert(store.revoke("SEC001"));
+    assert(!officer.isValid(now));
+    assert(!store.isAuthorized("SEC001", now));
+    assert(!store.revoke("SEC001"));
+    assert(store.addPersonnel("SEC001")); // reinstated
+    assert(!officer.isValid(now));
+    assert(store.openSession("SEC001", now).isValid(now));
+    
+    // Booth verification through a session
+    VerificationSystem verifier;
+    Passport p("P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+               "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(verifier.addAuthorizedPersonnel("SEC003"));
+    OperatorSession booth = verifier.openOperatorSession("SEC003");
+    assert(verifier.verifyPassport(p, booth) == verifier.verifyPassport(p, "SEC003"));
+    assert(verifier.revokeAuthorizedPersonnel("SEC003"));
+    assert(verifier.verifyPassport(p, booth) == VerificationSystem::DENIED);
+    assert(verifier.verifyPassport(p, "SEC003") == VerificationSystem::DENIED);
+    
+    // Officers added while other threads check authorization
+    std::atomic<bool> done(false);
+    std::thread reader([&] {
+        while (!done.load()) {
+            assert(verifier.isAuthorizedPersonnel("SEC001"));
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        assert(verifier.addAuthorizedPersonnel("TMP" + std::to_string(i)));
+    }
+    done.store(true);
+    reader.join();
+    assert(verifier.isAuthorizedPersonnel("TMP99"));
+    
+    std::cout << "✓ Personnel store tests passed\n";
+}
+
+void testStolenDocumentIndex() {
+    std::cout << "Testing Stolen Document Index...\n";
+    
+    // Keys: trailing fillers ignored, invalid numbers rejected
+    uint64_t key = StolenDocumentIndex::makeKey("USA", "123456789");
+    assert(key != StolenDocumentIndex::INVALID_KEY);
+    assert(StolenDocumentIndex::makeKey("USA", "AB123<<<<") == StolenDocumentIndex::makeKey("USA", "AB123"));
+    assert(StolenDocumentIndex::makeKey("USA", "AB123") != StolenDocumentIndex::makeKey("USA", "<AB123"));
+    assert(StolenDocumentIndex::makeKey("DEU", "123456789") != key);
+    assert(StolenDocumentIndex::makeKey("USA", "1234567890") == StolenDocumentIndex::INVALID_KEY);
+    assert(StolenDocumentIndex::makeKey("USA", "12-45") == StolenDocumentIndex::INVALID_KEY);
+    
+    std::vector<uint64_t> keys;
+    for (int i = 0; i < 20000; ++i) {
+        keys.push_back(StolenDocumentIndex::makeKey("DEU", "C" + std::to_string(1000000 + i)));
+    }
+    keys.push_back(key);
+    keys.push_back(key); // duplicate
+    std::string error;
+    assert(StolenDocumentIndex::build(keys, "test_stolen.idx", error));
+    
+    StolenDocumentIndex index;
+    assert(index.open("test_stolen.idx", error));
+    assert(index.getKeyCount() == 20001);
+    assert(index.contains("USA", "123456789"));
+    assert(index.contains("DEU", "C1019999"));
+    assert(!index.contains("FRA", "123456789"));
+    for (uint64_t listed : keys) {
+        assert(index.contains(listed));
+    }
+    
+    // Clean documents: the Bloom filter rejects nearly all of them
+    size_t falsePositives = 0;
+    for (int i = 0; i < 100000; ++i) {
+        falsePositives += index.contains("NLD", "X" + std::to_string(i)) ? 1 : 0;
+    }
+    assert(falsePositives < 500);
+    
+    // Garbage is not accepted as an index
+    {
+        std::ofstream file("test_stolen_bad.idx", std::ios::binary);
+        file << "not an index";
+    }
+    StolenDocumentIndex bad;
+    assert(!bad.open("test_stolen_bad.idx", error));
+    std::remove("test_stolen_bad.idx");
+    
+    // Counterfeit detection flags listed documents
+    VerificationSystem verifier;
+    Passport p("P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+               "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(!verifier.detectCounterfeit(p));
+    assert(verifier.attachStolenDocumentIndex("test_stolen.idx"));
+    assert(!verifier.isReportedStolen(p)); // P12345678 is not listed
+    p.setPassportNumber("123456789");
+    assert(verifier.isReportedStolen(p));
+    assert(verifier.detectCounterfeit(p));
+    verifier.detachStolenDocumentIndex();
+    assert(!verifier.isReportedStolen(p));
+    std::remove("test_stolen.idx");
+    
+    std::cout << "✓ Stolen document index tests passed\n";
+}
+
+void testNameWatchlist() {
+    std::cout << "Testing Name Watchlist...\n";
+    
+    // Normalization: case, MRZ fillers, punctuation and transliteration
+    assert(NameWatchlist::normalize("smith<<john") == "SMITH JOHN");
+    assert(NameWatchlist::normalize("  O'Brien-Smith ") == "O BRIEN SMITH");
+    assert(NameWatchlist::normalize("M\xc3\xbcller") == "MUELLER");
+    assert(NameWatchlist::normalize("\xc3\x87" "EL\xc4\xb0K \xc5\x9e" "AH\xc4\xb0N") == "CELIK SAHIN");
+    assert(NameWatchlist::fullName("VAN DER BERG", "ANNA<MARIA") == "VAN DER BERG ANNA MARIA");
+    
+    // Bounded edit distance
+    assert(NameWatchlist::editDistance("KITTEN", "SITTING", 5) == 3);
+    assert(NameWatchlist::editDistance("SMITH JOHN", "SMITH JOHN", 2) == 0);
+    assert(NameWatchlist::editDistance("SMITH JOHN", "SMYTH JON", 2) == 2);
+    assert(NameWatchlist::editDistance("SMITH JOHN", "JONES MARY", 2) == 3); // bound + 1
+    assert(NameWatchlist::editDistance("", "ABC", 5) == 3);
+    
+    NameWatchlist list;
+    list.add("W1", "M\xc3\xbcller", "Hans");
+    list.add("W2", "IVANOV", "SERGEI");
+    list.add("W3", "SMITH", "JOHN");
+    for (int i = 0; i < 1000; ++i) {
+        list.add("F" + std::to_string(i), "FILLER" + std::string(1, static_cast<char>('A' + i % 26)),
+                 "PERSON" + std::string(1, static_cast<char>('A' + (i / 26) % 26)));
+    }
+    list.build();
+    
+    std::vector<WatchlistMatch> matches;
+    assert(list.screen("MUELLER", "HANS", matches) == 1 && list.getId(matches[0].entry) == "W1");
+    matches.clear();
+    assert(list.screen("MULLER", "HANS", matches) == 1 && matches[0].distance == 1);
+    matches.clear();
+    assert(list.screen("IVANOV", "SERGEJ", matches) == 1 && list.getId(matches[0].entry) == "W2");
+    matches.clear();
+    assert(list.screen("SMITH", "JANE", matches) == 0);
+    assert(list.screen("DOE", "JOHN", matches) == 0);
+    
+    // Watchlist hits send the passenger to manual review
+    {
+        std::ofstream file("test_watchlist.csv");
+        file << "# id,last name,first name\n"
+             << "W100,SMYTH,JOHN\n";
+    }
+    VerificationSystem verifier;
+    Passport p("P<USASMITH<<JOHN<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+               "P123456789USA8001014M3012316<<<<<<<<<<<<<<<6");
+    assert(verifier.verifyPassport(p, "SEC001") == VerificationSystem::APPROVED);
+    assert(verifier.loadWatchlist("test_watchlist.csv"));
+    std::vector<std::string> ids;
+    assert(verifier.screenWatchlist(p, &ids) && ids.size() == 1 && ids[0] == "W100");
+    assert(verifier.verifyPassport(p, "SEC001") == VerificationSystem::MANUAL_REVIEW);
+    std::remove("test_watchlist.csv");
+    
+    std::cout << "✓ Name watchlist tests passed\n";
+}
+
+// Stands in for std::cout while the asynchronous logger is tested: the
+// writer thread stops inside its write until the gate opens, so what is
+// still queued is known exactly
+class GatedOutput : public std::streambuf {
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool open = false;
+    size_t waiting = 0;
+    std::string text;
+    
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++waiting;
+        changed.notify_all();
+        changed.wait(lock, [this] { return open; });
+        --waiting;
+        text.append(data, static_cast<size_t>(size));
+        return size;
+    }
+    
+    int overflow(int c) override {
+        if (c != traits_type::eof()) {
+            char ch = static_cast<char>(c);
+            xsputn(&ch, 1);
+        }
+        return c;
+    }
+    
+public:
+    void setOpen(bool value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = value;
+        changed.notify_all();
+    }
+    
+    // Until the writer is parked in a write
+    void waitForWriter() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return waiting > 0; });
+    }
+    
+    std::string contents() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return text;
+    }
+    
+    // Closes the gate and forgets what was written
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = false;
+        text.clear();
+    }
+};
+
+size_t countLines(const std::string& text, const std::string& needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+void testAsyncLogger() {
+    std::cout << "Testing Async Logger...\n";
+    std::cout.flush();
+    
+    GatedOutput output;
+    std::streambuf* console = std::cout.rdbuf(&output);
+    const std::string path = "test_async.log";
+    
+    // A full queue drops under DROP and DROP_AND_REPORT; the writer holds
+    // msg0, the queue (capacity 4) takes msg1-4 and msg5-7 are lost
+    const Logger::OverflowPolicy dropping[] = {Logger::DROP, Logger::DROP_AND_REPORT};
+    for (Logger::OverflowPolicy policy : dropping) {
+        std::remove(path.c_str());
+        output.reset();
+        {
+            Logger logger(path, Logger::ASYNCHRONOUS, 4, policy);
+            logger.info("msg0");
+            output.waitForWriter();
+            for (int i = 1; i < 8; ++i) {
+                logger.info("msg" + std::to_string(i));
+            }
+            assert(logger.getDroppedCount() == 3);
+            output.setOpen(true);
+            logger.flush();
+            const std::string text = output.contents();
+            for (int i = 0; i < 5; ++i) {
+                assert(countLines(text, "] msg" + std::to_string(i) + "\n") == 1);
+            }
+            assert(countLines(text, "msg5") == 0 && countLines(text, "msg7") == 0);
+            const bool reported = countLines(text, "3 log messages dropped (queue full)") == 1;
+            assert(reported == (policy == Logger::DROP_AND_REPORT));
+        }
+    }
+    
+    // BLOCK waits for room instead of dropping
+    output.reset();
+    {
+        Logger logger(path, Logger::ASYNCHRONOUS, 4, Logger::BLOCK);
+        logger.info("block0");
+        output.waitForWriter();
+        std::atomic<bool> producerDone(false);
+        std::thread producer([&] {
+            for (int i = 1; i < 8; ++i) {
+                logger.info("block" + std::to_string(i));
+            }
+            producerDone = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(!producerDone);   // only the gated writer can make room
+        output.setOpen(true);
+        producer.join();
+        logger.flush();
+        assert(logger.getDroppedCount() == 0);
+        const std::string text = output.contents();
+        for (int i = 0; i < 8; ++i) {
+            assert(countLines(text, "] block" + std::to_string(i) + "\n") == 1);
+        }
+    }
+    
+    // flush() returns only once everything logged before it is written
+    output.reset();
+    {
+        Logger logger(path, Logger::ASYNCHRONOUS, 64);
+        logger.info("flush0");
+        output.waitForWriter();
+        for (int i = 1; i < 20; ++i) {
+            logger.info("flush" + std::to_string(i));
+        }
+        std::atomic<bool> flushed(false);
+        std::string seen;
+        std::thread flusher([&] {
+            logger.flush();
+            seen = output.contents();
+            flushed = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(!flushed);
+        output.setOpen(true);
+        flusher.join();
+        for (int i = 0; i < 20; ++i) {
+            assert(countLines(seen, "] flush" + std::to_string(i) + "\n") == 1);
+        }
+    }
+    
+    // The destructor drains what is still queued
+    output.reset();
+    std::remove(path.c_str());
+    {
+        auto logger = std::make_unique<Logger>(path, Logger::ASYNCHRONOUS, 64);
+        logger->info("queued0");
+        output.waitForWriter();
+        for (int i = 1; i < 30; ++i) {
+            logger->info("queued" + std::to_string(i));
+        }
+        std::thread destroyer([&] { logger.reset(); });
+        output.setOpen(true);
+        destroyer.join();
+    }
+    std::ifstream in(path);
+    std::stringstream written;
+    written << in.rdbuf();
+    for (int i = 0; i < 30; ++i) {
+        assert(countLines(written.str(), "] queued" + std::to_string(i) + "\n") == 1);
+    }
+    
+    std::cout.rdbuf(console);
+    std::remove(path.c_str());
+    std::cout << "✓ Async logger tests passed\n";
+}
+
+void testBinaryLog() {
+    std::cout << "Testing Binary Log...\n";
+
+    const std::string textPath = "test_binary.log";
+    const std::string path = "test_binary.blog";
+    const int64_t before = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // The same records through both writers; each enableBinaryLog() starts a session
+    std::remove(path.c_str());
+    Logger::LogMode modes[] = {Logger::SYNCHRONOUS, Logger::ASYNCHRONOUS};
+    for (Logger::LogMode mode : modes) {
+        Logger logger(textPath, mode);
+        logger.setLogLevel(Logger::DEBUG);
+        assert(logger.enableBinaryLog(path));
+        logger.logBinary(Logger::INFO, MSG_VERIFICATION_RESULT, std::string("P12345678"),
+                         static_cast<int>(VerificationSystem::MANUAL_REVIEW), static_cast<int64_t>(1234));
+        logger.logBinary(Logger::DEBUG, MSG_DEVICE_STAGES, static_cast<int64_t>(42));
+        logger.logBinary(Logger::INFO, MSG_LANE_REPORT, static_cast<uint64_t>(500), 12.5, 40.0);
+        // Text arguments keep at most 16 bytes
+        logger.logBinary(Logger::WARNING, MSG_VERIFICATION_RESULT, std::string("ABCDEFGHIJKLMNOPQRS"),
+                         -1, static_cast<int64_t>(-7));
+        logger.flush();
+    }
+
+    const int64_t after = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::ifstream in(path, std::ios::binary);
+    BinaryLogReader reader(in);
+    BinaryLogRecord record;
+    for (int session = 0; session < 2; ++session) {
+        assert(reader.next(record) == BinaryLogReader::RECORD);
+        assert(record.messageId == MSG_SESSION_START);
+        assert(record.argCount == 3);
+        assert(record.args[0].intValue == BINARY_LOG_MAGIC);
+        assert(record.args[1].intValue == BINARY_LOG_VERSION);
+        assert(reader.wallClock(record) >= before && reader.wallClock(record) <= after);
+        const uint32_t threadId = record.threadId;
+
+        assert(reader.next(record) == BinaryLogReader::RECORD);
+        assert(record.messageId == MSG_VERIFICATION_RESULT);
+        assert(record.level == Logger::INFO);
+        assert(record.threadId == threadId);
+        assert(record.argCount == 3);
+        assert(record.argTypes[0] == ARG_TEXT && record.argTypes[1] == ARG_INT &&
+               record.argTypes[2] == ARG_INT && record.argTypes[3] == ARG_NONE);
+        assert(BinaryLogReader::formatArgument(record, 0) == "P12345678");
+        assert(record.args[1].intValue == static_cast<int>(VerificationSystem::MANUAL_REVIEW));
+        assert(record.args[2].intValue == 1234);
+        assert(reader.wallClock(record) >= before && reader.wallClock(record) <= after);
+        assert(BinaryLogReader::renderMessage(record) ==
+               "Verification of P12345678 finished with result " +
+               std::to_string(static_cast<int>(VerificationSystem::MANUAL_REVIEW)) + " in 1234 us");
+
+        assert(reader.next(record) == BinaryLogReader::RECORD);
+        assert(record.messageId == MSG_DEVICE_STAGES);
+        assert(record.level == Logger::DEBUG);
+        assert(record.argCount == 1);
+        assert(record.argTypes[0] == ARG_INT && record.argTypes[1] == ARG_NONE);
+        assert(record.args[0].intValue == 42);
+        assert(BinaryLogReader::renderMessage(record) == "Device stages completed in 42 ms");
+
+        assert(reader.next(record) == BinaryLogReader::RECORD);
+        assert(record.messageId == MSG_LANE_REPORT);
+        assert(record.level == Logger::INFO);
+        assert(record.argCount == 3);
+        assert(record.argTypes[0] == ARG_INT && record.argTypes[1] == ARG_DOUBLE &&
+               record.argTypes[2] == ARG_DOUBLE);
+        assert(record.args[0].intValue == 500);
+        assert(record.args[1].doubleValue == 12.5);
+        assert(record.args[2].doubleValue == 40.0);
+        assert(BinaryLogReader::renderMessage(record) ==
+               "Lane report: 500 passengers in 12.50 s (40.00 passengers/s)");
+
+        assert(reader.next(record) == BinaryLogReader::RECORD);
+        assert(record.level == Logger::WARNING);
+        assert(BinaryLogReader::formatArgument(record, 0) == "ABCDEFGHIJKLMNOP");
+        assert(record.args[1].intValue == -1);
+        assert(record.args[2].intValue == -7);
+    }
+    assert(reader.next(record) == BinaryLogReader::END);
+    in.close();
+
+    // A record cut short by a crash: whole header, part of the arguments
+    const size_t completeSize = std::filesystem::file_size(path);
+    {
+        Logger logger(textPath);
+        assert(logger.enableBinaryLog(path));
+        logger.logBinary(Logger::INFO, MSG_DEVICE_STAGES, static_cast<int64_t>(99));
+        logger.logBinary(Logger::INFO, MSG_LANE_REPORT, static_cast<uint64_t>(1), 2.0, 3.0);
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) -
+                                       sizeof(BinaryLogRecord::Argument));
+
+    std::ifstream truncated(path, std::ios::binary);
+    BinaryLogReader tail(truncated);
+    size_t records = 0;
+    BinaryLogReader::Status status;
+    while ((status = tail.next(record)) == BinaryLogReader::RECORD) {
+        ++records;
+    }
+    assert(status == BinaryLogReader::TRUNCATED);
+    // 2 x 5 records, the new session and the device record survive
+    assert(records == 12);
+    assert(record.messageId == MSG_LANE_REPORT);
+    assert(tail.getOffset() > completeSize);
+    truncated.close();
+
+    // Cut inside the header of that record instead
+    std::filesystem::resize_file(path, tail.getOffset() + 10);
+    std::ifstream shortHeader(path, std::ios::binary);
+    BinaryLogReader headerTail(shortHeader);
+    records = 0;
+    while ((status = headerTail.next(record)) == BinaryLogReader::RECORD) {
+        ++records;
+    }
+    assert(status == BinaryLogReader::TRUNCATED);
+    assert(records == 12);
+    shortHeader.close();
+
+    std::remove(path.c_str());
+    std::remove(textPath.c_str());
+    std::cout << "✓ Binary log tests passed\n";
+}
+
+// Holds scheduler workers inside a task until opened, so what is still
+// queued, and which worker is free, is known exactly
+class TaskGate {
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool open = false;
+    size_t waiting = 0;
+
+public:
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++waiting;
+        changed.notify_all();
+        changed.wait(lock, [this] { return open; });
+        --waiting;
+    }
+
+    void waitForWaiters(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this, count] { return waiting >= count; });
+    }
+
+    void setOpen() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        changed.notify_all();
+    }
+};
+
+// Which tasks ran, in what order, on which thread
+class ExecutionLog {
+    std::mutex mutex;
+    std::condition_variable changed;
+
+public:
+    std::vector<std::string> names;
+    std::vector<std::thread::id> threads;
+
+    void record(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        names.push_back(name);
+        threads.push_back(std::this_thread::get_id());
+        changed.notify_all();
+    }
+
+    void waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this, count] { return names.size() >= count; });
+    }
+};
+
+void testLaneScheduler() {
+    std::cout << "Testing Lane Scheduler...\n";
+
+    // Priority classes: with the only worker held, the queue is served
+    // class by class, arrival order within a class
+    {
+        LaneScheduler scheduler(1, 1);
+        TaskGate hold;
+        ExecutionLog log;
+        scheduler.start();
+        assert(scheduler.submit(0, LaneScheduler::STANDARD, [&] { hold.wait(); return true; }));
+        hold.waitForWaiters(1);
+
+        const std::pair<const char*, LaneScheduler::PriorityClass> arrivals[] = {
+            {"standard1", LaneScheduler::STANDARD}, {"egate1", LaneScheduler::EGATE},
+            {"diplomatic1", LaneScheduler::DIPLOMATIC}, {"crew1", LaneScheduler::CREW},
+            {"standard2", LaneScheduler::STANDARD}, {"crew2", LaneScheduler::CREW}};
+        for (const auto& arrival : arrivals) {
+            std::string name = arrival.first;
+            assert(scheduler.submit(0, arrival.second, [&log, name] {
+                log.record(name);
+                return name != "standard2";
+            }));
+        }
+        assert(!scheduler.submit(0, LaneScheduler::PRIORITY_CLASS_COUNT, [] { return true; }));
+        assert(!scheduler.submit(0, LaneScheduler::STANDARD, LaneScheduler::Task()));
+
+        hold.setOpen();
+        scheduler.waitIdle();
+        const std::vector<std::string> expected = {"crew1", "crew2", "diplomatic1", "egate1",
+                                                   "standard1", "standard2"};
+        assert(log.names == expected);
+
+        auto stats = scheduler.getStatistics();
+        assert(stats.submitted == 7 && stats.processed == 7 && stats.succeeded == 6);
+        assert(stats.stolen == 0);
+        assert((stats.processedPerClass == std::vector<uint64_t>{2, 1, 1, 3}));
+    }
+
+    // Stealing: lane 0's worker is held, lane 1's worker is released with
+    // an empty home lane and takes lane 0's queue from the tail
+    {
+        LaneScheduler scheduler(2, 2);
+        TaskGate homeHold;
+        TaskGate thiefHold;
+        ExecutionLog log;
+        // Queued before start, so each worker finds its own lane's task first
+        scheduler.submit(0, LaneScheduler::STANDARD, [&] { log.record("home"); homeHold.wait(); return true; });
+        scheduler.submit(1, LaneScheduler::STANDARD, [&] { log.record("thief"); thiefHold.wait(); return true; });
+        scheduler.start();
+        homeHold.waitForWaiters(1);
+        thiefHold.waitForWaiters(1);
+        log.waitFor(2);
+        const std::thread::id homeThread = log.names[0] == "home" ? log.threads[0] : log.threads[1];
+        const std::thread::id thiefThread = log.names[0] == "thief" ? log.threads[0] : log.threads[1];
+        assert(homeThread != thiefThread);
+
+        for (std::string name : {"standard1", "standard2", "standard3"}) {
+            scheduler.submit(0, LaneScheduler::STANDARD, [&log, name] { log.record(name); return true; });
+        }
+        scheduler.submit(0, LaneScheduler::CREW, [&log] { log.record("crew1"); return true; });
+
+        thiefHold.setOpen();
+        log.waitFor(6);
+        const std::vector<std::string> stolenOrder = {"crew1", "standard3", "standard2", "standard1"};
+        assert(std::vector<std::string>(log.names.begin() + 2, log.names.end()) == stolenOrder);
+        for (size_t i = 2; i < log.threads.size(); ++i) {
+            assert(log.threads[i] == thiefThread);
+        }
+
+        homeHold.setOpen();
+        scheduler.waitIdle();
+        auto stats = scheduler.getStatistics();
+        assert(stats.processed == 6 && stats.stolen == 4);
+        // Counted against the lane the passenger queued at
+        assert((stats.processedPerLane == std::vector<uint64_t>{5, 1}));
+    }
+
+    // waitIdle() returns only once the queue is empty, stop() lets the
+    // workers finish what is still queued
+    {
+        LaneScheduler scheduler(1, 1);
+        TaskGate hold;
+        ExecutionLog log;
+        scheduler.start();
+        scheduler.submit(0, LaneScheduler::STANDARD, [&] { hold.wait(); return true; });
+        hold.waitForWaiters(1);
+        for (int i = 0; i < 10; ++i) {
+            std::string name = "idle" + std::to_string(i);
+            scheduler.submit(0, LaneScheduler::EGATE, [&log, name] { log.record(name); return true; });
+        }
+
+        std::atomic<bool> idle(false);
+        std::thread waiter([&] { scheduler.waitIdle(); idle = true; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(!idle);
+        hold.setOpen();
+        waiter.join();
+        assert(log.names.size() == 10);
+        assert(scheduler.getStatistics().processed == 11);
+    }
+    {
+        LaneScheduler scheduler(1, 1);
+        TaskGate hold;
+        ExecutionLog log;
+        scheduler.start();
+        scheduler.submit(0, LaneScheduler::STANDARD, [&] { hold.wait(); return true; });
+        hold.waitForWaiters(1);
+        for (int i = 0; i < 10; ++i) {
+            std::string name = "queued" + std::to_string(i);
+            scheduler.submit(0, LaneScheduler::STANDARD, [&log, name] { log.record(name); return true; });
+        }
+
+        std::atomic<bool> stopped(false);
+        std::thread stopper([&] { scheduler.stop(); stopped = true; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(!stopped);
+        assert(!scheduler.isRunning());
+        hold.setOpen();
+        stopper.join();
+        assert(log.names.size() == 10);
+        for (int i = 0; i < 10; ++i) {
+            assert(log.names[i] == "queued" + std::to_string(i));
+        }
+        auto stats = scheduler.getStatistics();
+        assert(stats.submitted == 11 && stats.processed == 11);
+        // Stopping twice is harmless
+        scheduler.stop();
+
+        // After stop() nothing is queued, so waitIdle() cannot hang
+        assert(!scheduler.submit(0, LaneScheduler::CREW, [&log] { log.record("late"); return true; }));
+        scheduler.waitIdle();
+        assert(scheduler.getStatistics().submitted == 11);
+
+        // A restarted scheduler takes work again
+        scheduler.start();
+        assert(scheduler.submit(0, LaneScheduler::CREW, [&log] { log.record("restarted"); return true; }));
+        scheduler.waitIdle();
+        assert(log.names.size() == 11 && log.names.back() == "restarted");
+    }
+
+    std::cout << "✓ Lane scheduler tests passed\n";
+}
+
+// Booth devices for runDevicePipeline: no bring-up or read delays, and
+// every stage waits until all three have started, so they only complete
+// when they run concurrently. failingStage throws from that stage.
+class StubDevices : public HardwareInterface {
+    FramePool frames;
+    std::mutex mutex;
+    std::condition_variable changed;
+    int started = 0;
+
+    // False if the other stages never started alongside this one
+    bool enterStage() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++started;
+        changed.notify_all();
+        return changed.wait_for(lock, std::chrono::seconds(10), [this] { return started >= 3; });
+    }
+
+public:
+    std::string failingStage;
+    std::atomic<int> overlapped{0};
+    std::string savedLabel;
+
+    StubDevices() : HardwareInterface(DEFERRED), frames(64, 48, 3, 2) {}
+
+    std::shared_ptr<ScanData> scanDocument() override {
+        overlapped += enterStage();
+        if (failingStage == "scan") {
+            throw std::runtime_error("scanner jammed");
+        }
+        return simulateMRZScan();
+    }
+
+    CameraImage captureImage() override {
+        overlapped += enterStage();
+        if (failingStage == "camera") {
+            throw std::runtime_error("camera disconnected");
+        }
+        CameraImage image;
+        image.frame = frames.acquire();
+        image.width = frames.getWidth();
+        image.height = frames.getHeight();
+        image.channels = frames.getChannels();
+        image.format = "RAW";
+        std::memset(image.frame.data(), 0x80, image.frame.size());
+        return image;
+    }
+
+    std::future<bool> saveImage(const CameraImage& image, const std::string& label,
+                                ImageStore::Callback) override {
+        savedLabel = label;
+        std::promise<bool> stored;
+        stored.set_value(static_cast<bool>(image));
+        return stored.get_future();
+    }
+
+    std::shared_ptr<RFIDData> readRFIDChip() override {
+        overlapped += enterStage();
+        if (failingStage == "rfid") {
+            throw std::runtime_error("RFID reader timed out");
+        }
+        return std::make_shared<RFIDData>();
+    }
+};
+
+void testDevicePipeline() {
+    std::cout << "Testing Device Pipeline...\n";
+
+    // All three stages run at once and their readings are joined
+    {
+        auto devices = std::make_unique<StubDevices>();
+        StubDevices& stub = *devices;
+        PassportControlSystem system(std::move(devices));
+        auto readings = system.runDevicePipeline();
+        assert(stub.overlapped == 3);
+        assert(readings.passport && readings.passport->getPassportNumber() == "P12345678");
+        assert(readings.photo && readings.photo.width == 64);
+        assert(readings.chip);
+        // The photo is filed under the number from the concurrent scan
+        assert(stub.savedLabel == "P12345678");
+    }
+
+    // A stage that throws: the caller gets its exception, after the other
+    // stages have finished
+    for (std::string failing : {"scan", "camera", "rfid"}) {
+        auto devices = std::make_unique<StubDevices>();
+        StubDevices& stub = *devices;
+        stub.failingStage = failing;
+        PassportControlSystem system(std::move(devices));
+        std::string caught;
+        try {
+            system.runDevicePipeline();
+        } catch (const std::runtime_error& e) {
+            caught = e.what();
+        }
+        assert(stub.overlapped == 3);
+        if (failing == "scan") {
+            assert(caught == "scanner jammed");
+            assert(stub.savedLabel.empty());
+        } else if (failing == "camera") {
+            assert(caught == "camera disconnected");
+        } else {
+            assert(caught == "RFID reader timed out");
+        }
+    }
+
+    std::cout << "✓ Device pipeline tests passed\n";
+}
+
+// Counts device bring-ups; each waits at the gate, so callers that come
+// while a device is still coming up pile up behind it
+class StubBringUp : public HardwareInterface {
+    const bool cameraThrows;
+    const bool scannerFails;
+
+public:
+    TaskGate gate;
+    std::atomic<int> cameraConnects{0};
+    std::atomic<int> scannerConnects{0};
+    std::atomic<int> rfidConnects{0};
+
+    explicit StubBringUp(InitializationMode mode, bool cameraThrows = false, bool scannerFails = false)
+        : HardwareInterface(DEFERRED), cameraThrows(cameraThrows), scannerFails(scannerFails) {
+        if (mode == EAGER) {
+            startHardwareInitialization();
+        }
+    }
+
+    ~StubBringUp() { finishInitialization(); }
+
+protected:
+    bool connectCamera() override {
+        cameraConnects++;
+        gate.wait();
+        if (cameraThrows) {
+            throw std::runtime_error("camera firmware mismatch");
+        }
+        return true;
+    }
+
+    bool connectScanner() override {
+        scannerConnects++;
+        gate.wait();
+        return !scannerFails;
+    }
+
+    bool connectRFIDReader() override {
+        rfidConnects++;
+        gate.wait();
+        return true;
+    }
+};
+
+bool isResolved(const std::shared_future<bool>& ready) {
+    return ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void testHardwareBringUp() {
+    std::cout << "Testing Hardware Bring-Up...\n";
+
+    // EAGER: all devices start coming up on construction; callers that
+    // arrive meanwhile wait for that bring-up instead of starting another
+    {
+        StubBringUp hardware(HardwareInterface::EAGER);
+        hardware.gate.waitForWaiters(3);
+        std::vector<int> results(8, -1);
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 8; ++i) {
+            callers.emplace_back([&hardware, &results, i] {
+                if (i % 2 == 0) {
+                    results[i] = hardware.cameraReady().get() && hardware.scannerReady().get() &&
+                                 hardware.rfidReaderReady().get();
+                } else {
+                    hardware.startHardwareInitialization();
+                    results[i] = hardware.initializeCamera() && hardware.initializeScanner() &&
+                                 hardware.initializeRFIDReader();
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(!isResolved(hardware.cameraReady()));
+        assert(!hardware.isCameraAvailable());
+        hardware.gate.setOpen();
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        assert((results == std::vector<int>(8, 1)));
+        assert(hardware.cameraConnects == 1 && hardware.scannerConnects == 1 && hardware.rfidConnects == 1);
+        assert(hardware.isCameraAvailable() && hardware.isScannerAvailable() && hardware.isRFIDReaderAvailable());
+        assert(hardware.initializeCamera());
+        assert(hardware.cameraConnects == 1);
+    }
+
+    // DEFERRED: nothing comes up until a device is needed, and then only
+    // that device, once however many callers need it
+    {
+        StubBringUp hardware(HardwareInterface::DEFERRED);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(hardware.cameraConnects == 0 && hardware.scannerConnects == 0 && hardware.rfidConnects == 0);
+        assert(!isResolved(hardware.cameraReady()));
+
+        std::vector<int> results(8, -1);
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 8; ++i) {
+            callers.emplace_back([&hardware, &results, i] { results[i] = hardware.initializeScanner(); });
+        }
+        hardware.gate.waitForWaiters(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(hardware.scannerConnects == 1);
+        hardware.gate.setOpen();
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        assert((results == std::vector<int>(8, 1)));
+        assert(hardware.scannerConnects == 1);
+        assert(hardware.cameraConnects == 0 && hardware.rfidConnects == 0);
+        assert(!isResolved(hardware.rfidReaderReady()));
+
+        // Starting the rest later, from several threads, still brings each up once
+        std::vector<std::thread> starters;
+        for (int i = 0; i < 4; ++i) {
+            starters.emplace_back([&hardware] { hardware.startHardwareInitialization(); });
+        }
+        for (auto& starter : starters) {
+            starter.join();
+        }
+        assert(hardware.cameraReady().get() && hardware.rfidReaderReady().get());
+        assert(hardware.cameraConnects == 1 && hardware.scannerConnects == 1 && hardware.rfidConnects == 1);
+    }
+
+    // A failed bring-up, by error or by exception, resolves the readiness
+    // future to false for every waiter and is not retried
+    {
+        StubBringUp hardware(HardwareInterface::EAGER, true, true);
+        std::vector<int> camera(4, -1);
+        std::vector<int> scanner(4, -1);
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 4; ++i) {
+            callers.emplace_back([&hardware, &camera, &scanner, i] {
+                camera[i] = hardware.cameraReady().get();
+                scanner[i] = hardware.initializeScanner();
+            });
+        }
+        hardware.gate.setOpen();
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        assert((camera == std::vector<int>(4, 0)));
+        assert((scanner == std::vector<int>(4, 0)));
+        assert(!hardware.isCameraAvailable() && !hardware.isScannerAvailable());
+        assert(hardware.rfidReaderReady().get() && hardware.isRFIDReaderAvailable());
+        assert(!hardware.initializeCamera());
+        assert(!hardware.captureImage());
+        assert(hardware.scanDocument() == nullptr);
+        assert(hardware.cameraConnects == 1 && hardware.scannerConnects == 1 && hardware.rfidConnects == 1);
+    }
+
+    std::cout << "✓ Hardware bring-up tests passed\n";
+}
+
 int main() {
     Logger logger("test.log");
     logger.info("Starting Passport tests");
     
     try {
         testPassportCreation();
+        testMrzParser();
+        testMrzChecksum();
+        testMrzCharset();
+        testMrzReader();
+        testMrzCorrector();
+        testPassportRecord();
+        testDates();
+        testVisaRules();
+        testVerificationPipeline();
+        testVerdictCache();
+        testBatchVerification();
+        testPassengerManifest();
+        testFramePool();
+        testImageStore();
+        testFaceMatcher();
+        testFaceWatchlistIndex();
+        testSha256();
+        testLdsDocument();
+        testPersonnelStore();
+        testStolenDocumentIndex();
+        testNameWatchlist();
+        testAsyncLogger();
+        testBinaryLog();
+        testLaneScheduler();
+        testDevicePipeline();
+        testHardwareBringUp();
         testJSONOutput();
         testXMLOutput();
         testValidation();